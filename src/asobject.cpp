@@ -157,22 +157,12 @@ TRISTATE ASObject::isLess(ASObject* r)
 
 int variables_map::getNextEnumerable(unsigned int start) const
 {
-	if(start>=Variables.size())
-		return -1;
-
-	const_var_iterator it=Variables.begin()+start;
-
-	unsigned int i=start;
-
-	while(it->second.kind!=DYNAMIC_TRAIT || !it->second.isenumerable)
+	for(unsigned int i=start;i<values.size();i++)
 	{
-		++i;
-		++it;
-		if(it==Variables.end())
-			return -1;
+		if(values[i].kind==DYNAMIC_TRAIT && values[i].isenumerable)
+			return i;
 	}
-
-	return i;
+	return -1;
 }
 
 uint32_t ASObject::nextNameIndex(uint32_t cur_index)
@@ -443,24 +433,125 @@ bool ASObject::isConstructed() const
 {
 	return traitsInitialized && constructIndicator;
 }
+/* Maps with more variables than this get a private shape, to avoid
+ * creating a new shared shape for every variable of big dictionary-like objects */
+#define MAX_SHARED_SHAPE_SIZE 64
+/* Shapes with more distinct transitions than this are not extended anymore,
+ * objects adding variables in many different orders get a private shape */
+#define MAX_SHAPE_TRANSITIONS 16
+/* Global limit on the shared shapes, since the tree is never pruned */
+#define MAX_SHARED_SHAPES 65536
+
+static Mutex shapeTransitionsMutex;
+//Number of shared shapes in the tree, protected by shapeTransitionsMutex
+static uint32_t sharedShapesCount=0;
+
+variables_shape* variables_shape::getEmptyShape()
+{
+	static variables_shape emptyShape(true);
+	return &emptyShape;
+}
+
+variables_shape::~variables_shape()
+{
+	for(auto it=transitions.begin();it!=transitions.end();++it)
+		delete it->second;
+}
+
+variables_shape* variables_shape::getTransition(const varName& n, uint32_t pos)
+{
+	assert(shared);
+	Locker l(shapeTransitionsMutex);
+	auto it=transitions.find(n);
+	if(it!=transitions.end())
+		return it->second;
+	if(transitions.size()>=MAX_SHAPE_TRANSITIONS || sharedShapesCount>=MAX_SHARED_SHAPES)
+		return NULL;
+	sharedShapesCount++;
+	variables_shape* ret=new variables_shape(true);
+	ret->names.reserve(names.size()+1);
+	ret->names.insert(ret->names.end(),names.begin(),names.begin()+pos);
+	ret->names.push_back(n);
+	ret->names.insert(ret->names.end(),names.begin()+pos,names.end());
+	transitions.insert(make_pair(n,ret));
+	return ret;
+}
+
 variables_map::variables_map(MemoryAccount* m):
-	Variables(std::less<mapType::key_type>(), reporter_allocator<mapType::value_type>(m)),slots_vars()
+	shape(variables_shape::getEmptyShape()),values(reporter_allocator<variable>(m)),slots_vars()
+{
+}
+
+void variables_map::makeShapePrivate()
+{
+	if(shape->isShared())
+		shape=new variables_shape(*shape);
+}
+
+variable* variables_map::insertVar(const varName& n, const variable& v)
+{
+	uint32_t pos=shape->lowerBound(n);
+	variables_shape* next=NULL;
+	if(shape->isShared() && shape->size()<MAX_SHARED_SHAPE_SIZE)
+		next=shape->getTransition(n,pos);
+	if(next)
+		shape=next;
+	else
+	{
+		makeShapePrivate();
+		shape->names.insert(shape->names.begin()+pos,n);
+	}
+	return &*values.insert(values.begin()+pos,v);
+}
+
+void variables_map::eraseVar(uint32_t pos)
 {
+	//Deleting variables is uncommon, so no transitions are kept for it
+	makeShapePrivate();
+	shape->names.erase(shape->names.begin()+pos);
+	values.erase(values.begin()+pos);
+}
+
+void variables_map::copyFrom(const variables_map& r)
+{
+	for(auto it=r.values.begin();it!=r.values.end();++it)
+	{
+		if(it->var)
+			it->var->incRef();
+		if(it->getter)
+			it->getter->incRef();
+		if(it->setter)
+			it->setter->incRef();
+	}
+	if(values.empty())
+	{
+		//Share the shape, or copy it if it's private
+		if(r.shape->isShared())
+			shape=r.shape;
+		else
+			shape=new variables_shape(*r.shape);
+		values.assign(r.values.begin(),r.values.end());
+	}
+	else
+	{
+		for(uint32_t i=0;i<r.values.size();i++)
+			insertVar(r.shape->getName(i),r.values[i]);
+	}
 }
 
 variable* variables_map::findObjVar(uint32_t nameId, const nsNameAndKind& ns, TRAIT_KIND createKind, uint32_t traitKinds)
 {
-	var_iterator ret=Variables.lower_bound(nameId);
-	while(ret!=Variables.end() && ret->first == nameId)
+	uint32_t ret=shape->lowerBound(nameId);
+	while(ret<shape->size() && shape->getName(ret).nameId == nameId)
 	{
-		if (ret->second.ns == ns)
+		if (shape->getName(ret).ns == ns)
 		{
-			if(!(ret->second.kind & traitKinds))
+			if(!(values[ret].kind & traitKinds))
 			{
 				assert(createKind==NO_CREATE_TRAIT);
 				return NULL;
 			}
-			return &ret->second;
+			return &values[ret];
 		}
 		ret++;
 	}
@@ -469,10 +560,7 @@ variable* variables_map::findObjVar(uint32_t nameId, const nsNameAndKind& ns, TR
 	if(createKind==NO_CREATE_TRAIT)
 		return NULL;
 
-	if (Variables.capacity() == Variables.size())
-		Variables.reserve(Variables.capacity()+8);
-	var_iterator inserted=Variables.insert(Variables.cbegin(),make_pair(nameId, variable(createKind,ns)) );
-	return &inserted->second;
+	return insertVar(varName(nameId,ns),variable(createKind));
 }
 
 bool ASObject::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype)
@@ -694,6 +782,11 @@ void ASObject::setVariableByMultiname(const multiname& name, ASObject* o, CONST_
 		++varcount;
 	}
 
+	setValueOfVariable(obj,o);
+}
+
+void ASObject::setValueOfVariable(variable* obj, ASObject* o)
+{
 	if(obj->setter)
 	{
 		//Call the setter
@@ -714,6 +807,30 @@ void ASObject::setVariableByMultiname(const multiname& name, ASObject* o, CONST_
 	}
 }
 
+bool ASObject::setVariableByMultinameCached(const multiname& name, ASObject* o, inline_cache* ic)
+{
+	if(!canUseInlineCache(name))
+		return false;
+	bool borrowed=false;
+	variable* obj=findInlineCached(name, ic, borrowed);
+	if(!obj)
+	{
+		//Cache miss, remember where the variable is for the next time
+		obj=varcount ? Variables.findObjVar(getSystemState(),name,NO_CREATE_TRAIT,DECLARED_TRAIT|DYNAMIC_TRAIT) : NULL;
+		borrowed=(obj==NULL);
+		if(borrowed)
+			obj=classdef->borrowedVariables.findObjVar(getSystemState(),name,NO_CREATE_TRAIT,DECLARED_TRAIT|DYNAMIC_TRAIT);
+		if(!obj)
+			return false;
+		fillInlineCache(ic, obj, borrowed);
+	}
+	//Constants, methods and read-only properties raise errors in the generic path
+	if(borrowed ? obj->setter==NULL : ((obj->kind!=DECLARED_TRAIT && obj->kind!=DYNAMIC_TRAIT) || !(obj->setter || obj->var)))
+		return false;
+	setValueOfVariable(obj,o);
+	return true;
+}
+
 void ASObject::setVariableByQName(const tiny_string& name, const tiny_string& ns, ASObject* o, TRAIT_KIND traitKind, bool isEnumerable)
 {
 	const nsNameAndKind tmpns(getSystemState(),ns, NAMESPACE);
@@ -742,8 +859,8 @@ void ASObject::initializeVariableByMultiname(const multiname& name, ASObject* o,
 	++varcount;
 }
 
-variable::variable(TRAIT_KIND _k, ASObject* _v, multiname* _t, const Type* _type, const nsNameAndKind& _ns, bool _isenumerable)
-		: var(_v),typeUnion(NULL),setter(NULL),getter(NULL),ns(_ns),kind(_k),traitState(NO_STATE),isenumerable(_isenumerable),issealed(false)
+variable::variable(TRAIT_KIND _k, ASObject* _v, multiname* _t, const Type* _type, bool _isenumerable)
+		: var(_v),typeUnion(NULL),setter(NULL),getter(NULL),kind(_k),traitState(NO_STATE),isenumerable(_isenumerable),issealed(false)
 {
 	if(_type)
 	{
@@ -790,17 +907,17 @@ void variables_map::killObjVar(SystemState* sys,const multiname& mname)
 	//The namespaces in the multiname are ordered. So it's possible to use lower_bound
 	//to find the first candidate one and move from it
 	assert(!mname.ns.empty());
-	var_iterator ret=Variables.lower_bound(name);
+	uint32_t ret=shape->lowerBound(name);
 	auto nsIt=mname.ns.begin();
 
 	//Find the namespace
-	while(ret!=Variables.end() && ret->first==name)
+	while(ret<shape->size() && shape->getName(ret).nameId==name)
 	{
 		//breaks when the namespace is not found
-		const nsNameAndKind& ns=ret->second.ns;
+		const nsNameAndKind& ns=shape->getName(ret).ns;
 		if(ns==*nsIt)
 		{
-			Variables.erase(ret);
+			eraseVar(ret);
 			return;
 		}
 		else
@@ -821,18 +938,18 @@ variable* variables_map::findObjVar(SystemState* sys,const multiname& mname, TRA
 	uint32_t name=mname.normalizedNameId(sys);
 	assert(!mname.ns.empty());
 
-	var_iterator ret=Variables.lower_bound(name);
+	uint32_t ret=shape->lowerBound(name);
 	auto nsIt=mname.ns.begin();
 
 	//Find the namespace
-	while(ret!=Variables.end() && ret->first==name)
+	while(ret<shape->size() && shape->getName(ret).nameId==name)
 	{
 		//breaks when the namespace is not found
-		const nsNameAndKind& ns=ret->second.ns;
+		const nsNameAndKind& ns=shape->getName(ret).ns;
 		if(ns==*nsIt)
 		{
-			if(ret->second.kind & traitKinds)
-				return &ret->second;
+			if(values[ret].kind & traitKinds)
+				return &values[ret];
 			else
 				return NULL;
 		}
@@ -850,20 +967,14 @@ variable* variables_map::findObjVar(SystemState* sys,const multiname& mname, TRA
 	//Name not present, insert it, if the multiname has a single ns and if we have to insert it
 	if(createKind==NO_CREATE_TRAIT)
 		return NULL;
-	if (Variables.capacity() == Variables.size())
-		Variables.reserve(Variables.capacity()+8);
 	if(createKind == DYNAMIC_TRAIT)
 	{
 		if(!mname.hasEmptyNS)
 			throwError<ReferenceError>(kWriteSealedError, mname.normalizedNameUnresolved(sys), "" /* TODO: class name */);
-		var_iterator inserted=Variables.insert(Variables.cbegin(),
-			make_pair(name,variable(createKind,nsNameAndKind())));
-		return &inserted->second;
+		return insertVar(varName(name,nsNameAndKind()),variable(createKind));
 	}
 	assert(mname.ns.size() == 1);
-	var_iterator inserted=Variables.insert(Variables.cbegin(),
-		make_pair(name,variable(createKind,mname.ns[0])));
-	return &inserted->second;
+	return insertVar(varName(name,mname.ns[0]),variable(createKind));
 }
 
 void variables_map::initializeVar(const multiname& mname, ASObject* obj, multiname* typemname, ABCContext* context, TRAIT_KIND traitKind, ASObject* mainObj, uint32_t slot_id,bool isenumerable)
@@ -920,9 +1031,7 @@ void variables_map::initializeVar(const multiname& mname, ASObject* obj, multina
 	assert(traitKind==DECLARED_TRAIT || traitKind==CONSTANT_TRAIT || traitKind == INSTANCE_TRAIT);
 
 	uint32_t name=mname.normalizedNameId(mainObj->getSystemState());
-	if (Variables.capacity() == Variables.size())
-		Variables.reserve(Variables.capacity()+8);
-	Variables.insert(Variables.cbegin(),make_pair(name, variable(traitKind, obj, typemname, type,mname.ns[0],isenumerable)));
+	insertVar(varName(name,mname.ns[0]),variable(traitKind, obj, typemname, type, isenumerable));
 	if (slot_id)
 		initSlot(slot_id,name, mname.ns[0]);
 }
@@ -1179,6 +1288,11 @@ _NR<ASObject> ASObject::getVariableByMultiname(const multiname& name, GET_VARIAB
 			throwError<TypeError>(kCallOfNonFunctionError,name.normalizedNameUnresolved(getSystemState()));
 	}
 
+	return getValueOfVariable(obj,name);
+}
+
+_NR<ASObject> ASObject::getValueOfVariable(const variable* obj, const multiname& name)
+{
 	if(obj->getter)
 	{
 		//Call the getter
@@ -1213,6 +1327,101 @@ _NR<ASObject> ASObject::getVariableByMultiname(const multiname& name, GET_VARIAB
 	}
 }
 
+bool ASObject::getVariableByMultinameCached(const multiname& name, inline_cache* ic, _NR<ASObject>& ret)
+{
+	if(!canUseInlineCache(name))
+		return false;
+	bool borrowed=false;
+	const variable* obj=findInlineCached(name, ic, borrowed);
+	if(!obj)
+	{
+		//Cache miss, remember where the variable is for the next time
+		obj=varcount ? Variables.findObjVar(getSystemState(),name,name.hasEmptyNS ? DECLARED_TRAIT|DYNAMIC_TRAIT : DECLARED_TRAIT) : NULL;
+		borrowed=(obj==NULL);
+		if(borrowed)
+			obj=classdef->findBorrowedGettable(name);
+		//Properties of the prototype chain are not cached, since the chain can be modified
+		if(!obj)
+			return false;
+		fillInlineCache(ic, obj, borrowed);
+	}
+	//It seems valid for a class to redefine only the setter, the generic path looks further
+	if(!(obj->getter || obj->var) || (!borrowed && !name.hasEmptyNS && obj->kind==DYNAMIC_TRAIT))
+		return false;
+	ret=getValueOfVariable(obj,name);
+	return true;
+}
+
+bool ASObject::canUseInlineCache(const multiname& name) const
+{
+	//Objects with the same shape have the same variables at the same positions.
+	//Other types may override the lookup, so only plain objects are cached.
+	return classdef && type==T_OBJECT && subtype!=SUBTYPE_PROXY &&
+		name.name_type==multiname::NAME_STRING && !name.ns.empty();
+}
+
+variable* ASObject::findInlineCached(const multiname& name, inline_cache* ic, bool& borrowed)
+{
+	const variables_shape* shape=Variables.shape;
+	for(uint32_t i=0;i<INLINE_CACHE_SIZE;i++)
+	{
+		const inline_cache_entry& e=ic->entries[i];
+		if(e.cls!=classdef || e.shape!=shape || e.nameId!=name.name_s_id)
+			continue;
+		//The namespaces of runtime qualified names can change between accesses
+		bool nsMatches=false;
+		for(auto it=name.ns.begin();it!=name.ns.end();++it)
+		{
+			if(it->nsId==e.nsId)
+			{
+				nsMatches=true;
+				break;
+			}
+		}
+		if(!nsMatches)
+			continue;
+		borrowed=e.borrowed;
+		if(!borrowed)
+			return &Variables.values[e.position];
+		//The shape guarantees that the object doesn't have its own variable,
+		//the borrowed variables are not shared and must be validated
+		return classdef->borrowedVariables.getValueAtIfMatches(e.position, name.name_s_id, e.nsId);
+	}
+	return NULL;
+}
+
+void ASObject::fillInlineCache(inline_cache* ic, const variable* v, bool borrowed)
+{
+	//Private shapes are modified in place, so they can't be used as keys
+	if(!Variables.shape->isShared())
+		return;
+	const variables_map& map=borrowed ? classdef->borrowedVariables : Variables;
+	uint32_t position=map.getPosition(v);
+	if(position==UINT32_MAX)
+		return;
+	uint32_t nameId=map.getNameIdAt(position);
+	//Reuse the entry of this shape and name if it is not valid anymore
+	uint32_t i=0;
+	for(;i<INLINE_CACHE_SIZE;i++)
+	{
+		const inline_cache_entry& e=ic->entries[i];
+		if(e.cls==classdef && e.shape==Variables.shape && e.nameId==nameId)
+			break;
+	}
+	if(i==INLINE_CACHE_SIZE)
+	{
+		i=ic->next;
+		ic->next=(ic->next+1)%INLINE_CACHE_SIZE;
+	}
+	inline_cache_entry& e=ic->entries[i];
+	e.cls=classdef;
+	e.shape=Variables.shape;
+	e.position=position;
+	e.nameId=nameId;
+	e.nsId=map.getNsAt(position).nsId;
+	e.borrowed=borrowed;
+}
+
 _NR<ASObject> ASObject::getVariableByMultiname(const tiny_string& name, std::list<tiny_string> namespaces)
 {
 	multiname varName(NULL);
@@ -1262,33 +1471,14 @@ void variables_map::check() const
 {
 	//Heavyweight stuff
 #ifdef EXPENSIVE_DEBUG
-	variables_map::const_var_iterator it=Variables.begin();
-	for(;it!=Variables.end();++it)
+	assert(shape->size()==values.size());
+	for(uint32_t i=1;i<values.size();i++)
 	{
-		variables_map::const_var_iterator next=it;
-		++next;
-		if(next==Variables.end())
-			break;
-
-		//No double definition of a single variable should exist
-		if(it->first==next->first && it->second.ns==next->second.ns)
+		//The names must be sorted, and no double definition of a single variable should exist
+		if(!(shape->getName(i-1)<shape->getName(i)))
 		{
-			if(it->second.var==NULL && next->second.var==NULL)
-				continue;
-
-			if(it->second.var==NULL || next->second.var==NULL)
-			{
-				LOG(LOG_INFO, it->first << " " << it->second.ns);
-				LOG(LOG_INFO, it->second.var << ' ' << it->second.setter << ' ' << it->second.getter);
-				LOG(LOG_INFO, next->second.var << ' ' << next->second.setter << ' ' << next->second.getter);
-				abort();
-			}
-
-			if(it->second.var->getObjectType()!=T_FUNCTION || next->second.var->getObjectType()!=T_FUNCTION)
-			{
-				LOG(LOG_INFO, it->first);
-				abort();
-			}
+			LOG(LOG_INFO, shape->getName(i).nameId << " " << shape->getName(i).ns);
+			abort();
 		}
 	}
 #endif
@@ -1296,11 +1486,11 @@ void variables_map::check() const
 
 void variables_map::dumpVariables() const
 {
-	const_var_iterator it=Variables.cbegin();
-	for(;it!=Variables.cend();++it)
+	for(uint32_t i=0;i<values.size();i++)
 	{
+		const variable& v=values[i];
 		const char* kind;
-		switch(it->second.kind)
+		switch(v.kind)
 		{
 			case DECLARED_TRAIT:
 				kind="Declared: ";
@@ -1317,29 +1507,35 @@ void variables_map::dumpVariables() const
 			case NO_CREATE_TRAIT:
 				assert(false);
 		}
-		LOG(LOG_INFO, kind <<  '[' << it->second.ns << "] "<<
-			getSys()->getStringFromUniqueId(it->first) << ' ' <<
-			it->second.var << ' ' << it->second.setter << ' ' << it->second.getter);
+		LOG(LOG_INFO, kind <<  '[' << getNsAt(i) << "] "<<
+			getSys()->getStringFromUniqueId(getNameIdAt(i)) << ' ' <<
+			v.var << ' ' << v.setter << ' ' << v.getter);
 	}
 }
 
 variables_map::~variables_map()
 {
 	destroyContents();
+	if(!shape->isShared())
+		delete shape;
 }
 
 void variables_map::destroyContents()
 {
-	const_var_iterator it=Variables.cbegin();
-	while(it!=Variables.cend())
+	//Detach the variables first, since decRef may access this map again
+	valuesType oldValues(values.get_allocator());
+	oldValues.swap(values);
+	if(!shape->isShared())
+		delete shape;
+	shape=variables_shape::getEmptyShape();
+	for(auto it=oldValues.begin();it!=oldValues.end();++it)
 	{
-		if(it->second.var)
-			it->second.var->decRef();
-		if(it->second.setter)
-			it->second.setter->decRef();
-		if(it->second.getter)
-			it->second.getter->decRef();
-		it = Variables.erase(it);
+		if(it->var)
+			it->var->decRef();
+		if(it->setter)
+			it->setter->decRef();
+		if(it->getter)
+			it->getter->decRef();
 	}
 }
 
@@ -1398,14 +1594,21 @@ bool ASObject::destruct()
 	return dodestruct;
 }
 
+variable* variables_map::findSlotVar(unsigned int n)
+{
+	const varName& name=slots_vars[n-1];
+	uint32_t pos=shape->lowerBound(name);
+	if(pos<shape->size() && shape->getName(pos)==name)
+		return &values[pos];
+	return NULL;
+}
+
 void variables_map::initSlot(unsigned int n, uint32_t nameId, const nsNameAndKind& ns)
 {
 	if(n>slots_vars.size())
 		slots_vars.resize(n+8);
 
-	var_iterator ret=Variables.find(nameId);
-
-	if(ret==Variables.end())
+	if(shape->lowerBound(nameId)==shape->size())
 	{
 		//Name not present, no good
 		throw RunTimeException("initSlot on missing variable");
@@ -1416,43 +1619,23 @@ void variables_map::initSlot(unsigned int n, uint32_t nameId, const nsNameAndKin
 ASObject *variables_map::getSlot(unsigned int n)
 {
 	assert_and_throw(n > 0 && n<=slots_vars.size());
-	var_iterator it = Variables.find(slots_vars[n-1].nameId);
-	while(it!=Variables.end() && it->first == slots_vars[n-1].nameId)
-	{
-		if (it->second.ns == slots_vars[n-1].ns)
-			return it->second.var;
-		it++;
-	}
-	return NULL;
+	variable* v=findSlotVar(n);
+	return v ? v->var : NULL;
 }
 void variables_map::setSlot(unsigned int n,ASObject* o)
 {
 	validateSlotId(n);
-	var_iterator it = Variables.find(slots_vars[n-1].nameId);
-	while(it!=Variables.end() && it->first == slots_vars[n-1].nameId)
-	{
-		if (it->second.ns == slots_vars[n-1].ns)
-		{
-			it->second.setVar(o);
-			return;
-		}
-		it++;
-	}
+	variable* v=findSlotVar(n);
+	if(v)
+		v->setVar(o);
 }
 
 void variables_map::setSlotNoCoerce(unsigned int n,ASObject* o)
 {
 	validateSlotId(n);
-	var_iterator it = Variables.find(slots_vars[n-1].nameId);
-	while(it!=Variables.end() && it->first == slots_vars[n-1].nameId)
-	{
-		if (it->second.ns == slots_vars[n-1].ns)
-		{
-			it->second.setVarNoCoerce(o);
-			return;
-		}
-		it++;
-	}
+	variable* v=findSlotVar(n);
+	if(v)
+		v->setVarNoCoerce(o);
 }
 
 void variables_map::validateSlotId(unsigned int n) const
@@ -1472,11 +1655,8 @@ void variables_map::validateSlotId(unsigned int n) const
 variable* variables_map::getValueAt(unsigned int index)
 {
 	//TODO: CHECK behaviour on overridden methods
-	if(index<Variables.size())
-	{
-		var_iterator it=Variables.begin()+index;
-		return &it->second;
-	}
+	if(index<values.size())
+		return &values[index];
 	else
 		throw RunTimeException("getValueAt out of bounds");
 }
@@ -1505,11 +1685,8 @@ _R<ASObject> ASObject::getValueAt(int index)
 tiny_string variables_map::getNameAt(SystemState *sys, unsigned int index) const
 {
 	//TODO: CHECK behaviour on overridden methods
-	if(index<Variables.size())
-	{
-		const_var_iterator it=Variables.begin()+index;
-		return sys->getStringFromUniqueId(it->first);
-	}
+	if(index<values.size())
+		return sys->getStringFromUniqueId(getNameIdAt(index));
 	else
 		throw RunTimeException("getNameAt out of bounds");
 }
@@ -1519,39 +1696,38 @@ unsigned int ASObject::numVariables() const
 	return varcount;
 }
 
-void ASObject::serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap) const
+void ASObject::serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t> traitsMap) const
 {
 	Variables.serialize(out, stringMap, objMap, traitsMap);
 }
 
-void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap) const
+void variables_map::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const
 {
 	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
 	//Pairs of name, value
-	auto it=Variables.begin();
-	for(;it!=Variables.end();it++)
+	for(uint32_t i=0;i<values.size();i++)
 	{
-		if(it->second.kind!=DYNAMIC_TRAIT)
+		if(values[i].kind!=DYNAMIC_TRAIT)
 			continue;
 		//Dynamic traits always have empty namespace
-		assert(it->second.ns.hasEmptyName());
+		assert(getNsAt(i).hasEmptyName());
 		if (amf0)
-			out->writeStringAMF0(out->getSystemState()->getStringFromUniqueId(it->first));
+			out->writeStringAMF0(out->getSystemState()->getStringFromUniqueId(getNameIdAt(i)));
 		else
-			out->writeStringVR(stringMap,out->getSystemState()->getStringFromUniqueId(it->first));
-		it->second.var->serialize(out, stringMap, objMap, traitsMap);
+			out->writeStringVR(stringMap,out->getSystemState()->getStringFromUniqueId(getNameIdAt(i)));
+		values[i].var->serialize(out, stringMap, objMap, traitsMap);
 	}
 	//The empty string closes the object
 	if (!amf0) out->writeStringVR(stringMap, "");
 }
 
-void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ASObject::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
 	if (amf0)
@@ -1630,8 +1806,7 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	objMap.insert(make_pair(this, objMap.size()));
 
 	uint32_t traitsCount=0;
-	const variables_map::const_var_iterator beginIt = Variables.Variables.begin();
-	const variables_map::const_var_iterator endIt = Variables.Variables.end();
+	const uint32_t varsCount = Variables.size();
 	//Check if the class traits has been already serialized to send it by reference
 	auto it2=traitsMap.find(type);
 
@@ -1642,17 +1817,17 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 		{
 			out->writeByte(amf0_reference_marker);
 			out->writeShort(it2->second);
-			for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
+			for(uint32_t i=0; i < varsCount; i++)
 			{
-				if(varIt->second.kind==DECLARED_TRAIT)
+				if(Variables.getValueAt(i)->kind==DECLARED_TRAIT)
 				{
-					if(!varIt->second.ns.hasEmptyName())
+					if(!Variables.getNsAt(i).hasEmptyName())
 					{
 						//Skip variable with a namespace, like protected ones
 						continue;
 					}
-					out->writeStringAMF0(getSystemState()->getStringFromUniqueId(varIt->first));
-					varIt->second.var->serialize(out, stringMap, objMap, traitsMap);
+					out->writeStringAMF0(getSystemState()->getStringFromUniqueId(Variables.getNameIdAt(i)));
+					Variables.getValueAt(i)->var->serialize(out, stringMap, objMap, traitsMap);
 				}
 			}
 		}
@@ -1668,11 +1843,11 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	else
 	{
 		traitsMap.insert(make_pair(type, traitsMap.size()));
-		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
+		for(uint32_t i=0; i < varsCount; i++)
 		{
-			if(varIt->second.kind==DECLARED_TRAIT)
+			if(Variables.getValueAt(i)->kind==DECLARED_TRAIT)
 			{
-				if(!varIt->second.ns.hasEmptyName())
+				if(!Variables.getNsAt(i).hasEmptyName())
 				{
 					//Skip variable with a namespace, like protected ones
 					continue;
@@ -1683,29 +1858,29 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 		uint32_t dynamicFlag=(type->isSealed)?0:(1 << 3);
 		out->writeU29((traitsCount << 4) | dynamicFlag | 0x03);
 		out->writeStringVR(stringMap, alias);
-		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
+		for(uint32_t i=0; i < varsCount; i++)
 		{
-			if(varIt->second.kind==DECLARED_TRAIT)
+			if(Variables.getValueAt(i)->kind==DECLARED_TRAIT)
 			{
-				if(!varIt->second.ns.hasEmptyName())
+				if(!Variables.getNsAt(i).hasEmptyName())
 				{
 					//Skip variable with a namespace, like protected ones
 					continue;
 				}
-				out->writeStringVR(stringMap, getSystemState()->getStringFromUniqueId(varIt->first));
+				out->writeStringVR(stringMap, getSystemState()->getStringFromUniqueId(Variables.getNameIdAt(i)));
 			}
 		}
 	}
-	for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
+	for(uint32_t i=0; i < varsCount; i++)
 	{
-		if(varIt->second.kind==DECLARED_TRAIT)
+		if(Variables.getValueAt(i)->kind==DECLARED_TRAIT)
 		{
-			if(!varIt->second.ns.hasEmptyName())
+			if(!Variables.getNsAt(i).hasEmptyName())
 			{
 				//Skip variable with a namespace, like protected ones
 				continue;
 			}
-			varIt->second.var->serialize(out, stringMap, objMap, traitsMap);
+			Variables.getValueAt(i)->var->serialize(out, stringMap, objMap, traitsMap);
 		}
 	}
 	if(!type->isSealed)
@@ -1830,20 +2005,21 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, IFunction *replacer,
 	else
 	{
 		res += "{";
-		variables_map::var_iterator beginIt = Variables.Variables.begin();
-		variables_map::var_iterator endIt = Variables.Variables.end();
+		const variables_map* map = &Variables;
+		uint32_t varIndex = 0;
 		bool bfirst = true;
 		bool bObjectVars = true;
 		path.push_back(this);
-		variables_map::const_var_iterator varIt = beginIt;
-		while (varIt != endIt)
+		while (varIndex < map->size())
 		{
-			if(varIt->second.ns.hasEmptyName() && (varIt->second.getter != NULL || varIt->second.var!= NULL))
+			const variable& var = *map->getValueAt(varIndex);
+			const uint32_t varNameId = map->getNameIdAt(varIndex);
+			if(map->getNsAt(varIndex).hasEmptyName() && (var.getter != NULL || var.var!= NULL))
 			{
-				ASObject* v = varIt->second.var;
-				if (varIt->second.getter)
-					v=varIt->second.getter->call(this,NULL,0);
-				if(v->getObjectType() != T_UNDEFINED && varIt->second.isenumerable)
+				ASObject* v = var.var;
+				if (var.getter)
+					v=var.getter->call(this,NULL,0);
+				if(v->getObjectType() != T_UNDEFINED && var.isenumerable)
 				{
 					// check for cylic reference
 					if (v->getObjectType() != T_UNDEFINED &&
@@ -1858,14 +2034,14 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, IFunction *replacer,
 							res += ",";
 						res += newline+spaces;
 						res += "\"";
-						res += getSystemState()->getStringFromUniqueId(varIt->first);
+						res += getSystemState()->getStringFromUniqueId(varNameId);
 						res += "\"";
 						res += ":";
 						if (!spaces.empty())
 							res += " ";
 						ASObject* params[2];
 						
-						params[0] = abstract_s(getSystemState(),getSystemState()->getStringFromUniqueId(varIt->first));
+						params[0] = abstract_s(getSystemState(),getSystemState()->getStringFromUniqueId(varNameId));
 						params[1] = v;
 						params[1]->incRef();
 						ASObject *funcret=replacer->call(getSystemState()->getNullRef(), params, 2);
@@ -1875,13 +2051,13 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, IFunction *replacer,
 							res += v->toJSON(path,replacer,spaces+spaces,filter);
 						bfirst = false;
 					}
-					else if (filter.empty() || filter.find(tiny_string(" ")+getSystemState()->getStringFromUniqueId(varIt->first)+" ") != tiny_string::npos)
+					else if (filter.empty() || filter.find(tiny_string(" ")+getSystemState()->getStringFromUniqueId(varNameId)+" ") != tiny_string::npos)
 					{
 						if (!bfirst)
 							res += ",";
 						res += newline+spaces;
 						res += "\"";
-						res += getSystemState()->getStringFromUniqueId(varIt->first);
+						res += getSystemState()->getStringFromUniqueId(varNameId);
 						res += "\"";
 						res += ":";
 						if (!spaces.empty())
@@ -1893,14 +2069,14 @@ tiny_string ASObject::toJSON(std::vector<ASObject *> &path, IFunction *replacer,
 				if (!bfirst)
 					res += newline+spaces.substr_bytes(0,spaces.numBytes()/2);
 			}
-			varIt++;
-			if (varIt == endIt && bObjectVars)
+			varIndex++;
+			if (varIndex == map->size() && bObjectVars)
 			{
 				bObjectVars = false;
 				if (this->getClass())
 				{
-					varIt = this->getClass()->borrowedVariables.Variables.begin();
-					endIt = this->getClass()->borrowedVariables.Variables.end();
+					map = &this->getClass()->borrowedVariables;
+					varIndex = 0;
 				}
 			}
 		}
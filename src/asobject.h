@@ -26,6 +26,8 @@
 #include "threading.h"
 #include "memory_support.h"
 #include <map>
+#include <unordered_map>
+#include <algorithm>
 #include <boost/intrusive/list.hpp>
 #include <boost/container/flat_map.hpp>
 
@@ -184,6 +186,7 @@ class Type;
 class ABCContext;
 class SystemState;
 struct asfreelist;
+struct inline_cache;
 
 extern SystemState* getSys();
 enum TRAIT_KIND { NO_CREATE_TRAIT=0, DECLARED_TRAIT=1, DYNAMIC_TRAIT=2, INSTANCE_TRAIT=5, CONSTANT_TRAIT=9 /* constants are also declared traits */ };
@@ -200,14 +203,14 @@ struct variable
 	};
 	IFunction* setter;
 	IFunction* getter;
-	nsNameAndKind ns;
-	TRAIT_KIND kind;
-	TRAIT_STATE traitState;
+	//The name and namespace are stored in the shape of the map
+	TRAIT_KIND kind:8;
+	TRAIT_STATE traitState:8;
 	bool isenumerable:1;
 	bool issealed:1;
-	variable(TRAIT_KIND _k,const nsNameAndKind& _ns)
-		: var(NULL),typeUnion(NULL),setter(NULL),getter(NULL),ns(_ns),kind(_k),traitState(NO_STATE),isenumerable(true),issealed(false) {}
-	variable(TRAIT_KIND _k, ASObject* _v, multiname* _t, const Type* type, const nsNameAndKind &_ns, bool _isenumerable);
+	variable(TRAIT_KIND _k)
+		: var(NULL),typeUnion(NULL),setter(NULL),getter(NULL),kind(_k),traitState(NO_STATE),isenumerable(true),issealed(false) {}
+	variable(TRAIT_KIND _k, ASObject* _v, multiname* _t, const Type* type, bool _isenumerable);
 	void setVar(ASObject* v);
 	/*
 	 * To be used only if the value is guaranteed to be of the right type
@@ -238,17 +241,78 @@ struct varName
 	}
 };
 
+/*
+ * The layout of the variables of an object, also known as hidden class.
+ * It holds the names of the variables, sorted by name and namespace.
+ * Objects with the same variables share the same shape and only store the values.
+ * Shared shapes are never modified, adding a variable moves the object to
+ * another shape through a tree of transitions starting from the empty shape.
+ * Objects with many variables, that had variables deleted, or that add
+ * variables to a shape that already has too many transitions, own a private
+ * shape that is modified in place. This bounds the size of the tree.
+ */
+class variables_shape
+{
+friend class variables_map;
+private:
+	std::vector<varName> names;
+	//Shapes obtained by adding a variable to this one, protected by a global mutex
+	std::map<varName,variables_shape*> transitions;
+	bool shared;
+	variables_shape(bool s):shared(s) {}
+	variables_shape(const variables_shape& r):names(r.names),shared(false) {}
+	/*
+	 * Returns the shared shape with the given variable added at position pos,
+	 * or NULL if this shape already has too many distinct transitions or the
+	 * tree is full
+	 */
+	variables_shape* getTransition(const varName& n, uint32_t pos);
+public:
+	~variables_shape();
+	static variables_shape* getEmptyShape();
+	inline bool isShared() const { return shared; }
+	inline uint32_t size() const { return names.size(); }
+	inline const varName& getName(uint32_t i) const { return names[i]; }
+	//Position of the first variable with the given name, or of the one following it
+	inline uint32_t lowerBound(uint32_t nameId) const
+	{
+		uint32_t low=0;
+		uint32_t high=names.size();
+		while(low<high)
+		{
+			uint32_t mid=(low+high)/2;
+			if(names[mid].nameId<nameId)
+				low=mid+1;
+			else
+				high=mid;
+		}
+		return low;
+	}
+	//Position where the given variable is, or should be inserted
+	inline uint32_t lowerBound(const varName& n) const
+	{
+		return std::lower_bound(names.begin(),names.end(),n)-names.begin();
+	}
+};
+
 class variables_map
 {
+private:
+	//Moves the map to a private shape that can be modified
+	void makeShapePrivate();
+	variable* insertVar(const varName& n, const variable& v);
+	void eraseVar(uint32_t pos);
+	variable* findSlotVar(unsigned int n);
 public:
-	//Names are represented by strings in the string and namespace pools
-	typedef boost::container::flat_multimap<uint32_t,variable,std::less<uint32_t>,reporter_allocator<std::pair<uint32_t, variable>>>
-		mapType;
-	mapType Variables;
-	typedef boost::container::flat_multimap<uint32_t,variable>::iterator var_iterator;
-	typedef boost::container::flat_multimap<uint32_t,variable>::const_iterator const_var_iterator;
+	typedef std::vector<variable,reporter_allocator<variable>> valuesType;
+	variables_shape* shape;
+	//Values of the variables, in the same order of the names in the shape
+	valuesType values;
 	std::vector<varName> slots_vars;
 	variables_map(MemoryAccount* m);
+	//Private shapes are owned by the map, so it can't be copied
+	variables_map(const variables_map&) = delete;
+	variables_map& operator=(const variables_map&) = delete;
 	/**
 	   Find a variable in the map
 
@@ -268,20 +332,20 @@ public:
 		uint32_t name=mname.name_type == multiname::NAME_STRING ? mname.name_s_id : mname.normalizedNameId(sys);
 		assert(!mname.ns.empty());
 		
-		const_var_iterator ret=Variables.lower_bound(name);
+		uint32_t ret=shape->lowerBound(name);
 		auto nsIt=mname.ns.cbegin();
 		//Find the namespace
-		while(ret!=Variables.cend() && ret->first==name)
+		while(ret<shape->size() && shape->getName(ret).nameId==name)
 		{
 			//breaks when the namespace is not found
-			const nsNameAndKind& ns=ret->second.ns;
+			const nsNameAndKind& ns=shape->getName(ret).ns;
 			if(ns==*nsIt || (mname.hasEmptyNS && ns.hasEmptyName()) || (mname.hasBuiltinNS && ns.hasBuiltinName()))
 			{
-				if(ret->second.kind & traitKinds)
+				if(values[ret].kind & traitKinds)
 				{
 					if (nsRealId)
 						*nsRealId = ns.nsRealId;
-					return &ret->second;
+					return &values[ret];
 				}
 				else
 					return NULL;
@@ -303,6 +367,11 @@ public:
 	//Initialize a new variable specifying the type (TODO: add support for const)
 	void initializeVar(const multiname& mname, ASObject* obj, multiname *typemname, ABCContext* context, TRAIT_KIND traitKind, ASObject* mainObj, uint32_t slot_id, bool isenumerable);
 	void killObjVar(SystemState* sys, const multiname& mname);
+	/*
+	 * Copies all the variables of another map, taking a reference to the values.
+	 * The map must be empty
+	 */
+	void copyFrom(const variables_map& r);
 	ASObject* getSlot(unsigned int n);
 	/*
 	 * This method does throw if the slot id is not valid
@@ -317,16 +386,50 @@ public:
 	void initSlot(unsigned int n, uint32_t nameId, const nsNameAndKind& ns);
 	inline unsigned int size() const
 	{
-		return Variables.size();
+		return values.size();
 	}
 	tiny_string getNameAt(SystemState* sys,unsigned int i) const;
+	inline uint32_t getNameIdAt(unsigned int i) const
+	{
+		return shape->getName(i).nameId;
+	}
+	inline const nsNameAndKind& getNsAt(unsigned int i) const
+	{
+		return shape->getName(i).ns;
+	}
 	variable* getValueAt(unsigned int i);
+	inline const variable* getValueAt(unsigned int i) const
+	{
+		return &values[i];
+	}
+	/*
+	 * Returns the variable at the given position only if it has the given name and namespace.
+	 * Used to validate the positions remembered by inline caches
+	 */
+	inline variable* getValueAtIfMatches(unsigned int i, uint32_t nameId, uint32_t nsId)
+	{
+		if(i>=values.size())
+			return NULL;
+		const varName& n=shape->getName(i);
+		if(n.nameId!=nameId || n.ns.nsId!=nsId)
+			return NULL;
+		return &values[i];
+	}
+	/*
+	 * Returns the position of a variable stored in this map, or UINT32_MAX
+	 */
+	inline uint32_t getPosition(const variable* v) const
+	{
+		if(values.empty() || v<&values.front() || v>&values.back())
+			return UINT32_MAX;
+		return v-&values.front();
+	}
 	int getNextEnumerable(unsigned int i) const;
 	~variables_map();
 	void check() const;
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap) const;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const;
 	void dumpVariables() const;
 	void destroyContents();
 };
@@ -350,6 +453,15 @@ private:
 	variables_map Variables;
 	unsigned int varcount;
 	Class_base* classdef;
+	bool canUseInlineCache(const multiname& name) const DLL_LOCAL;
+	variable* findInlineCached(const multiname& name, inline_cache* ic, bool& borrowed) DLL_LOCAL;
+	void fillInlineCache(inline_cache* ic, const variable* v, bool borrowed) DLL_LOCAL;
+	/*
+	 * Returns the value of a variable found by a lookup, calling the getter or
+	 * binding the method to this object
+	 */
+	_NR<ASObject> getValueOfVariable(const variable* obj, const multiname& name) DLL_LOCAL;
+	void setValueOfVariable(variable* obj, ASObject* o) DLL_LOCAL;
 	inline const variable* findGettable(const multiname& name, uint32_t* nsRealId = NULL) const DLL_LOCAL
 	{
 		const variable* ret=varcount ? Variables.findObjVar(getSystemState(),name,DECLARED_TRAIT|DYNAMIC_TRAIT,nsRealId):NULL;
@@ -388,9 +500,9 @@ protected:
 	bool traitsInitialized:1;
 	bool constructIndicator:1;
 	bool constructorCallComplete:1; // indicates that the constructor including all super constructors has been called
-	void serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap) const;
+	void serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t> traitsMap) const;
 	void setClass(Class_base* c);
 	static variable* findSettableImpl(SystemState* sys,variables_map& map, const multiname& name, bool* has_getter);
 	inline static const variable* findGettableImpl(SystemState* sys,const variables_map& map, const multiname& name, uint32_t* nsRealId = NULL)
@@ -479,6 +591,15 @@ public:
 	 * If the property found is a getter, it is called and its return value returned.
 	 */
 	_NR<ASObject> getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt, Class_base* cls);
+	/*
+	 * Versions of getVariableByMultiname and setVariableByMultiname used by the inline
+	 * caches of the optimized code. They return false if the access can't be served
+	 * through the cache, in which case the generic version must be used.
+	 * Only plain objects (not proxies) and names with a namespace are cached,
+	 * both the variables of the object and the ones borrowed from its class.
+	 */
+	bool getVariableByMultinameCached(const multiname& name, inline_cache* ic, _NR<ASObject>& ret);
+	bool setVariableByMultinameCached(const multiname& name, ASObject* o, inline_cache* ic);
 	virtual int32_t getVariableByMultiname_i(const multiname& name);
 	/* Simple getter interface for the common case */
 	_NR<ASObject> getVariableByMultiname(const tiny_string& name, std::list<tiny_string> namespaces);
@@ -613,9 +734,9 @@ public:
 
 	  The various maps are used to implement reference type of the AMF3 spec
 	*/
-	virtual void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	virtual void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 
 	virtual ASObject *describeType() const;
 
@@ -84,7 +84,7 @@ Config::Config():
 	//DEFAULT SETTINGS
 	defaultCacheDirectory((string) g_get_user_cache_dir() + "/lightspark"),
 	cacheDirectory(defaultCacheDirectory),cachePrefix("cache"),
-	renderingEnabled(true)
+	renderingEnabled(true),threadPoolSize(0),textureBudget(128)
 {
 #ifdef _WIN32
 	const char* exePath = getExectuablePath();
@@ -189,12 +189,18 @@ void Config::handleEntry()
 	//Rendering
 	if(group == "rendering" && key == "enabled")
 		renderingEnabled = atoi(value.c_str());
+	//Texture memory budget
+	else if(group == "rendering" && key == "texture_budget")
+		textureBudget = atoi(value.c_str());
 	//Cache directory
 	else if(group == "cache" && key == "directory")
 		cacheDirectory = value;
 	//Cache prefix
 	else if(group == "cache" && key == "prefix")
 		cachePrefix = value;
+	//Worker threads
+	else if(group == "threads" && key == "pool_size")
+		threadPoolSize = atoi(value.c_str());
 	else
 		LOG(LOG_ERROR,_("Invalid entry encountered in configuration file") << ": '" << group << "/" << key << "'='" << value << "'");
 }
@@ -48,6 +48,10 @@ namespace lightspark
 
 		//Specifies if rendering should be done
 		bool renderingEnabled;
+		//Specifies how many idle worker threads are kept, 0 means one for each hardware thread
+		uint32_t threadPoolSize;
+		//Specifies the texture memory in MB above which unused cached surfaces are evicted, 0 means no limit
+		uint32_t textureBudget;
 		Config();
 		~Config();
 	public:
@@ -59,6 +63,8 @@ namespace lightspark
 		const std::string& getGnashPath() const { return gnashPath; }
 
 		bool isRenderingEnabled() const { return renderingEnabled; }
+		uint32_t getThreadPoolSize() const { return threadPoolSize; }
+		uint32_t getTextureBudget() const { return textureBudget; }
 	};
 }
 
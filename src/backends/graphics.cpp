@@ -26,13 +26,21 @@
 #include "backends/rendering.h"
 #include "backends/config.h"
 #include "compat.h"
+#include "platforms/fastpaths.h"
 #include "scripting/flash/text/flashtext.h"
 #include "scripting/flash/display/BitmapData.h"
 #include <pango/pangocairo.h>
 
 using namespace lightspark;
 
-TextureChunk::TextureChunk(uint32_t w, uint32_t h)
+//The render thread may be already gone during shutdown
+static RenderThread* getTextureAllocator()
+{
+	SystemState* sys=getSys();
+	return sys?sys->getRenderThread():NULL;
+}
+
+TextureChunk::TextureChunk(uint32_t w, uint32_t h):texId(0),lastUsedFrame(0),evictable(false),evicted(false)
 {
 	width=w;
 	height=h;
@@ -46,37 +54,50 @@ TextureChunk::TextureChunk(uint32_t w, uint32_t h)
 	chunks=new uint32_t[blocksW*blocksH];
 }
 
-TextureChunk::TextureChunk(const TextureChunk& r):chunks(NULL),texId(0),width(r.width),height(r.height)
+TextureChunk::TextureChunk(TextureChunk&& r):chunks(NULL),texId(0),lastUsedFrame(0),evictable(false),evicted(false),width(0),height(0)
 {
-	*this = r;
-	return;
+	*this = std::move(r);
 }
 
-TextureChunk& TextureChunk::operator=(const TextureChunk& r)
+TextureChunk& TextureChunk::operator=(TextureChunk&& r)
 {
-	if(chunks)
+	if(this==&r)
+		return *this;
+	RenderThread* rt=getTextureAllocator();
+	//The render thread keeps track of the allocated chunks, so let it update its bookkeeping
+	if(rt && (chunks || r.chunks))
+		rt->moveTexture(*this, r);
+	else
 	{
-		//We were already initialized, so first clean up
-		getSys()->getRenderThread()->releaseTexture(*this);
 		delete[] chunks;
+		takeOver(r);
 	}
+	return *this;
+}
+
+void TextureChunk::takeOver(TextureChunk& r)
+{
+	chunks=r.chunks;
+	texId=r.texId;
 	width=r.width;
 	height=r.height;
-	uint32_t blocksW=(width+CHUNKSIZE-1)/CHUNKSIZE;
-	uint32_t blocksH=(height+CHUNKSIZE-1)/CHUNKSIZE;
-	texId=r.texId;
-	if(r.chunks)
-	{
-		chunks=new uint32_t[blocksW*blocksH];
-		memcpy(chunks, r.chunks, blocksW*blocksH*4);
-	}
-	else
-		chunks=NULL;
-	return *this;
+	lastUsedFrame=r.lastUsedFrame;
+	evictable=r.evictable;
+	evicted=r.evicted;
+	r.chunks=NULL;
+	r.width=0;
+	r.height=0;
+	r.evicted=false;
 }
 
 TextureChunk::~TextureChunk()
 {
+	if(chunks)
+	{
+		RenderThread* rt=getTextureAllocator();
+		if(rt)
+			rt->releaseTexture(*this);
+	}
 	delete[] chunks;
 }
 
@@ -94,16 +115,18 @@ bool TextureChunk::resizeIfLargeEnough(uint32_t w, uint32_t h)
 	if(w==0 || h==0)
 	{
 		//The texture collapsed, release the resources
-		getSys()->getRenderThread()->releaseTexture(*this);
+		if(chunks)
+			getSys()->getRenderThread()->releaseTexture(*this);
 		delete[] chunks;
 		chunks=NULL;
 		width=w;
 		height=h;
 		return true;
 	}
+	//The chunks are laid out in rows of blocks, so the layout must stay the same
 	const uint32_t blocksW=(width+CHUNKSIZE-1)/CHUNKSIZE;
 	const uint32_t blocksH=(height+CHUNKSIZE-1)/CHUNKSIZE;
-	if(w<=blocksW*CHUNKSIZE && h<=blocksH*CHUNKSIZE)
+	if(chunks && (w+CHUNKSIZE-1)/CHUNKSIZE==blocksW && (h+CHUNKSIZE-1)/CHUNKSIZE==blocksH)
 	{
 		width=w;
 		height=h;
@@ -203,7 +226,7 @@ cairo_pattern_t* CairoTokenRenderer::FILLSTYLEToCairo(const FILLSTYLE& style, do
 		case REPEATING_BITMAP:
 		case CLIPPED_BITMAP:
 		{
-			_NR<BitmapContainer> bm(style.bitmap);
+			_NR<BitmapContainer> bm(style.getBitmap());
 			if(bm.isNull())
 				return NULL;
 
@@ -448,15 +471,8 @@ void CairoTokenRenderer::executeDraw(cairo_t* cr)
 	cairoPathFromTokens(cr, tokens, scaleFactor, false);
 }
 
-#ifdef HAVE_NEW_GLIBMM_THREAD_API
-StaticRecMutex CairoRenderer::cairoMutex;
-#else
-StaticRecMutex CairoRenderer::cairoMutex = GLIBMM_STATIC_REC_MUTEX_INIT;
-#endif
-
 uint8_t* CairoRenderer::getPixelBuffer()
 {
-	RecMutex::Lock l(cairoMutex);
 	if(width==0 || height==0 || !Config::getConfig()->isRenderingEnabled())
 		return NULL;
 
@@ -608,11 +624,12 @@ void CairoRenderer::convertBitmapWithAlphaToCairo(std::vector<uint8_t, reporter_
 
 	for(uint32_t i = 0; i < height; i++)
 	{
-		for(uint32_t j = 0; j < width; j++)
-		{
-			uint32_t* outDataPos = (uint32_t*)(outData+i*(*stride)) + j;
-			*outDataPos = GINT32_FROM_BE( *(inData32+(i*width+j)) );
-		}
+		uint32_t* outRow = (uint32_t*)(outData+i*(*stride));
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+		fastSwapPixels(outRow, inData32+i*width, width);
+#else
+		memcpy(outRow, inData32+i*width, width*4);
+#endif
 	}
 }
 
@@ -663,11 +680,22 @@ void CairoRenderer::convertBitmapToCairo(std::vector<uint8_t, reporter_allocator
 	}
 }
 
-#ifdef HAVE_NEW_GLIBMM_THREAD_API
-StaticMutex CairoPangoRenderer::pangoMutex;
-#else
-StaticMutex CairoPangoRenderer::pangoMutex = GLIBMM_STATIC_MUTEX_INIT;
-#endif
+DEFINE_AND_INITIALIZE_TLS_WITH_NOTIFY(pango_font_map_tls, g_object_unref);
+
+PangoLayout* CairoPangoRenderer::createLayout(cairo_t* cr)
+{
+	PangoFontMap* fontMap=(PangoFontMap*)tls_get(&pango_font_map_tls);
+	if(fontMap==NULL)
+	{
+		fontMap=pango_cairo_font_map_new();
+		tls_set(&pango_font_map_tls,fontMap);
+	}
+	PangoContext* context=pango_font_map_create_context(fontMap);
+	pango_cairo_update_context(cr, context);
+	PangoLayout* layout=pango_layout_new(context);
+	g_object_unref(context);
+	return layout;
+}
 
 void CairoPangoRenderer::pangoLayoutFromData(PangoLayout* layout, const TextData& tData)
 {
@@ -719,13 +747,9 @@ void CairoPangoRenderer::pangoLayoutFromData(PangoLayout* layout, const TextData
 
 void CairoPangoRenderer::executeDraw(cairo_t* cr)
 {
-	/* TODO: pango is not fully thread-safe,
-	 * but we may be able to use finer grained locking.
-	 */
-	Locker l(pangoMutex);
 	PangoLayout* layout;
 
-	layout = pango_cairo_create_layout(cr);
+	layout = createLayout(cr);
 	pangoLayoutFromData(layout, textData);
 
 	if(textData.background)
@@ -761,14 +785,12 @@ void CairoPangoRenderer::executeDraw(cairo_t* cr)
 
 bool CairoPangoRenderer::getBounds(const TextData& _textData, uint32_t& w, uint32_t& h, uint32_t& tw, uint32_t& th)
 {
-	//TODO:check locking
-	Locker l(pangoMutex);
 	cairo_surface_t* cairoSurface=cairo_image_surface_create_for_data(NULL, CAIRO_FORMAT_ARGB32, 0, 0, 0);
 	cairo_t *cr=cairo_create(cairoSurface);
 
 	PangoLayout* layout;
 
-	layout = pango_cairo_create_layout(cr);
+	layout = createLayout(cr);
 	pangoLayoutFromData(layout, _textData);
 
 	PangoRectangle ink_rect, logical_rect;
@@ -814,13 +836,11 @@ PangoRectangle CairoPangoRenderer::lineExtents(PangoLayout *layout, int lineNumb
 
 std::vector<LineData> CairoPangoRenderer::getLineData(const TextData& _textData)
 {
-	//TODO:check locking
-	Locker l(pangoMutex);
 	cairo_surface_t* cairoSurface=cairo_image_surface_create_for_data(NULL, CAIRO_FORMAT_ARGB32, 0, 0, 0);
 	cairo_t *cr=cairo_create(cairoSurface);
 
 	PangoLayout* layout;
-	layout = pango_cairo_create_layout(cr);
+	layout = createLayout(cr);
 	pangoLayoutFromData(layout, _textData);
 
 	int XOffset = _textData.scrollH;
@@ -911,7 +931,7 @@ const TextureChunk& AsyncDrawJob::getTexture()
 	uint32_t height=drawable->getHeight();
 	//Verify that the texture is large enough
 	if(!surface.tex.resizeIfLargeEnough(width, height))
-		surface.tex=getSys()->getRenderThread()->allocateTexture(width, height,false);
+		surface.tex=getSys()->getRenderThread()->allocateTexture(width, height, false, true);
 	surface.xOffset=drawable->getXOffset();
 	surface.yOffset=drawable->getYOffset();
 	surface.alpha=drawable->getAlpha();
@@ -51,15 +51,37 @@ private:
 	 */
 	uint32_t* chunks;
 	uint32_t texId;
+	/*
+	 * The frame this chunk was last drawn in, the least recently used
+	 * chunks are evicted first when over the texture memory budget
+	 */
+	mutable uint32_t lastUsedFrame;
+	/*
+	 * Only chunks whose content can be drawn again on demand may be evicted
+	 */
+	bool evictable;
+	mutable bool evicted;
 	TextureChunk(uint32_t w, uint32_t h);
+	/*
+	 * The allocated blocks are owned by a single chunk, so chunks can only be moved
+	 */
+	TextureChunk(const TextureChunk& r)=delete;
+	TextureChunk& operator=(const TextureChunk& r)=delete;
+	void takeOver(TextureChunk& r);
 public:
-	TextureChunk():chunks(NULL),texId(0),width(0),height(0){}
-	TextureChunk(const TextureChunk& r);
-	TextureChunk& operator=(const TextureChunk& r);
+	TextureChunk():chunks(NULL),texId(0),lastUsedFrame(0),evictable(false),evicted(false),width(0),height(0){}
+	TextureChunk(TextureChunk&& r);
+	TextureChunk& operator=(TextureChunk&& r);
 	~TextureChunk();
 	bool resizeIfLargeEnough(uint32_t w, uint32_t h);
 	uint32_t getNumberOfChunks() const { return ((width+CHUNKSIZE-1)/CHUNKSIZE)*((height+CHUNKSIZE-1)/CHUNKSIZE); }
 	bool isValid() const { return chunks; }
+	/*
+	 * True if the content was evicted from the texture and the owner should be drawn again
+	 * The flag is reset by clearEvicted, so that the owner is invalidated only once
+	 */
+	bool isEvicted() const { return evicted; }
+	void clearEvicted() const { evicted=false; }
 	void makeEmpty();
 	uint32_t width;
 	uint32_t height;
@@ -165,6 +187,8 @@ public:
 	void execute();
 	void threadAbort();
 	void jobFence();
+	//The next frame waits for the drawing
+	JOB_PRIORITY getPriority() const { return JOB_PRIORITY_HIGH; }
 	//ITextureUploadable interface
 	void upload(uint8_t* data, uint32_t w, uint32_t h) const;
 	void sizeNeeded(uint32_t& w, uint32_t& h) const;
@@ -189,13 +213,10 @@ protected:
 	*/
 	MATRIX matrix;
 	/*
-	 * There are reports (http://lists.freedesktop.org/archives/cairo/2011-September/022247.html)
-	 * that cairo is not threadsafe, and I have encountered some spurious crashes, too.
-	 * So we use a global lock for all cairo calls until this issue is sorted out.
-	 * TODO: CairoRenderes are enqueued as IThreadJobs, therefore this mutex
-	 *       will serialize the thread pool when all thread pool workers are executing CairoRenderers!
+	 * CairoRenderers are enqueued as IThreadJobs and run in parallel.
+	 * Every renderer draws on its own surface and cairo context, the
+	 * only shared cairo objects are the read-only bitmap sources.
 	 */
-	static StaticRecMutex cairoMutex;
 	static void cairoClean(cairo_t* cr);
 	cairo_surface_t* allocateSurface(uint8_t*& buf);
 	virtual void executeDraw(cairo_t* cr)=0;
@@ -310,12 +331,16 @@ public:
 
 class CairoPangoRenderer : public CairoRenderer
 {
-	static StaticMutex pangoMutex;
 	/*
 	 * This is run by CairoRenderer::execute()
 	 */
 	void executeDraw(cairo_t* cr);
 	TextData textData;
+	/*
+	 * Creates a layout for cr using the font map of the calling thread,
+	 * font maps can not be shared between threads
+	 */
+	static PangoLayout* createLayout(cairo_t* cr);
 	static void pangoLayoutFromData(PangoLayout* layout, const TextData& tData);
 	void applyCairoMask(cairo_t* cr, int32_t offsetX, int32_t offsetY) const;
 	static PangoRectangle lineExtents(PangoLayout *layout, int lineNumber);
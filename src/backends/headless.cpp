@@ -0,0 +1,181 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "scripting/abc.h"
+#include "scripting/flash/display/flashdisplay.h"
+#include "backends/headless.h"
+#include "backends/graphics.h"
+#include "backends/rendering.h"
+#include "backends/rendering_context.h"
+#include "compat.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+using namespace lightspark;
+using namespace std;
+
+HeadlessRenderer::HeadlessRenderer(SystemState* s, uint32_t w, uint32_t h):
+	m_sys(s),width(w),height(h),frameRate(0),pixels(NULL),dumpFormat(DUMP_NONE),
+	renderedFrames(0),totalTime(0)
+{
+	assert(width && height);
+	pixels=new uint8_t[width*height*4];
+	//The render thread is never started, but the rasterizers clip against its window size
+	m_sys->getRenderThread()->windowWidth=width;
+	m_sys->getRenderThread()->windowHeight=height;
+}
+
+HeadlessRenderer::~HeadlessRenderer()
+{
+	delete[] pixels;
+}
+
+void HeadlessRenderer::setDumpFrames(DUMP_FORMAT format, const tiny_string& dir)
+{
+	dumpFormat=format;
+	dumpDir=dir;
+}
+
+uint32_t HeadlessRenderer::run(uint32_t frames)
+{
+	const uint64_t runStart=g_get_monotonic_time();
+	const uint64_t frameInterval=(frameRate>0)?uint64_t(1000000/frameRate):0;
+	uint64_t nextFrame=runStart;
+	uint32_t i;
+	for(i=0;i<frames;i++)
+	{
+		if(frameInterval)
+		{
+			uint64_t now=g_get_monotonic_time();
+			if(nextFrame>now)
+				g_usleep(nextFrame-now);
+			else if(now-nextFrame>frameInterval)
+			{
+				//We are late by more than a frame, don't try to catch up
+				nextFrame=now;
+			}
+			nextFrame+=frameInterval;
+		}
+		const uint64_t frameStart=g_get_monotonic_time();
+		//Queue the events of the frame. tick() only waits for the
+		//AdvanceFrameEvent, events queued by their handlers may still be
+		//pending, and it does not wait at all if the VM is not running
+		m_sys->tick();
+		//The VM runs the events in order, so when the render event is
+		//handled every event of this frame queued before it has run
+		_R<RenderFrameEvent> ev=_MR(new (m_sys->unaccountedMemory) RenderFrameEvent(this));
+		if(m_sys->currentVm==NULL || !m_sys->currentVm->addEvent(NullRef, ev))
+			break;
+		ev->wait();
+		frameTimes.push_back(g_get_monotonic_time()-frameStart);
+		if(dumpFormat!=DUMP_NONE)
+			dumpFrame(renderedFrames);
+		renderedFrames++;
+	}
+	totalTime+=g_get_monotonic_time()-runStart;
+	return i;
+}
+
+void HeadlessRenderer::renderFrame()
+{
+	const uint64_t start=g_get_monotonic_time();
+	//Clear the buffer with the opaque background color
+	RGB bg=m_sys->mainClip->getBackground();
+	uint32_t* buf=reinterpret_cast<uint32_t*>(pixels);
+	std::fill(buf, buf+width*height, 0xff000000|bg.toUInt());
+
+	//Rasterize every object on stage in software, like BitmapData.draw does
+	Stage* stage=m_sys->stage;
+	SoftwareInvalidateQueue queue;
+	stage->requestInvalidation(&queue);
+	CairoRenderContext ctxt(pixels, width, height);
+	for(auto it=queue.queue.begin();it!=queue.queue.end();it++)
+	{
+		DisplayObject* target=(*it).getPtr();
+		IDrawable* drawable=target->invalidate(stage, MATRIX());
+		if(drawable==NULL)
+			continue;
+		uint8_t* texBuf=drawable->getPixelBuffer();
+		CachedSurface& surface=ctxt.allocateCustomSurface(target,texBuf);
+		surface.tex.width=drawable->getWidth();
+		surface.tex.height=drawable->getHeight();
+		surface.xOffset=drawable->getXOffset();
+		surface.yOffset=drawable->getYOffset();
+		delete drawable;
+	}
+	stage->Render(ctxt);
+	renderTimes.push_back(g_get_monotonic_time()-start);
+}
+
+void HeadlessRenderer::dumpFrame(uint32_t frame) const
+{
+	char name[32];
+	snprintf(name,32,"/frame%05u.%s",frame,(dumpFormat==DUMP_PNG)?"png":"raw");
+	tiny_string path=dumpDir+name;
+	if(dumpFormat==DUMP_PNG)
+	{
+		uint32_t stride=cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, width);
+		cairo_surface_t* surface=cairo_image_surface_create_for_data(pixels, CAIRO_FORMAT_ARGB32, width, height, stride);
+		cairo_status_t status=cairo_surface_write_to_png(surface, path.raw_buf());
+		cairo_surface_destroy(surface);
+		if(status!=CAIRO_STATUS_SUCCESS)
+			LOG(LOG_ERROR,_("Could not write frame to ") << path << ": " << cairo_status_to_string(status));
+	}
+	else
+	{
+		//Premultiplied ARGB in native byte order, as produced by cairo
+		ofstream f(path.raw_buf(), ios::binary);
+		f.write(reinterpret_cast<const char*>(pixels), width*height*4);
+		if(!f)
+			LOG(LOG_ERROR,_("Could not write frame to ") << path);
+	}
+}
+
+void HeadlessRenderer::writeFrameTimes(std::ostream& out) const
+{
+	out << "# frame frame_us render_us" << endl;
+	for(uint32_t i=0;i<frameTimes.size();i++)
+		out << i << ' ' << frameTimes[i] << ' ' << renderTimes[i] << endl;
+}
+
+void HeadlessRenderer::logStatistics() const
+{
+	if(frameTimes.empty())
+	{
+		LOG(LOG_INFO,_("Headless rendering: no frames rendered"));
+		return;
+	}
+	uint64_t frameSum=0;
+	uint64_t renderSum=0;
+	for(uint32_t i=0;i<frameTimes.size();i++)
+	{
+		frameSum+=frameTimes[i];
+		renderSum+=renderTimes[i];
+	}
+	auto renderMinMax=std::minmax_element(renderTimes.begin(), renderTimes.end());
+	auto frameMinMax=std::minmax_element(frameTimes.begin(), frameTimes.end());
+	const uint32_t count=frameTimes.size();
+	LOG(LOG_INFO,_("Headless rendering: ") << count << _(" frames of ") << width << "x" << height <<
+		_(" in ") << totalTime/1000 << " ms, " << (totalTime ? count*1000000.0/totalTime : 0) << " FPS");
+	LOG(LOG_INFO,_("Frame time (us): min ") << *frameMinMax.first << _(" avg ") << frameSum/count <<
+		_(" max ") << *frameMinMax.second);
+	LOG(LOG_INFO,_("Render time (us): min ") << *renderMinMax.first << _(" avg ") << renderSum/count <<
+		_(" max ") << *renderMinMax.second);
+}
@@ -0,0 +1,89 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_HEADLESS_H
+#define BACKENDS_HEADLESS_H 1
+
+#include "compat.h"
+#include "swftypes.h"
+#include <vector>
+#include <ostream>
+
+namespace lightspark
+{
+
+class SystemState;
+
+/*
+ * Renders the display list of a SystemState into an offscreen ARGB buffer
+ * using CairoRenderContext only, without a window, GL or EngineData.
+ * Frames are driven by the caller thread, while the rasterization itself
+ * happens in the VM thread to access the display list safely.
+ */
+class DLL_PUBLIC HeadlessRenderer
+{
+public:
+	enum DUMP_FORMAT { DUMP_NONE=0, DUMP_PNG, DUMP_RAW };
+private:
+	SystemState* m_sys;
+	uint32_t width;
+	uint32_t height;
+	/*
+	 * Target frame rate, 0 renders the frames as fast as possible
+	 */
+	float frameRate;
+	uint8_t* pixels;
+	DUMP_FORMAT dumpFormat;
+	tiny_string dumpDir;
+	uint32_t renderedFrames;
+	/*
+	 * Per frame timings in microseconds, the frame time includes
+	 * the script execution of the frame, the render time only the rasterization
+	 */
+	std::vector<uint64_t> frameTimes;
+	std::vector<uint64_t> renderTimes;
+	uint64_t totalTime;
+	void dumpFrame(uint32_t frame) const;
+public:
+	HeadlessRenderer(SystemState* s, uint32_t w, uint32_t h);
+	~HeadlessRenderer();
+	void setFrameRate(float rate) { frameRate=rate; }
+	void setDumpFrames(DUMP_FORMAT format, const tiny_string& dir);
+	/*
+	 * Advance and render the given number of frames, blocking the caller.
+	 * Returns the number of frames actually rendered, which is lower
+	 * if the VM is shutting down
+	 */
+	uint32_t run(uint32_t frames);
+	/*
+	 * Rasterize the stage into the buffer, must be called from the VM thread
+	 */
+	void renderFrame();
+	uint32_t getWidth() const { return width; }
+	uint32_t getHeight() const { return height; }
+	const uint8_t* getPixels() const { return pixels; }
+	/*
+	 * Write a line for each frame with the frame and render times in microseconds
+	 */
+	void writeFrameTimes(std::ostream& out) const;
+	void logStatistics() const;
+};
+
+};
+#endif /* BACKENDS_HEADLESS_H */
@@ -750,6 +750,7 @@ void LocalDownloader::execute()
 		//This prevents unneeded copying of the file's data
 
 		FileStreamCache *fileCache = dynamic_cast<FileStreamCache *>(cache.getPtr());
+		MemoryStreamCache *memoryCache = dynamic_cast<MemoryStreamCache *>(cache.getPtr());
 		if (fileCache)
 		{
 			fileCache->useExistingFile(url);
@@ -759,6 +760,14 @@ void LocalDownloader::execute()
 			notifyOwnerAboutBytesLoaded();
 			notifyOwnerAboutBytesTotal();
 		}
+		//In memory caches read the pages of the local file directly
+		else if (memoryCache && !dataGenerationMode && memoryCache->mapFile(url))
+		{
+			//Report that we've downloaded everything already
+			length = cache->getReceivedLength();
+			notifyOwnerAboutBytesLoaded();
+			notifyOwnerAboutBytesTotal();
+		}
 		//Otherwise we follow the normal procedure
 		else {
 			std::ifstream file;
@@ -20,8 +20,12 @@
 #include "scripting/abc.h"
 #include "parsing/textfile.h"
 #include "backends/rendering.h"
+#include "backends/config.h"
 #include "compat.h"
 #include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
 
 #ifdef _WIN32
 #   define WIN32_LEAN_AND_MEAN
@@ -36,6 +40,13 @@
 using namespace lightspark;
 using namespace std;
 
+//Above this the dirty rectangles are merged into their bounding box
+#define MAX_DIRTY_RECTS 8
+//How often, in rendered frames, textures are evicted and compacted
+#define TEXTURE_MANAGEMENT_INTERVAL 64
+//Chunks drawn during this number of frames are never evicted
+#define TEXTURE_EVICTION_AGE 256
+
 /* calculate FPS every second */
 const Glib::TimeVal RenderThread::FPS_time(/*seconds*/1,/*microseconds*/0);
 
@@ -63,8 +74,10 @@ void RenderThread::wait()
 RenderThread::RenderThread(SystemState* s):GLRenderContext(),
 	m_sys(s),status(CREATED),
 	prevUploadJob(NULL),
+	textureFrame(0),textureBudget(uint64_t(Config::getConfig()->getTextureBudget())*1024*1024),compactionFramebuffer(0),
 	renderNeeded(false),uploadNeeded(false),resizeNeeded(false),newTextureNeeded(false),event(0),newWidth(0),newHeight(0),scaleX(1),scaleY(1),
-	offsetX(0),offsetY(0),tempBufferAcquired(false),frameCount(0),secsCount(0),initialized(0),
+	offsetX(0),offsetY(0),tempBufferAcquired(false),frameCount(0),secsCount(0),
+	stageFramebuffer(0),stageTextureID(0),stageBackground(0),collectingQuads(false),fullRedrawNeeded(true),initialized(0),
 	cairoTextureContext(NULL)
 {
 	LOG(LOG_INFO,_("RenderThread this=") << this);
@@ -104,7 +117,7 @@ void RenderThread::handleNewTexture()
 	Locker l(mutexLargeTexture);
 	for(uint32_t i=0;i<largeTextures.size();i++)
 	{
-		if(largeTextures[i].id==(uint32_t)-1)
+		if(largeTextures[i].id==(uint32_t)-1 && !largeTextures[i].released)
 			largeTextures[i].id=allocateNewGLTexture();
 	}
 	newTextureNeeded=false;
@@ -119,6 +132,9 @@ void RenderThread::finalizeUpload()
 	engineData->bindCurrentBuffer();
 	loadChunkBGRA(tex, w, h, engineData->getCurrentPixBuf());
 	engineData->exec_glBindBuffer_GL_PIXEL_UNPACK_BUFFER(0);
+	//The content changed even if the quads using it may not have moved
+	if(tex.isValid())
+		uploadedChunks.insert(quadKey(tex.texId, tex.chunks[0]));
 	u->uploadFence();
 	prevUploadJob=NULL;
 }
@@ -335,13 +351,24 @@ bool RenderThread::loadShaderPrograms()
 void RenderThread::commonGLDeinit()
 {
 	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(0);
-	for(uint32_t i=0;i<largeTextures.size();i++)
 	{
-		engineData->exec_glDeleteTextures(1,&largeTextures[i].id);
-		delete[] largeTextures[i].bitmap;
+		Locker l(mutexLargeTexture);
+		for(uint32_t i=0;i<largeTextures.size();i++)
+		{
+			if(!largeTextures[i].released)
+				engineData->exec_glDeleteTextures(1,&largeTextures[i].id);
+			delete[] largeTextures[i].bitmap;
+		}
+		//Chunks released from now on will find no texture
+		largeTextures.clear();
 	}
+	if(compactionFramebuffer)
+		engineData->exec_glDeleteFramebuffers(1, &compactionFramebuffer);
 	engineData->exec_glDeleteBuffers();
 	engineData->exec_glDeleteTextures(1, &cairoTextureID);
+	if(stageFramebuffer)
+		engineData->exec_glDeleteFramebuffers(1, &stageFramebuffer);
+	engineData->exec_glDeleteTextures(1, &stageTextureID);
 }
 
 void RenderThread::commonGLInit(int width, int height)
@@ -390,6 +417,12 @@ void RenderThread::commonGLInit(int width, int height)
 
 	engineData->exec_glGenTextures(1, &cairoTextureID);
 
+	//The stage is rendered to this framebuffer, the texture is allocated on resize
+	engineData->exec_glGenFramebuffers(1, &stageFramebuffer);
+	engineData->exec_glGenTextures(1, &stageTextureID);
+	//Used to copy blocks between textures when compacting them
+	engineData->exec_glGenFramebuffers(1, &compactionFramebuffer);
+
 	if(handleGLErrors())
 	{
 		LOG(LOG_ERROR,_("GL errors during initialization"));
@@ -407,6 +440,33 @@ void RenderThread::commonGLResize()
 	lsglTranslatef(offsetX,windowHeight-offsetY,0);
 	lsglScalef(scaleX,-scaleY,1);
 	setMatrixUniform(LSGL_PROJECTION);
+	allocateStageFramebuffer();
+}
+
+void RenderThread::allocateStageFramebuffer()
+{
+	//The content of the stage framebuffer is lost anyway
+	fullRedrawNeeded=true;
+	if(stageFramebuffer==0 || windowWidth==0 || windowHeight==0)
+		return;
+	engineData->exec_glBindTexture_GL_TEXTURE_2D(stageTextureID);
+	engineData->exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MIN_FILTER_GL_LINEAR();
+	engineData->exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MAG_FILTER_GL_LINEAR();
+	//The window size is usually not a power of two, GLES2 requires clamping
+	//for such textures to be complete
+	engineData->exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_S_GL_CLAMP_TO_EDGE();
+	engineData->exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_T_GL_CLAMP_TO_EDGE();
+	engineData->exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_BYTE(0, windowWidth, windowHeight, 0, NULL);
+	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(stageFramebuffer);
+	engineData->exec_glFramebufferTexture2D_GL_FRAMEBUFFER_GL_COLOR_ATTACHMENT0(stageTextureID);
+	if(!engineData->exec_glCheckFramebufferStatus_GL_FRAMEBUFFER())
+	{
+		//Fall back to redrawing the whole back buffer every frame
+		LOG(LOG_ERROR,_("Stage framebuffer is not complete, partial redraw disabled"));
+		engineData->exec_glDeleteFramebuffers(1, &stageFramebuffer);
+		stageFramebuffer=0;
+	}
+	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(0);
 }
 
 void RenderThread::requestResize(uint32_t w, uint32_t h, bool force)
@@ -532,16 +592,13 @@ void RenderThread::plotProfilingData()
 void RenderThread::coreRendering()
 {
 	Locker l(mutexRendering);
+	manageTextures();
+	renderStage();
+
 	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(0);
 	engineData->exec_glDrawBuffer_GL_BACK();
-	//Clear the back buffer
-	RGB bg=m_sys->mainClip->getBackground();
-	engineData->exec_glClearColor(bg.Red/255.0F,bg.Green/255.0F,bg.Blue/255.0F,1);
-	engineData->exec_glClear_GL_COLOR_BUFFER_BIT();
-	lsglLoadIdentity();
-	setMatrixUniform(LSGL_MODELVIEW);
-
-	m_sys->mainClip->getStage()->Render(*this);
+	if(stageFramebuffer)
+		compositeStage();
 
 	if(m_sys->showProfilingData)
 		plotProfilingData();
@@ -549,6 +606,233 @@ void RenderThread::coreRendering()
 	handleGLErrors();
 }
 
+ClipRect RenderThread::quadBounds(int32_t x, int32_t y, uint32_t w, uint32_t h) const
+{
+	//Negative offsets are ignored by GLRenderContext::renderTextured
+	const float startX=(x<0)?0:x;
+	const float startY=(y<0)?0:y;
+	const float corners[8]={ startX, startY, startX+w, startY, startX, startY+h, startX+w, startY+h };
+	float minX=0, minY=0, maxX=0, maxY=0;
+	for(int i=0;i<8;i+=2)
+	{
+		//Apply the modelview matrix and then the same stage to window mapping of the projection
+		float px=lsMVPMatrix[0]*corners[i]+lsMVPMatrix[4]*corners[i+1]+lsMVPMatrix[12];
+		float py=lsMVPMatrix[1]*corners[i]+lsMVPMatrix[5]*corners[i+1]+lsMVPMatrix[13];
+		px=offsetX+px*scaleX;
+		py=offsetY+py*scaleY;
+		if(i==0 || px<minX)
+			minX=px;
+		if(i==0 || px>maxX)
+			maxX=px;
+		if(i==0 || py<minY)
+			minY=py;
+		if(i==0 || py>maxY)
+			maxY=py;
+	}
+	//Linear filtering may touch one more pixel on each side
+	return ClipRect(floorf(minX)-1, floorf(minY)-1, ceilf(maxX)+1, ceilf(maxY)+1);
+}
+
+void RenderThread::renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
+			float alpha, COLOR_MODE colorMode)
+{
+	chunk.lastUsedFrame=textureFrame;
+	if(!collectingQuads && !clipping)
+	{
+		GLRenderContext::renderTextured(chunk, x, y, w, h, alpha, colorMode);
+		return;
+	}
+
+	const ClipRect bounds=quadBounds(x, y, w, h);
+	if(collectingQuads && chunk.isValid())
+	{
+		RenderedQuad q;
+		q.texId=chunk.texId;
+		q.firstChunk=chunk.chunks[0];
+		q.bounds=bounds;
+		q.alpha=alpha;
+		q.colorMode=colorMode;
+		collectedQuads.push_back(q);
+	}
+	if(clipping && !clipRect.intersects(bounds))
+		return;
+	GLRenderContext::renderTextured(chunk, x, y, w, h, alpha, colorMode);
+}
+
+void RenderThread::setClipRect(const ClipRect& r)
+{
+	RenderContext::setClipRect(r);
+	//The scissor box has a bottom-left origin
+	engineData->exec_glScissor(r.xmin, windowHeight-r.ymax, r.xmax-r.xmin, r.ymax-r.ymin);
+	engineData->exec_glEnable_GL_SCISSOR_TEST();
+}
+
+void RenderThread::resetClipRect()
+{
+	RenderContext::resetClipRect();
+	engineData->exec_glDisable_GL_SCISSOR_TEST();
+}
+
+void RenderThread::addDirtyRect(const ClipRect& r)
+{
+	ClipRect rect=r;
+	rect.intersect(ClipRect(0, 0, windowWidth, windowHeight));
+	if(rect.isEmpty())
+		return;
+	//Merge with all the touching rectangles, the result may touch others in turn
+	for(uint32_t i=0;i<dirtyRects.size();)
+	{
+		if(dirtyRects[i].touches(rect))
+		{
+			rect.merge(dirtyRects[i]);
+			dirtyRects[i]=dirtyRects.back();
+			dirtyRects.pop_back();
+			i=0;
+		}
+		else
+			i++;
+	}
+	dirtyRects.push_back(rect);
+	//Each rectangle costs a traversal of the display list, so keep them few
+	if(dirtyRects.size()>MAX_DIRTY_RECTS)
+	{
+		for(uint32_t i=1;i<dirtyRects.size();i++)
+			dirtyRects[0].merge(dirtyRects[i]);
+		dirtyRects.resize(1);
+	}
+}
+
+void RenderThread::computeDirtyRects()
+{
+	dirtyRects.clear();
+	unordered_map<uint64_t, uint32_t> previous;
+	previous.reserve(renderedQuads.size());
+	for(uint32_t i=0;i<renderedQuads.size();i++)
+	{
+		const RenderedQuad& q=renderedQuads[i];
+		//The same texture drawn more than once can't be tracked, repaint it
+		if(!previous.emplace(quadKey(q.texId, q.firstChunk), i).second)
+			addDirtyRect(q.bounds);
+	}
+
+	vector<bool> matched(renderedQuads.size(), false);
+	uint32_t lastIndex=0;
+	for(auto it=collectedQuads.begin();it!=collectedQuads.end();++it)
+	{
+		const uint64_t key=quadKey(it->texId, it->firstChunk);
+		auto prev=previous.find(key);
+		if(prev==previous.end())
+		{
+			//A new object, or an object with a new texture
+			addDirtyRect(it->bounds);
+			continue;
+		}
+		const RenderedQuad& p=renderedQuads[prev->second];
+		matched[prev->second]=true;
+		//Quads drawn in a different order than before changed depth
+		if(prev->second<lastIndex || p.bounds!=it->bounds || p.alpha!=it->alpha ||
+			p.colorMode!=it->colorMode || uploadedChunks.count(key))
+		{
+			addDirtyRect(p.bounds);
+			addDirtyRect(it->bounds);
+		}
+		lastIndex=max(lastIndex, prev->second);
+	}
+	//Quads not drawn anymore leave an area to be repainted
+	for(uint32_t i=0;i<renderedQuads.size();i++)
+	{
+		if(!matched[i])
+			addDirtyRect(renderedQuads[i].bounds);
+	}
+
+	//When most of the window changed a single pass is cheaper
+	const ClipRect window(0, 0, windowWidth, windowHeight);
+	uint64_t dirtyArea=0;
+	for(uint32_t i=0;i<dirtyRects.size();i++)
+		dirtyArea+=dirtyRects[i].area();
+	if(dirtyRects.size()>1 && dirtyArea*4>window.area()*3)
+	{
+		dirtyRects.clear();
+		dirtyRects.push_back(window);
+	}
+}
+
+void RenderThread::renderStage()
+{
+	RGB bg=m_sys->mainClip->getBackground();
+	if(bg.toUInt()!=stageBackground)
+	{
+		stageBackground=bg.toUInt();
+		fullRedrawNeeded=true;
+	}
+	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(stageFramebuffer);
+	if(stageFramebuffer==0)
+	{
+		//The back buffer content is undefined after swapping
+		engineData->exec_glDrawBuffer_GL_BACK();
+		fullRedrawNeeded=true;
+	}
+	engineData->exec_glClearColor(bg.Red/255.0F,bg.Green/255.0F,bg.Blue/255.0F,1);
+
+	_NR<Stage> stage=m_sys->mainClip->getStage();
+	collectedQuads.clear();
+	collectingQuads=true;
+	if(fullRedrawNeeded)
+	{
+		//Quads are collected while drawing
+		engineData->exec_glClear_GL_COLOR_BUFFER_BIT();
+		lsglLoadIdentity();
+		setMatrixUniform(LSGL_MODELVIEW);
+		stage->Render(*this);
+		collectingQuads=false;
+		fullRedrawNeeded=false;
+	}
+	else
+	{
+		//Collect the quads without drawing anything, everything is clipped away
+		RenderContext::setClipRect(ClipRect());
+		lsglLoadIdentity();
+		stage->Render(*this);
+		RenderContext::resetClipRect();
+		collectingQuads=false;
+
+		computeDirtyRects();
+		for(uint32_t i=0;i<dirtyRects.size();i++)
+		{
+			setClipRect(dirtyRects[i]);
+			engineData->exec_glClear_GL_COLOR_BUFFER_BIT();
+			lsglLoadIdentity();
+			setMatrixUniform(LSGL_MODELVIEW);
+			stage->Render(*this);
+		}
+		resetClipRect();
+	}
+	renderedQuads.swap(collectedQuads);
+	uploadedChunks.clear();
+}
+
+//Draw the stage framebuffer over the whole window
+void RenderThread::compositeStage()
+{
+	lsglLoadIdentity();
+	lsglScalef(1.0f/scaleX,-1.0f/scaleY,1);
+	lsglTranslatef(-offsetX,(windowHeight-offsetY)*(-1.0f),0);
+	setMatrixUniform(LSGL_MODELVIEW);
+	engineData->exec_glUniform1f(yuvUniform, 0);
+	engineData->exec_glUniform1f(alphaUniform, 1);
+
+	engineData->exec_glBindTexture_GL_TEXTURE_2D(stageTextureID);
+	float vertex_coords[] = {0,0, float(windowWidth),0, 0,float(windowHeight), float(windowWidth),float(windowHeight)};
+	float texture_coords[] = {0,0, 1,0, 0,1, 1,1};
+	engineData->exec_glVertexAttribPointer(VERTEX_ATTRIB, 2, 0, vertex_coords);
+	engineData->exec_glVertexAttribPointer(TEXCOORD_ATTRIB, 2, 0, texture_coords);
+	engineData->exec_glEnableVertexAttribArray(VERTEX_ATTRIB);
+	engineData->exec_glEnableVertexAttribArray(TEXCOORD_ATTRIB);
+	engineData->exec_glDrawArrays_GL_TRIANGLE_STRIP(0, 4);
+	engineData->exec_glDisableVertexAttribArray(VERTEX_ATTRIB);
+	engineData->exec_glDisableVertexAttribArray(TEXCOORD_ATTRIB);
+}
+
 //Renders the error message which caused the VM to stop.
 void RenderThread::renderErrorPage(RenderThread *th, bool standalone)
 {
@@ -639,6 +923,11 @@ void RenderThread::draw(bool force)
 	{
 		time_s=time_d;
 		LOG(LOG_INFO,_("FPS: ") << dec << frameCount<<" "<<getVm(m_sys)->getEventQueueSize());
+		TextureStatistics stats;
+		getTextureStatistics(stats);
+		LOG(LOG_INFO,_("Textures: ") << stats.textures << " (peak " << stats.peakTextures << ", released " << stats.releasedTextures
+			<< ") chunks " << stats.chunks << " occupancy " << int(stats.occupancy()*100) << "% fragmentation "
+			<< int(stats.fragmentation()*100) << "% evicted " << stats.evictedChunks << " moved " << stats.movedChunks);
 		frameCount=0;
 		secsCount++;
 	}
@@ -657,10 +946,17 @@ void RenderThread::tickFence()
 
 void RenderThread::releaseTexture(const TextureChunk& chunk)
 {
-	uint32_t blocksW=(chunk.width+CHUNKSIZE-1)/CHUNKSIZE;
-	uint32_t blocksH=(chunk.height+CHUNKSIZE-1)/CHUNKSIZE;
-	uint32_t numberOfBlocks=blocksW*blocksH;
 	Locker l(mutexLargeTexture);
+	freeBlocks(chunk);
+	liveChunks.erase(const_cast<TextureChunk*>(&chunk));
+}
+
+void RenderThread::freeBlocks(const TextureChunk& chunk)
+{
+	//Nothing is left to free after an eviction or after deinit
+	if(chunk.chunks==NULL || chunk.texId>=largeTextures.size())
+		return;
+	uint32_t numberOfBlocks=chunk.getNumberOfChunks();
 	LargeTexture& tex=largeTextures[chunk.texId];
 	for(uint32_t i=0;i<numberOfBlocks;i++)
 	{
@@ -668,6 +964,208 @@ void RenderThread::releaseTexture(const TextureChunk& chunk)
 		assert(tex.bitmap[bitOffset/8]&(1<<(bitOffset%8)));
 		tex.bitmap[bitOffset/8]^=(1<<(bitOffset%8));
 	}
+	assert(tex.usedBlocks>=numberOfBlocks);
+	tex.usedBlocks-=numberOfBlocks;
+}
+
+void RenderThread::moveTexture(TextureChunk& dst, TextureChunk& src)
+{
+	Locker l(mutexLargeTexture);
+	if(dst.chunks)
+	{
+		freeBlocks(dst);
+		liveChunks.erase(&dst);
+		delete[] dst.chunks;
+	}
+	const bool allocated=liveChunks.erase(&src);
+	dst.takeOver(src);
+	if(allocated)
+		liveChunks.insert(&dst);
+}
+
+uint32_t RenderThread::allocatedTextureCount() const
+{
+	uint32_t ret=0;
+	for(uint32_t i=0;i<largeTextures.size();i++)
+	{
+		if(!largeTextures[i].released)
+			ret++;
+	}
+	return ret;
+}
+
+void RenderThread::getTextureStatistics(TextureStatistics& stats)
+{
+	Locker l(mutexLargeTexture);
+	stats=textureStats;
+	stats.textures=allocatedTextureCount();
+	stats.blocksPerTexture=(largeTextureSize/CHUNKSIZE)*(largeTextureSize/CHUNKSIZE);
+	stats.usedBlocks=0;
+	for(uint32_t i=0;i<largeTextures.size();i++)
+		stats.usedBlocks+=largeTextures[i].usedBlocks;
+	stats.chunks=liveChunks.size();
+}
+
+void RenderThread::manageTextures()
+{
+	textureFrame++;
+	if(textureFrame%TEXTURE_MANAGEMENT_INTERVAL)
+		return;
+	Locker l(mutexLargeTexture);
+	const uint64_t textureBytes=uint64_t(largeTextureSize)*largeTextureSize*4;
+	if(textureBudget && allocatedTextureCount()*textureBytes>textureBudget)
+	{
+		//Free as much as possible to get back in the budget
+		evictTextures();
+		while(compactTexture())
+			;
+	}
+	else
+	{
+		//Otherwise compact at most a texture at a time, in the background
+		compactTexture();
+	}
+	releaseEmptyTextures();
+}
+
+void RenderThread::evictTextures()
+{
+	const uint32_t blocksPerTexture=(largeTextureSize/CHUNKSIZE)*(largeTextureSize/CHUNKSIZE);
+	const uint64_t textureBytes=uint64_t(largeTextureSize)*largeTextureSize*4;
+	const uint64_t budgetBlocks=(textureBudget/textureBytes)*blocksPerTexture;
+	uint64_t usedBlocks=0;
+	for(uint32_t i=0;i<largeTextures.size();i++)
+		usedBlocks+=largeTextures[i].usedBlocks;
+	if(usedBlocks<=budgetBlocks)
+		return;
+
+	//Evict the least recently drawn chunks first
+	vector<TextureChunk*> candidates;
+	for(auto it=liveChunks.begin();it!=liveChunks.end();++it)
+	{
+		TextureChunk* chunk=*it;
+		if(chunk->evictable && chunk->lastUsedFrame+TEXTURE_EVICTION_AGE<textureFrame)
+			candidates.push_back(chunk);
+	}
+	sort(candidates.begin(), candidates.end(),
+		[](const TextureChunk* a, const TextureChunk* b) { return a->lastUsedFrame<b->lastUsedFrame; });
+	for(uint32_t i=0;i<candidates.size() && usedBlocks>budgetBlocks;i++)
+	{
+		TextureChunk* chunk=candidates[i];
+		usedBlocks-=chunk->getNumberOfChunks();
+		freeBlocks(*chunk);
+		liveChunks.erase(chunk);
+		delete[] chunk->chunks;
+		chunk->chunks=NULL;
+		chunk->width=0;
+		chunk->height=0;
+		//The owner will be invalidated the next time it is rendered
+		chunk->evicted=true;
+		textureStats.evictedChunks++;
+	}
+}
+
+bool RenderThread::compactTexture()
+{
+	if(compactionFramebuffer==0)
+		return false;
+	const uint32_t blocksPerSide=largeTextureSize/CHUNKSIZE;
+	const uint32_t blocksPerTexture=blocksPerSide*blocksPerSide;
+	//Find the least used texture, it can be freed if its blocks fit in the others
+	uint32_t source=(uint32_t)-1;
+	for(uint32_t i=0;i<largeTextures.size();i++)
+	{
+		const LargeTexture& tex=largeTextures[i];
+		if(tex.released || tex.id==(uint32_t)-1 || tex.usedBlocks==0)
+			continue;
+		if(source==(uint32_t)-1 || tex.usedBlocks<largeTextures[source].usedBlocks)
+			source=i;
+	}
+	if(source==(uint32_t)-1)
+		return false;
+	uint32_t freeBlocksElsewhere=0;
+	for(uint32_t i=0;i<largeTextures.size();i++)
+	{
+		const LargeTexture& tex=largeTextures[i];
+		//Empty textures are about to be released, don't fill them again
+		if(i!=source && !tex.released && tex.id!=(uint32_t)-1 && tex.usedBlocks)
+			freeBlocksElsewhere+=blocksPerTexture-tex.usedBlocks;
+	}
+	if(largeTextures[source].usedBlocks>freeBlocksElsewhere)
+		return false;
+
+	vector<TextureChunk*> toMove;
+	for(auto it=liveChunks.begin();it!=liveChunks.end();++it)
+	{
+		if((*it)->texId==source)
+			toMove.push_back(*it);
+	}
+
+	//Blocks are copied on the GPU, reading from the source texture through a framebuffer
+	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(compactionFramebuffer);
+	engineData->exec_glFramebufferTexture2D_GL_FRAMEBUFFER_GL_COLOR_ATTACHMENT0(largeTextures[source].id);
+	if(!engineData->exec_glCheckFramebufferStatus_GL_FRAMEBUFFER())
+	{
+		LOG(LOG_ERROR,_("Texture compaction framebuffer is not complete, compaction disabled"));
+		engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(0);
+		engineData->exec_glDeleteFramebuffers(1, &compactionFramebuffer);
+		compactionFramebuffer=0;
+		return false;
+	}
+	for(uint32_t i=0;i<toMove.size();i++)
+	{
+		TextureChunk* chunk=toMove[i];
+		const uint32_t numberOfBlocks=chunk->getNumberOfChunks();
+		//Best fit: the most used texture which still has enough free blocks
+		uint32_t dest=(uint32_t)-1;
+		for(uint32_t j=0;j<largeTextures.size();j++)
+		{
+			const LargeTexture& tex=largeTextures[j];
+			if(j==source || tex.released || tex.id==(uint32_t)-1 || tex.usedBlocks==0 ||
+				blocksPerTexture-tex.usedBlocks<numberOfBlocks)
+				continue;
+			if(dest==(uint32_t)-1 || tex.usedBlocks>largeTextures[dest].usedBlocks)
+				dest=j;
+		}
+		if(dest==(uint32_t)-1)
+			break;
+		uint32_t* blocks=new uint32_t[numberOfBlocks];
+		bool done=allocateBlocksSparse(largeTextures[dest], blocks, numberOfBlocks);
+		assert(done);
+		engineData->exec_glBindTexture_GL_TEXTURE_2D(largeTextures[dest].id);
+		for(uint32_t j=0;j<numberOfBlocks;j++)
+		{
+			const uint32_t from=chunk->chunks[j];
+			const uint32_t to=blocks[j];
+			engineData->exec_glCopyTexSubImage2D_GL_TEXTURE_2D(0,
+					(to%blocksPerSide)*CHUNKSIZE, (to/blocksPerSide)*CHUNKSIZE,
+					(from%blocksPerSide)*CHUNKSIZE, (from/blocksPerSide)*CHUNKSIZE,
+					CHUNKSIZE, CHUNKSIZE);
+		}
+		freeBlocks(*chunk);
+		delete[] chunk->chunks;
+		chunk->chunks=blocks;
+		chunk->texId=dest;
+		textureStats.movedChunks++;
+	}
+	engineData->exec_glBindFramebuffer_GL_FRAMEBUFFER(0);
+	handleGLErrors();
+	return largeTextures[source].usedBlocks==0;
+}
+
+void RenderThread::releaseEmptyTextures()
+{
+	//The first texture is always kept, to avoid creating it again and again
+	for(uint32_t i=1;i<largeTextures.size();i++)
+	{
+		LargeTexture& tex=largeTextures[i];
+		if(tex.usedBlocks || tex.released || tex.id==(uint32_t)-1)
+			continue;
+		engineData->exec_glDeleteTextures(1,&tex.id);
+		tex.id=-1;
+		tex.released=true;
+		textureStats.releasedTextures++;
+	}
 }
 
 uint32_t RenderThread::allocateNewGLTexture() const
@@ -694,11 +1192,22 @@ RenderThread::LargeTexture& RenderThread::allocateNewTexture()
 {
 	//Signal that a new texture is needed
 	newTextureNeeded=true;
+	//Reuse a texture released before, if any
+	for(uint32_t i=0;i<largeTextures.size();i++)
+	{
+		if(largeTextures[i].released)
+		{
+			largeTextures[i].released=false;
+			textureStats.peakTextures=max(textureStats.peakTextures, allocatedTextureCount());
+			return largeTextures[i];
+		}
+	}
 	//Let's allocate the bitmap for the texture blocks, minumum block size is CHUNKSIZE
 	uint32_t bitmapSize=(largeTextureSize/CHUNKSIZE)*(largeTextureSize/CHUNKSIZE)/8;
 	uint8_t* bitmap=new uint8_t[bitmapSize];
 	memset(bitmap,0,bitmapSize);
 	largeTextures.emplace_back(bitmap);
+	textureStats.peakTextures=max(textureStats.peakTextures, allocatedTextureCount());
 	return largeTextures.back();
 }
 
@@ -708,10 +1217,14 @@ bool RenderThread::allocateChunkOnTextureCompact(LargeTexture& tex, TextureChunk
 	uint32_t start;
 	uint32_t blockPerSide=largeTextureSize/CHUNKSIZE;
 	uint32_t bitmapSize=blockPerSide*blockPerSide;
+	if(tex.usedBlocks+blocksW*blocksH>bitmapSize)
+		return false;
 	for(start=0;start<bitmapSize;start++)
 	{
+		//The rect must not wrap around to the next row
+		if(start%blockPerSide+blocksW>blockPerSide)
+			continue;
 		bool badRect=false;
-		//TODO: correct rect lookup
 		for(uint32_t i=0;i<blocksH;i++)
 		{
 			for(uint32_t j=0;j<blocksW;j++)
@@ -746,92 +1259,83 @@ bool RenderThread::allocateChunkOnTextureCompact(LargeTexture& tex, TextureChunk
 			ret.chunks[i*blocksW+j]=bitOffset;
 		}
 	}
+	tex.usedBlocks+=blocksW*blocksH;
 	return true;
 }
 
-bool RenderThread::allocateChunkOnTextureSparse(LargeTexture& tex, TextureChunk& ret, uint32_t blocksW, uint32_t blocksH)
+bool RenderThread::allocateBlocksSparse(LargeTexture& tex, uint32_t* blocks, uint32_t count)
 {
-	//Allocate a sparse set of texture chunks
-	uint32_t found=0;
 	uint32_t blockPerSide=largeTextureSize/CHUNKSIZE;
 	uint32_t bitmapSize=blockPerSide*blockPerSide;
-	//TODO: use the already allocated array
-	uint32_t* tmp=new uint32_t[blocksW*blocksH];
-	for(uint32_t i=0;i<bitmapSize;i++)
+	//Fast bailout, the number of free blocks is known
+	if(tex.usedBlocks+count>bitmapSize)
+		return false;
+	uint32_t found=0;
+	for(uint32_t i=0;i<bitmapSize && found<count;i++)
 	{
 		if((tex.bitmap[i/8]&(1<<(i%8)))==0)
 		{
 			tex.bitmap[i/8]|=1<<(i%8);
-			tmp[found]=i;
+			blocks[found]=i;
 			found++;
-			if(found==(blocksW*blocksH))
-				break;
 		}
 	}
-	if(found<blocksW*blocksH)
-	{
-		//This is considered the unfrequent case
-		for(uint32_t i=0;i<found;i++)
-		{
-			uint32_t bitOffset=tmp[i];
-			assert(tex.bitmap[bitOffset/8]&(1<<(bitOffset%8)));
-			tex.bitmap[bitOffset/8]^=(1<<(bitOffset%8));
-		}
-		delete[] tmp;
-		return false;
-	}
-	else
-	{
-		delete[] ret.chunks;
-		ret.chunks=tmp;
-		return true;
-	}
+	assert(found==count);
+	tex.usedBlocks+=count;
+	return true;
 }
 
-TextureChunk RenderThread::allocateTexture(uint32_t w, uint32_t h, bool compact)
+bool RenderThread::allocateChunkOnTextureSparse(LargeTexture& tex, TextureChunk& ret, uint32_t blocksW, uint32_t blocksH)
+{
+	//Allocate a sparse set of texture chunks
+	return allocateBlocksSparse(tex, ret.chunks, blocksW*blocksH);
+}
+
+TextureChunk RenderThread::allocateTexture(uint32_t w, uint32_t h, bool compact, bool evictable)
 {
 	assert(w && h);
-	Locker l(mutexLargeTexture);
 	//Find the number of blocks needed for the given w and h
 	uint32_t blocksW=(w+CHUNKSIZE-1)/CHUNKSIZE;
 	uint32_t blocksH=(h+CHUNKSIZE-1)/CHUNKSIZE;
 	TextureChunk ret(w, h);
-	//Try to find a good place in the available textures
-	uint32_t index=0;
-	for(index=0;index<largeTextures.size();index++)
+	ret.evictable=evictable;
+	ret.lastUsedFrame=textureFrame;
+	//The lock must be released before returning, as moving ret takes it again
 	{
-		if(compact)
+		Locker l(mutexLargeTexture);
+		bool done=false;
+		//Try to find a good place in the available textures
+		for(uint32_t index=0;index<largeTextures.size() && !done;index++)
 		{
-			if(allocateChunkOnTextureCompact(largeTextures[index], ret, blocksW, blocksH))
-			{
+			if(largeTextures[index].released)
+				continue;
+			if(compact)
+				done=allocateChunkOnTextureCompact(largeTextures[index], ret, blocksW, blocksH);
+			else
+				done=allocateChunkOnTextureSparse(largeTextures[index], ret, blocksW, blocksH);
+			if(done)
 				ret.texId=index;
-				return ret;
-			}
 		}
-		else
+		if(!done)
 		{
-			if(allocateChunkOnTextureSparse(largeTextures[index], ret, blocksW, blocksH))
-			{
-				ret.texId=index;
-				return ret;
-			}
+			//No place found, allocate a new one and try on that
+			LargeTexture& tex=allocateNewTexture();
+			if(compact)
+				done=allocateChunkOnTextureCompact(tex, ret, blocksW, blocksH);
+			else
+				done=allocateChunkOnTextureSparse(tex, ret, blocksW, blocksH);
+			if(done)
+				ret.texId=&tex-&largeTextures[0];
 		}
+		if(!done)
+		{
+			//We were not able to allocate the whole surface on a single page
+			LOG(LOG_NOT_IMPLEMENTED,"Support multi page surface allocation");
+			ret.makeEmpty();
+		}
+		else
+			liveChunks.insert(&ret);
 	}
-	//No place found, allocate a new one and try on that
-	LargeTexture& tex=allocateNewTexture();
-	bool done;
-	if(compact)
-		done=allocateChunkOnTextureCompact(tex, ret, blocksW, blocksH);
-	else
-		done=allocateChunkOnTextureSparse(tex, ret, blocksW, blocksH);
-	if(!done)
-	{
-		//We were not able to allocate the whole surface on a single page
-		LOG(LOG_NOT_IMPLEMENTED,"Support multi page surface allocation");
-		ret.makeEmpty();
-	}
-	else
-		ret.texId=index;
 	return ret;
 }
 
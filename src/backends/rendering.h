@@ -22,6 +22,7 @@
 
 #include "backends/rendering_context.h"
 #include "timer.h"
+#include <unordered_set>
 #include <glibmm/timeval.h>
 #include <SDL2/SDL.h>
 #ifdef _WIN32
@@ -32,6 +33,41 @@ namespace lightspark
 {
 class ThreadProfile;
 
+/*
+	Counters about the textures used to store the cached surfaces
+*/
+class TextureStatistics
+{
+public:
+	TextureStatistics():textures(0),peakTextures(0),releasedTextures(0),blocksPerTexture(0),usedBlocks(0),
+		chunks(0),evictedChunks(0),movedChunks(0){}
+	//Number of GL textures currently allocated and the maximum ever allocated
+	uint32_t textures;
+	uint32_t peakTextures;
+	//Number of textures deleted since they were not used anymore
+	uint32_t releasedTextures;
+	uint32_t blocksPerTexture;
+	uint32_t usedBlocks;
+	//Number of chunks currently allocated
+	uint32_t chunks;
+	uint64_t evictedChunks;
+	//Chunks moved to another texture to free fragmented ones
+	uint64_t movedChunks;
+	//Fraction of the allocated blocks which is in use
+	float occupancy() const
+	{
+		return textures?float(usedBlocks)/(textures*blocksPerTexture):0;
+	}
+	//Fraction of the allocated textures which would not be needed if the blocks were packed
+	float fragmentation() const
+	{
+		if(textures==0)
+			return 0;
+		uint32_t neededTextures=(usedBlocks+blocksPerTexture-1)/blocksPerTexture;
+		return float(textures-neededTextures)/textures;
+	}
+};
+
 class DLL_PUBLIC RenderThread: public ITickJob, public GLRenderContext
 {
 friend class DisplayObject;
@@ -51,6 +87,25 @@ private:
 	LargeTexture& allocateNewTexture();
 	bool allocateChunkOnTextureCompact(LargeTexture& tex, TextureChunk& ret, uint32_t blocksW, uint32_t blocksH);
 	bool allocateChunkOnTextureSparse(LargeTexture& tex, TextureChunk& ret, uint32_t blocksW, uint32_t blocksH);
+	bool allocateBlocksSparse(LargeTexture& tex, uint32_t* blocks, uint32_t count);
+	/*
+		Texture management, the following must be called with mutexLargeTexture held
+	*/
+	//All the chunks currently allocated
+	std::unordered_set<TextureChunk*> liveChunks;
+	uint32_t textureFrame;
+	uint64_t textureBudget;
+	uint32_t compactionFramebuffer;
+	TextureStatistics textureStats;
+	void freeBlocks(const TextureChunk& chunk);
+	uint32_t allocatedTextureCount() const;
+	void evictTextures();
+	bool compactTexture();
+	void releaseEmptyTextures();
+	/*
+		Periodically enforces the memory budget and compacts fragmented textures
+	*/
+	void manageTextures();
 	//Possible events to be handled
 	//TODO: pad to avoid false sharing on the cache lines
 	volatile bool renderNeeded;
@@ -89,6 +144,45 @@ private:
 	*/
 	void coreRendering();
 	void plotProfilingData();
+	/*
+		Dirty region tracking
+		The stage is rendered into a persistent framebuffer. Every frame the
+		quads emitted by the display list are collected and compared with the
+		ones of the previous frame, so that only the window areas whose content
+		changed are repainted before the framebuffer is composited on screen
+	*/
+	class RenderedQuad
+	{
+	public:
+		uint32_t texId;
+		uint32_t firstChunk;
+		ClipRect bounds;
+		float alpha;
+		COLOR_MODE colorMode;
+	};
+	std::vector<RenderedQuad> renderedQuads;
+	std::vector<RenderedQuad> collectedQuads;
+	//Textures uploaded since the last frame, see quadKey
+	std::unordered_set<uint64_t> uploadedChunks;
+	std::vector<ClipRect> dirtyRects;
+	uint32_t stageFramebuffer;
+	uint32_t stageTextureID;
+	uint32_t stageBackground;
+	bool collectingQuads;
+	bool fullRedrawNeeded;
+	static uint64_t quadKey(uint32_t texId, uint32_t firstChunk)
+	{
+		return (uint64_t(texId)<<32)|firstChunk;
+	}
+	/*
+		Bounds in window pixels of a quad drawn with the current modelview matrix
+	*/
+	ClipRect quadBounds(int32_t x, int32_t y, uint32_t w, uint32_t h) const;
+	void addDirtyRect(const ClipRect& r);
+	void computeDirtyRects();
+	void allocateStageFramebuffer();
+	void renderStage();
+	void compositeStage();
 	Semaphore initialized;
 	Mutex mutexRendering;
 
@@ -113,11 +207,16 @@ public:
 	/**
 		Allocates a chunk from the shared texture
 	*/
-	TextureChunk allocateTexture(uint32_t w, uint32_t h, bool compact);
+	TextureChunk allocateTexture(uint32_t w, uint32_t h, bool compact, bool evictable=false);
 	/**
 		Release texture
 	*/
 	void releaseTexture(const TextureChunk& chunk);
+	/**
+		Move the allocation owned by src to dst, releasing the one of dst
+	*/
+	void moveTexture(TextureChunk& dst, TextureChunk& src);
+	void getTextureStatistics(TextureStatistics& stats);
 	/**
 		Load the given data in the given texture chunk
 	*/
@@ -126,6 +225,16 @@ public:
 		Enqueue something to be uploaded to texture
 	*/
 	void addUploadJob(ITextureUploadable* u);
+	/**
+		Records the quads for dirty region tracking and skips the ones outside the clipped area
+	*/
+	void renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
+			float alpha, COLOR_MODE colorMode);
+	/**
+		The clipping rectangle is in window coordinates and is applied using the scissor test
+	*/
+	void setClipRect(const ClipRect& r);
+	void resetClipRect();
 
 	void requestResize(uint32_t w, uint32_t h, bool force);
 	void waitForInitialization()
@@ -49,11 +49,38 @@ const float RenderContext::lsIdentityMatrix[16] = {
 
 const CachedSurface CairoRenderContext::invalidSurface;
 
-RenderContext::RenderContext(CONTEXT_TYPE t):contextType(t)
+void ClipRect::merge(const ClipRect& r)
+{
+	xmin=min(xmin,r.xmin);
+	ymin=min(ymin,r.ymin);
+	xmax=max(xmax,r.xmax);
+	ymax=max(ymax,r.ymax);
+}
+
+void ClipRect::intersect(const ClipRect& r)
+{
+	xmin=max(xmin,r.xmin);
+	ymin=max(ymin,r.ymin);
+	xmax=min(xmax,r.xmax);
+	ymax=min(ymax,r.ymax);
+}
+
+RenderContext::RenderContext(CONTEXT_TYPE t):clipping(false),contextType(t)
 {
 	lsglLoadIdentity();
 }
 
+void RenderContext::setClipRect(const ClipRect& r)
+{
+	clipping=true;
+	clipRect=r;
+}
+
+void RenderContext::resetClipRect()
+{
+	clipping=false;
+}
+
 void RenderContext::lsglLoadMatrixf(const float *m)
 {
 	memcpy(lsMVPMatrix, m, LSGL_MATRIX_SIZE);
@@ -311,6 +338,9 @@ void CairoRenderContext::renderTextured(const TextureChunk& chunk, int32_t x, in
 			float alpha, COLOR_MODE colorMode)
 {
 	//TODO: support alpha, and colorMode
+	//Nothing to do if the quad is outside of the clipped area
+	if(clipping && !clipRect.intersects(ClipRect(x, y, x+int32_t(w), y+int32_t(h))))
+		return;
 	uint8_t* buf=(uint8_t*)chunk.chunks;
 	cairo_surface_t* chunkSurface = getCairoSurfaceForData(buf, chunk.width, chunk.height);
 	cairo_pattern_t* chunkPattern = cairo_pattern_create_for_surface(chunkSurface);
@@ -327,6 +357,20 @@ void CairoRenderContext::renderTextured(const TextureChunk& chunk, int32_t x, in
 	cairo_fill(cr);
 }
 
+void CairoRenderContext::setClipRect(const ClipRect& r)
+{
+	RenderContext::setClipRect(r);
+	cairo_reset_clip(cr);
+	cairo_rectangle(cr, r.xmin, r.ymin, r.xmax-r.xmin, r.ymax-r.ymin);
+	cairo_clip(cr);
+}
+
+void CairoRenderContext::resetClipRect()
+{
+	RenderContext::resetClipRect();
+	cairo_reset_clip(cr);
+}
+
 const CachedSurface& CairoRenderContext::getCachedSurface(const DisplayObject* d) const
 {
 	auto ret=customSurfaces.find(d);
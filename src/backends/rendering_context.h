@@ -29,6 +29,41 @@ namespace lightspark
 
 enum VertexAttrib { VERTEX_ATTRIB=0, COLOR_ATTRIB, TEXCOORD_ATTRIB};
 
+/*
+ * A rectangle in the pixel coordinates of the render target, top-left origin.
+ * The max coordinates are exclusive.
+ */
+class ClipRect
+{
+public:
+	int32_t xmin;
+	int32_t ymin;
+	int32_t xmax;
+	int32_t ymax;
+	ClipRect():xmin(0),ymin(0),xmax(0),ymax(0){}
+	ClipRect(int32_t x1, int32_t y1, int32_t x2, int32_t y2):xmin(x1),ymin(y1),xmax(x2),ymax(y2){}
+	bool isEmpty() const { return xmax<=xmin || ymax<=ymin; }
+	uint64_t area() const { return isEmpty()?0:uint64_t(xmax-xmin)*uint64_t(ymax-ymin); }
+	bool intersects(const ClipRect& r) const
+	{
+		return xmin<r.xmax && r.xmin<xmax && ymin<r.ymax && r.ymin<ymax;
+	}
+	/* Like intersects, but also true for rectangles sharing an edge */
+	bool touches(const ClipRect& r) const
+	{
+		return xmin<=r.xmax && r.xmin<=xmax && ymin<=r.ymax && r.ymin<=ymax;
+	}
+	/* Enlarge this rectangle to the bounding box of both */
+	void merge(const ClipRect& r);
+	/* Shrink this rectangle to the intersection of both */
+	void intersect(const ClipRect& r);
+	bool operator==(const ClipRect& r) const
+	{
+		return xmin==r.xmin && ymin==r.ymin && xmax==r.xmax && ymax==r.ymax;
+	}
+	bool operator!=(const ClipRect& r) const { return !(*this==r); }
+};
+
 /*
  * The RenderContext contains all (public) functions that are needed by DisplayObjects to draw themselves.
  */
@@ -41,6 +76,9 @@ protected:
 	std::stack<float*> lsglMatrixStack;
 	~RenderContext(){}
 	void lsglMultMatrixf(const float *m);
+	/* Clipping */
+	bool clipping;
+	ClipRect clipRect;
 public:
 	enum CONTEXT_TYPE { CAIRO=0, GL };
 	RenderContext(CONTEXT_TYPE t);
@@ -64,6 +102,16 @@ public:
 	 * Get the right CachedSurface from an object
 	 */
 	virtual const CachedSurface& getCachedSurface(const DisplayObject* obj) const=0;
+
+	/* Clipping */
+	/**
+		Restrict rendering to the given rectangle of the render target.
+		Quads completely outside of it are skipped
+	*/
+	virtual void setClipRect(const ClipRect& r);
+	virtual void resetClipRect();
+	bool isClipping() const { return clipping; }
+	const ClipRect& getClipRect() const { return clipRect; }
 };
 
 class GLRenderContext: public RenderContext
@@ -86,7 +134,11 @@ protected:
 	public:
 		uint32_t id;
 		uint8_t* bitmap;
-		LargeTexture(uint8_t* b):id(-1),bitmap(b){}
+		//Number of blocks set in bitmap
+		uint32_t usedBlocks;
+		//The GL texture has been deleted because no block was used, it is created again on demand
+		bool released;
+		LargeTexture(uint8_t* b):id(-1),bitmap(b),usedBlocks(0),released(false){}
 		~LargeTexture(){/*delete[] bitmap;*/}
 	};
 	std::vector<LargeTexture> largeTextures;
@@ -137,6 +189,8 @@ public:
 	 * In the Cairo case we get the right CachedSurface out of the map
 	 */
 	const CachedSurface& getCachedSurface(const DisplayObject* obj) const;
+	void setClipRect(const ClipRect& r);
+	void resetClipRect();
 
 	/**
 	 * The CairoRenderContext acquires the ownership of the buffer
@@ -0,0 +1,214 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "backends/sharedobjectstore.h"
+#include "backends/config.h"
+#include "logger.h"
+#include "compat.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <fstream>
+#include <cerrno>
+#include <cstdio>
+
+using namespace lightspark;
+using namespace std;
+
+SharedObjectStore::SharedObjectStore():t(NULL),stopped(false)
+{
+	const Config* config=Config::getConfig();
+	directory=config->getCacheDirectory()+G_DIR_SEPARATOR_S+config->getCachePrefix()+"-sharedobjects";
+}
+
+SharedObjectStore::~SharedObjectStore()
+{
+	{
+		Locker l(mutex);
+		stopped=true;
+		newWrite.signal();
+	}
+	//The worker writes everything that is still pending before exiting
+	if(t)
+		t->join();
+}
+
+void SharedObjectStore::appendEscaped(string& ret, const tiny_string& s)
+{
+	//Keep only safe characters, so that no path can escape the directory
+	const char* buf=s.raw_buf();
+	for(uint32_t i=0;i<s.numBytes();i++)
+	{
+		char c=buf[i];
+		if(g_ascii_isalnum(c) || c=='-' || c=='_')
+			ret+=c;
+		else
+		{
+			char esc[4];
+			snprintf(esc,4,"%%%02X",(uint8_t)c);
+			ret+=esc;
+		}
+	}
+}
+
+string SharedObjectStore::getFileName(const tiny_string& host, const tiny_string& name) const
+{
+	//The name contains the local path of the object
+	string ret=directory+G_DIR_SEPARATOR_S;
+	//Local files have no host
+	if(host.empty())
+		ret+="localhost";
+	else
+		appendEscaped(ret, host);
+	ret+=G_DIR_SEPARATOR_S;
+	appendEscaped(ret, name);
+	ret+=".sol";
+	return ret;
+}
+
+bool SharedObjectStore::load(const tiny_string& host, const tiny_string& name, vector<uint8_t>& data)
+{
+	const string filename=getFileName(host, name);
+	{
+		Locker l(mutex);
+		auto it=pending.find(filename);
+		if(it!=pending.end())
+		{
+			data=it->second.data;
+			return !it->second.remove;
+		}
+		if(writingFile==filename)
+		{
+			data=writing.data;
+			return !writing.remove;
+		}
+	}
+	ifstream f(filename.c_str(), ios::in|ios::binary);
+	if(!f.is_open())
+		return false;
+	f.seekg(0, ios::end);
+	streamoff size=f.tellg();
+	if(size<=0)
+		return false;
+	f.seekg(0, ios::beg);
+	data.resize(size);
+	f.read((char*)&data[0], size);
+	if(f.fail())
+	{
+		LOG(LOG_ERROR,_("Could not read shared object ") << filename);
+		data.clear();
+		return false;
+	}
+	return true;
+}
+
+void SharedObjectStore::queue(const tiny_string& host, const tiny_string& name, PendingWrite& w)
+{
+	const string filename=getFileName(host, name);
+	Locker l(mutex);
+	if(stopped)
+		return;
+	PendingWrite& p=pending[filename];
+	p.data.swap(w.data);
+	p.remove=w.remove;
+	if(t==NULL)
+	{
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+		t = Thread::create(sigc::mem_fun(this,&SharedObjectStore::worker));
+#else
+		t = Thread::create(sigc::mem_fun(this,&SharedObjectStore::worker),true);
+#endif
+	}
+	newWrite.signal();
+}
+
+void SharedObjectStore::store(const tiny_string& host, const tiny_string& name, vector<uint8_t>& data)
+{
+	PendingWrite w;
+	w.data.swap(data);
+	queue(host, name, w);
+}
+
+void SharedObjectStore::remove(const tiny_string& host, const tiny_string& name)
+{
+	PendingWrite w;
+	w.remove=true;
+	queue(host, name, w);
+}
+
+void SharedObjectStore::writeFile(const string& filename, const PendingWrite& w)
+{
+	if(w.remove)
+	{
+		if(g_unlink(filename.c_str())!=0 && errno!=ENOENT)
+			LOG(LOG_ERROR,_("Could not delete shared object ") << filename);
+		return;
+	}
+	//The directory of the host
+	gchar* dirname=g_path_get_dirname(filename.c_str());
+	const string hostDirectory(dirname);
+	g_free(dirname);
+	if(g_mkdir_with_parents(hostDirectory.c_str(), 0700)!=0)
+	{
+		LOG(LOG_ERROR,_("Could not create directory ") << hostDirectory);
+		return;
+	}
+	//Write to a temporary file and rename it, so that a crash never leaves a truncated object
+	const string tmpname=filename+".tmp";
+	ofstream f(tmpname.c_str(), ios::out|ios::binary|ios::trunc);
+	if(!w.data.empty())
+		f.write((const char*)&w.data[0], w.data.size());
+	f.close();
+	if(f.fail())
+	{
+		LOG(LOG_ERROR,_("Could not write shared object ") << tmpname);
+		g_unlink(tmpname.c_str());
+		return;
+	}
+#ifdef _WIN32
+	//rename does not replace existing files on Windows
+	g_unlink(filename.c_str());
+#endif
+	if(g_rename(tmpname.c_str(), filename.c_str())!=0)
+	{
+		LOG(LOG_ERROR,_("Could not rename shared object ") << tmpname);
+		g_unlink(tmpname.c_str());
+	}
+}
+
+void SharedObjectStore::worker()
+{
+	Locker l(mutex);
+	while(true)
+	{
+		while(pending.empty() && !stopped)
+			newWrite.wait(mutex);
+		if(pending.empty())
+			break;
+		auto it=pending.begin();
+		writingFile=it->first;
+		writing.data.swap(it->second.data);
+		writing.remove=it->second.remove;
+		pending.erase(it);
+		l.release();
+		writeFile(writingFile, writing);
+		l.acquire();
+		writingFile.clear();
+		writing.data.clear();
+	}
+}
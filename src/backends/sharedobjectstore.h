@@ -0,0 +1,85 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_SHAREDOBJECTSTORE_H
+#define BACKENDS_SHAREDOBJECTSTORE_H 1
+
+#include "compat.h"
+#include "threading.h"
+#include "tiny_string.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lightspark
+{
+
+/*
+ * Keeps the serialized data of local SharedObjects in files under the cache
+ * directory, in a subdirectory for each host so that SWFs of different
+ * origins never see each other's objects. Writes are queued and done by a dedicated thread, so that the
+ * VM thread never waits for the disk. When an object is flushed again before
+ * its previous data has been written, only the latest data is written
+ */
+class SharedObjectStore
+{
+private:
+	class PendingWrite
+	{
+	public:
+		std::vector<uint8_t> data;
+		//The file must be deleted instead of written
+		bool remove;
+		PendingWrite():remove(false){}
+	};
+	std::string directory;
+	Mutex mutex;
+	Cond newWrite;
+	Thread* t;
+	//Keyed by file name, so flushes of the same object are coalesced
+	std::map<std::string, PendingWrite> pending;
+	//The write that the worker is doing right now, it is still visible to load()
+	std::string writingFile;
+	PendingWrite writing;
+	bool stopped;
+	static void appendEscaped(std::string& ret, const tiny_string& s);
+	std::string getFileName(const tiny_string& host, const tiny_string& name) const;
+	void queue(const tiny_string& host, const tiny_string& name, PendingWrite& w);
+	void writeFile(const std::string& filename, const PendingWrite& w);
+	void worker();
+public:
+	SharedObjectStore();
+	/*
+	 * Writes all the pending data before returning
+	 */
+	~SharedObjectStore();
+	/*
+	 * Get the last stored data of the named object, including data that has not been
+	 * written yet. Returns false if nothing has been stored
+	 */
+	bool load(const tiny_string& host, const tiny_string& name, std::vector<uint8_t>& data);
+	/*
+	 * Queue the data to be written, the vector is swapped out
+	 */
+	void store(const tiny_string& host, const tiny_string& name, std::vector<uint8_t>& data);
+	void remove(const tiny_string& host, const tiny_string& name);
+};
+
+};
+#endif /* BACKENDS_SHAREDOBJECTSTORE_H */
@@ -47,10 +47,10 @@ size_t StreamCache::markFinished(bool _failed)
 	return receivedLength;
 }
 
-void StreamCache::waitForData(size_t currentOffset)
+void StreamCache::waitForData(size_t currentOffset, const std::atomic<bool>* aborted)
 {
 	stateMutex.lock();
-	while (receivedLength <= currentOffset && !terminated)
+	while (receivedLength <= currentOffset && !terminated && !(aborted && *aborted))
 	{
 		stateMutex.unlock();
 		sys->waitMainSignal();
@@ -59,6 +59,11 @@ void StreamCache::waitForData(size_t currentOffset)
 	stateMutex.unlock();
 }
 
+void StreamCache::wakeReaders()
+{
+	sys->sendMainSignal();
+}
+
 void StreamCache::waitForTermination()
 {
 	stateMutex.lock();
@@ -89,20 +94,33 @@ void StreamCache::append(const unsigned char* buffer, size_t length)
 class lightspark::MemoryChunk {
 public:
 	MemoryChunk(size_t len);
+	// The chunk references the pages of a mapped file, it is full
+	// and it can not be written
+	MemoryChunk(GMappedFile* file);
 	~MemoryChunk();
+	GMappedFile* const mappedFile;
 	unsigned char * const buffer;
 	const size_t capacity;
 	ACQUIRE_RELEASE_VARIABLE(size_t, used);
 };
 
 MemoryChunk::MemoryChunk(size_t len) :
-	buffer(new unsigned char[len]), capacity(len), used(0)
+	mappedFile(NULL), buffer(new unsigned char[len]), capacity(len), used(0)
+{
+}
+
+MemoryChunk::MemoryChunk(GMappedFile* file) :
+	mappedFile(file), buffer((unsigned char*)g_mapped_file_get_contents(file)),
+	capacity(g_mapped_file_get_length(file)), used(capacity)
 {
 }
 
 MemoryChunk::~MemoryChunk()
 {
-	delete[] buffer;
+	if (mappedFile)
+		g_mapped_file_unref(mappedFile);
+	else
+		delete[] buffer;
 }
 
 MemoryStreamCache::MemoryStreamCache(SystemState* _sys):StreamCache(_sys),
@@ -181,6 +199,46 @@ void MemoryStreamCache::reserve(size_t expectedLength)
 		nextChunkSize = expectedLength - allocated;
 }
 
+/**
+ * \brief Uses the pages of a local file as the cache
+ *
+ * Maps \c filename in memory, readers access the file data without
+ * copying it. Must be called before append().
+ * \return false if the file could not be mapped, the cache is left
+ * untouched and the data must be appended as usual
+ */
+bool MemoryStreamCache::mapFile(const tiny_string& filename)
+{
+	assert(chunks.empty());
+
+	GError* error=NULL;
+	GMappedFile* file=g_mapped_file_new(filename.raw_buf(), FALSE, &error);
+	if (!file)
+	{
+		LOG(LOG_INFO, _("NET: Cannot map local file: ") << filename << " " << error->message);
+		g_error_free(error);
+		return false;
+	}
+	// Empty files can not be mapped
+	if (g_mapped_file_get_length(file) == 0)
+	{
+		g_mapped_file_unref(file);
+		return false;
+	}
+
+	{
+		Locker locker(chunkListMutex);
+		chunks.push_back(new MemoryChunk(file));
+	}
+	stateMutex.lock();
+	receivedLength = chunks.back()->capacity;
+	stateMutex.unlock();
+
+	// We already have the whole file
+	markFinished();
+	return true;
+}
+
 std::streambuf *MemoryStreamCache::createReader()
 {
 	incRef();
@@ -193,11 +251,17 @@ void MemoryStreamCache::openForWriting()
 }
 
 MemoryStreamCache::Reader::Reader(_R<MemoryStreamCache> b) :
-	buffer(b), chunkIndex(0), chunkStartOffset(0)
+	buffer(b), aborted(false), chunkIndex(0), chunkStartOffset(0)
 {
 	setg(NULL, NULL, NULL);
 }
 
+void MemoryStreamCache::Reader::abortRead()
+{
+	aborted = true;
+	buffer->wakeReaders();
+}
+
 /**
  * \brief Called by the streambuf API
  *
@@ -205,6 +269,9 @@ MemoryStreamCache::Reader::Reader(_R<MemoryStreamCache> b) :
  */
 int MemoryStreamCache::Reader::underflow()
 {
+	if (aborted)
+		return EOF;
+
 	Locker locker(buffer->chunkListMutex);
 
 	// Wait until there is some data to be read or until terminated
@@ -214,7 +281,9 @@ int MemoryStreamCache::Reader::underflow()
 	if (!buffer->hasTerminated() && !hasMoreChunks && !lastChunkHasBytes)
 	{
 		locker.release();
-		buffer->waitForData(getOffset());
+		buffer->waitForData(getOffset(), &aborted);
+		if (aborted)
+			return EOF;
 		locker.acquire();
 	}
 
@@ -493,14 +562,22 @@ std::streambuf *FileStreamCache::createReader()
 	return fbuf;
 }
 
-FileStreamCache::Reader::Reader(_R<FileStreamCache> b) : buffer(b)
+FileStreamCache::Reader::Reader(_R<FileStreamCache> b) : buffer(b), aborted(false)
 {
 }
 
+void FileStreamCache::Reader::abortRead()
+{
+	aborted = true;
+	buffer->wakeReaders();
+}
+
 int FileStreamCache::Reader::underflow()
 {
 	if (!buffer->hasTerminated())
-		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in));
+		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in), &aborted);
+	if (aborted)
+		return EOF;
 
 	return filebuf::underflow();
 }
@@ -510,9 +587,11 @@ streamsize FileStreamCache::Reader::xsgetn(char* s, streamsize n)
 	streamsize read=filebuf::xsgetn(s, n);
 
 	// If not enough data was available, wait for writer
-	while (read < n)
+	while (read < n && !aborted)
 	{
-		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in));
+		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in), &aborted);
+		if (aborted)
+			break;
 
 		streamsize b = filebuf::xsgetn(s+read, n-read);
 
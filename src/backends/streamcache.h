@@ -32,6 +32,18 @@
 namespace lightspark
 {
 
+/*
+ * Implemented by stream buffers whose reads may block waiting for another
+ * thread. abortRead() can be called from any thread, it wakes up a blocked
+ * reader and makes all the following reads return EOF.
+ */
+class abortable_streambuf
+{
+public:
+	virtual ~abortable_streambuf() {}
+	virtual void abortRead()=0;
+};
+
 /*
  * A single-writer-multiple-reader buffer for downloaded streams.
  *
@@ -57,9 +69,12 @@ protected:
 	bool notifyLoader:1;
 	SystemState* sys;
 
-	// Wait until more than currentOffset bytes has been received
-	// or until terminated
-	void waitForData(size_t currentOffset);
+	// Wait until more than currentOffset bytes has been received,
+	// until terminated or until *aborted is set
+	void waitForData(size_t currentOffset, const std::atomic<bool>* aborted=NULL);
+
+	// Wakes up the readers blocked in waitForData
+	void wakeReaders();
 
 	// Derived class implements this to store received data
 	virtual void handleAppend(const unsigned char* buffer, size_t length)=0;
@@ -106,9 +121,10 @@ class MemoryChunk;
  */
 class DLL_PUBLIC MemoryStreamCache : public StreamCache {
 private:
-	class DLL_LOCAL Reader : public std::streambuf {
+	class DLL_LOCAL Reader : public std::streambuf, public abortable_streambuf {
 	private:
 		_R<MemoryStreamCache> buffer;
+		std::atomic<bool> aborted;
 		// The chunk that is currently being read
 		unsigned int chunkIndex;
 		// Offset at the start of current chunk
@@ -124,6 +140,7 @@ private:
 		std::streampos getOffset() const;
 	public:
 		Reader(_R<MemoryStreamCache> b);
+		void abortRead();
 	};
 
 	// Stream is stored into a sequence of memory chunks. The
@@ -154,6 +171,10 @@ public:
 	virtual std::streambuf *createReader();
 	
 	void openForWriting();
+
+	// Use the pages of a local file instead of copying it. Must be
+	// called before append(). Returns false if mapping failed.
+	bool mapFile(const tiny_string& filename);
 };
 
 /*
@@ -165,13 +186,15 @@ private:
 	 * Extends filebuf to wait for writer thread to supply more
 	 * data when the end of temporary file is reached.
 	 */
-	class DLL_LOCAL Reader : public std::filebuf {
+	class DLL_LOCAL Reader : public std::filebuf, public abortable_streambuf {
 	private:
 		_R<FileStreamCache> buffer;
+		std::atomic<bool> aborted;
 		virtual int underflow();
 		virtual std::streamsize xsgetn(char* s, std::streamsize n);
 	public:
 		Reader(_R<FileStreamCache> buffer);
+		void abortRead();
 	};
 
 	//Cache filename
@@ -21,10 +21,27 @@
 #define BACKENDS_XML_SUPPORT_H 1
 
 #include "tiny_string.h"
+#include "smartrefs.h"
 #include <3rdparty/pugixml/src/pugixml.hpp>
 namespace lightspark
 {
 
+/*
+ * A parsed document, shared by all the objects referencing its nodes.
+ * XML trees are built lazily, so the nodes may outlive the object that parsed them
+ */
+class XMLSharedDocument: public RefCountable
+{
+public:
+	pugi::xml_document doc;
+	/*
+	 * Settings in effect when the document was parsed,
+	 * nodes built later must not see changes made in the meantime
+	 */
+	uint32_t defaultns;
+	bool ignorewhitespace;
+	XMLSharedDocument():defaultns(0),ignorewhitespace(true) {}
+};
 
 /*
  * Base class for both XML and XMLNode
@@ -32,8 +49,8 @@ namespace lightspark
 class XMLBase
 {
 protected:
-	//The parser will destroy the document and all the childs on destruction
-	pugi::xml_document xmldoc;
+	//The document is released when the last object referencing its nodes is gone
+	_NR<XMLSharedDocument> xmldoc;
 	const pugi::xml_node buildFromString(const tiny_string& str,
 										unsigned int xmlparsemode,
 										const tiny_string& default_ns=tiny_string());
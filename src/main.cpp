@@ -19,9 +19,11 @@
 
 #include "version.h"
 #include "backends/security.h"
+#include "backends/streamcache.h"
 #include "swf.h"
 #include "logger.h"
 #include "platforms/engineutils.h"
+#include "platforms/fastpaths.h"
 #include "compat.h"
 #include <SDL2/SDL.h>
 
@@ -126,6 +128,8 @@ int main(int argc, char* argv[])
 	bool useInterpreter=true;
 	bool useFastInterpreter=false;
 	bool useJit=false;
+	int optimizationThreshold=-1;
+	int jitThreshold=-1;
 	SystemState::ERROR_TYPE exitOnError=SystemState::ERROR_PARSING;
 	LOG_LEVEL log_level=LOG_INFO;
 	SystemState::FLASH_MODE flashMode=SystemState::FLASH;
@@ -165,6 +169,33 @@ int main(int argc, char* argv[])
 			useFastInterpreter=true;
 		else if(strcmp(argv[i],"-j")==0 || strcmp(argv[i],"--enable-jit")==0)
 			useJit=true;
+		else if(strcmp(argv[i],"-t")==0 || strcmp(argv[i],"--tiered")==0)
+		{
+			//Start in the interpreter and promote hot methods to the fast interpreter and the JIT
+			useInterpreter=true;
+			useFastInterpreter=true;
+			useJit=true;
+		}
+		else if(strcmp(argv[i],"--optimization-threshold")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				fileName=NULL;
+				break;
+			}
+			optimizationThreshold=max(0, atoi(argv[i]));
+		}
+		else if(strcmp(argv[i],"--jit-threshold")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				fileName=NULL;
+				break;
+			}
+			jitThreshold=max(0, atoi(argv[i]));
+		}
 		else if(strcmp(argv[i],"-l")==0 || strcmp(argv[i],"--log-level")==0)
 		{
 			i++;
@@ -223,6 +254,13 @@ int main(int argc, char* argv[])
 		{
 			exit(0);
 		}
+		else if(strcmp(argv[i],"--verify-kernels")==0)
+		{
+			//Self test of the SIMD pixel kernels, no SWF is loaded
+			bool ok=verifyPixelKernels();
+			cout << "Pixel kernels " << getPixelKernelsName() << ": " << (ok ? "OK" : "FAILED") << endl;
+			exit(ok ? 0 : 1);
+		}
 		else if(strcmp(argv[i],"--exit-on-error")==0)
 		{
 			exitOnError = SystemState::ERROR_ANY;
@@ -253,8 +291,9 @@ int main(int argc, char* argv[])
 	{
 		LOG(LOG_ERROR, "Usage: " << argv[0] << " [--url|-u http://loader.url/file.swf]" <<
 			" [--disable-interpreter|-ni] [--enable-fast-interpreter|-fi] [--enable-jit|-j]" <<
+			" [--tiered|-t] [--optimization-threshold count] [--jit-threshold count]" <<
 			" [--log-level|-l 0-4] [--parameters-file|-p params-file] [--security-sandbox|-s sandbox]" <<
-			" [--exit-on-error] [--HTTP-cookies cookie] [--air] [--avmplus]" <<
+			" [--exit-on-error] [--HTTP-cookies cookie] [--air] [--avmplus] [--verify-kernels]" <<
 #ifdef PROFILING_SUPPORT
 			" [--profiling-output|-o profiling-file]" <<
 #endif
@@ -285,7 +324,15 @@ int main(int argc, char* argv[])
 	}
 	//NOTE: see SystemState declaration
 	SystemState* sys = new SystemState(fileSize, flashMode);
-	ParseThread* pt = new ParseThread(f, sys->mainClip);
+	//Parse directly from the pages of the file when it can be mapped
+	_R<MemoryStreamCache> mappedFile(_MR(new MemoryStreamCache(sys)));
+	streambuf* mappedBuf=NULL;
+	if(mappedFile->mapFile(fileName))
+		mappedBuf=mappedFile->createReader();
+	istream mappedStream(mappedBuf);
+	if(mappedBuf)
+		mappedStream.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
+	ParseThread* pt = new ParseThread(mappedBuf ? mappedStream : f, sys->mainClip);
 	setTLSSys(sys);
 	sys->setDownloadedPath(fileName);
 
@@ -328,6 +375,10 @@ int main(int argc, char* argv[])
 	sys->useInterpreter=useInterpreter;
 	sys->useFastInterpreter=useFastInterpreter;
 	sys->useJit=useJit;
+	if(optimizationThreshold>=0)
+		sys->optimizationThreshold=optimizationThreshold;
+	if(jitThreshold>=0)
+		sys->jitThreshold=jitThreshold;
 	sys->exitOnError=exitOnError;
 	if(paramsFileName)
 		sys->parseParametersFromFile(paramsFileName);
@@ -367,6 +418,7 @@ int main(int argc, char* argv[])
 	EngineData::mainLoopThread->join();
 
 	delete pt;
+	delete mappedBuf;
 	delete sys;
 
 	SystemState::staticDeinit();
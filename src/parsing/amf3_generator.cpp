@@ -57,13 +57,10 @@ _R<ASObject> Amf3Deserializer::parseDouble() const
 		uint64_t dummy;
 		double val;
 	} tmp;
-	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
-
-	for(uint32_t i=0;i<8;i++)
-	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse double");
-	}
+	const uint8_t* buf=input->consumeBytes(8);
+	if(buf==NULL)
+		throw ParseException("Not enough data to parse double");
+	memcpy(&tmp.dummy,buf,8);
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
 	return _MR(abstract_d(input->getSystemState(),tmp.val));
 }
@@ -103,16 +100,12 @@ tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap)
 	}
 
 	uint32_t strLen=strRef>>1;
-	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
+	const uint8_t* buf=input->consumeBytes(strLen);
+	if(buf==NULL)
+		throw ParseException("Not enough data to parse string");
+	string retStr((const char*)buf,strLen);
 	//Add string to the map, if it's not the empty one
-	if(retStr.size())
+	if(strLen)
 		stringMap.emplace_back(retStr);
 	return retStr;
 }
@@ -223,42 +216,20 @@ _R<ASObject> Amf3Deserializer::parseVector(uint8_t marker, std::vector<tiny_stri
 	
 	int32_t count = vectorRef >> 1;
 
-	for(int32_t i=0;i<count;i++)
+	if (marker == vector_object_marker)
 	{
-		switch (marker)
+		for(int32_t i=0;i<count;i++)
 		{
-			case vector_int_marker:
-			{
-				uint32_t value = 0;
-				if (!input->readUnsignedInt(value))
-					throw ParseException("Not enough data to parse AMF3 vector");
-				ret->append(abstract_i(input->getSystemState(),value));
-				break;
-			}
-			case vector_uint_marker:
-			{
-				uint32_t value = 0;
-				if (!input->readUnsignedInt(value))
-					throw ParseException("Not enough data to parse AMF3 vector");
-				ret->append(abstract_ui(input->getSystemState(),value));
-				break;
-			}
-			case vector_double_marker:
-			{
-				_R<ASObject> v = parseDouble();
-				v->incRef();
-				ret->append(v.getPtr());
-				break;
-			}
-			case vector_object_marker:
-			{
-				_R<ASObject> value=parseValue(stringMap, objMap, traitsMap);
-				value->incRef();
-				ret->append(value.getPtr());
-				break;
-			}
+			_R<ASObject> value=parseValue(stringMap, objMap, traitsMap);
+			value->incRef();
+			ret->append(value.getPtr());
 		}
 	}
+	else if (!ret->appendSerialized(input,count))
+	{
+		//Numeric elements are read in a single block, without boxing them
+		throw ParseException("Not enough data to parse AMF3 vector");
+	}
 	// set fixed at last to avoid rangeError
 	ret->setFixed(b == 0x01);
 	return ret;
@@ -333,15 +304,12 @@ _R<ASObject> Amf3Deserializer::parseByteArray(std::vector<tiny_string>& stringMa
 	objMap.push_back(ret.getPtr());
 
 	
-	int32_t count = bytearrayRef >> 1;
-
-	for(int32_t i=0;i<count;i++)
-	{
-		uint8_t b;
-		if (!input->readByte(b))
-			throw ParseException("Not enough data to parse AMF3 bytearray");
-		ret->writeByte(b);
-	}
+	uint32_t count = bytearrayRef >> 1;
+	const uint8_t* buf=input->consumeBytes(count);
+	if (buf==NULL)
+		throw ParseException("Not enough data to parse AMF3 bytearray");
+	if (count)
+		memcpy(ret->reserveBytes(count),buf,count);
 	return ret;
 }
 
@@ -582,15 +550,10 @@ tiny_string Amf3Deserializer::parseStringAMF0() const
 	if(!input->readShort(strLen))
 		throw ParseException("Not enough data to parse integer");
 	
-	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
-	return retStr;
+	const uint8_t* buf=input->consumeBytes(strLen);
+	if(buf==NULL)
+		throw ParseException("Not enough data to parse string");
+	return string((const char*)buf,strLen);
 }
 _R<ASObject> Amf3Deserializer::parseECMAArrayAMF0(std::vector<tiny_string>& stringMap,
 			std::vector<ASObject*>& objMap,
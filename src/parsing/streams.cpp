@@ -55,6 +55,13 @@ int uncompressing_filter::underflow()
 	return (unsigned char)buffer[0];
 }
 
+void uncompressing_filter::abortRead()
+{
+	lightspark::abortable_streambuf* b=dynamic_cast<lightspark::abortable_streambuf*>(backend);
+	if(b)
+		b->abortRead();
+}
+
 streampos uncompressing_filter::seekoff(off_type off, ios_base::seekdir dir,ios_base::openmode mode)
 {
 	assert(off==0);
@@ -209,6 +216,169 @@ int liblzma_filter::fillBuffer()
 	return sizeof(buffer) - strm.avail_out;
 }
 
+pipelined_filter::pipelined_filter(streambuf* s):source(s),thread(NULL),head(0),tail(0),filled(0),
+	reading(false),finished(false),stopping(false),workerDone(false),consumed(0),decompressedBytes(0),decompressionTime(0)
+{
+	for(unsigned int i=0;i<BUFFER_COUNT;i++)
+	{
+		ring[i].data=new char[BUFFER_LENGTH];
+		ring[i].length=0;
+	}
+	setg(NULL,NULL,NULL);
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+	thread = lightspark::Thread::create(sigc::mem_fun(this,&pipelined_filter::decompress));
+#else
+	thread = lightspark::Thread::create(sigc::mem_fun(this,&pipelined_filter::decompress),true);
+#endif
+}
+
+pipelined_filter::~pipelined_filter()
+{
+	stop();
+	for(unsigned int i=0;i<BUFFER_COUNT;i++)
+		delete[] ring[i].data;
+}
+
+void pipelined_filter::stop()
+{
+	if(thread==NULL)
+		return;
+	lightspark::abortable_streambuf* abortable=dynamic_cast<lightspark::abortable_streambuf*>(source);
+	{
+		lightspark::Locker l(mutex);
+		stopping=true;
+		cond.broadcast();
+		//The thread may be blocked reading the source, waiting for data
+		//that is not coming. Abort the source until the thread notices,
+		//the wake up may be lost if it arrives just before the thread waits
+		while(!workerDone && abortable)
+		{
+			l.release();
+			abortable->abortRead();
+			l.acquire();
+			lightspark::CondTime timeout(STOP_RETRY_INTERVAL);
+			timeout.wait(mutex,cond);
+		}
+	}
+	thread->join();
+	thread=NULL;
+}
+
+void pipelined_filter::decompress()
+{
+	uint64_t startTime=compat_get_thread_cputime_us();
+	//The first chunks are small, so that the reader can start early
+	//when the compressed data is still being downloaded
+	unsigned int chunkLength=FIRST_CHUNK_LENGTH;
+	while(true)
+	{
+		chunk* c;
+		{
+			lightspark::Locker l(mutex);
+			while(filled==BUFFER_COUNT && !stopping)
+				cond.wait(mutex);
+			if(stopping)
+				break;
+			c=&ring[tail];
+		}
+		//The chunk is not visible to the reader until it is committed
+		c->length=0;
+		std::string failure;
+		bool sourceEnded=false;
+		try
+		{
+			while(c->length<(int)chunkLength && !sourceEnded)
+			{
+				unsigned int requested=chunkLength-c->length;
+				if(requested>READ_LENGTH)
+					requested=READ_LENGTH;
+				streamsize n=source->sgetn(c->data+c->length,requested);
+				c->length+=n;
+				sourceEnded=(n<(streamsize)requested);
+			}
+		}
+		catch(std::exception& e)
+		{
+			failure=e.what();
+			if(failure.empty())
+				failure="Decompression failed";
+		}
+		if(chunkLength<BUFFER_LENGTH)
+			chunkLength*=2;
+
+		lightspark::Locker l(mutex);
+		tail=(tail+1)%BUFFER_COUNT;
+		filled++;
+		decompressedBytes+=c->length;
+		error=failure;
+		finished=sourceEnded || !failure.empty();
+		cond.broadcast();
+		if(finished)
+			break;
+	}
+	lightspark::Locker l(mutex);
+	decompressionTime=compat_get_thread_cputime_us()-startTime;
+	workerDone=true;
+	cond.broadcast();
+}
+
+int pipelined_filter::underflow()
+{
+	assert(gptr()==egptr());
+	lightspark::Locker l(mutex);
+	if(reading)
+	{
+		//Give the current chunk back to the decompression thread
+		consumed+=(gptr()-eback());
+		head=(head+1)%BUFFER_COUNT;
+		filled--;
+		reading=false;
+		cond.broadcast();
+	}
+	while(filled==0 && !finished)
+		cond.wait(mutex);
+	if(filled==0)
+	{
+		setg(NULL,NULL,NULL);
+		if(!error.empty())
+			throw lightspark::ParseException(error);
+		return -1;
+	}
+	chunk& c=ring[head];
+	reading=true;
+	setg(c.data,c.data,c.data+c.length);
+	if(c.length==0)
+	{
+		//Only the last chunk can be empty, it may be empty because the decompression failed
+		if(!error.empty())
+			throw lightspark::ParseException(error);
+		return -1;
+	}
+	//Cast to unsigned, otherwise 0xff would become eof
+	return (unsigned char)c.data[0];
+}
+
+streampos pipelined_filter::seekoff(off_type off, ios_base::seekdir dir,ios_base::openmode mode)
+{
+	assert(off==0);
+	assert(dir==ios_base::cur);
+	//The current offset is the amount of byte completely consumed plus the amount used in the chunk
+	int ret=consumed+(gptr()-eback());
+	return ret;
+}
+
+uint64_t pipelined_filter::getDecompressedBytes()
+{
+	lightspark::Locker l(mutex);
+	return decompressedBytes;
+}
+
+uint64_t pipelined_filter::getDecompressionTime()
+{
+	lightspark::Locker l(mutex);
+	return decompressionTime;
+}
+
 void memorystream::handleError(const char* msg)
 {
 	throw lightspark::Class<lightspark::VerifyError>::getInstanceS(lightspark::getSys(),msg);
@@ -23,13 +23,15 @@
 #include "compat.h"
 #include "abctypes.h"
 #include "swftypes.h"
+#include "threading.h"
+#include "backends/streamcache.h"
 #include <streambuf>
 #include <fstream>
 #include <cinttypes>
 #include <zlib.h>
 #include <lzma.h>
 
-class uncompressing_filter: public std::streambuf
+class uncompressing_filter: public std::streambuf, public lightspark::abortable_streambuf
 {
 protected:
 	static const unsigned int BUFFER_LENGTH = 4096;
@@ -51,6 +53,9 @@ protected:
 	virtual int fillBuffer()=0;
 public:
 	uncompressing_filter(std::streambuf* b);
+	// Aborts the backend, if it supports it. The following reads
+	// fail as if the compressed data was truncated
+	void abortRead();
 };
 
 
@@ -80,6 +85,67 @@ public:
 	~liblzma_filter();
 };
 
+/*
+ * Runs an uncompressing_filter on a separate thread, which inflates
+ * into a ring of large buffers while the reader parses the previous
+ * ones. Errors of the decompression are rethrown to the reader when it
+ * reaches them.
+ */
+class pipelined_filter: public std::streambuf
+{
+private:
+	static const unsigned int BUFFER_COUNT = 4;
+	static const unsigned int BUFFER_LENGTH = 256*1024;
+	static const unsigned int FIRST_CHUNK_LENGTH = 16*1024;
+	// Amount read from the source at once
+	static const unsigned int READ_LENGTH = 4096;
+	// Milliseconds between the attempts to abort the source in stop()
+	static const unsigned int STOP_RETRY_INTERVAL = 50;
+	struct chunk
+	{
+		char* data;
+		int length;
+	};
+	// The source filter, read only by the decompression thread
+	std::streambuf* source;
+	lightspark::Thread* thread;
+	// mutex protects the ring and the state below
+	lightspark::Mutex mutex;
+	lightspark::Cond cond;
+	chunk ring[BUFFER_COUNT];
+	// The chunk being read is ring[head], ring[tail] is the next
+	// one to be filled
+	unsigned int head;
+	unsigned int tail;
+	unsigned int filled;
+	bool reading;
+	// Set when the source is over, or on errors
+	bool finished;
+	bool stopping;
+	// Set when the decompression thread is about to exit
+	bool workerDone;
+	std::string error;
+	// Total number of read bytes not including the current chunk
+	int consumed;
+	// Statistics of the decompression thread
+	uint64_t decompressedBytes;
+	uint64_t decompressionTime;
+	void decompress();
+	virtual int underflow();
+	virtual std::streampos seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode);
+public:
+	// The source is not owned and must survive this filter
+	pipelined_filter(std::streambuf* s);
+	~pipelined_filter();
+	// Waits for the decompression thread to exit, nothing can be read
+	// after this. If the thread is blocked on the source, the source is
+	// aborted, so it must not be read by anybody else afterwards
+	void stop();
+	uint64_t getDecompressedBytes();
+	// CPU time of the decompression thread in microseconds
+	uint64_t getDecompressionTime();
+};
+
 class bytes_buf:public std::streambuf
 {
 private:
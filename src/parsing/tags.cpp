@@ -822,13 +822,71 @@ ASObject* DefineFont4Tag::instance(Class_base* c) const
 	return ret;
 }
 
-BitmapTag::BitmapTag(RECORDHEADER h,RootMovieClip* root):DictionaryTag(h,root),bitmap(_MR(new BitmapContainer(root->getSystemState()->tagsMemory)))
+BitmapTag::BitmapTag(RECORDHEADER h,RootMovieClip* root):DictionaryTag(h,root),decodeJob(NULL),decoded(false),
+	bitmap(_MR(new BitmapContainer(root->getSystemState()->tagsMemory)))
 {
 }
 
+void BitmapTag::cancelDecoding()
+{
+	if(decodeJob==NULL)
+		return;
+	{
+		//Nobody needs the bitmap anymore, a job which did not start yet
+		//can skip the decoding
+		Locker l(decodeMutex);
+		decoded=true;
+	}
+	decodeJob->waitFinished();
+	delete decodeJob;
+	decodeJob=NULL;
+}
+
+void BitmapTag::decodeInBackground()
+{
+	assert(decodeJob==NULL);
+	decodeJob=new BitmapDecodeJob(this);
+	loadedFrom->getSystemState()->addJob(decodeJob);
+}
+
+void BitmapTag::decodeOnce()
+{
+	Locker l(decodeMutex);
+	if(decoded)
+		return;
+	decode();
+	data.clear();
+	data.shrink_to_fit();
+	RELEASE_WRITE(decoded,true);
+}
+
+void BitmapTag::ensureDecoded() const
+{
+	if(ACQUIRE_READ(decoded))
+		return;
+	//If the job is already running this waits for it to finish,
+	//otherwise the bitmap is decoded here and the job does nothing
+	const_cast<BitmapTag*>(this)->decodeOnce();
+}
+
 _R<BitmapContainer> BitmapTag::getBitmap() const {
+	ensureDecoded();
 	return bitmap;
 }
+
+void BitmapDecodeJob::execute()
+{
+	if(threadAborting)
+		return;
+	tag->decodeOnce();
+}
+
+void BitmapDecodeJob::jobFence()
+{
+	//The tag owns the job, it will be destroyed with the tag
+	finished.signal();
+}
+
 void BitmapTag::loadBitmap(uint8_t* inData, int datasize)
 {
 	if (datasize < 4)
@@ -842,7 +900,8 @@ void BitmapTag::loadBitmap(uint8_t* inData, int datasize)
 	else
 		LOG(LOG_ERROR,"unknown image format for ID "<<getId());
 }
-DefineBitsLosslessTag::DefineBitsLosslessTag(RECORDHEADER h, istream& in, int version, RootMovieClip* root):BitmapTag(h,root),BitmapColorTableSize(0)
+DefineBitsLosslessTag::DefineBitsLosslessTag(RECORDHEADER h, istream& in, int version, RootMovieClip* root):BitmapTag(h,root),BitmapColorTableSize(0),
+	version(version)
 {
 	int dest=in.tellg();
 	dest+=h.getLength();
@@ -851,10 +910,15 @@ DefineBitsLosslessTag::DefineBitsLosslessTag(RECORDHEADER h, istream& in, int ve
 	if(BitmapFormat==LOSSLESS_BITMAP_PALETTE)
 		in >> BitmapColorTableSize;
 
-	string cData;
 	size_t cSize = dest-in.tellg(); //rest of this tag
-	cData.resize(cSize);
-	in.read(&cData[0], cSize);
+	data.resize(cSize);
+	in.read((char*)data.data(), cSize);
+	decodeInBackground();
+}
+
+void DefineBitsLosslessTag::decode()
+{
+	string cData((const char*)data.data(), data.size());
 	istringstream cDataStream(cData);
 	zlib_filter zf(cDataStream.rdbuf());
 	istream zfstream(&zf);
@@ -916,6 +980,7 @@ ASObject* BitmapTag::instance(Class_base* c) const
 	Class_base* realClass=(c)?c:bindedTo;
 	Class_base* classRet = Class<BitmapData>::getClass(loadedFrom->getSystemState());
 
+	ensureDecoded();
 	if(!realClass)
 		return new (classRet->memoryAccount) BitmapData(classRet, bitmap);
 
@@ -1054,21 +1119,18 @@ DefineShapeTag::DefineShapeTag(RECORDHEADER h, std::istream& in,RootMovieClip* r
 {
 	LOG(LOG_TRACE,_("DefineShapeTag"));
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
 DefineShape2Tag::DefineShape2Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShapeTag(h,2,root)
 {
 	LOG(LOG_TRACE,_("DefineShape2Tag"));
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
 DefineShape3Tag::DefineShape3Tag(RECORDHEADER h, std::istream& in,RootMovieClip* root):DefineShape2Tag(h,3,root)
 {
 	LOG(LOG_TRACE,"DefineShape3Tag");
 	in >> ShapeId >> ShapeBounds >> Shapes;
-	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
 DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):DefineShape3Tag(h,4,root)
@@ -1081,6 +1143,26 @@ DefineShape4Tag::DefineShape4Tag(RECORDHEADER h, std::istream& in, RootMovieClip
 	UsesNonScalingStrokes=UB(1,bs);
 	UsesScalingStrokes=UB(1,bs);
 	in >> Shapes;
+}
+
+ASObject* DefineShapeTag::instance(Class_base* c) const
+{
+	/* Shapes are often defined and never placed, so the tokens
+	 * are computed at the first instance instead of in the parser
+	 */
+	if(tokens.empty())
+		computeCached();
+
+	if(c==NULL)
+		c=Class<Shape>::getClass(loadedFrom->getSystemState());
+	Shape* ret=new (c->memoryAccount) Shape(c, tokens, 1.0f/20.0f);
+	return ret;
+}
+
+void DefineShapeTag::computeCached() const
+{
+	if(!tokens.empty())
+		return;
 	TokenContainer::FromShaperecordListToShapeVector(Shapes.ShapeRecords,tokens,Shapes.FillStyles.FillStyles);
 }
 
@@ -1848,10 +1930,14 @@ DefineBitsTag::DefineBitsTag(RECORDHEADER h, std::istream& in,RootMovieClip* roo
 	in >> CharacterId;
 	//Read image data
 	int dataSize=Header.getLength()-2;
-	uint8_t *inData=new(nothrow) uint8_t[dataSize];
-	in.read((char*)inData,dataSize);
-	loadBitmap(inData,dataSize);
-	delete[] inData;
+	data.resize(dataSize);
+	in.read((char*)data.data(),dataSize);
+	decodeInBackground();
+}
+
+void DefineBitsTag::decode()
+{
+	loadBitmap(data.data(),data.size());
 }
 
 DefineBitsJPEG2Tag::DefineBitsJPEG2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):BitmapTag(h,root)
@@ -1860,57 +1946,65 @@ DefineBitsJPEG2Tag::DefineBitsJPEG2Tag(RECORDHEADER h, std::istream& in, RootMov
 	in >> CharacterId;
 	//Read image data
 	int dataSize=Header.getLength()-2;
-	uint8_t* inData=new(nothrow) uint8_t[dataSize];
-	in.read((char*)inData,dataSize);
-	loadBitmap(inData,dataSize);
-	delete[] inData;
+	data.resize(dataSize);
+	in.read((char*)data.data(),dataSize);
+	decodeInBackground();
 }
 
-DefineBitsJPEG3Tag::DefineBitsJPEG3Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):BitmapTag(h,root),alphaData(NULL)
+void DefineBitsJPEG2Tag::decode()
+{
+	loadBitmap(data.data(),data.size());
+}
+
+DefineBitsJPEG3Tag::DefineBitsJPEG3Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root):BitmapTag(h,root)
 {
 	LOG(LOG_TRACE,_("DefineBitsJPEG3Tag Tag"));
 	UI32_SWF dataSize;
 	in >> CharacterId >> dataSize;
 	//Read image data
-	uint8_t* inData=new(nothrow) uint8_t[dataSize];
-	in.read((char*)inData,dataSize);
-
-	loadBitmap(inData,dataSize);
-	delete[] inData;
+	data.resize(dataSize);
+	in.read((char*)data.data(),dataSize);
 
 	//Read alpha data (if any)
 	int alphaSize=Header.getLength()-dataSize-6;
 	if(alphaSize>0) //If less that 0 the consistency check on tag size will stop later
 	{
-		//Create a zlib filter
-		string alphaData;
 		alphaData.resize(alphaSize);
-		in.read(&alphaData[0], alphaSize);
-		istringstream alphaStream(alphaData);
-		zlib_filter zf(alphaStream.rdbuf());
-		istream zfstream(&zf);
-		zfstream.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
-
-		//Catch the exception if the stream ends
-		try
-		{
-			//Set alpha
-			for(int32_t i=0;i<bitmap->getHeight();i++)
-			{
-				for(int32_t j=0;j<bitmap->getWidth();j++)
-					bitmap->setAlpha(i, j, zfstream.get());
-			}
-		}
-		catch(std::exception& e)
-		{
-			LOG(LOG_ERROR, "Exception while parsing Alpha data in DefineBitsJPEG3");
-		}
+		in.read((char*)alphaData.data(), alphaSize);
 	}
+	decodeInBackground();
 }
 
-DefineBitsJPEG3Tag::~DefineBitsJPEG3Tag()
+void DefineBitsJPEG3Tag::decode()
 {
-	delete[] alphaData;
+	loadBitmap(data.data(),data.size());
+
+	if(alphaData.empty())
+		return;
+
+	//Create a zlib filter
+	string alphaString((const char*)alphaData.data(), alphaData.size());
+	istringstream alphaStream(alphaString);
+	zlib_filter zf(alphaStream.rdbuf());
+	istream zfstream(&zf);
+	zfstream.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
+
+	//Catch the exception if the stream ends
+	try
+	{
+		//Set alpha
+		for(int32_t i=0;i<bitmap->getHeight();i++)
+		{
+			for(int32_t j=0;j<bitmap->getWidth();j++)
+				bitmap->setAlpha(i, j, zfstream.get());
+		}
+	}
+	catch(std::exception& e)
+	{
+		LOG(LOG_ERROR, "Exception while parsing Alpha data in DefineBitsJPEG3");
+	}
+	alphaData.clear();
+	alphaData.shrink_to_fit();
 }
 
 DefineSceneAndFrameLabelDataTag::DefineSceneAndFrameLabelDataTag(RECORDHEADER h, std::istream& in):ControlTag(h)
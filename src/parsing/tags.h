@@ -24,6 +24,7 @@
 #include <vector>
 #include <iostream>
 #include "swftypes.h"
+#include "threading.h"
 #include "backends/geometry.h"
 #include "scripting/flash/utils/flashutils.h"
 #include "scripting/class.h"
@@ -112,19 +113,14 @@ protected:
 	UI16_SWF ShapeId;
 	RECT ShapeBounds;
 	SHAPEWITHSTYLE Shapes;
-	/* tokens are computed from Shapes */
-	tokensVector tokens;
+	/* tokens are computed from Shapes when the shape is first instanced */
+	mutable tokensVector tokens;
+	void computeCached() const;
 	DefineShapeTag(RECORDHEADER h,int v,RootMovieClip* root);
 public:
 	DefineShapeTag(RECORDHEADER h,std::istream& in, RootMovieClip* root);
 	virtual int getId() const{ return ShapeId; }
-	ASObject* instance(Class_base* c=NULL) const
-	{
-		if(c==NULL)
-			c=Class<Shape>::getClass(loadedFrom->getSystemState());
-		Shape* ret=new (c->memoryAccount) Shape(c, tokens, 1.0f/20.0f);
-		return ret;
-	}
+	ASObject* instance(Class_base* c=NULL) const;
 };
 
 class DefineShape2Tag: public DefineShapeTag
@@ -552,11 +548,51 @@ public:
 
 class BitmapContainer;
 
+class BitmapTag;
+
+/*
+ * Decodes the payload of a BitmapTag on the ThreadPool
+ */
+class BitmapDecodeJob: public IThreadJob
+{
+private:
+	BitmapTag* tag;
+	//Signaled when the job is over, whether it has been executed or not
+	Semaphore finished;
+public:
+	BitmapDecodeJob(BitmapTag* t):tag(t),finished(0){}
+	void execute();
+	void jobFence();
+	void waitFinished() { finished.wait(); }
+};
+
+/*
+ * The parser only copies the image data, decoding happens in background
+ * and the first user of the bitmap waits for it (or decodes it itself if
+ * the job did not start yet)
+ */
 class BitmapTag: public DictionaryTag
 {
+friend class BitmapDecodeJob;
+private:
+	BitmapDecodeJob* decodeJob;
+	//Serializes the decoding between the job and the users of the bitmap
+	Mutex decodeMutex;
+	ACQUIRE_RELEASE_FLAG(decoded);
+	void decodeOnce();
 protected:
         _R<BitmapContainer> bitmap;
+	//Compressed image data, released after decoding
+	std::vector<uint8_t> data;
     void loadBitmap(uint8_t* inData, int datasize);
+	//Called once with decodeMutex held
+	virtual void decode()=0;
+	//Subclasses call this at the end of their constructor
+	void decodeInBackground();
+	//Subclasses call this first in their destructor, decode() must not
+	//run while they are being destroyed
+	void cancelDecoding();
+	void ensureDecoded() const;
 public:
 	BitmapTag(RECORDHEADER h,RootMovieClip* root);
 	ASObject* instance(Class_base* c=NULL) const;
@@ -582,9 +618,12 @@ private:
 	UI16_SWF BitmapWidth;
 	UI16_SWF BitmapHeight;
 	UI8 BitmapColorTableSize;
-	//ZlibBitmapData;
+	int version;
+	//ZlibBitmapData is kept in data
+	void decode();
 public:
 	DefineBitsLosslessTag(RECORDHEADER h, std::istream& in, int version, RootMovieClip* root);
+	~DefineBitsLosslessTag() { cancelDecoding(); }
 	int getId() const{ return CharacterId; }
 };
 
@@ -592,8 +631,10 @@ class DefineBitsTag: public BitmapTag
 {
 private:
 	UI16_SWF CharacterId;
+	void decode();
 public:
 	DefineBitsTag(RECORDHEADER h, std::istream& in, RootMovieClip* root);
+	~DefineBitsTag() { cancelDecoding(); }
 	int getId() const{ return CharacterId; }
 };
 
@@ -601,8 +642,10 @@ class DefineBitsJPEG2Tag: public BitmapTag
 {
 private:
 	UI16_SWF CharacterId;
+	void decode();
 public:
 	DefineBitsJPEG2Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root);
+	~DefineBitsJPEG2Tag() { cancelDecoding(); }
 	int getId() const{ return CharacterId; }
 };
 
@@ -610,10 +653,12 @@ class DefineBitsJPEG3Tag: public BitmapTag
 {
 private:
 	UI16_SWF CharacterId;
-	uint8_t* alphaData;
+	//Zlib compressed alpha channel
+	std::vector<uint8_t> alphaData;
+	void decode();
 public:
 	DefineBitsJPEG3Tag(RECORDHEADER h, std::istream& in, RootMovieClip* root);
-	~DefineBitsJPEG3Tag();
+	~DefineBitsJPEG3Tag() { cancelDecoding(); }
 	int getId() const{ return CharacterId; }
 };
 
@@ -507,6 +507,14 @@ void EngineData::exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MAG_FILTER_GL_LIN
 {
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
+void EngineData::exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_S_GL_CLAMP_TO_EDGE()
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+}
+void EngineData::exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_T_GL_CLAMP_TO_EDGE()
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
 
 void EngineData::exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_BYTE(int32_t level,int32_t width, int32_t height,int32_t border, const void* pixels)
 {
@@ -567,6 +575,46 @@ void EngineData::exec_glGetIntegerv_GL_MAX_TEXTURE_SIZE(int32_t* data)
 	glGetIntegerv(GL_MAX_TEXTURE_SIZE,data);
 }
 
+void EngineData::exec_glGenFramebuffers(int32_t n,uint32_t* framebuffers)
+{
+	glGenFramebuffers(n,framebuffers);
+}
+
+void EngineData::exec_glDeleteFramebuffers(int32_t n,uint32_t* framebuffers)
+{
+	glDeleteFramebuffers(n,framebuffers);
+}
+
+void EngineData::exec_glFramebufferTexture2D_GL_FRAMEBUFFER_GL_COLOR_ATTACHMENT0(uint32_t texture)
+{
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+}
+
+bool EngineData::exec_glCheckFramebufferStatus_GL_FRAMEBUFFER()
+{
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE;
+}
+
+void EngineData::exec_glScissor(int32_t x,int32_t y,int32_t width,int32_t height)
+{
+	glScissor(x,y,width,height);
+}
+
+void EngineData::exec_glEnable_GL_SCISSOR_TEST()
+{
+	glEnable(GL_SCISSOR_TEST);
+}
+
+void EngineData::exec_glDisable_GL_SCISSOR_TEST()
+{
+	glDisable(GL_SCISSOR_TEST);
+}
+
+void EngineData::exec_glCopyTexSubImage2D_GL_TEXTURE_2D(int32_t level,int32_t xoffset,int32_t yoffset,int32_t x,int32_t y,int32_t width,int32_t height)
+{
+	glCopyTexSubImage2D(GL_TEXTURE_2D,level,xoffset,yoffset,x,y,width,height);
+}
+
 void mixer_effect_ffmpeg_cb(int chan, void * stream, int len, void * udata)
 {
 	AudioStream *s = (AudioStream*)udata;
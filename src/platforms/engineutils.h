@@ -160,6 +160,8 @@ public:
 	virtual void exec_glBufferData_GL_PIXEL_UNPACK_BUFFER_GL_STREAM_DRAW(int32_t size, const void* data);
 	virtual void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MIN_FILTER_GL_LINEAR();
 	virtual void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MAG_FILTER_GL_LINEAR();
+	virtual void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_S_GL_CLAMP_TO_EDGE();
+	virtual void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_T_GL_CLAMP_TO_EDGE();
 	virtual void exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_BYTE(int32_t level,int32_t width, int32_t height,int32_t border, const void* pixels);
 	virtual void exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_INT_8_8_8_8_HOST(int32_t level,int32_t width, int32_t height,int32_t border, const void* pixels);
 	virtual void exec_glDrawBuffer_GL_BACK();
@@ -170,6 +172,15 @@ public:
 	virtual void exec_glPixelStorei_GL_UNPACK_SKIP_ROWS(int32_t param);
 	virtual void exec_glTexSubImage2D_GL_TEXTURE_2D(int32_t level, int32_t xoffset, int32_t yoffset, int32_t width, int32_t height, const void* pixels, uint32_t w, uint32_t curX, uint32_t curY);
 	virtual void exec_glGetIntegerv_GL_MAX_TEXTURE_SIZE(int32_t* data);
+	virtual void exec_glGenFramebuffers(int32_t n,uint32_t* framebuffers);
+	virtual void exec_glDeleteFramebuffers(int32_t n,uint32_t* framebuffers);
+	virtual void exec_glFramebufferTexture2D_GL_FRAMEBUFFER_GL_COLOR_ATTACHMENT0(uint32_t texture);
+	//Returns true if the bound framebuffer is complete
+	virtual bool exec_glCheckFramebufferStatus_GL_FRAMEBUFFER();
+	virtual void exec_glScissor(int32_t x,int32_t y,int32_t width,int32_t height);
+	virtual void exec_glEnable_GL_SCISSOR_TEST();
+	virtual void exec_glDisable_GL_SCISSOR_TEST();
+	virtual void exec_glCopyTexSubImage2D_GL_TEXTURE_2D(int32_t level,int32_t xoffset,int32_t yoffset,int32_t x,int32_t y,int32_t width,int32_t height);
 
 	// Audio handling
 	virtual int audio_StreamInit(AudioStream* s);
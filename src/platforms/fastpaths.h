@@ -39,5 +39,79 @@ namespace lightspark
 */
 void fastYUV420ChannelsToYUV0Buffer(uint8_t* y, uint8_t* u, uint8_t* v, uint8_t* out, uint32_t width, uint32_t height);
 
+/*
+	Pixel kernels for BitmapData
+
+	All the kernels work on runs of native-endian 32 bit ARGB pixels, like the
+	rows of a BitmapContainer. The implementation (AVX2, SSE2, NEON or plain C)
+	is selected at runtime on first use, every implementation gives exactly
+	the same results of the plain C one. Source and destination may be the same
+	buffer, but must not partially overlap.
+*/
+
+/**
+	Set count pixels to color
+*/
+void fastFillPixels(uint32_t* dst, uint32_t count, uint32_t color);
+/**
+	Composite premultiplied src over premultiplied dst
+*/
+void fastBlendPixels(uint32_t* dst, const uint32_t* src, uint32_t count);
+/**
+	Copy the channel at bit srcShift of src into the channel at bit destShift of dst
+*/
+void fastCopyChannel(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift);
+/**
+	Copy the bits of src selected by mask into dst, the other bits of dst are preserved
+*/
+void fastMaskedCopyPixels(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask);
+/**
+	Reverse the byte order of every pixel, to convert from/to big-endian data
+*/
+void fastSwapPixels(uint32_t* dst, const uint32_t* src, uint32_t count);
+/**
+	In place conversion between straight and premultiplied alpha
+*/
+void fastPremultiplyPixels(uint32_t* pixels, uint32_t count);
+void fastUnpremultiplyPixels(uint32_t* pixels, uint32_t count);
+/**
+	In place color transformation of every channel of the pixels
+
+	@param multipliers Per channel multipliers, indexed by byte: blue, green, red, alpha
+	@param offsets Per channel offsets, in the same order
+*/
+void fastColorTransformPixels(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets);
+enum THRESHOLD_OP { THRESHOLD_LESS=0, THRESHOLD_LESS_EQUAL, THRESHOLD_GREATER, THRESHOLD_GREATER_EQUAL,
+	THRESHOLD_EQUAL, THRESHOLD_NOT_EQUAL };
+/**
+	Set the pixels of dst to color where (src & mask) op (threshold & mask) holds,
+	the other pixels are copied from src if copySource is true
+
+	@return The number of pixels set to color
+*/
+uint32_t fastThresholdPixels(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+		uint32_t threshold, uint32_t color, uint32_t mask, bool copySource);
+/**
+	Compute the difference of pixels a and b as BitmapData.compare does
+
+	@return true if any pixel is different
+*/
+bool fastComparePixels(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count);
+/**
+	Accumulate the value of each byte of the pixels in counts
+*/
+void fastHistogramPixels(const uint32_t* src, uint32_t count, uint32_t counts[4][256]);
+/**
+	Name of the selected pixel kernels implementation
+*/
+const char* getPixelKernelsName() DLL_PUBLIC;
+/**
+	Check every pixel kernels implementation this CPU can run against the
+	plain C one. Errors are logged
+
+	@return true if all the kernels give the same results
+*/
+bool verifyPixelKernels() DLL_PUBLIC;
+
 };
 #endif /* PLATFORMS_FASTPATHS_H */
@@ -0,0 +1,1198 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "platforms/fastpaths.h"
+#include "logger.h"
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define PIXELS_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIXELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace lightspark;
+using namespace std;
+
+namespace
+{
+
+struct PixelKernels
+{
+	const char* name;
+	void (*fillPixels)(uint32_t* dst, uint32_t count, uint32_t color);
+	void (*blendPixels)(uint32_t* dst, const uint32_t* src, uint32_t count);
+	void (*copyChannel)(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift);
+	void (*maskedCopyPixels)(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask);
+	void (*swapPixels)(uint32_t* dst, const uint32_t* src, uint32_t count);
+	void (*premultiplyPixels)(uint32_t* pixels, uint32_t count);
+	void (*unpremultiplyPixels)(uint32_t* pixels, uint32_t count);
+	void (*colorTransformPixels)(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets);
+	uint32_t (*thresholdPixels)(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+			uint32_t threshold, uint32_t color, uint32_t mask, bool copySource);
+	bool (*comparePixels)(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count);
+	void (*histogramPixels)(const uint32_t* src, uint32_t count, uint32_t counts[4][256]);
+};
+
+/*
+ * Plain C kernels. They are the reference for the vectorized ones,
+ * which also use them to process the pixels left over by the vector loops
+ */
+
+/* x*a/255 rounded to nearest, as pixman and cairo compute it */
+inline uint32_t mulUN8(uint32_t x, uint32_t a)
+{
+	uint32_t t=x*a+0x80;
+	return ((t>>8)+t)>>8;
+}
+
+void genericFillPixels(uint32_t* dst, uint32_t count, uint32_t color)
+{
+	for(uint32_t i=0;i<count;i++)
+		dst[i]=color;
+}
+
+void genericBlendPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t s=src[i];
+		const uint32_t d=dst[i];
+		const uint32_t ia=255-(s>>24);
+		uint32_t ret=0;
+		for(uint32_t shift=0;shift<32;shift+=8)
+		{
+			uint32_t c=((s>>shift)&0xff)+mulUN8((d>>shift)&0xff, ia);
+			if(c>255)
+				c=255;
+			ret|=c<<shift;
+		}
+		dst[i]=ret;
+	}
+}
+
+void genericCopyChannel(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift)
+{
+	const uint32_t keepMask=~(0xffu<<destShift);
+	for(uint32_t i=0;i<count;i++)
+		dst[i]=(dst[i]&keepMask)|(((src[i]>>srcShift)&0xff)<<destShift);
+}
+
+void genericMaskedCopyPixels(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask)
+{
+	for(uint32_t i=0;i<count;i++)
+		dst[i]=(dst[i]&~mask)|(src[i]&mask);
+}
+
+void genericSwapPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t v=src[i];
+		dst[i]=(v<<24)|((v<<8)&0xff0000)|((v>>8)&0xff00)|(v>>24);
+	}
+}
+
+void genericPremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t p=pixels[i];
+		const uint32_t a=p>>24;
+		pixels[i]=(a<<24)|(mulUN8((p>>16)&0xff, a)<<16)|(mulUN8((p>>8)&0xff, a)<<8)|mulUN8(p&0xff, a);
+	}
+}
+
+void genericUnpremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t p=pixels[i];
+		const uint32_t a=p>>24;
+		if(a==0)
+		{
+			pixels[i]=0;
+			continue;
+		}
+		uint32_t ret=a<<24;
+		for(uint32_t shift=0;shift<24;shift+=8)
+		{
+			uint32_t c=(((p>>shift)&0xff)*255+(a>>1))/a;
+			if(c>255)
+				c=255;
+			ret|=c<<shift;
+		}
+		pixels[i]=ret;
+	}
+}
+
+void genericColorTransformPixels(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets)
+{
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t p=pixels[i];
+		uint32_t ret=0;
+		for(uint32_t channel=0;channel<4;channel++)
+		{
+			/* Same operations and clamping order of the vector versions,
+			 * so that the results are bit exact */
+			float c=float((p>>(channel*8))&0xff)*multipliers[channel];
+			c+=offsets[channel];
+			c=(c>0.0f)?c:0.0f;
+			c=(c<255.0f)?c:255.0f;
+			ret|=uint32_t(c)<<(channel*8);
+		}
+		pixels[i]=ret;
+	}
+}
+
+inline bool thresholdTest(uint32_t value, uint32_t threshold, THRESHOLD_OP op)
+{
+	switch(op)
+	{
+		case THRESHOLD_LESS:
+			return value<threshold;
+		case THRESHOLD_LESS_EQUAL:
+			return value<=threshold;
+		case THRESHOLD_GREATER:
+			return value>threshold;
+		case THRESHOLD_GREATER_EQUAL:
+			return value>=threshold;
+		case THRESHOLD_EQUAL:
+			return value==threshold;
+		case THRESHOLD_NOT_EQUAL:
+			return value!=threshold;
+	}
+	return false;
+}
+
+uint32_t genericThresholdPixels(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+		uint32_t threshold, uint32_t color, uint32_t mask, bool copySource)
+{
+	const uint32_t maskedThreshold=threshold&mask;
+	uint32_t changed=0;
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t s=src[i];
+		if(thresholdTest(s&mask, maskedThreshold, op))
+		{
+			dst[i]=color;
+			changed++;
+		}
+		else if(copySource)
+			dst[i]=s;
+	}
+	return changed;
+}
+
+inline uint32_t comparePixel(uint32_t a, uint32_t b)
+{
+	if(a==b)
+		return 0;
+	else if(((a^b)&0x00ffffff)==0)
+		return ((a&0xff000000)-(b&0xff000000))|0x00ffffff;
+	else
+		return (a&0x00ffffff)-(b&0x00ffffff);
+}
+
+bool genericComparePixels(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count)
+{
+	bool different=false;
+	for(uint32_t i=0;i<count;i++)
+	{
+		dst[i]=comparePixel(a[i], b[i]);
+		different|=(a[i]!=b[i]);
+	}
+	return different;
+}
+
+void genericHistogramPixels(const uint32_t* src, uint32_t count, uint32_t counts[4][256])
+{
+	/* Histograms do not vectorize, this is shared by all the implementations */
+	for(uint32_t i=0;i<count;i++)
+	{
+		const uint32_t p=src[i];
+		counts[0][p&0xff]++;
+		counts[1][(p>>8)&0xff]++;
+		counts[2][(p>>16)&0xff]++;
+		counts[3][p>>24]++;
+	}
+}
+
+const PixelKernels genericKernels =
+{
+	"generic",
+	genericFillPixels,
+	genericBlendPixels,
+	genericCopyChannel,
+	genericMaskedCopyPixels,
+	genericSwapPixels,
+	genericPremultiplyPixels,
+	genericUnpremultiplyPixels,
+	genericColorTransformPixels,
+	genericThresholdPixels,
+	genericComparePixels,
+	genericHistogramPixels
+};
+
+/* Lane selectors for the threshold operation: less, equal, greater */
+inline void thresholdSelectors(THRESHOLD_OP op, int32_t& selLess, int32_t& selEqual, int32_t& selGreater)
+{
+	selLess=(op==THRESHOLD_LESS || op==THRESHOLD_LESS_EQUAL || op==THRESHOLD_NOT_EQUAL)?-1:0;
+	selEqual=(op==THRESHOLD_LESS_EQUAL || op==THRESHOLD_GREATER_EQUAL || op==THRESHOLD_EQUAL)?-1:0;
+	selGreater=(op==THRESHOLD_GREATER || op==THRESHOLD_GREATER_EQUAL || op==THRESHOLD_NOT_EQUAL)?-1:0;
+}
+
+#ifdef PIXELS_X86
+/*
+ * SSE2 kernels, 4 pixels at a time
+ */
+
+/* x*a/255 on 16 bit lanes */
+inline TARGET_SSE2 __m128i sse2MulUN8(__m128i x, __m128i a)
+{
+	__m128i t=_mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(0x80));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/* Broadcast the alpha of the 2 pixels unpacked in 16 bit lanes */
+inline TARGET_SSE2 __m128i sse2Alpha(__m128i x)
+{
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+}
+
+TARGET_SSE2 void sse2FillPixels(uint32_t* dst, uint32_t count, uint32_t color)
+{
+	const __m128i c=_mm_set1_epi32(color);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+		_mm_storeu_si128((__m128i*)(dst+i), c);
+	genericFillPixels(dst+i, count-i, color);
+}
+
+TARGET_SSE2 void sse2BlendPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	const __m128i zero=_mm_setzero_si128();
+	const __m128i ff=_mm_set1_epi16(0xff);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i s=_mm_loadu_si128((const __m128i*)(src+i));
+		const __m128i d=_mm_loadu_si128((const __m128i*)(dst+i));
+		const __m128i iaLo=_mm_xor_si128(sse2Alpha(_mm_unpacklo_epi8(s, zero)), ff);
+		const __m128i iaHi=_mm_xor_si128(sse2Alpha(_mm_unpackhi_epi8(s, zero)), ff);
+		const __m128i dLo=sse2MulUN8(_mm_unpacklo_epi8(d, zero), iaLo);
+		const __m128i dHi=sse2MulUN8(_mm_unpackhi_epi8(d, zero), iaHi);
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_adds_epu8(s, _mm_packus_epi16(dLo, dHi)));
+	}
+	genericBlendPixels(dst+i, src+i, count-i);
+}
+
+TARGET_SSE2 void sse2CopyChannel(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift)
+{
+	const __m128i srcCount=_mm_cvtsi32_si128(srcShift);
+	const __m128i destCount=_mm_cvtsi32_si128(destShift);
+	const __m128i keepMask=_mm_set1_epi32(~(0xffu<<destShift));
+	const __m128i byteMask=_mm_set1_epi32(0xff);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i s=_mm_loadu_si128((const __m128i*)(src+i));
+		const __m128i d=_mm_loadu_si128((const __m128i*)(dst+i));
+		const __m128i channel=_mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(s, srcCount), byteMask), destCount);
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_or_si128(_mm_and_si128(d, keepMask), channel));
+	}
+	genericCopyChannel(dst+i, src+i, count-i, srcShift, destShift);
+}
+
+TARGET_SSE2 void sse2MaskedCopyPixels(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask)
+{
+	const __m128i m=_mm_set1_epi32(mask);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i s=_mm_loadu_si128((const __m128i*)(src+i));
+		const __m128i d=_mm_loadu_si128((const __m128i*)(dst+i));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_or_si128(_mm_andnot_si128(m, d), _mm_and_si128(s, m)));
+	}
+	genericMaskedCopyPixels(dst+i, src+i, count-i, mask);
+}
+
+TARGET_SSE2 void sse2SwapPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		__m128i v=_mm_loadu_si128((const __m128i*)(src+i));
+		//Swap the 16 bit halves, then the bytes inside them
+		v=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+		v=_mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		_mm_storeu_si128((__m128i*)(dst+i), v);
+	}
+	genericSwapPixels(dst+i, src+i, count-i);
+}
+
+TARGET_SSE2 void sse2PremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	const __m128i zero=_mm_setzero_si128();
+	//The alpha lane is multiplied by 255, which leaves it unchanged
+	const __m128i colorLanes=_mm_set_epi16(0,-1,-1,-1,0,-1,-1,-1);
+	const __m128i alphaLane=_mm_set_epi16(255,0,0,0,255,0,0,0);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i p=_mm_loadu_si128((const __m128i*)(pixels+i));
+		const __m128i pLo=_mm_unpacklo_epi8(p, zero);
+		const __m128i pHi=_mm_unpackhi_epi8(p, zero);
+		const __m128i aLo=_mm_or_si128(_mm_and_si128(sse2Alpha(pLo), colorLanes), alphaLane);
+		const __m128i aHi=_mm_or_si128(_mm_and_si128(sse2Alpha(pHi), colorLanes), alphaLane);
+		_mm_storeu_si128((__m128i*)(pixels+i), _mm_packus_epi16(sse2MulUN8(pLo, aLo), sse2MulUN8(pHi, aHi)));
+	}
+	genericPremultiplyPixels(pixels+i, count-i);
+}
+
+/*
+ * The unpremultiply division is done in single precision: the numerator is
+ * an exact integer and the quotient is never close enough to the next integer
+ * to be rounded up, so truncation gives the same result of the integer division
+ */
+template<int shift>
+inline TARGET_SSE2 __m128i sse2UnpremultiplyChannel(__m128i p, __m128 half, __m128 alpha)
+{
+	const __m128 f255=_mm_set1_ps(255.0f);
+	const __m128 c=_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, shift), _mm_set1_epi32(0xff)));
+	const __m128 q=_mm_min_ps(_mm_div_ps(_mm_add_ps(_mm_mul_ps(c, f255), half), alpha), f255);
+	return _mm_slli_epi32(_mm_cvttps_epi32(q), shift);
+}
+
+TARGET_SSE2 void sse2UnpremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i p=_mm_loadu_si128((const __m128i*)(pixels+i));
+		const __m128i a=_mm_srli_epi32(p, 24);
+		const __m128 alpha=_mm_cvtepi32_ps(a);
+		const __m128 half=_mm_cvtepi32_ps(_mm_srli_epi32(a, 1));
+		__m128i ret=_mm_slli_epi32(a, 24);
+		ret=_mm_or_si128(ret, sse2UnpremultiplyChannel<0>(p, half, alpha));
+		ret=_mm_or_si128(ret, sse2UnpremultiplyChannel<8>(p, half, alpha));
+		ret=_mm_or_si128(ret, sse2UnpremultiplyChannel<16>(p, half, alpha));
+		//Fully transparent pixels become 0
+		ret=_mm_andnot_si128(_mm_cmpeq_epi32(a, _mm_setzero_si128()), ret);
+		_mm_storeu_si128((__m128i*)(pixels+i), ret);
+	}
+	genericUnpremultiplyPixels(pixels+i, count-i);
+}
+
+template<int shift>
+inline TARGET_SSE2 __m128i sse2TransformChannel(__m128i p, __m128 multiplier, __m128 offset)
+{
+	__m128 c=_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(p, shift), _mm_set1_epi32(0xff)));
+	c=_mm_add_ps(_mm_mul_ps(c, multiplier), offset);
+	c=_mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+	return _mm_slli_epi32(_mm_cvttps_epi32(c), shift);
+}
+
+TARGET_SSE2 void sse2ColorTransformPixels(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets)
+{
+	const __m128 m0=_mm_set1_ps(multipliers[0]);
+	const __m128 m1=_mm_set1_ps(multipliers[1]);
+	const __m128 m2=_mm_set1_ps(multipliers[2]);
+	const __m128 m3=_mm_set1_ps(multipliers[3]);
+	const __m128 o0=_mm_set1_ps(offsets[0]);
+	const __m128 o1=_mm_set1_ps(offsets[1]);
+	const __m128 o2=_mm_set1_ps(offsets[2]);
+	const __m128 o3=_mm_set1_ps(offsets[3]);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i p=_mm_loadu_si128((const __m128i*)(pixels+i));
+		__m128i ret=sse2TransformChannel<0>(p, m0, o0);
+		ret=_mm_or_si128(ret, sse2TransformChannel<8>(p, m1, o1));
+		ret=_mm_or_si128(ret, sse2TransformChannel<16>(p, m2, o2));
+		ret=_mm_or_si128(ret, sse2TransformChannel<24>(p, m3, o3));
+		_mm_storeu_si128((__m128i*)(pixels+i), ret);
+	}
+	genericColorTransformPixels(pixels+i, count-i, multipliers, offsets);
+}
+
+TARGET_SSE2 uint32_t sse2ThresholdPixels(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+		uint32_t threshold, uint32_t color, uint32_t mask, bool copySource)
+{
+	int32_t less, equal, greater;
+	thresholdSelectors(op, less, equal, greater);
+	const __m128i selLess=_mm_set1_epi32(less);
+	const __m128i selEqual=_mm_set1_epi32(equal);
+	const __m128i selGreater=_mm_set1_epi32(greater);
+	//SSE2 only has signed comparisons, flip the sign bit to compare unsigned values
+	const __m128i bias=_mm_set1_epi32(0x80000000);
+	const __m128i m=_mm_set1_epi32(mask);
+	const __m128i t=_mm_xor_si128(_mm_set1_epi32(threshold&mask), bias);
+	const __m128i c=_mm_set1_epi32(color);
+	__m128i changed=_mm_setzero_si128();
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i s=_mm_loadu_si128((const __m128i*)(src+i));
+		const __m128i v=_mm_xor_si128(_mm_and_si128(s, m), bias);
+		__m128i sel=_mm_and_si128(_mm_cmplt_epi32(v, t), selLess);
+		sel=_mm_or_si128(sel, _mm_and_si128(_mm_cmpeq_epi32(v, t), selEqual));
+		sel=_mm_or_si128(sel, _mm_and_si128(_mm_cmpgt_epi32(v, t), selGreater));
+		const __m128i other=copySource?s:_mm_loadu_si128((const __m128i*)(dst+i));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_or_si128(_mm_and_si128(sel, c), _mm_andnot_si128(sel, other)));
+		//Selected lanes are -1
+		changed=_mm_sub_epi32(changed, sel);
+	}
+	uint32_t lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, changed);
+	return lanes[0]+lanes[1]+lanes[2]+lanes[3]+
+		genericThresholdPixels(dst+i, src+i, count-i, op, threshold, color, mask, copySource);
+}
+
+TARGET_SSE2 bool sse2ComparePixels(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count)
+{
+	const __m128i rgbMask=_mm_set1_epi32(0x00ffffff);
+	const __m128i alphaMask=_mm_set1_epi32(0xff000000);
+	__m128i allEqual=_mm_set1_epi32(-1);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const __m128i va=_mm_loadu_si128((const __m128i*)(a+i));
+		const __m128i vb=_mm_loadu_si128((const __m128i*)(b+i));
+		const __m128i rgbA=_mm_and_si128(va, rgbMask);
+		const __m128i rgbB=_mm_and_si128(vb, rgbMask);
+		const __m128i equal=_mm_cmpeq_epi32(va, vb);
+		const __m128i rgbEqual=_mm_cmpeq_epi32(rgbA, rgbB);
+		const __m128i alphaDiff=_mm_or_si128(_mm_sub_epi32(_mm_and_si128(va, alphaMask), _mm_and_si128(vb, alphaMask)), rgbMask);
+		const __m128i rgbDiff=_mm_sub_epi32(rgbA, rgbB);
+		const __m128i ret=_mm_or_si128(_mm_and_si128(rgbEqual, alphaDiff), _mm_andnot_si128(rgbEqual, rgbDiff));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_andnot_si128(equal, ret));
+		allEqual=_mm_and_si128(allEqual, equal);
+	}
+	const bool different=(_mm_movemask_epi8(allEqual)!=0xffff);
+	return genericComparePixels(dst+i, a+i, b+i, count-i) || different;
+}
+
+const PixelKernels sse2Kernels =
+{
+	"SSE2",
+	sse2FillPixels,
+	sse2BlendPixels,
+	sse2CopyChannel,
+	sse2MaskedCopyPixels,
+	sse2SwapPixels,
+	sse2PremultiplyPixels,
+	sse2UnpremultiplyPixels,
+	sse2ColorTransformPixels,
+	sse2ThresholdPixels,
+	sse2ComparePixels,
+	genericHistogramPixels
+};
+
+/*
+ * AVX2 kernels, 8 pixels at a time. Unpacking and packing work inside
+ * the 128 bit lanes, so the pixel order is preserved
+ */
+
+inline TARGET_AVX2 __m256i avx2MulUN8(__m256i x, __m256i a)
+{
+	__m256i t=_mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(0x80));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+inline TARGET_AVX2 __m256i avx2Alpha(__m256i x)
+{
+	return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+}
+
+TARGET_AVX2 void avx2FillPixels(uint32_t* dst, uint32_t count, uint32_t color)
+{
+	const __m256i c=_mm256_set1_epi32(color);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+		_mm256_storeu_si256((__m256i*)(dst+i), c);
+	genericFillPixels(dst+i, count-i, color);
+}
+
+TARGET_AVX2 void avx2BlendPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	const __m256i zero=_mm256_setzero_si256();
+	const __m256i ff=_mm256_set1_epi16(0xff);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i s=_mm256_loadu_si256((const __m256i*)(src+i));
+		const __m256i d=_mm256_loadu_si256((const __m256i*)(dst+i));
+		const __m256i iaLo=_mm256_xor_si256(avx2Alpha(_mm256_unpacklo_epi8(s, zero)), ff);
+		const __m256i iaHi=_mm256_xor_si256(avx2Alpha(_mm256_unpackhi_epi8(s, zero)), ff);
+		const __m256i dLo=avx2MulUN8(_mm256_unpacklo_epi8(d, zero), iaLo);
+		const __m256i dHi=avx2MulUN8(_mm256_unpackhi_epi8(d, zero), iaHi);
+		_mm256_storeu_si256((__m256i*)(dst+i), _mm256_adds_epu8(s, _mm256_packus_epi16(dLo, dHi)));
+	}
+	sse2BlendPixels(dst+i, src+i, count-i);
+}
+
+TARGET_AVX2 void avx2CopyChannel(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift)
+{
+	const __m128i srcCount=_mm_cvtsi32_si128(srcShift);
+	const __m128i destCount=_mm_cvtsi32_si128(destShift);
+	const __m256i keepMask=_mm256_set1_epi32(~(0xffu<<destShift));
+	const __m256i byteMask=_mm256_set1_epi32(0xff);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i s=_mm256_loadu_si256((const __m256i*)(src+i));
+		const __m256i d=_mm256_loadu_si256((const __m256i*)(dst+i));
+		const __m256i channel=_mm256_sll_epi32(_mm256_and_si256(_mm256_srl_epi32(s, srcCount), byteMask), destCount);
+		_mm256_storeu_si256((__m256i*)(dst+i), _mm256_or_si256(_mm256_and_si256(d, keepMask), channel));
+	}
+	genericCopyChannel(dst+i, src+i, count-i, srcShift, destShift);
+}
+
+TARGET_AVX2 void avx2MaskedCopyPixels(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask)
+{
+	const __m256i m=_mm256_set1_epi32(mask);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i s=_mm256_loadu_si256((const __m256i*)(src+i));
+		const __m256i d=_mm256_loadu_si256((const __m256i*)(dst+i));
+		_mm256_storeu_si256((__m256i*)(dst+i), _mm256_or_si256(_mm256_andnot_si256(m, d), _mm256_and_si256(s, m)));
+	}
+	genericMaskedCopyPixels(dst+i, src+i, count-i, mask);
+}
+
+TARGET_AVX2 void avx2SwapPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	const __m256i order=_mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12,
+			3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i v=_mm256_loadu_si256((const __m256i*)(src+i));
+		_mm256_storeu_si256((__m256i*)(dst+i), _mm256_shuffle_epi8(v, order));
+	}
+	genericSwapPixels(dst+i, src+i, count-i);
+}
+
+TARGET_AVX2 void avx2PremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	const __m256i zero=_mm256_setzero_si256();
+	const __m256i colorLanes=_mm256_set_epi16(0,-1,-1,-1,0,-1,-1,-1,0,-1,-1,-1,0,-1,-1,-1);
+	const __m256i alphaLane=_mm256_set_epi16(255,0,0,0,255,0,0,0,255,0,0,0,255,0,0,0);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i p=_mm256_loadu_si256((const __m256i*)(pixels+i));
+		const __m256i pLo=_mm256_unpacklo_epi8(p, zero);
+		const __m256i pHi=_mm256_unpackhi_epi8(p, zero);
+		const __m256i aLo=_mm256_or_si256(_mm256_and_si256(avx2Alpha(pLo), colorLanes), alphaLane);
+		const __m256i aHi=_mm256_or_si256(_mm256_and_si256(avx2Alpha(pHi), colorLanes), alphaLane);
+		_mm256_storeu_si256((__m256i*)(pixels+i), _mm256_packus_epi16(avx2MulUN8(pLo, aLo), avx2MulUN8(pHi, aHi)));
+	}
+	sse2PremultiplyPixels(pixels+i, count-i);
+}
+
+template<int shift>
+inline TARGET_AVX2 __m256i avx2UnpremultiplyChannel(__m256i p, __m256 half, __m256 alpha)
+{
+	const __m256 f255=_mm256_set1_ps(255.0f);
+	const __m256 c=_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p, shift), _mm256_set1_epi32(0xff)));
+	const __m256 q=_mm256_min_ps(_mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(c, f255), half), alpha), f255);
+	return _mm256_slli_epi32(_mm256_cvttps_epi32(q), shift);
+}
+
+TARGET_AVX2 void avx2UnpremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i p=_mm256_loadu_si256((const __m256i*)(pixels+i));
+		const __m256i a=_mm256_srli_epi32(p, 24);
+		const __m256 alpha=_mm256_cvtepi32_ps(a);
+		const __m256 half=_mm256_cvtepi32_ps(_mm256_srli_epi32(a, 1));
+		__m256i ret=_mm256_slli_epi32(a, 24);
+		ret=_mm256_or_si256(ret, avx2UnpremultiplyChannel<0>(p, half, alpha));
+		ret=_mm256_or_si256(ret, avx2UnpremultiplyChannel<8>(p, half, alpha));
+		ret=_mm256_or_si256(ret, avx2UnpremultiplyChannel<16>(p, half, alpha));
+		ret=_mm256_andnot_si256(_mm256_cmpeq_epi32(a, _mm256_setzero_si256()), ret);
+		_mm256_storeu_si256((__m256i*)(pixels+i), ret);
+	}
+	sse2UnpremultiplyPixels(pixels+i, count-i);
+}
+
+template<int shift>
+inline TARGET_AVX2 __m256i avx2TransformChannel(__m256i p, __m256 multiplier, __m256 offset)
+{
+	__m256 c=_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(p, shift), _mm256_set1_epi32(0xff)));
+	//Keep multiplication and addition separate, a fused one would round differently
+	c=_mm256_add_ps(_mm256_mul_ps(c, multiplier), offset);
+	c=_mm256_min_ps(_mm256_max_ps(c, _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+	return _mm256_slli_epi32(_mm256_cvttps_epi32(c), shift);
+}
+
+TARGET_AVX2 void avx2ColorTransformPixels(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets)
+{
+	const __m256 m0=_mm256_set1_ps(multipliers[0]);
+	const __m256 m1=_mm256_set1_ps(multipliers[1]);
+	const __m256 m2=_mm256_set1_ps(multipliers[2]);
+	const __m256 m3=_mm256_set1_ps(multipliers[3]);
+	const __m256 o0=_mm256_set1_ps(offsets[0]);
+	const __m256 o1=_mm256_set1_ps(offsets[1]);
+	const __m256 o2=_mm256_set1_ps(offsets[2]);
+	const __m256 o3=_mm256_set1_ps(offsets[3]);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i p=_mm256_loadu_si256((const __m256i*)(pixels+i));
+		__m256i ret=avx2TransformChannel<0>(p, m0, o0);
+		ret=_mm256_or_si256(ret, avx2TransformChannel<8>(p, m1, o1));
+		ret=_mm256_or_si256(ret, avx2TransformChannel<16>(p, m2, o2));
+		ret=_mm256_or_si256(ret, avx2TransformChannel<24>(p, m3, o3));
+		_mm256_storeu_si256((__m256i*)(pixels+i), ret);
+	}
+	sse2ColorTransformPixels(pixels+i, count-i, multipliers, offsets);
+}
+
+TARGET_AVX2 uint32_t avx2ThresholdPixels(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+		uint32_t threshold, uint32_t color, uint32_t mask, bool copySource)
+{
+	int32_t less, equal, greater;
+	thresholdSelectors(op, less, equal, greater);
+	const __m256i selLess=_mm256_set1_epi32(less);
+	const __m256i selEqual=_mm256_set1_epi32(equal);
+	const __m256i selGreater=_mm256_set1_epi32(greater);
+	const __m256i bias=_mm256_set1_epi32(0x80000000);
+	const __m256i m=_mm256_set1_epi32(mask);
+	const __m256i t=_mm256_xor_si256(_mm256_set1_epi32(threshold&mask), bias);
+	const __m256i c=_mm256_set1_epi32(color);
+	__m256i changed=_mm256_setzero_si256();
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i s=_mm256_loadu_si256((const __m256i*)(src+i));
+		const __m256i v=_mm256_xor_si256(_mm256_and_si256(s, m), bias);
+		__m256i sel=_mm256_and_si256(_mm256_cmpgt_epi32(t, v), selLess);
+		sel=_mm256_or_si256(sel, _mm256_and_si256(_mm256_cmpeq_epi32(v, t), selEqual));
+		sel=_mm256_or_si256(sel, _mm256_and_si256(_mm256_cmpgt_epi32(v, t), selGreater));
+		const __m256i other=copySource?s:_mm256_loadu_si256((const __m256i*)(dst+i));
+		_mm256_storeu_si256((__m256i*)(dst+i), _mm256_blendv_epi8(other, c, sel));
+		changed=_mm256_sub_epi32(changed, sel);
+	}
+	uint32_t lanes[8];
+	_mm256_storeu_si256((__m256i*)lanes, changed);
+	uint32_t ret=0;
+	for(uint32_t j=0;j<8;j++)
+		ret+=lanes[j];
+	return ret+sse2ThresholdPixels(dst+i, src+i, count-i, op, threshold, color, mask, copySource);
+}
+
+TARGET_AVX2 bool avx2ComparePixels(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count)
+{
+	const __m256i rgbMask=_mm256_set1_epi32(0x00ffffff);
+	const __m256i alphaMask=_mm256_set1_epi32(0xff000000);
+	__m256i allEqual=_mm256_set1_epi32(-1);
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const __m256i va=_mm256_loadu_si256((const __m256i*)(a+i));
+		const __m256i vb=_mm256_loadu_si256((const __m256i*)(b+i));
+		const __m256i rgbA=_mm256_and_si256(va, rgbMask);
+		const __m256i rgbB=_mm256_and_si256(vb, rgbMask);
+		const __m256i equal=_mm256_cmpeq_epi32(va, vb);
+		const __m256i rgbEqual=_mm256_cmpeq_epi32(rgbA, rgbB);
+		const __m256i alphaDiff=_mm256_or_si256(_mm256_sub_epi32(_mm256_and_si256(va, alphaMask), _mm256_and_si256(vb, alphaMask)), rgbMask);
+		const __m256i rgbDiff=_mm256_sub_epi32(rgbA, rgbB);
+		const __m256i ret=_mm256_blendv_epi8(rgbDiff, alphaDiff, rgbEqual);
+		_mm256_storeu_si256((__m256i*)(dst+i), _mm256_andnot_si256(equal, ret));
+		allEqual=_mm256_and_si256(allEqual, equal);
+	}
+	const bool different=(_mm256_movemask_epi8(allEqual)!=-1);
+	return sse2ComparePixels(dst+i, a+i, b+i, count-i) || different;
+}
+
+const PixelKernels avx2Kernels =
+{
+	"AVX2",
+	avx2FillPixels,
+	avx2BlendPixels,
+	avx2CopyChannel,
+	avx2MaskedCopyPixels,
+	avx2SwapPixels,
+	avx2PremultiplyPixels,
+	avx2UnpremultiplyPixels,
+	avx2ColorTransformPixels,
+	avx2ThresholdPixels,
+	avx2ComparePixels,
+	genericHistogramPixels
+};
+#endif //PIXELS_X86
+
+#ifdef PIXELS_NEON
+/*
+ * NEON kernels. The blending ones deinterleave 8 pixels in planes
+ * of blue, green, red and alpha
+ */
+
+inline uint8x8_t neonMulUN8(uint8x8_t x, uint8x8_t a)
+{
+	const uint16x8_t t=vaddq_u16(vmull_u8(x, a), vdupq_n_u16(0x80));
+	return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+void neonFillPixels(uint32_t* dst, uint32_t count, uint32_t color)
+{
+	const uint32x4_t c=vdupq_n_u32(color);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+		vst1q_u32(dst+i, c);
+	genericFillPixels(dst+i, count-i, color);
+}
+
+void neonBlendPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		const uint8x8x4_t s=vld4_u8((const uint8_t*)(src+i));
+		uint8x8x4_t d=vld4_u8((const uint8_t*)(dst+i));
+		const uint8x8_t ia=vmvn_u8(s.val[3]);
+		for(int j=0;j<4;j++)
+			d.val[j]=vqadd_u8(s.val[j], neonMulUN8(d.val[j], ia));
+		vst4_u8((uint8_t*)(dst+i), d);
+	}
+	genericBlendPixels(dst+i, src+i, count-i);
+}
+
+void neonCopyChannel(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift)
+{
+	const int32x4_t srcCount=vdupq_n_s32(-int32_t(srcShift));
+	const int32x4_t destCount=vdupq_n_s32(destShift);
+	const uint32x4_t keepMask=vdupq_n_u32(~(0xffu<<destShift));
+	const uint32x4_t byteMask=vdupq_n_u32(0xff);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const uint32x4_t s=vld1q_u32(src+i);
+		const uint32x4_t d=vld1q_u32(dst+i);
+		const uint32x4_t channel=vshlq_u32(vandq_u32(vshlq_u32(s, srcCount), byteMask), destCount);
+		vst1q_u32(dst+i, vorrq_u32(vandq_u32(d, keepMask), channel));
+	}
+	genericCopyChannel(dst+i, src+i, count-i, srcShift, destShift);
+}
+
+void neonMaskedCopyPixels(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask)
+{
+	const uint32x4_t m=vdupq_n_u32(mask);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+		vst1q_u32(dst+i, vbslq_u32(m, vld1q_u32(src+i), vld1q_u32(dst+i)));
+	genericMaskedCopyPixels(dst+i, src+i, count-i, mask);
+}
+
+void neonSwapPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+		vst1q_u8((uint8_t*)(dst+i), vrev32q_u8(vld1q_u8((const uint8_t*)(src+i))));
+	genericSwapPixels(dst+i, src+i, count-i);
+}
+
+void neonPremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+8<=count;i+=8)
+	{
+		uint8x8x4_t p=vld4_u8((const uint8_t*)(pixels+i));
+		for(int j=0;j<3;j++)
+			p.val[j]=neonMulUN8(p.val[j], p.val[3]);
+		vst4_u8((uint8_t*)(pixels+i), p);
+	}
+	genericPremultiplyPixels(pixels+i, count-i);
+}
+
+#ifdef __aarch64__
+/* Only AArch64 has a correctly rounded vector division, see sse2UnpremultiplyChannel */
+inline uint32x4_t neonUnpremultiplyChannel(uint32x4_t p, int shift, float32x4_t half, float32x4_t alpha)
+{
+	const float32x4_t f255=vdupq_n_f32(255.0f);
+	const float32x4_t c=vcvtq_f32_u32(vandq_u32(vshlq_u32(p, vdupq_n_s32(-shift)), vdupq_n_u32(0xff)));
+	const float32x4_t q=vminq_f32(vdivq_f32(vaddq_f32(vmulq_f32(c, f255), half), alpha), f255);
+	return vshlq_u32(vcvtq_u32_f32(q), vdupq_n_s32(shift));
+}
+
+void neonUnpremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const uint32x4_t p=vld1q_u32(pixels+i);
+		const uint32x4_t a=vshrq_n_u32(p, 24);
+		const float32x4_t alpha=vcvtq_f32_u32(a);
+		const float32x4_t half=vcvtq_f32_u32(vshrq_n_u32(a, 1));
+		uint32x4_t ret=vshlq_n_u32(a, 24);
+		ret=vorrq_u32(ret, neonUnpremultiplyChannel(p, 0, half, alpha));
+		ret=vorrq_u32(ret, neonUnpremultiplyChannel(p, 8, half, alpha));
+		ret=vorrq_u32(ret, neonUnpremultiplyChannel(p, 16, half, alpha));
+		ret=vbicq_u32(ret, vceqq_u32(a, vdupq_n_u32(0)));
+		vst1q_u32(pixels+i, ret);
+	}
+	genericUnpremultiplyPixels(pixels+i, count-i);
+}
+
+inline uint32x4_t neonTransformChannel(uint32x4_t p, int shift, float32x4_t multiplier, float32x4_t offset)
+{
+	float32x4_t c=vcvtq_f32_u32(vandq_u32(vshlq_u32(p, vdupq_n_s32(-shift)), vdupq_n_u32(0xff)));
+	//Keep multiplication and addition separate, a fused one would round differently
+	c=vaddq_f32(vmulq_f32(c, multiplier), offset);
+	c=vminq_f32(vmaxq_f32(c, vdupq_n_f32(0.0f)), vdupq_n_f32(255.0f));
+	return vshlq_u32(vcvtq_u32_f32(c), vdupq_n_s32(shift));
+}
+
+void neonColorTransformPixels(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets)
+{
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const uint32x4_t p=vld1q_u32(pixels+i);
+		uint32x4_t ret=vdupq_n_u32(0);
+		for(int j=0;j<4;j++)
+			ret=vorrq_u32(ret, neonTransformChannel(p, j*8, vdupq_n_f32(multipliers[j]), vdupq_n_f32(offsets[j])));
+		vst1q_u32(pixels+i, ret);
+	}
+	genericColorTransformPixels(pixels+i, count-i, multipliers, offsets);
+}
+#endif //__aarch64__
+
+uint32_t neonThresholdPixels(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+		uint32_t threshold, uint32_t color, uint32_t mask, bool copySource)
+{
+	int32_t less, equal, greater;
+	thresholdSelectors(op, less, equal, greater);
+	const uint32x4_t selLess=vdupq_n_u32(less);
+	const uint32x4_t selEqual=vdupq_n_u32(equal);
+	const uint32x4_t selGreater=vdupq_n_u32(greater);
+	const uint32x4_t m=vdupq_n_u32(mask);
+	const uint32x4_t t=vdupq_n_u32(threshold&mask);
+	const uint32x4_t c=vdupq_n_u32(color);
+	uint32x4_t changed=vdupq_n_u32(0);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const uint32x4_t s=vld1q_u32(src+i);
+		const uint32x4_t v=vandq_u32(s, m);
+		uint32x4_t sel=vandq_u32(vcltq_u32(v, t), selLess);
+		sel=vorrq_u32(sel, vandq_u32(vceqq_u32(v, t), selEqual));
+		sel=vorrq_u32(sel, vandq_u32(vcgtq_u32(v, t), selGreater));
+		const uint32x4_t other=copySource?s:vld1q_u32(dst+i);
+		vst1q_u32(dst+i, vbslq_u32(sel, c, other));
+		changed=vsubq_u32(changed, sel);
+	}
+	const uint32_t ret=vgetq_lane_u32(changed, 0)+vgetq_lane_u32(changed, 1)+
+		vgetq_lane_u32(changed, 2)+vgetq_lane_u32(changed, 3);
+	return ret+genericThresholdPixels(dst+i, src+i, count-i, op, threshold, color, mask, copySource);
+}
+
+bool neonComparePixels(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count)
+{
+	const uint32x4_t rgbMask=vdupq_n_u32(0x00ffffff);
+	const uint32x4_t alphaMask=vdupq_n_u32(0xff000000);
+	uint32x4_t allEqual=vdupq_n_u32(0xffffffff);
+	uint32_t i=0;
+	for(;i+4<=count;i+=4)
+	{
+		const uint32x4_t va=vld1q_u32(a+i);
+		const uint32x4_t vb=vld1q_u32(b+i);
+		const uint32x4_t rgbA=vandq_u32(va, rgbMask);
+		const uint32x4_t rgbB=vandq_u32(vb, rgbMask);
+		const uint32x4_t equal=vceqq_u32(va, vb);
+		const uint32x4_t alphaDiff=vorrq_u32(vsubq_u32(vandq_u32(va, alphaMask), vandq_u32(vb, alphaMask)), rgbMask);
+		const uint32x4_t ret=vbslq_u32(vceqq_u32(rgbA, rgbB), alphaDiff, vsubq_u32(rgbA, rgbB));
+		vst1q_u32(dst+i, vbicq_u32(ret, equal));
+		allEqual=vandq_u32(allEqual, equal);
+	}
+	const bool different=(vgetq_lane_u32(allEqual, 0)&vgetq_lane_u32(allEqual, 1)&
+		vgetq_lane_u32(allEqual, 2)&vgetq_lane_u32(allEqual, 3))==0;
+	return genericComparePixels(dst+i, a+i, b+i, count-i) || different;
+}
+
+const PixelKernels neonKernels =
+{
+	"NEON",
+	neonFillPixels,
+	neonBlendPixels,
+	neonCopyChannel,
+	neonMaskedCopyPixels,
+	neonSwapPixels,
+	neonPremultiplyPixels,
+#ifdef __aarch64__
+	neonUnpremultiplyPixels,
+	neonColorTransformPixels,
+#else
+	genericUnpremultiplyPixels,
+	genericColorTransformPixels,
+#endif
+	neonThresholdPixels,
+	neonComparePixels,
+	genericHistogramPixels
+};
+#endif //PIXELS_NEON
+
+/*
+ * Run every kernel of k and of the generic implementation on the same
+ * pseudo random data, for many lengths to exercise the vector loops and their tails
+ */
+bool verifyKernels(const PixelKernels& k)
+{
+	const uint32_t maxCount=67;
+	vector<uint32_t> src(maxCount), src2(maxCount), expected(maxCount), actual(maxCount);
+	uint32_t seed=0x12345678;
+	for(uint32_t i=0;i<maxCount;i++)
+	{
+		seed=seed*1103515245+12345;
+		src[i]=seed^(seed>>13);
+		//Include fully transparent and opaque pixels, and some equal ones for compare
+		if(i%7==0)
+			src[i]&=0x00ffffff;
+		else if(i%7==1)
+			src[i]|=0xff000000;
+		src2[i]=(i%5==0)?src[i]:((i%5==1)?(src[i]^0x11000000):(src[i]*2654435761u));
+	}
+	vector<uint32_t> premultiplied(src);
+	genericPremultiplyPixels(&premultiplied[0], maxCount);
+
+	const float multipliers[4]={0.5f, 2.0f, -1.0f, 0.75f};
+	const float offsets[4]={-10.0f, 20.0f, 255.0f, 0.0f};
+	const uint32_t counts[]={0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, maxCount};
+	for(uint32_t n : counts)
+	{
+		const char* failed=NULL;
+		auto reset=[&](const vector<uint32_t>& init)
+		{
+			expected=init;
+			actual=init;
+		};
+		auto same=[&](){ return memcmp(&expected[0], &actual[0], maxCount*4)==0; };
+
+		reset(src);
+		genericKernels.fillPixels(&expected[0], n, 0x80ff4020);
+		k.fillPixels(&actual[0], n, 0x80ff4020);
+		if(!same())
+			failed="fill";
+
+		reset(premultiplied);
+		genericKernels.blendPixels(&expected[0], &src2[0], n);
+		k.blendPixels(&actual[0], &src2[0], n);
+		if(!same())
+			failed="blend";
+
+		for(uint32_t srcShift=0;srcShift<32;srcShift+=8)
+		{
+			for(uint32_t destShift=0;destShift<32;destShift+=8)
+			{
+				reset(src);
+				genericKernels.copyChannel(&expected[0], &src2[0], n, srcShift, destShift);
+				k.copyChannel(&actual[0], &src2[0], n, srcShift, destShift);
+				if(!same())
+					failed="copyChannel";
+			}
+		}
+
+		reset(src);
+		genericKernels.maskedCopyPixels(&expected[0], &src2[0], n, 0x00ffffff);
+		k.maskedCopyPixels(&actual[0], &src2[0], n, 0x00ffffff);
+		if(!same())
+			failed="maskedCopy";
+
+		reset(src);
+		genericKernels.swapPixels(&expected[0], &src2[0], n);
+		k.swapPixels(&actual[0], &src2[0], n);
+		if(!same())
+			failed="swap";
+
+		reset(src);
+		genericKernels.premultiplyPixels(&expected[0], n);
+		k.premultiplyPixels(&actual[0], n);
+		if(!same())
+			failed="premultiply";
+
+		//Also unpremultiply invalid data, with channels larger than alpha
+		reset(src);
+		genericKernels.unpremultiplyPixels(&expected[0], n);
+		k.unpremultiplyPixels(&actual[0], n);
+		if(!same())
+			failed="unpremultiply";
+
+		reset(src);
+		genericKernels.colorTransformPixels(&expected[0], n, multipliers, offsets);
+		k.colorTransformPixels(&actual[0], n, multipliers, offsets);
+		if(!same())
+			failed="colorTransform";
+
+		for(int op=THRESHOLD_LESS;op<=THRESHOLD_NOT_EQUAL;op++)
+		{
+			for(int copySource=0;copySource<2;copySource++)
+			{
+				reset(src);
+				uint32_t e=genericKernels.thresholdPixels(&expected[0], &src2[0], n, (THRESHOLD_OP)op,
+						src2[n/2], 0xff00ff00, 0xff00ffff, copySource);
+				uint32_t a=k.thresholdPixels(&actual[0], &src2[0], n, (THRESHOLD_OP)op,
+						src2[n/2], 0xff00ff00, 0xff00ffff, copySource);
+				if(e!=a || !same())
+					failed="threshold";
+			}
+		}
+
+		uint32_t expectedCounts[4][256]={{0}};
+		uint32_t actualCounts[4][256]={{0}};
+		genericKernels.histogramPixels(&src[0], n, expectedCounts);
+		k.histogramPixels(&src[0], n, actualCounts);
+		if(memcmp(expectedCounts, actualCounts, sizeof(expectedCounts))!=0)
+			failed="histogram";
+
+		reset(src);
+		bool e=genericKernels.comparePixels(&expected[0], &src[0], &src2[0], n);
+		bool a=k.comparePixels(&actual[0], &src[0], &src2[0], n);
+		if(e!=a || !same())
+			failed="compare";
+		e=genericKernels.comparePixels(&expected[0], &src[0], &src[0], n);
+		a=k.comparePixels(&actual[0], &src[0], &src[0], n);
+		if(e!=a || !same())
+			failed="compare";
+
+		if(failed)
+		{
+			LOG(LOG_ERROR, k.name << " pixel kernel " << failed << " gives wrong results for " << n << " pixels");
+			return false;
+		}
+	}
+	return true;
+}
+
+const PixelKernels* selectPixelKernels()
+{
+	const PixelKernels* ret=&genericKernels;
+#ifdef PIXELS_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		ret=&avx2Kernels;
+	else if(__builtin_cpu_supports("sse2"))
+		ret=&sse2Kernels;
+#elif defined(PIXELS_NEON)
+	ret=&neonKernels;
+#endif
+#ifndef NDEBUG
+	if(ret!=&genericKernels && !verifyKernels(*ret))
+		ret=&genericKernels;
+#endif
+	LOG(LOG_INFO, "Using " << ret->name << " pixel kernels");
+	return ret;
+}
+
+inline const PixelKernels& kernels()
+{
+	static const PixelKernels* k=selectPixelKernels();
+	return *k;
+}
+
+}
+
+void lightspark::fastFillPixels(uint32_t* dst, uint32_t count, uint32_t color)
+{
+	kernels().fillPixels(dst, count, color);
+}
+
+void lightspark::fastBlendPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	kernels().blendPixels(dst, src, count);
+}
+
+void lightspark::fastCopyChannel(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t srcShift, uint32_t destShift)
+{
+	kernels().copyChannel(dst, src, count, srcShift, destShift);
+}
+
+void lightspark::fastMaskedCopyPixels(uint32_t* dst, const uint32_t* src, uint32_t count, uint32_t mask)
+{
+	kernels().maskedCopyPixels(dst, src, count, mask);
+}
+
+void lightspark::fastSwapPixels(uint32_t* dst, const uint32_t* src, uint32_t count)
+{
+	kernels().swapPixels(dst, src, count);
+}
+
+void lightspark::fastPremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	kernels().premultiplyPixels(pixels, count);
+}
+
+void lightspark::fastUnpremultiplyPixels(uint32_t* pixels, uint32_t count)
+{
+	kernels().unpremultiplyPixels(pixels, count);
+}
+
+void lightspark::fastColorTransformPixels(uint32_t* pixels, uint32_t count, const float* multipliers, const float* offsets)
+{
+	kernels().colorTransformPixels(pixels, count, multipliers, offsets);
+}
+
+uint32_t lightspark::fastThresholdPixels(uint32_t* dst, const uint32_t* src, uint32_t count, THRESHOLD_OP op,
+		uint32_t threshold, uint32_t color, uint32_t mask, bool copySource)
+{
+	return kernels().thresholdPixels(dst, src, count, op, threshold, color, mask, copySource);
+}
+
+bool lightspark::fastComparePixels(uint32_t* dst, const uint32_t* a, const uint32_t* b, uint32_t count)
+{
+	return kernels().comparePixels(dst, a, b, count);
+}
+
+void lightspark::fastHistogramPixels(const uint32_t* src, uint32_t count, uint32_t counts[4][256])
+{
+	kernels().histogramPixels(src, count, counts);
+}
+
+const char* lightspark::getPixelKernelsName()
+{
+	return kernels().name;
+}
+
+bool lightspark::verifyPixelKernels()
+{
+	//Check all the implementations this CPU can run, not only the selected one
+	bool ret=true;
+#ifdef PIXELS_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse2"))
+		ret&=verifyKernels(sse2Kernels);
+	if(__builtin_cpu_supports("avx2"))
+		ret&=verifyKernels(avx2Kernels);
+#elif defined(PIXELS_NEON)
+	ret&=verifyKernels(neonKernels);
+#endif
+	return ret;
+}
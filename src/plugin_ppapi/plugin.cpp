@@ -1988,6 +1988,16 @@ void ppPluginEngineData::exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MAG_FILTE
 	g_gles2_interface->TexParameteri(instance->m_graphics,GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
+void ppPluginEngineData::exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_S_GL_CLAMP_TO_EDGE()
+{
+	g_gles2_interface->TexParameteri(instance->m_graphics,GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+}
+
+void ppPluginEngineData::exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_T_GL_CLAMP_TO_EDGE()
+{
+	g_gles2_interface->TexParameteri(instance->m_graphics,GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
 void ppPluginEngineData::exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_BYTE(int32_t level,int32_t width, int32_t height,int32_t border, const void* pixels)
 {
 	g_gles2_interface->TexImage2D(instance->m_graphics,GL_TEXTURE_2D, level, GL_RGBA, width, height, border, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
@@ -2047,6 +2057,46 @@ void ppPluginEngineData::exec_glGetIntegerv_GL_MAX_TEXTURE_SIZE(int32_t* data)
 	g_gles2_interface->GetIntegerv(instance->m_graphics,GL_MAX_TEXTURE_SIZE,data);
 }
 
+void ppPluginEngineData::exec_glGenFramebuffers(int32_t n,uint32_t* framebuffers)
+{
+	g_gles2_interface->GenFramebuffers(instance->m_graphics,n,framebuffers);
+}
+
+void ppPluginEngineData::exec_glDeleteFramebuffers(int32_t n,uint32_t* framebuffers)
+{
+	g_gles2_interface->DeleteFramebuffers(instance->m_graphics,n,framebuffers);
+}
+
+void ppPluginEngineData::exec_glFramebufferTexture2D_GL_FRAMEBUFFER_GL_COLOR_ATTACHMENT0(uint32_t texture)
+{
+	g_gles2_interface->FramebufferTexture2D(instance->m_graphics,GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,texture,0);
+}
+
+bool ppPluginEngineData::exec_glCheckFramebufferStatus_GL_FRAMEBUFFER()
+{
+	return g_gles2_interface->CheckFramebufferStatus(instance->m_graphics,GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE;
+}
+
+void ppPluginEngineData::exec_glScissor(int32_t x,int32_t y,int32_t width,int32_t height)
+{
+	g_gles2_interface->Scissor(instance->m_graphics,x,y,width,height);
+}
+
+void ppPluginEngineData::exec_glEnable_GL_SCISSOR_TEST()
+{
+	g_gles2_interface->Enable(instance->m_graphics,GL_SCISSOR_TEST);
+}
+
+void ppPluginEngineData::exec_glDisable_GL_SCISSOR_TEST()
+{
+	g_gles2_interface->Disable(instance->m_graphics,GL_SCISSOR_TEST);
+}
+
+void ppPluginEngineData::exec_glCopyTexSubImage2D_GL_TEXTURE_2D(int32_t level,int32_t xoffset,int32_t yoffset,int32_t x,int32_t y,int32_t width,int32_t height)
+{
+	g_gles2_interface->CopyTexSubImage2D(instance->m_graphics,GL_TEXTURE_2D,level,xoffset,yoffset,x,y,width,height);
+}
+
 void audio_callback(void* sample_buffer,uint32_t buffer_size_in_bytes,PP_TimeDelta latency,void* user_data)
 {
 	AudioStream *s = (AudioStream*)user_data;
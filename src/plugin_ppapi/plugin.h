@@ -249,6 +249,8 @@ public:
 	void exec_glBufferData_GL_PIXEL_UNPACK_BUFFER_GL_STREAM_DRAW(int32_t size,const void* data);
 	void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MIN_FILTER_GL_LINEAR();
 	void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_MAG_FILTER_GL_LINEAR();
+	void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_S_GL_CLAMP_TO_EDGE();
+	void exec_glTexParameteri_GL_TEXTURE_2D_GL_TEXTURE_WRAP_T_GL_CLAMP_TO_EDGE();
 	void exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_BYTE(int32_t level,int32_t width, int32_t height,int32_t border, const void* pixels);
 	void exec_glTexImage2D_GL_TEXTURE_2D_GL_UNSIGNED_INT_8_8_8_8_HOST(int32_t level,int32_t width, int32_t height,int32_t border, const void* pixels);
 	void exec_glDrawBuffer_GL_BACK();
@@ -259,6 +261,14 @@ public:
 	void exec_glPixelStorei_GL_UNPACK_SKIP_ROWS(int32_t param);
 	void exec_glTexSubImage2D_GL_TEXTURE_2D(int32_t level,int32_t xoffset,int32_t yoffset,int32_t width,int32_t height,const void* pixels, uint32_t w, uint32_t curX, uint32_t curY);
 	void exec_glGetIntegerv_GL_MAX_TEXTURE_SIZE(int32_t* data);
+	void exec_glGenFramebuffers(int32_t n,uint32_t* framebuffers);
+	void exec_glDeleteFramebuffers(int32_t n,uint32_t* framebuffers);
+	void exec_glFramebufferTexture2D_GL_FRAMEBUFFER_GL_COLOR_ATTACHMENT0(uint32_t texture);
+	bool exec_glCheckFramebufferStatus_GL_FRAMEBUFFER();
+	void exec_glScissor(int32_t x,int32_t y,int32_t width,int32_t height);
+	void exec_glEnable_GL_SCISSOR_TEST();
+	void exec_glDisable_GL_SCISSOR_TEST();
+	void exec_glCopyTexSubImage2D_GL_TEXTURE_2D(int32_t level,int32_t xoffset,int32_t yoffset,int32_t x,int32_t y,int32_t width,int32_t height);
 
 	// Audio handling
 	virtual int audio_StreamInit(AudioStream* s);
@@ -129,6 +129,7 @@
 #include "scripting/class.h"
 #include "exceptions.h"
 #include "scripting/abc.h"
+#include "backends/headless.h"
 
 using namespace std;
 using namespace lightspark;
@@ -146,6 +147,30 @@ bool lightspark::isVmThread()
 #endif
 }
 
+/* Reads the ABC data of a tag and builds the context for it. The data is
+ * hashed to look up the optimized code saved by previous sessions */
+static ABCContext* createContext(RootMovieClip* root, std::istream& in, int len)
+{
+	if(len<0)
+		throw ParseException("Not complete ABC data");
+	string data(len,'\0');
+	in.read(&data[0], len);
+	if(in.fail())
+	{
+		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << len-in.gcount());
+		throw ParseException("Not complete ABC data");
+	}
+	istringstream abc(data);
+	ABCContext* context=new ABCContext(_MR(root), abc, getVm(root->getSystemState()));
+	if(abc.tellg()!=len)
+	{
+		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << len-abc.tellg());
+		throw ParseException("Not complete ABC data");
+	}
+	context->codeCache=new OptimizedCodeCache(OptimizedCodeCache::computeHash(data.c_str(), len));
+	return context;
+}
+
 DoABCTag::DoABCTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 {
 	int dest=in.tellg();
@@ -154,14 +179,7 @@ DoABCTag::DoABCTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 
 	RootMovieClip* root=getParseThread()->getRootMovie();
 	root->incRef();
-	context=new ABCContext(_MR(root), in, getVm(root->getSystemState()));
-
-	int pos=in.tellg();
-	if(dest!=pos)
-	{
-		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
-		throw ParseException("Not complete ABC data");
-	}
+	context=createContext(root, in, dest-in.tellg());
 }
 
 void DoABCTag::execute(RootMovieClip* root) const
@@ -180,14 +198,7 @@ DoABCDefineTag::DoABCDefineTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 
 	RootMovieClip* root=getParseThread()->getRootMovie();
 	root->incRef();
-	context=new ABCContext(_MR(root), in, getVm(root->getSystemState()));
-
-	int pos=in.tellg();
-	if(dest!=pos)
-	{
-		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
-		throw ParseException("Not complete ABC data");
-	}
+	context=createContext(root, in, dest-in.tellg());
 }
 
 void DoABCDefineTag::execute(RootMovieClip* root) const
@@ -959,7 +970,7 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 	return ret;
 }
 
-ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),constant_pool(vm->vmDataMemory),
+ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),codeCache(NULL),constant_pool(vm->vmDataMemory),
 	methods(reporter_allocator<method_info>(vm->vmDataMemory)),
 	metadata(reporter_allocator<metadata_info>(vm->vmDataMemory)),
 	instances(reporter_allocator<instance_info>(vm->vmDataMemory)),
@@ -1041,6 +1052,11 @@ ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),cons
 #endif
 }
 
+ABCContext::~ABCContext()
+{
+	delete codeCache;
+}
+
 #ifdef PROFILING_SUPPORT
 void ABCContext::dumpProfilingData(ostream& f) const
 {
@@ -1055,8 +1071,8 @@ void ABCContext::dumpProfilingData(ostream& f) const
 			for(uint32_t j=0;j<methods[i].profTime.size();j++)
 			{
 				//Only output instructions that have been actually executed
-				if(methods[i].profTime[j]!=0)
-					f << j << ' ' << methods[i].profTime[j] << endl;
+				if(methods[i].profTime[j]!=0 || methods[i].profBoxes[j]!=0)
+					f << j << ' ' << methods[i].profTime[j] << ' ' << methods[i].profBoxes[j] << endl;
 			}
 			auto it=methods[i].profCalls.begin();
 			for(;it!=methods[i].profCalls.end();it++)
@@ -1076,8 +1092,8 @@ void ABCContext::dumpProfilingData(ostream& f) const
 /*
  * nextNamespaceBase is set to 2 since 0 is the empty namespace and 1 is the AS3 namespace
  */
-ABCVm::ABCVm(SystemState* s, MemoryAccount* m):m_sys(s),status(CREATED),shuttingdown(false),
-	events_queue(reporter_allocator<eventType>(m)),nextNamespaceBase(2),currentCallContext(NULL),
+ABCVm::ABCVm(SystemState* s, MemoryAccount* m):m_sys(s),status(CREATED),vmWaiting(false),shuttingdown(false),
+	events_queue(reporter_allocator<QueuedEvent*>(m)),queuedEvents(0),activeProducers(0),nextNamespaceBase(2),currentCallContext(NULL),
 	vmDataMemory(m),cur_recursion(0)
 {
 	limits.max_recursion = 256;
@@ -1112,22 +1128,73 @@ void ABCVm::shutdown()
 
 void ABCVm::finalize()
 {
+	collectEvents();
 	//The event queue may be not empty if the VM has been been started
 	if(status==CREATED && !events_queue.empty())
 		LOG(LOG_ERROR, "Events queue is not empty as expected");
-	events_queue.clear();
+	clearEvents();
 }
 
+void ABCVm::clearEvents()
+{
+	while(!events_queue.empty())
+	{
+		delete events_queue.front();
+		events_queue.pop_front();
+		queuedEvents--;
+	}
+}
 
 ABCVm::~ABCVm()
 {
+	collectEvents();
+	clearEvents();
 	for(size_t i=0;i<contexts.size();++i)
 		delete contexts[i];
 }
 
 int ABCVm::getEventQueueSize()
 {
-	return events_queue.size();
+	return max(queuedEvents.load(),0);
+}
+
+EventQueueStats::EventQueueStats():handledEvents(0),totalLatency(0),maxLatency(0),maxDepth(0)
+{
+	memset(depthHistogram,0,sizeof(depthHistogram));
+	memset(latencyHistogram,0,sizeof(latencyHistogram));
+}
+
+static uint32_t histogramBucket(uint64_t v)
+{
+	if(v==0)
+		return 0;
+	uint32_t bucket=63-__builtin_clzll(v);
+	return min(bucket,EventQueueStats::BUCKETS-1);
+}
+
+void EventQueueStats::addSample(uint32_t depth, uint64_t latency)
+{
+	depthHistogram[histogramBucket(depth)]++;
+	latencyHistogram[histogramBucket(latency)]++;
+	handledEvents++;
+	totalLatency+=latency;
+	maxLatency=max(maxLatency,latency);
+	maxDepth=max(maxDepth,depth);
+}
+
+void EventQueueStats::logStatistics() const
+{
+	if(handledEvents==0)
+		return;
+	LOG(LOG_INFO,_("Event queue: ") << handledEvents << _(" events, max depth ") << maxDepth <<
+		_(", latency (us) avg ") << totalLatency/handledEvents << _(" max ") << maxLatency);
+	for(uint32_t i=0;i<BUCKETS;i++)
+	{
+		if(depthHistogram[i]==0 && latencyHistogram[i]==0)
+			continue;
+		LOG(LOG_INFO,_("Event queue: [") << ((i==0)?0:(1<<i)) << "," << (1<<(i+1)) << _(") depth ") <<
+			depthHistogram[i] << _(" latency ") << latencyHistogram[i]);
+	}
 }
 
 void ABCVm::publicHandleEvent(_R<EventDispatcher> dispatcher, _R<Event> event)
@@ -1361,6 +1428,13 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				m_sys->flushInvalidationQueue();
 				break;
 			}
+			case RENDER_FRAME:
+			{
+				RenderFrameEvent* ev=static_cast<RenderFrameEvent*>(e.second.getPtr());
+				LOG(LOG_CALLS,"RENDER_FRAME");
+				ev->renderer->renderFrame();
+				break;
+			}
 			case PARSE_RPC_MESSAGE:
 			{
 				ParseRPCMessageEvent* ev=static_cast<ParseRPCMessageEvent*>(e.second.getPtr());
@@ -1400,15 +1474,8 @@ bool ABCVm::prependEvent(_NR<EventDispatcher> obj ,_R<Event> ev)
 		return true;
 	}
 
-	Mutex::Lock l(event_queue_mutex);
-
-	//If the system should terminate new events are not accepted
-	if(shuttingdown)
-		return false;
-
-	events_queue.push_front(pair<_NR<EventDispatcher>,_R<Event>>(obj, ev));
-	sem_event_cond.signal();
-	return true;
+	//Prepended events are handled before all the others, the last one first
+	return enqueueEvent(priorityLane, obj, ev);
 }
 
 /*! \brief enqueue an event, a reference is acquired
@@ -1426,18 +1493,49 @@ bool ABCVm::addEvent(_NR<EventDispatcher> obj ,_R<Event> ev)
 		return true;
 	}
 
+	return enqueueEvent(eventsLane, obj, ev);
+}
 
-	Mutex::Lock l(event_queue_mutex);
-
+bool ABCVm::enqueueEvent(MPSCQueue<QueuedEvent>& lane, _NR<EventDispatcher> obj, _R<Event> ev)
+{
+	activeProducers++;
 	//If the system should terminate new events are not accepted
 	if(shuttingdown)
+	{
+		activeProducers--;
 		return false;
-
-	events_queue.push_back(pair<_NR<EventDispatcher>,_R<Event>>(obj, ev));
-	sem_event_cond.signal();
+	}
+	queuedEvents++;
+	lane.push(new QueuedEvent(make_pair(obj, ev)));
+	//The mutex is only taken when the VM thread is sleeping
+	if(vmWaiting)
+	{
+		Mutex::Lock l(event_queue_mutex);
+		sem_event_cond.signal();
+	}
+	activeProducers--;
 	return true;
 }
 
+void ABCVm::collectEvents()
+{
+	//Pushing each prepended event to the front keeps the old LIFO order
+	while(QueuedEvent* ev=priorityLane.pop())
+		events_queue.push_front(ev);
+	while(QueuedEvent* ev=eventsLane.pop())
+		events_queue.push_back(ev);
+}
+
+void ABCVm::waitForEvents()
+{
+	Mutex::Lock l(event_queue_mutex);
+	vmWaiting=true;
+	//Check again after publishing vmWaiting, producers that did not see it have already pushed
+	while(lanesEmpty() && !shuttingdown)
+		sem_event_cond.wait(event_queue_mutex);
+	vmWaiting=false;
+}
+
 Class_inherit* ABCVm::findClassInherit(const string& s, RootMovieClip* root)
 {
 	LOG(LOG_CALLS,_("Setting class name to ") << s);
@@ -1492,27 +1590,23 @@ bool ABCVm::buildClassAndBindTag(const string& s, DictionaryTag* t)
 }
 void ABCVm::checkExternalCallEvent()
 {
-	event_queue_mutex.lock();
-	if (events_queue.size() == 0)
-	{
-		event_queue_mutex.unlock();
+	collectEvents();
+	if (events_queue.empty())
 		return;
-	}
-	pair<_NR<EventDispatcher>,_R<Event>> e=events_queue.front();
+	const eventType& e=events_queue.front()->e;
 	if (e.first.isNull() && e.second->getEventType() == EXTERNAL_CALL)
 		handleFrontEvent();
-	else
-		event_queue_mutex.unlock();
 }
 void ABCVm::handleFrontEvent()
 {
-	pair<_NR<EventDispatcher>,_R<Event>> e=events_queue.front();
+	QueuedEvent* queued=events_queue.front();
 	events_queue.pop_front();
-
-	event_queue_mutex.unlock();
+	eventQueueStats.addSample(max(queuedEvents.load(),0), g_get_monotonic_time()-queued->enqueueTime);
+	queuedEvents--;
+	eventType e=queued->e;
+	delete queued;
 	try
 	{
-		//handle event without lock
 		handleEvent(e);
 		//Flush the invalidation queue
 		if (!e.first.isNull() || e.second->getEventType() != EXTERNAL_CALL)
@@ -1571,6 +1665,10 @@ call_context::~call_context()
 		LOG(LOG_ERROR,_("Stack not clean at the end of function"));
 		for(uint32_t i=0;i<stack_index;i++)
 		{
+#ifdef TAGGED_STACK_VALUES
+			if(isTaggedInt(stack[i]))
+				continue;
+#endif
 			if(stack[i]) //Values might be NULL when using callproperty to call a void returning function
 				stack[i]->decRef();
 		}
@@ -1587,6 +1685,13 @@ call_context::~call_context()
 	}
 }
 
+#ifdef TAGGED_STACK_VALUES
+ASObject* call_context::boxInt(int32_t i) const
+{
+	return abstract_i(context->root->getSystemState(),i);
+}
+#endif
+
 void call_context::handleError(int errorcode)
 {
 	throwError<ASError>(errorcode);
@@ -1808,27 +1913,33 @@ void ABCVm::Run(ABCVm* th)
 #endif
 	while(true)
 	{
-		th->event_queue_mutex.lock();
-		while(th->events_queue.empty() && !th->shuttingdown)
-			th->sem_event_cond.wait(th->event_queue_mutex);
-
-		if(th->shuttingdown)
+		//Take all the available events at once
+		th->collectEvents();
+		if(th->events_queue.empty())
 		{
-			//If the queue is empty stop immediately
-			if(th->events_queue.empty())
+			if(th->shuttingdown)
 			{
-				th->event_queue_mutex.unlock();
-				break;
+				//Stop when no producer can still be adding an event
+				if(th->activeProducers==0 && th->lanesEmpty())
+					break;
+				Thread::yield();
 			}
-			else if(firstMissingEvents)
+			else if(th->lanesEmpty())
+				th->waitForEvents();
+			else
 			{
-				LOG(LOG_INFO,th->events_queue.size() << _(" events missing before exit"));
-				firstMissingEvents = false;
+				//A producer is in the middle of a push
+				Thread::yield();
 			}
+			continue;
+		}
+		if(th->shuttingdown && firstMissingEvents)
+		{
+			LOG(LOG_INFO,th->events_queue.size() << _(" events missing before exit"));
+			firstMissingEvents = false;
 		}
 		Chronometer chronometer;
 
-		pair<_NR<EventDispatcher>,_R<Event>> e=th->events_queue.front();
 		th->handleFrontEvent();
 		profile->accountTime(chronometer.checkpoint());
 #ifdef MEMORY_USAGE_PROFILING
@@ -1837,8 +1948,10 @@ void ABCVm::Run(ABCVm* th)
 		snapshotCount++;
 #endif
 	}
+	th->eventQueueStats.logStatistics();
 	if(th->m_sys->useJit)
 	{
+		th->waitBackgroundCompilation();
 		th->ex->clearAllGlobalMappings();
 		delete th->module;
 	}
@@ -1851,13 +1964,17 @@ void ABCVm::Run(ABCVm* th)
 void ABCVm::signalEventWaiters()
 {
 	assert(shuttingdown);
-	//we do not need a lock because th->shuttingdown keeps other events from being enqueued
+	//shuttingdown keeps other events from being enqueued, the few that
+	//were being added in the meantime are handled by the VM loop
+	collectEvents();
 	while(!events_queue.empty())
 	{
-		pair<_NR<EventDispatcher>,_R<Event>> e=events_queue.front();
-                events_queue.pop_front();
-		if(e.second->is<WaitableEvent>())
-			e.second->as<WaitableEvent>()->signal();
+		QueuedEvent* queued=events_queue.front();
+		events_queue.pop_front();
+		queuedEvents--;
+		if(queued->e.second->is<WaitableEvent>())
+			queued->e.second->as<WaitableEvent>()->signal();
+		delete queued;
 	}
 }
 
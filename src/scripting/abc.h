@@ -97,14 +97,21 @@ public:
 #ifdef PROFILING_SUPPORT
 	std::map<method_info*,uint64_t> profCalls;
 	std::vector<uint64_t> profTime;
+	std::vector<uint64_t> profBoxes;
 	tiny_string profName;
 	bool validProfName;
 #endif
 
+	//Native code of the method, it is accessed with ABCVm::jitMutex held
 	SyntheticFunction::synt_function f;
 	ABCContext* context;
 	method_body_info* body;
 	SyntheticFunction::synt_function synt_method(SystemState* sys);
+	/* The two halves of synt_method. The LLVM IR is generated on the VM thread,
+	 * since it inspects VM data. Compilation to native code may happen
+	 * on any thread. Both require ABCVm::jitMutex to be held */
+	bool synt_method_ir(SystemState* sys, bool& optimize);
+	void synt_method_compile(SystemState* sys, bool optimize);
 	bool needsArgs() { return info.needsArgs(); }
 	bool needsActivation() { return info.needsActivation(); }
 	bool needsRest() { return info.needsRest(); }
@@ -124,6 +131,7 @@ public:
 		llvmf(NULL),
 #ifdef PROFILING_SUPPORT
 		profTime(0),
+		profBoxes(0),
 		validProfName(false),
 #endif
 		f(NULL),context(NULL),body(NULL),returnType(NULL),hasExplicitTypes(false)
@@ -149,12 +157,65 @@ struct typed_opcode_handler
 	ARGS_TYPE type;
 };
 
+/* A pointer stored in optimized code. Pointers are not valid across
+ * sessions, so the cache saves how to resolve them again */
+struct code_relocation
+{
+	enum KIND { MULTINAME=0, APPDOMAIN_TARGET, SYSTEMDOMAIN_VARIABLE };
+	uint32_t offset;
+	uint32_t kind;
+	uint32_t nameIndex;
+	code_relocation(uint32_t o, KIND k, uint32_t n):offset(o),kind(k),nameIndex(n){}
+};
+
+/* On-disk cache of the code produced by ABCVm::optimizeFunction for the
+ * methods of a single ABC block. It is keyed by a hash of the ABC data and
+ * lives in the configured cache directory */
+class OptimizedCodeCache
+{
+private:
+	struct entry
+	{
+		std::string code;
+		std::vector<exception_info> exceptions;
+		std::vector<code_relocation> relocations;
+		uint32_t inlineCacheCount;
+	};
+	std::string filename;
+	Mutex mutex;
+	std::map<uint32_t,entry> entries;
+	//Methods whose records must be dropped when the file is compacted
+	std::set<uint32_t> staleMethods;
+	uint32_t hits;
+	uint32_t misses;
+	bool loaded;
+	//Set when the file contains damaged, duplicated or stale records
+	bool needsRewrite;
+	static std::string serializeEntry(uint32_t methodIndex, const entry& e);
+	static bool parseEntry(const std::string& payload, uint32_t& methodIndex, entry& e);
+	/* Returns false if any record had to be skipped or replaced */
+	bool readEntries(std::map<uint32_t,entry>& out) const;
+	void load();
+	/* Rewrites the file with only the valid records, through a temporary file */
+	void compact();
+public:
+	OptimizedCodeCache(const std::string& abcHash);
+	~OptimizedCodeCache();
+	/* Computes the hash identifying a cache for the given ABC data */
+	static std::string computeHash(const char* data, uint32_t len);
+	/* Loads the optimized code of the method, returns false on cache miss */
+	bool lookup(method_info* mi);
+	void store(const method_info* mi, const std::vector<code_relocation>& relocations);
+};
+
 class ABCContext
 {
 friend class ABCVm;
 friend class method_info;
 public:
 	_R<RootMovieClip> root;
+	//Cache of optimized method bodies, NULL if not available
+	OptimizedCodeCache* codeCache;
 
 	method_info* get_method(unsigned int m);
 	uint32_t getString(unsigned int s) const;
@@ -229,6 +290,7 @@ public:
 	multiname* getMultinameImpl(ASObject* rt1, ASObject* rt2, unsigned int m);
 	void buildInstanceTraits(ASObject* obj, int class_index);
 	ABCContext(_R<RootMovieClip> r, std::istream& in, ABCVm* vm) DLL_PUBLIC;
+	~ABCContext();
 	void exec(bool lazy);
 
 	bool isinstance(ASObject* obj, multiname* name);
@@ -240,6 +302,28 @@ public:
 
 struct BasicBlock;
 struct InferenceData;
+class JitCompileJob;
+
+/*
+ * Statistics of the VM event queue. Bucket i of the histograms counts
+ * the samples in [2^i, 2^(i+1)), the first bucket also counts 0
+ */
+class EventQueueStats
+{
+public:
+	static const uint32_t BUCKETS=24;
+	//Number of queued events when an event is taken for handling
+	uint64_t depthHistogram[BUCKETS];
+	//Microseconds between the enqueueing and the handling of an event
+	uint64_t latencyHistogram[BUCKETS];
+	uint64_t handledEvents;
+	uint64_t totalLatency;
+	uint64_t maxLatency;
+	uint32_t maxDepth;
+	EventQueueStats();
+	void addSample(uint32_t depth, uint64_t latency);
+	void logStatistics() const;
+};
 
 class ABCVm
 {
@@ -327,6 +411,7 @@ private:
 	static void callStatic(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
 	static void callSuper(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
 	static void callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
+	static void callPropertyCached(call_context* th, int n, int m, method_info** called_mi, bool keepReturn, inline_cache* ic);
 	static void callImpl(call_context* th, ASObject* f, ASObject* obj, ASObject** args, int m, method_info** called_mi, bool keepReturn);
 	static void constructProp(call_context* th, int n, int m); 
 	static void setLocal(int n); 
@@ -383,6 +468,9 @@ private:
 	static ASObject* getProperty(ASObject* obj, multiname* name);
 	static int32_t getProperty_i(ASObject* obj, multiname* name);
 	static void setProperty(ASObject* value,ASObject* obj, multiname* name);
+	//Versions of getProperty and setProperty using the inline cache of the call site
+	static ASObject* getPropertyCached(ASObject* obj, multiname* name, inline_cache* ic);
+	static void setPropertyCached(ASObject* value,ASObject* obj, multiname* name, inline_cache* ic);
 	static void setProperty_i(int32_t value,ASObject* obj, multiname* name);
 	static void call(call_context* th, int n, method_info** called_mi);
 	static void constructSuper(call_context* th, int n);
@@ -494,22 +582,48 @@ private:
 	static typed_opcode_handler opcode_table_bool_t[];
 
 
-	//Synchronization
+	//Synchronization, only used to sleep when there are no events
 	Mutex event_queue_mutex;
 	Cond sem_event_cond;
+	std::atomic<bool> vmWaiting;
 
 	//Event handling
-	volatile bool shuttingdown;
+	std::atomic<bool> shuttingdown;
 	typedef std::pair<_NR<EventDispatcher>,_R<Event>> eventType;
-	std::deque<eventType, reporter_allocator<eventType>> events_queue;
+	class QueuedEvent: public MPSCNode
+	{
+	public:
+		eventType e;
+		uint64_t enqueueTime;
+		QueuedEvent(const eventType& _e):e(_e),enqueueTime(g_get_monotonic_time()){}
+	};
+	//Producers push to these lock-free lanes, prepended events have their own lane
+	MPSCQueue<QueuedEvent> eventsLane;
+	MPSCQueue<QueuedEvent> priorityLane;
+	//Events taken in batches from the lanes, only accessed by the VM thread
+	std::deque<QueuedEvent*, reporter_allocator<QueuedEvent*>> events_queue;
+	//Events added but not handled yet
+	std::atomic<int32_t> queuedEvents;
+	//Threads inside addEvent/prependEvent, the VM waits for them before exiting
+	std::atomic<int32_t> activeProducers;
+	EventQueueStats eventQueueStats;
+	bool enqueueEvent(MPSCQueue<QueuedEvent>& lane, _NR<EventDispatcher> obj, _R<Event> ev);
+	//Moves the events from the lanes to events_queue
+	void collectEvents();
+	bool lanesEmpty() const { return eventsLane.isEmpty() && priorityLane.isEmpty(); }
+	void waitForEvents();
 	void handleEvent(std::pair<_NR<EventDispatcher>,_R<Event> > e);
 	void handleFrontEvent();
 	void signalEventWaiters();
+	void clearEvents();
 	void buildClassAndInjectBase(const std::string& s, _R<RootMovieClip> base);
 	Class_inherit* findClassInherit(const std::string& s, RootMovieClip* r);
 
 	//Profiling support
 	static uint64_t profilingCheckpoint(uint64_t& startTime);
+#ifdef PROFILING_SUPPORT
+	static uint64_t profilingBoxesCheckpoint(uint64_t& startBoxes);
+#endif
 	// The base to assign to the next loaded context
 	ATOMIC_INT32(nextNamespaceBase);
 
@@ -704,6 +818,19 @@ public:
 	llvm::FunctionPassManager* FPM;
 #endif
 	llvm::LLVMContext& llvm_context();
+	//Protects the LLVM module, context and execution engine, which are also
+	//used by background compilation
+	Mutex jitMutex;
+	//Pending background compilations, only accessed by the VM thread
+	std::map<method_info*,JitCompileJob*> jitJobs;
+	/* Generates the code of the method and compiles it on the ThreadPool.
+	 * The method must keep running in the interpreter until
+	 * backgroundCompilationDone returns true */
+	void compileInBackground(method_info* mi);
+	bool backgroundCompilationDone(method_info* mi);
+	/* Waits for all the queued compilations, must be called before
+	 * destroying the LLVM module */
+	void waitBackgroundCompilation();
 
 	ABCVm(SystemState* s, MemoryAccount* m) DLL_PUBLIC;
 	/**
@@ -728,11 +855,16 @@ public:
 	static void writeInt32(std::ostream& out, int32_t val);
 	static void writeDouble(std::ostream& out, double val);
 	static void writePtr(std::ostream& out, const void* val);
+	//Allocates a new inline cache for the access to the given name and writes its index,
+	//or NO_INLINE_CACHE if the name is known only at runtime
+	static void writeInlineCache(std::ostream& out, const method_info* mi, uint32_t nameIndex);
 
 	static InferenceData earlyBindGetLex(std::ostream& out, const SyntheticFunction* f,
-			const std::vector<InferenceData>& scopeStack, const multiname* name, uint32_t name_index);
+			const std::vector<InferenceData>& scopeStack, const multiname* name, uint32_t name_index,
+			std::vector<code_relocation>& relocations);
 	static InferenceData earlyBindFindPropStrict(std::ostream& out, const SyntheticFunction* f,
-			const std::vector<InferenceData>& scopeStack, const multiname* name);
+			const std::vector<InferenceData>& scopeStack, const multiname* name, uint32_t name_index,
+			std::vector<code_relocation>& relocations);
 	static EARLY_BIND_STATUS earlyBindForScopeStack(std::ostream& out, const SyntheticFunction* f,
 			const std::vector<InferenceData>& scopeStack, const multiname* name, InferenceData& inferredData);
 	static const Type* getLocalType(const SyntheticFunction* f, unsigned localIndex);
@@ -740,6 +872,8 @@ public:
 	bool addEvent(_NR<EventDispatcher>,_R<Event> ) DLL_PUBLIC;
 	bool prependEvent(_NR<EventDispatcher>,_R<Event> ) DLL_PUBLIC;
 	int getEventQueueSize();
+	//Only consistent when read from the VM thread or after shutdown
+	const EventQueueStats& getEventQueueStats() const { return eventQueueStats; }
 	void shutdown();
 	bool hasEverStarted() const { return status!=CREATED; }
 
@@ -770,6 +904,26 @@ public:
 	void checkExternalCallEvent() DLL_PUBLIC;
 };
 
+/* Compiles the IR of a method to native code on the ThreadPool */
+class JitCompileJob: public IThreadJob
+{
+private:
+	method_info* mi;
+	SystemState* sys;
+	bool optimize;
+	//Signaled when the job is over, whether it has been executed or not
+	Semaphore finished;
+public:
+	//Set when the native code of the method is ready
+	ACQUIRE_RELEASE_FLAG(done);
+	JitCompileJob(method_info* m, SystemState* s, bool o):mi(m),sys(s),optimize(o),finished(0),done(false){}
+	void execute();
+	void jobFence();
+	//Compilation happens in background, rendering and loading go first
+	JOB_PRIORITY getPriority() const { return JOB_PRIORITY_LOW; }
+	void waitFinished() { finished.wait(); }
+};
+
 class DoABCTag: public ControlTag
 {
 private:
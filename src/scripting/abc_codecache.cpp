@@ -0,0 +1,390 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "abc.h"
+#include "compat.h"
+#include "backends/config.h"
+#include "scripting/flash/system/flashsystem.h"
+#include "version.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <zlib.h>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#ifdef _WIN32
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/file.h>
+#endif
+
+using namespace std;
+using namespace lightspark;
+
+/* Every record in the cache file is framed as magic, payload length,
+ * CRC32 of the payload and the payload itself. Damaged records are
+ * skipped by looking for the next magic */
+#define CODE_CACHE_MAGIC 0x434f534c
+#define CODE_CACHE_RECORD_HEADER 12
+/* Must be increased when the format of the optimized code changes */
+#define CODE_CACHE_VERSION 3
+
+static void writeU32(ostream& o, uint32_t val)
+{
+	o.write((char*)&val, 4);
+}
+
+static bool readU32(istream& i, uint32_t& val)
+{
+	i.read((char*)&val, 4);
+	return !i.fail();
+}
+
+static uint32_t readU32(const char* buf)
+{
+	uint32_t ret;
+	memcpy(&ret, buf, 4);
+	return ret;
+}
+
+namespace
+{
+/* Serializes the accesses to the cache file between threads and processes.
+ * The lock is taken on a separate file, since the cache file itself is
+ * replaced when it is compacted */
+class CacheFileLock
+{
+private:
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	int fd;
+#endif
+public:
+	CacheFileLock(const string& filename, bool exclusive)
+	{
+		const string lockname=filename+".lock";
+#ifdef _WIN32
+		handle=CreateFileA(lockname.c_str(), GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE,
+				NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if(handle!=INVALID_HANDLE_VALUE)
+		{
+			OVERLAPPED ov;
+			memset(&ov, 0, sizeof(ov));
+			LockFileEx(handle, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &ov);
+		}
+#else
+		fd=open(lockname.c_str(), O_RDWR|O_CREAT, 0600);
+		if(fd>=0)
+		{
+			while(flock(fd, exclusive ? LOCK_EX : LOCK_SH)<0 && errno==EINTR);
+		}
+#endif
+	}
+	~CacheFileLock()
+	{
+		//Closing the file releases the lock
+#ifdef _WIN32
+		if(handle!=INVALID_HANDLE_VALUE)
+			CloseHandle(handle);
+#else
+		if(fd>=0)
+			close(fd);
+#endif
+	}
+};
+}
+
+OptimizedCodeCache::OptimizedCodeCache(const string& abcHash):hits(0),misses(0),loaded(false),needsRewrite(false)
+{
+	const Config* config=Config::getConfig();
+	filename=config->getCacheDirectory()+G_DIR_SEPARATOR_S+config->getCachePrefix()+"-abc-"+abcHash;
+}
+
+OptimizedCodeCache::~OptimizedCodeCache()
+{
+	if(needsRewrite)
+		compact();
+	if(hits || misses)
+		LOG(LOG_INFO,_("Optimized code cache ") << filename << _(": ") << hits << _(" hits, ") << misses << _(" misses"));
+}
+
+string OptimizedCodeCache::computeHash(const char* data, uint32_t len)
+{
+	GChecksum* checksum=g_checksum_new(G_CHECKSUM_SHA1);
+	g_checksum_update(checksum, (const guchar*)data, len);
+	//The optimized code depends on the VM version and on the pointer size
+	ostringstream salt;
+	salt << VERSION << '-' << CODE_CACHE_VERSION << '-' << sizeof(void*);
+	g_checksum_update(checksum, (const guchar*)salt.str().c_str(), salt.str().size());
+	string ret=g_checksum_get_string(checksum);
+	g_checksum_free(checksum);
+	return ret;
+}
+
+string OptimizedCodeCache::serializeEntry(uint32_t methodIndex, const entry& e)
+{
+	ostringstream payload;
+	writeU32(payload, methodIndex);
+	writeU32(payload, e.code.size());
+	payload.write(e.code.data(), e.code.size());
+	writeU32(payload, e.exceptions.size());
+	for(uint32_t i=0;i<e.exceptions.size();i++)
+	{
+		const exception_info& ei=e.exceptions[i];
+		writeU32(payload, ei.from);
+		writeU32(payload, ei.to);
+		writeU32(payload, ei.target);
+		writeU32(payload, ei.exc_type);
+		writeU32(payload, ei.var_name);
+	}
+	writeU32(payload, e.relocations.size());
+	for(uint32_t i=0;i<e.relocations.size();i++)
+	{
+		writeU32(payload, e.relocations[i].offset);
+		writeU32(payload, e.relocations[i].kind);
+		writeU32(payload, e.relocations[i].nameIndex);
+	}
+	writeU32(payload, e.inlineCacheCount);
+	const string& p=payload.str();
+	//Frame the payload, so that the whole record is appended with a single write
+	ostringstream record;
+	writeU32(record, CODE_CACHE_MAGIC);
+	writeU32(record, p.size());
+	writeU32(record, crc32(0, (const Bytef*)p.data(), p.size()));
+	record.write(p.data(), p.size());
+	return record.str();
+}
+
+bool OptimizedCodeCache::parseEntry(const string& payload, uint32_t& methodIndex, entry& e)
+{
+	istringstream f(payload);
+	uint32_t codeLen, count;
+	if(!readU32(f, methodIndex) || !readU32(f, codeLen) || codeLen>payload.size())
+		return false;
+	e.code.resize(codeLen);
+	f.read(&e.code[0], codeLen);
+	if(f.fail() || !readU32(f, count))
+		return false;
+	bool valid=true;
+	for(uint32_t i=0;i<count && valid;i++)
+	{
+		exception_info ei;
+		uint32_t excType, varName;
+		valid=readU32(f, ei.from) && readU32(f, ei.to) && readU32(f, ei.target) &&
+			readU32(f, excType) && readU32(f, varName);
+		ei.exc_type=excType;
+		ei.var_name=varName;
+		e.exceptions.push_back(ei);
+	}
+	if(!valid || !readU32(f, count))
+		return false;
+	for(uint32_t i=0;i<count && valid;i++)
+	{
+		uint32_t offset, kind, nameIndex;
+		valid=readU32(f, offset) && readU32(f, kind) && readU32(f, nameIndex) &&
+			kind<=code_relocation::SYSTEMDOMAIN_VARIABLE && offset+sizeof(void*)<=codeLen;
+		e.relocations.push_back(code_relocation(offset,(code_relocation::KIND)kind,nameIndex));
+	}
+	if(!valid || !readU32(f, e.inlineCacheCount))
+		return false;
+	//The payload must be consumed exactly
+	return f.peek()==EOF;
+}
+
+bool OptimizedCodeCache::readEntries(map<uint32_t,entry>& out) const
+{
+	ifstream f(filename.c_str(), ios::in|ios::binary);
+	if(!f.is_open())
+		return true;
+	const string buf((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+	bool clean=true;
+	size_t pos=0;
+	while(pos+CODE_CACHE_RECORD_HEADER<=buf.size())
+	{
+		const uint32_t magic=readU32(&buf[pos]);
+		const uint32_t len=readU32(&buf[pos+4]);
+		const uint32_t checksum=readU32(&buf[pos+8]);
+		if(magic!=CODE_CACHE_MAGIC || len>buf.size()-pos-CODE_CACHE_RECORD_HEADER ||
+			crc32(0, (const Bytef*)&buf[pos+CODE_CACHE_RECORD_HEADER], len)!=checksum)
+		{
+			//Resynchronize on the next magic
+			clean=false;
+			pos++;
+			continue;
+		}
+		const string payload=buf.substr(pos+CODE_CACHE_RECORD_HEADER, len);
+		pos+=CODE_CACHE_RECORD_HEADER+len;
+		uint32_t methodIndex;
+		entry e;
+		if(!parseEntry(payload, methodIndex, e))
+		{
+			clean=false;
+			continue;
+		}
+		//Later records replace earlier ones for the same method
+		if(!out.insert(make_pair(methodIndex, e)).second)
+		{
+			out[methodIndex]=e;
+			clean=false;
+		}
+	}
+	//A truncated tail is garbage as well
+	return clean && pos==buf.size();
+}
+
+void OptimizedCodeCache::load()
+{
+	loaded=true;
+	CacheFileLock l(filename, false);
+	if(!readEntries(entries))
+	{
+		LOG(LOG_INFO,_("Optimized code cache ") << filename << _(" contains damaged or duplicated records"));
+		needsRewrite=true;
+	}
+	LOG(LOG_INFO,_("Loaded ") << entries.size() << _(" optimized methods from ") << filename);
+}
+
+void OptimizedCodeCache::compact()
+{
+	CacheFileLock l(filename, true);
+	//Read the file again, other processes may have appended records since it was loaded
+	map<uint32_t,entry> current;
+	readEntries(current);
+	for(auto it=staleMethods.begin();it!=staleMethods.end();++it)
+		current.erase(*it);
+	const string tmpname=filename+".tmp";
+	{
+		ofstream f(tmpname.c_str(), ios::out|ios::binary|ios::trunc);
+		if(!f.is_open())
+		{
+			LOG(LOG_ERROR,_("Could not open optimized code cache ") << tmpname);
+			return;
+		}
+		for(auto it=current.begin();it!=current.end();++it)
+		{
+			const string record=serializeEntry(it->first, it->second);
+			f.write(record.data(), record.size());
+		}
+		f.close();
+		if(f.fail())
+		{
+			LOG(LOG_ERROR,_("Could not write optimized code cache ") << tmpname);
+			g_unlink(tmpname.c_str());
+			return;
+		}
+	}
+	if(g_rename(tmpname.c_str(), filename.c_str())!=0)
+	{
+		LOG(LOG_ERROR,_("Could not replace optimized code cache ") << filename);
+		g_unlink(tmpname.c_str());
+		return;
+	}
+	LOG(LOG_INFO,_("Compacted optimized code cache ") << filename << _(" to ") << current.size() << _(" methods"));
+}
+
+bool OptimizedCodeCache::lookup(method_info* mi)
+{
+	Locker l(mutex);
+	if(!loaded)
+		load();
+	ABCContext* context=mi->context;
+	uint32_t methodIndex=mi-&context->methods[0];
+	auto it=entries.find(methodIndex);
+	if(it==entries.end())
+	{
+		LOG(LOG_TRACE,_("Optimized code cache miss for method ") << methodIndex);
+		misses++;
+		return false;
+	}
+	const entry& e=it->second;
+	string code=e.code;
+	for(uint32_t i=0;i<e.relocations.size();i++)
+	{
+		const code_relocation& r=e.relocations[i];
+		const void* ptr=NULL;
+		const multiname* name=NULL;
+		if(r.nameIndex<context->constant_pool.multinames.size() && context->getMultinameRTData(r.nameIndex)==0)
+			name=context->getMultiname(r.nameIndex,NULL);
+		switch(name ? r.kind : (uint32_t)-1)
+		{
+			case code_relocation::MULTINAME:
+				ptr=name;
+				break;
+			case code_relocation::APPDOMAIN_TARGET:
+			{
+				ASObject* target;
+				if(context->root->applicationDomain->findTargetByMultiname(*name, target))
+					ptr=target;
+				break;
+			}
+			case code_relocation::SYSTEMDOMAIN_VARIABLE:
+			{
+				ASObject* target;
+				ptr=context->root->getSystemState()->systemDomain->getVariableAndTargetByMultiname(*name, target);
+				break;
+			}
+			default:
+				break;
+		}
+		if(ptr==NULL)
+		{
+			//The early binding done in the previous session is not valid anymore
+			LOG(LOG_TRACE,_("Optimized code cache stale entry for method ") << methodIndex);
+			entries.erase(it);
+			staleMethods.insert(methodIndex);
+			needsRewrite=true;
+			misses++;
+			return false;
+		}
+		memcpy(&code[r.offset], &ptr, sizeof(void*));
+	}
+	LOG(LOG_TRACE,_("Optimized code cache hit for method ") << methodIndex);
+	hits++;
+	mi->body->code=code;
+	mi->body->exceptions.assign(e.exceptions.begin(), e.exceptions.end());
+	mi->body->inlineCaches.assign(e.inlineCacheCount, inline_cache());
+	return true;
+}
+
+void OptimizedCodeCache::store(const method_info* mi, const vector<code_relocation>& relocations)
+{
+	uint32_t methodIndex=mi-&mi->context->methods[0];
+	entry e;
+	e.code=mi->body->code;
+	e.exceptions.assign(mi->body->exceptions.begin(), mi->body->exceptions.end());
+	e.relocations=relocations;
+	e.inlineCacheCount=mi->body->inlineCaches.size();
+	const string record=serializeEntry(methodIndex, e);
+	Locker l(mutex);
+	//The fresh record supersedes the stale one
+	staleMethods.erase(methodIndex);
+	CacheFileLock fl(filename, true);
+	ofstream f(filename.c_str(), ios::out|ios::binary|ios::app);
+	if(!f.is_open())
+	{
+		LOG(LOG_ERROR,_("Could not open optimized code cache ") << filename);
+		return;
+	}
+	f.write(record.data(), record.size());
+}
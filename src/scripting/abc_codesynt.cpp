@@ -903,7 +903,7 @@ void method_info::doAnalysis(std::map<unsigned int,block_info>& blocks, BuilderW
 {
 	llvm::IRBuilder<>& Builder = builderWrapper.Builder;
 	bool stop;
-	stringstream code(body->code);
+	stringstream code(body->abcCode());
 	for (unsigned int i=0;i<body->exceptions.size();i++)
 	{
 		exception_info& exc=body->exceptions[i];
@@ -1857,15 +1857,89 @@ void method_info::doAnalysis(std::map<unsigned int,block_info>& blocks, BuilderW
 
 SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 {
+	//The native code may be being written by a background compilation
+	Locker l(getVm(sys)->jitMutex);
 	if(f)
 		return f;
 
+	bool optimize;
+	if(!synt_method_ir(sys, optimize))
+		return NULL;
+	synt_method_compile(sys, optimize);
+	body->codeStatus = method_body_info::JITTED;
+	return f;
+}
+
+void method_info::synt_method_compile(SystemState* sys, bool optimize)
+{
+	//llvmf->dump(); //dump before optimization
+	if(optimize)
+		getVm(sys)->FPM->run(*llvmf);
+	f=(SyntheticFunction::synt_function)getVm(sys)->ex->getPointerToFunction(llvmf);
+	//llvmf->dump(); //dump after optimization
+}
+
+void JitCompileJob::execute()
+{
+	if(threadAborting)
+		return;
+	Locker l(getVm(sys)->jitMutex);
+	mi->synt_method_compile(sys, optimize);
+	done=true;
+}
+
+void JitCompileJob::jobFence()
+{
+	//The VM thread owns the job, it will be destroyed after being collected
+	finished.signal();
+}
+
+void ABCVm::compileInBackground(method_info* mi)
+{
+	assert(!mi->body->jitQueued);
+	mi->body->jitQueued=true;
+	bool optimize;
+	{
+		Locker l(jitMutex);
+		if(!mi->synt_method_ir(m_sys, optimize))
+			return;
+	}
+	JitCompileJob* job=new JitCompileJob(mi, m_sys, optimize);
+	jitJobs[mi]=job;
+	m_sys->addJob(job);
+}
+
+bool ABCVm::backgroundCompilationDone(method_info* mi)
+{
+	auto it=jitJobs.find(mi);
+	if(it==jitJobs.end() || !it->second->done)
+		return false;
+	it->second->waitFinished();
+	delete it->second;
+	jitJobs.erase(it);
+	mi->body->codeStatus = method_body_info::JITTED;
+	return true;
+}
+
+void ABCVm::waitBackgroundCompilation()
+{
+	for(auto it=jitJobs.begin();it!=jitJobs.end();++it)
+	{
+		it->second->waitFinished();
+		delete it->second;
+	}
+	jitJobs.clear();
+}
+
+bool method_info::synt_method_ir(SystemState* sys, bool& optimize)
+{
+	optimize=true;
 	string method_name="method";
 	method_name+=sys->getStringFromUniqueId(context->getString(info.name)).raw_buf();
 	if(!body)
 	{
 		LOG(LOG_CALLS,_("Method ") << method_name << _(" should be intrinsic"));;
-		return NULL;
+		return false;
 	}
 	llvm::ExecutionEngine* ex=getVm(sys)->ex;
 	llvm::LLVMContext& llvm_context=getVm(sys)->llvm_context();
@@ -2008,7 +2082,7 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 	doAnalysis(blocks,wrapper);
 
 	//Let's reset the stream
-	stringstream code(body->code);
+	stringstream code(body->abcCode());
 	vector<stack_entry> static_locals(body->local_count,make_stack_entry(NULL,STACK_NONE));
 	block_info* cur_block=NULL;
 	static_stack.clear();
@@ -4663,8 +4737,8 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 				Builder.CreateCall(ex->FindFunctionNamed("not_impl"), constant);
 				Builder.CreateRetVoid();
 
-				f=(SyntheticFunction::synt_function)getVm(sys)->ex->getPointerToFunction(llvmf);
-				return f;
+				optimize=false;
+				return true;
 		}
 	}
 
@@ -4678,12 +4752,7 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 		}
 	}
 
-	//llvmf->dump(); //dump before optimization
-	getVm(sys)->FPM->run(*llvmf);
-	f=(SyntheticFunction::synt_function)getVm(sys)->ex->getPointerToFunction(llvmf);
-	//llvmf->dump(); //dump after optimization
-	body->codeStatus = method_body_info::JITTED;
-	return f;
+	return true;
 }
 
 void ABCVm::wrong_exec_pos()
@@ -21,12 +21,32 @@
 #include "compat.h"
 #include "exceptions.h"
 #include "abcutils.h"
+#include "scripting/toplevel/Vector.h"
 #include <string>
 #include <sstream>
 
 using namespace std;
 using namespace lightspark;
 
+/* With GCC compatible compilers the handlers of the fast interpreter are
+ * direct threaded using computed gotos. Profiling accounts time at the end
+ * of the dispatch loop, so it keeps using the plain switch */
+#if defined(__GNUC__) && !defined(PROFILING_SUPPORT)
+#define THREADED_DISPATCH
+#endif
+
+/* Offset of the instruction being executed, data points right after its opcode */
+#define CURRENT_INSTRUCTION ((uint32_t)(reinterpret_cast<const char*>(data)-code-1))
+
+/* Jumps to the given offset. Backward jumps are counted as loop iterations
+ * to find out hot methods for tiered execution */
+#define BRANCH_TO(dest) \
+	do { \
+		if((dest)<=CURRENT_INSTRUCTION && mi->body->backedge_count!=UINT32_MAX) \
+			++mi->body->backedge_count; \
+		instructionPointer=(dest); \
+	} while(0)
+
 struct OpcodeData
 {
 	union
@@ -40,6 +60,110 @@ struct OpcodeData
 	};
 };
 
+#ifdef TAGGED_STACK_VALUES
+/* Returns true if the stack slot contains an int, either tagged or boxed */
+static inline bool isIntSlot(const ASObject* o)
+{
+	return isTaggedInt(o) || (o && o->is<Integer>());
+}
+
+/* Consumes a stack slot previously checked with isIntSlot */
+static inline int32_t consumeIntSlot(ASObject* o)
+{
+	if(isTaggedInt(o))
+		return getTaggedInt(o);
+	int32_t ret=o->as<Integer>()->val;
+	o->decRef();
+	return ret;
+}
+
+/* Stores an int in a local, reusing the Integer already stored there
+ * when nobody else is referencing it */
+static inline void setLocalInt(call_context* context, uint32_t i, int32_t v)
+{
+	ASObject* old=context->locals[i];
+	if(old && old->is<Integer>() && old->isLastRef())
+	{
+		old->as<Integer>()->val=v;
+		return;
+	}
+	if(old)
+		old->decRef();
+	context->locals[i]=abstract_i(context->context->root->getSystemState(),v);
+}
+
+#define TOP_IS_TAGGED_INT(n) (context->stack_index>=(n) && isTaggedInt(context->stack[context->stack_index-(n)]))
+#define TOP_IS_INT(n) (context->stack_index>=(n) && isIntSlot(context->stack[context->stack_index-(n)]))
+
+/* Fast paths used when the operands are ints. They break out of the
+ * opcode switch, so they must be used directly inside a case block */
+#define TAGGED_INT_BRANCH(cond) \
+	if(TOP_IS_INT(1) && TOP_IS_INT(2)) \
+	{ \
+		int32_t b=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		int32_t a=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		if(cond) \
+		{ \
+			assert(dest < code_len); \
+			BRANCH_TO(dest); \
+		} \
+		break; \
+	}
+#define TAGGED_INT_BINARY_OP(expr) \
+	if(TOP_IS_INT(1) && TOP_IS_INT(2)) \
+	{ \
+		int32_t b=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		int32_t a=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		context->runtime_stack_push_int(expr); \
+		break; \
+	}
+#define TAGGED_INT_UNARY_OP(expr) \
+	if(TOP_IS_INT(1)) \
+	{ \
+		int32_t a=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		context->runtime_stack_push_int(expr); \
+		break; \
+	}
+#define TAGGED_INT_COMPARISON(cond) \
+	if(TOP_IS_INT(1) && TOP_IS_INT(2)) \
+	{ \
+		int32_t b=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		int32_t a=consumeIntSlot(context->runtime_stack_pop_raw()); \
+		context->runtime_stack_push(abstract_b(function->getSystemState(),cond)); \
+		break; \
+	}
+#define TAGGED_INT_SETLOCAL(i) \
+	if(TOP_IS_TAGGED_INT(1)) \
+	{ \
+		int32_t v=getTaggedInt(context->runtime_stack_pop_raw()); \
+		LOG_CALL( _("setLocal ") << (i) ); \
+		if ((int)(i) != context->argarrayposition) \
+			setLocalInt(context,(i),v); \
+		break; \
+	}
+#else
+#define TAGGED_INT_BRANCH(cond)
+#define TAGGED_INT_BINARY_OP(expr)
+#define TAGGED_INT_UNARY_OP(expr)
+#define TAGGED_INT_COMPARISON(cond)
+#define TAGGED_INT_SETLOCAL(i)
+#endif
+
+/* Returns true if name is an index of the Vector obj, indexed accesses to
+ * Vectors skip the generic property lookup */
+static inline bool isVectorIndex(ASObject* obj, const multiname* name, uint32_t& index)
+{
+	if(!obj->is<Vector>() || !name->hasEmptyNS || name->isAttribute)
+		return false;
+	if(name->name_type==multiname::NAME_INT && name->name_i>=0)
+		index=name->name_i;
+	else if(name->name_type==multiname::NAME_UINT)
+		index=name->name_ui;
+	else
+		return false;
+	return true;
+}
+
 ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_context* context, ASObject *caller)
 {
 	method_info* mi=function->mi;
@@ -55,1667 +179,1956 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 #ifdef PROFILING_SUPPORT
 	if(mi->profTime.empty())
 		mi->profTime.resize(code_len,0);
+	if(mi->profBoxes.empty())
+		mi->profBoxes.resize(code_len,0);
 	uint64_t startTime=compat_get_thread_cputime_us();
+	uint64_t startBoxes=numericBoxCount.load(std::memory_order_relaxed);
+	/* Accounts time and boxes to the instruction being executed, both indexed
+	 * by its position. It is called at the end of each instruction and when the
+	 * function is left by a return or an exception */
+	struct InstructionProfiler
+	{
+		method_info* mi;
+		const call_context* context;
+		uint64_t& startTime;
+		uint64_t& startBoxes;
+		void account()
+		{
+			mi->profTime[context->exec_pos]+=ABCVm::profilingCheckpoint(startTime);
+			mi->profBoxes[context->exec_pos]+=ABCVm::profilingBoxesCheckpoint(startBoxes);
+		}
+		~InstructionProfiler()
+		{
+			account();
+		}
+	} instructionProfiler={mi, context, startTime, startBoxes};
 #define PROF_ACCOUNT_TIME(a, b)  do{a+=b;}while(0)
 #define PROF_IGNORE_TIME(a) do{ a; } while(0)
+#define PROF_ACCOUNT_INSTRUCTION() instructionProfiler.account()
 #else
 #define PROF_ACCOUNT_TIME(a, b) do{ ; }while(0)
 #define PROF_IGNORE_TIME(a) do{ ; } while(0)
+#define PROF_ACCOUNT_INSTRUCTION() do{ ; }while(0)
 #endif
 
-	//Each case block builds the correct parameters for the interpreter function and call it
-	while(1)
+#ifdef THREADED_DISPATCH
+	/* Handler address for every opcode, used to jump directly from the end of
+	 * an handler to the next one instead of going back through the switch */
+	static const void* const dispatch_table[256] = {
+		&&op_default, &&op_0x01, &&op_0x02, &&op_0x03,
+		&&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07,
+		&&op_0x08, &&op_default, &&op_default, &&op_default,
+		&&op_0x0c, &&op_0x0d, &&op_0x0e, &&op_0x0f,
+		&&op_0x10, &&op_0x11, &&op_0x12, &&op_0x13,
+		&&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17,
+		&&op_0x18, &&op_0x19, &&op_0x1a, &&op_0x1b,
+		&&op_0x1c, &&op_0x1d, &&op_0x1e, &&op_default,
+		&&op_0x20, &&op_0x21, &&op_default, &&op_0x23,
+		&&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27,
+		&&op_0x28, &&op_0x29, &&op_0x2a, &&op_0x2b,
+		&&op_0x2c, &&op_0x2d, &&op_0x2e, &&op_0x2f,
+		&&op_0x30, &&op_0x31, &&op_0x32, &&op_default,
+		&&op_default, &&op_0x35, &&op_0x36, &&op_0x37,
+		&&op_0x38, &&op_0x39, &&op_0x3a, &&op_0x3b,
+		&&op_0x3c, &&op_0x3d, &&op_0x3e, &&op_default,
+		&&op_0x40, &&op_0x41, &&op_0x42, &&op_default,
+		&&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+		&&op_0x48, &&op_0x49, &&op_0x4a, &&op_default,
+		&&op_0x4c, &&op_default, &&op_0x4e, &&op_0x4f,
+		&&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53,
+		&&op_default, &&op_0x55, &&op_0x56, &&op_0x57,
+		&&op_0x58, &&op_0x59, &&op_0x5a, &&op_default,
+		&&op_default, &&op_0x5d, &&op_0x5e, &&op_0x5f,
+		&&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63,
+		&&op_0x64, &&op_0x65, &&op_0x66, &&op_default,
+		&&op_0x68, &&op_default, &&op_0x6a, &&op_default,
+		&&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+		&&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73,
+		&&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+		&&op_0x78, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_0x80, &&op_default, &&op_0x82, &&op_default,
+		&&op_default, &&op_0x85, &&op_0x86, &&op_0x87,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93,
+		&&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3,
+		&&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7,
+		&&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab,
+		&&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+		&&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3,
+		&&op_0xb4, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3,
+		&&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3,
+		&&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_0xf2, &&op_0xf3,
+		&&op_default, &&op_default, &&op_default, &&op_default,
+		&&op_default, &&op_default, &&op_default, &&op_0xfb,
+		&&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+	};
+#define OPCODE_LABEL(n) op_##n:
+#define DISPATCH_NEXT \
+	do { \
+		assert(instructionPointer<code_len); \
+		opcode=code[instructionPointer]; \
+		instructionPointer++; \
+		data=reinterpret_cast<const OpcodeData*>(code+instructionPointer); \
+		goto *dispatch_table[opcode]; \
+	} while(0)
+#else
+#define OPCODE_LABEL(n)
+#define DISPATCH_NEXT break
+#endif
+/* Every handler must be declared with OPCODE_CASE, so that it has both a case
+ * and a label. A label missing from dispatch_table is reported by -Wunused-label,
+ * so an opcode can not silently fall to op_default without a warning */
+#define OPCODE_CASE(n) case n: OPCODE_LABEL(n)
+
+	uint8_t opcode;
+	const OpcodeData* data=NULL;
+	/* The position of the current instruction is only needed by the exception
+	 * handling in SyntheticFunction::call, so it is stored when something is thrown
+	 * instead of at every instruction. Profiling accounts everything by position */
+	try
 	{
-		assert(instructionPointer<code_len);
-		uint8_t opcode=code[instructionPointer];
-		//Save ip for exception handling in SyntheticFunction::callImpl
-		context->exec_pos = instructionPointer;
-		instructionPointer++;
-		const OpcodeData* data=reinterpret_cast<const OpcodeData*>(code+instructionPointer);
-
-		switch(opcode)
+		//Each case block builds the correct parameters for the interpreter function and call it
+		while(1)
 		{
-			case 0x01:
-			{
-				//bkpt
-				LOG_CALL( _("bkpt") );
-				break;
-			}
-			case 0x02:
-			{
-				//nop
-				break;
-			}
-			case 0x03:
-			{
-				//throw
-				_throw(context);
-				break;
-			}
-			case 0x04:
-			{
-				//getsuper
-				getSuper(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x05:
-			{
-				//setsuper
-				setSuper(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x06:
-			{
-				//dxns
-				dxns(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x07:
-			{
-				//dxnslate
-				ASObject* v=context->runtime_stack_pop();
-				dxnslate(context, v);
-				break;
-			}
-			case 0x08:
-			{
-				//kill
-				uint32_t t=data->uints[0];
-				LOG_CALL( "kill " << t);
-				instructionPointer+=4;
-				assert_and_throw(context->locals[t]);
-				context->locals[t]->decRef();
-				context->locals[t]=function->getSystemState()->getUndefinedRef();
-				break;
-			}
-			case 0x0c:
+			assert(instructionPointer<code_len);
+			opcode=code[instructionPointer];
+#ifdef PROFILING_SUPPORT
+			context->exec_pos = instructionPointer;
+#endif
+			instructionPointer++;
+			data=reinterpret_cast<const OpcodeData*>(code+instructionPointer);
+
+			switch(opcode)
 			{
-				//ifnlt
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifNLT(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x01)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//bkpt
+					LOG_CALL( _("bkpt") );
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x0d:
-			{
-				//ifnle
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifNLE(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x02)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//nop
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x0e:
-			{
-				//ifngt
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifNGT(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x03)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//throw
+					_throw(context);
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x0f:
-			{
-				//ifnge
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifNGE(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x04)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//getsuper
+					getSuper(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x10:
-			{
-				//jump
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				assert(dest < code_len);
-				instructionPointer=dest;
-				break;
-			}
-			case 0x11:
-			{
-				//iftrue
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				bool cond=ifTrue(v1);
-				if(cond)
+				OPCODE_CASE(0x05)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//setsuper
+					setSuper(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x12:
-			{
-				//iffalse
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				bool cond=ifFalse(v1);
-				if(cond)
+				OPCODE_CASE(0x06)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//dxns
+					dxns(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x13:
-			{
-				//ifeq
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifEq(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x07)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//dxnslate
+					ASObject* v=context->runtime_stack_pop();
+					dxnslate(context, v);
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x14:
-			{
-				//ifne
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifNE(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x08)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//kill
+					uint32_t t=data->uints[0];
+					LOG_CALL( "kill " << t);
+					instructionPointer+=4;
+					assert_and_throw(context->locals[t]);
+					context->locals[t]->decRef();
+					context->locals[t]=function->getSystemState()->getUndefinedRef();
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x15:
-			{
-				//iflt
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifLT(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x0c)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//ifnlt
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(!(a<b));
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifNLT(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x16:
-			{
-				//ifle
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifLE(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x0d)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//ifnle
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(!(a<=b));
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifNLE(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x17:
-			{
-				//ifgt
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifGT(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x0e)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//ifngt
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(!(a>b));
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifNGT(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x18:
-			{
-				//ifge
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifGE(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x0f)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//ifnge
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(!(a>=b));
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifNGE(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x19:
-			{
-				//ifstricteq
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifStrictEq(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x10)
 				{
+					//jump
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+
 					assert(dest < code_len);
-					instructionPointer=dest;
+					BRANCH_TO(dest);
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x1a:
-			{
-				//ifstrictne
-				uint32_t dest=data->uints[0];
-				instructionPointer+=4;
-
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				bool cond=ifStrictNE(v1, v2);
-				if(cond)
+				OPCODE_CASE(0x11)
 				{
-					assert(dest < code_len);
-					instructionPointer=dest;
+					//iftrue
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+#ifdef TAGGED_STACK_VALUES
+					if(TOP_IS_INT(1))
+					{
+						int32_t a=consumeIntSlot(context->runtime_stack_pop_raw());
+						if(a!=0)
+						{
+							assert(dest < code_len);
+							BRANCH_TO(dest);
+						}
+						break;
+					}
+#endif
+
+					ASObject* v1=context->runtime_stack_pop();
+					bool cond=ifTrue(v1);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x1b:
-			{
-				//lookupswitch
-				uint32_t defaultdest=data->uints[0];
-				LOG_CALL(_("Switch default dest ") << defaultdest);
-				uint32_t count=data->uints[1];
-
-				ASObject* index_obj=context->runtime_stack_pop();
-				assert_and_throw(index_obj->getObjectType()==T_INTEGER);
-				unsigned int index=index_obj->toUInt();
-				index_obj->decRef();
-
-				uint32_t dest=defaultdest;
-				if(index<=count)
-					dest=data->uints[2+index];
-
-				assert(dest < code_len);
-				instructionPointer=dest;
-				break;
-			}
-			case 0x1c:
-			{
-				//pushwith
-				pushWith(context);
-				break;
-			}
-			case 0x1d:
-			{
-				//popscope
-				popScope(context);
-				break;
-			}
-			case 0x1e:
-			{
-				//nextname
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				context->runtime_stack_push(nextName(v1,v2));
-				break;
-			}
-			case 0x20:
-			{
-				//pushnull
-				context->runtime_stack_push(pushNull());
-				break;
-			}
-			case 0x21:
-			{
-				//pushundefined
-				context->runtime_stack_push(pushUndefined());
-				break;
-			}
-			case 0x23:
-			{
-				//nextvalue
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-				context->runtime_stack_push(nextValue(v1,v2));
-				break;
-			}
-			case 0x24:
-			{
-				//pushbyte
-				int8_t t=code[instructionPointer];
-				instructionPointer++;
-				context->runtime_stack_push(abstract_i(function->getSystemState(),t));
-				pushByte(t);
-				break;
-			}
-			case 0x25:
-			{
-				//pushshort
-				// specs say pushshort is a u30, but it's really a u32
-				// see https://bugs.adobe.com/jira/browse/ASC-4181
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				context->runtime_stack_push(abstract_i(function->getSystemState(),t));
-				pushShort(t);
-				break;
-			}
-			case 0x26:
-			{
-				//pushtrue
-				context->runtime_stack_push(abstract_b(function->getSystemState(),pushTrue()));
-				break;
-			}
-			case 0x27:
-			{
-				//pushfalse
-				context->runtime_stack_push(abstract_b(function->getSystemState(),pushFalse()));
-				break;
-			}
-			case 0x28:
-			{
-				//pushnan
-				context->runtime_stack_push(pushNaN());
-				break;
-			}
-			case 0x29:
-			{
-				//pop
-				pop();
-				ASObject* o=context->runtime_stack_pop();
-				if(o)
-					o->decRef();
-				break;
-			}
-			case 0x2a:
-			{
-				//dup
-				dup();
-				ASObject* o=context->runtime_stack_peek();
-				o->incRef();
-				context->runtime_stack_push(o);
-				break;
-			}
-			case 0x2b:
-			{
-				//swap
-				swap();
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				context->runtime_stack_push(v1);
-				context->runtime_stack_push(v2);
-				break;
-			}
-			case 0x2c:
-			{
-				//pushstring
-				context->runtime_stack_push(pushString(context,data->uints[0]));
-				instructionPointer+=4;
-				break;
-			}
-			case 0x2d:
-			{
-				//pushint
-				int32_t t=data->ints[0];
-				instructionPointer+=4;
-				pushInt(context, t);
-				ASObject* i=abstract_i(function->getSystemState(),t);
-				context->runtime_stack_push(i);
-				break;
-			}
-			case 0x2e:
-			{
-				//pushuint
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				pushUInt(context, t);
-
-				ASObject* i=abstract_ui(function->getSystemState(),t);
-				context->runtime_stack_push(i);
-				break;
-			}
-			case 0x2f:
-			{
-				//pushdouble
-				double t=data->doubles[0];
-				instructionPointer+=8;
-				pushDouble(context, t);
-
-				ASObject* d=abstract_d(function->getSystemState(),t);
-				context->runtime_stack_push(d);
-				break;
-			}
-			case 0x30:
-			{
-				//pushscope
-				pushScope(context);
-				break;
-			}
-			case 0x31:
-			{
-				//pushnamespace
-				context->runtime_stack_push( pushNamespace(context, data->uints[0]) );
-				instructionPointer+=4;
-				break;
-			}
-			case 0x32:
-			{
-				//hasnext2
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				instructionPointer+=8;
-
-				bool ret=hasNext2(context,t,t2);
-				context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
-				break;
-			}
-			//Alchemy opcodes
-			case 0x35:
-			{
-				//li8
-				LOG_CALL( "li8");
-				loadIntN<uint8_t>(context);
-				break;
-			}
-			case 0x36:
-			{
-				//li16
-				LOG_CALL( "li16");
-				loadIntN<uint16_t>(context);
-				break;
-			}
-			case 0x37:
-			{
-				//li32
-				LOG_CALL( "li32");
-				loadIntN<uint32_t>(context);
-				break;
-			}
-			case 0x38:
-			{
-				//lf32
-				LOG_CALL( "lf32");
-				loadFloat(context);
-				break;
-			}
-			case 0x39:
-			{
-				//lf32
-				LOG_CALL( "lf64");
-				loadDouble(context);
-				break;
-			}
-			case 0x3a:
-			{
-				//si8
-				LOG_CALL( "si8");
-				storeIntN<uint8_t>(context);
-				break;
-			}
-			case 0x3b:
-			{
-				//si16
-				LOG_CALL( "si16");
-				storeIntN<uint16_t>(context);
-				break;
-			}
-			case 0x3c:
-			{
-				//si32
-				LOG_CALL( "si32");
-				storeIntN<uint32_t>(context);
-				break;
-			}
-			case 0x3d:
-			{
-				//sf32
-				LOG_CALL( "sf32");
-				storeFloat(context);
-				break;
-			}
-			case 0x3e:
-			{
-				//sf32
-				LOG_CALL( "sf64");
-				storeDouble(context);
-				break;
-			}
-			case 0x40:
-			{
-				//newfunction
-				context->runtime_stack_push(newFunction(context,data->uints[0]));
-				instructionPointer+=4;
-				break;
-			}
-			case 0x41:
-			{
-				//call
-				uint32_t t=data->uints[0];
-				method_info* called_mi=NULL;
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				call(context,t,&called_mi);
-				if(called_mi)
-					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
-				else
-					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
-				instructionPointer+=4;
-				break;
-			}
-			case 0x42:
-			{
-				//construct
-				construct(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x44:
-			{
-				//callstatic
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				method_info* called_mi=NULL;
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				callStatic(context,t,t2,&called_mi,true);
-				if(called_mi)
-					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
-				else
-					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
-				break;
-			}
-			case 0x45:
-			{
-				//callsuper
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				method_info* called_mi=NULL;
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				callSuper(context,t,t2,&called_mi,true);
-				if(called_mi)
-					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
-				else
-					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
-				instructionPointer+=8;
-				break;
-			}
-			case 0x46:
-			case 0x4c: //callproplex seems to be exactly like callproperty
-			{
-				//callproperty
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				method_info* called_mi=NULL;
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				callProperty(context,t,t2,&called_mi,true);
-				if(called_mi)
-					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
-				else
-					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
-				instructionPointer+=8;
-				break;
-			}
-			case 0x47:
-			{
-				//returnvoid
-				LOG_CALL(_("returnVoid"));
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				return NULL;
-			}
-			case 0x48:
-			{
-				//returnvalue
-				ASObject* ret=context->runtime_stack_pop();
-				LOG_CALL(_("returnValue ") << ret);
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				return ret;
-			}
-			case 0x49:
-			{
-				//constructsuper
-				constructSuper(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x4a:
-			{
-				//constructprop
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				instructionPointer+=8;
-				constructProp(context,t,t2);
-				break;
-			}
-			case 0x4e:
-			{
-				//callsupervoid
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				method_info* called_mi=NULL;
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				callSuper(context,t,t2,&called_mi,false);
-				if(called_mi)
-					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
-				else
-					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
-				instructionPointer+=8;
-				break;
-			}
-			case 0x4f:
-			{
-				//callpropvoid
-				uint32_t t=data->uints[0];
-				uint32_t t2=data->uints[1];
-				method_info* called_mi=NULL;
-				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
-				callProperty(context,t,t2,&called_mi,false);
-				if(called_mi)
-					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
-				else
-					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
-				instructionPointer+=8;
-				break;
-			}
-			case 0x50:
-			{
-				//sxi1
-				LOG_CALL( "sxi1");
-				ASObject* arg1=context->runtime_stack_pop();
-				int32_t ret=arg1->toUInt() & 0x1;
-				arg1->decRef();
-				context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
-				break;
-			}
-			case 0x51:
-			{
-				//sxi8
-				LOG_CALL( "sxi8");
-				ASObject* arg1=context->runtime_stack_pop();
-				int32_t ret=(int8_t)arg1->toUInt();
-				arg1->decRef();
-				context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
-				break;
-			}
-			case 0x52:
-			{
-				//sxi16
-				LOG_CALL( "sxi16");
-				ASObject* arg1=context->runtime_stack_pop();
-				int32_t ret=(int16_t)arg1->toUInt();
-				arg1->decRef();
-				context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
-				break;
-			}
-			case 0x53:
-			{
-				//constructgenerictype
-				constructGenericType(context, data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x55:
-			{
-				//newobject
-				newObject(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x56:
-			{
-				//newarray
-				newArray(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x57:
-			{
-				//newactivation
-				context->runtime_stack_push(newActivation(context, mi));
-				break;
-			}
-			case 0x58:
-			{
-				//newclass
-				newClass(context,data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x59:
-			{
-				//getdescendants
-				getDescendants(context, data->uints[0]);
-				instructionPointer+=4;
-				break;
-			}
-			case 0x5a:
-			{
-				//newcatch
-				context->runtime_stack_push(newCatch(context,data->uints[0]));
-				instructionPointer+=4;
-				break;
-			}
-			case 0x5d:
-			{
-				//findpropstrict
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name=context->context->getMultiname(t,context);
-				context->runtime_stack_push(findPropStrict(context,name));
-				name->resetNameIfObject();
-				break;
-			}
-			case 0x5e:
-			{
-				//findproperty
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name=context->context->getMultiname(t,context);
-				context->runtime_stack_push(findProperty(context,name));
-				name->resetNameIfObject();
-				break;
-			}
-			case 0x5f:
-			{
-				//finddef
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name=context->context->getMultiname(t,context);
-				LOG(LOG_NOT_IMPLEMENTED,"opcode 0x5f (finddef) not implemented:"<< *name);
-				context->runtime_stack_push(function->getSystemState()->getNullRef());
-				name->resetNameIfObject();
-				break;
-			}
-			case 0x60:
-			{
-				//getlex
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				getLex(context,t);
-				break;
-			}
-			case 0x61:
-			{
-				//setproperty
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				ASObject* value=context->runtime_stack_pop();
+				OPCODE_CASE(0x12)
+				{
+					//iffalse
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+#ifdef TAGGED_STACK_VALUES
+					if(TOP_IS_INT(1))
+					{
+						int32_t a=consumeIntSlot(context->runtime_stack_pop_raw());
+						if(a==0)
+						{
+							assert(dest < code_len);
+							BRANCH_TO(dest);
+						}
+						break;
+					}
+#endif
 
-				multiname* name=context->context->getMultiname(t,context);
+					ASObject* v1=context->runtime_stack_pop();
+					bool cond=ifFalse(v1);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x13)
+				{
+					//ifeq
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a==b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifEq(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x14)
+				{
+					//ifne
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a!=b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifNE(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x15)
+				{
+					//iflt
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a<b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifLT(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x16)
+				{
+					//ifle
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a<=b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifLE(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x17)
+				{
+					//ifgt
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a>b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifGT(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x18)
+				{
+					//ifge
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a>=b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifGE(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x19)
+				{
+					//ifstricteq
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a==b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifStrictEq(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x1a)
+				{
+					//ifstrictne
+					uint32_t dest=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_BRANCH(a!=b);
+
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					bool cond=ifStrictNE(v1, v2);
+					if(cond)
+					{
+						assert(dest < code_len);
+						BRANCH_TO(dest);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x1b)
+				{
+					//lookupswitch
+					uint32_t defaultdest=data->uints[0];
+					LOG_CALL(_("Switch default dest ") << defaultdest);
+					uint32_t count=data->uints[1];
+
+#ifdef TAGGED_STACK_VALUES
+					ASObject* index_obj=context->runtime_stack_pop_raw();
+					assert_and_throw(isIntSlot(index_obj));
+					unsigned int index=consumeIntSlot(index_obj);
+#else
+					ASObject* index_obj=context->runtime_stack_pop();
+					assert_and_throw(index_obj->getObjectType()==T_INTEGER);
+					unsigned int index=index_obj->toUInt();
+					index_obj->decRef();
+#endif
 
-				ASObject* obj=context->runtime_stack_pop();
+					uint32_t dest=defaultdest;
+					if(index<=count)
+						dest=data->uints[2+index];
 
-				setProperty(value,obj,name);
-				name->resetNameIfObject();
-				break;
-			}
-			case 0x62:
-			{
-				//getlocal
-				uint32_t i=data->uints[0];
-				instructionPointer+=4;
-				if (!context->locals[i])
+					assert(dest < code_len);
+					BRANCH_TO(dest);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x1c)
 				{
-					LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
-					context->runtime_stack_push(function->getSystemState()->getUndefinedRef());
-					break;
+					//pushwith
+					pushWith(context);
+					DISPATCH_NEXT;
 				}
-				context->locals[i]->incRef();
-				LOG_CALL( _("getLocal ") << i << _(": ") << context->locals[i]->toDebugString() );
-				context->runtime_stack_push(context->locals[i]);
-				break;
-			}
-			case 0x63:
-			{
-				//setlocal
-				uint32_t i=data->uints[0];
-				instructionPointer+=4;
-				LOG_CALL( _("setLocal ") << i );
-				ASObject* obj=context->runtime_stack_pop();
-				assert_and_throw(obj);
-				if ((int)i != context->argarrayposition || obj->is<Array>())
-				{
-					if(context->locals[i])
-						context->locals[i]->decRef();
-					context->locals[i]=obj;
-				}
-				break;
-			}
-			case 0x64:
-			{
-				//getglobalscope
-				context->runtime_stack_push(getGlobalScope(context));
-				break;
-			}
-			case 0x65:
-			{
-				//getscopeobject
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				context->runtime_stack_push(getScopeObject(context,t));
-				break;
-			}
-			case 0x66:
-			{
-				//getproperty
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name=context->context->getMultiname(t,context);
-
-				ASObject* obj=context->runtime_stack_pop();
+				OPCODE_CASE(0x1d)
+				{
+					//popscope
+					popScope(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x1e)
+				{
+					//nextname
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					context->runtime_stack_push(nextName(v1,v2));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x20)
+				{
+					//pushnull
+					context->runtime_stack_push(pushNull());
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x21)
+				{
+					//pushundefined
+					context->runtime_stack_push(pushUndefined());
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x23)
+				{
+					//nextvalue
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+					context->runtime_stack_push(nextValue(v1,v2));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x24)
+				{
+					//pushbyte
+					int8_t t=code[instructionPointer];
+					instructionPointer++;
+#ifdef TAGGED_STACK_VALUES
+					context->runtime_stack_push_int(t);
+#else
+					context->runtime_stack_push(abstract_i(function->getSystemState(),t));
+#endif
+					pushByte(t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x25)
+				{
+					//pushshort
+					// specs say pushshort is a u30, but it's really a u32
+					// see https://bugs.adobe.com/jira/browse/ASC-4181
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+#ifdef TAGGED_STACK_VALUES
+					context->runtime_stack_push_int(t);
+#else
+					context->runtime_stack_push(abstract_i(function->getSystemState(),t));
+#endif
+					pushShort(t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x26)
+				{
+					//pushtrue
+					context->runtime_stack_push(abstract_b(function->getSystemState(),pushTrue()));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x27)
+				{
+					//pushfalse
+					context->runtime_stack_push(abstract_b(function->getSystemState(),pushFalse()));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x28)
+				{
+					//pushnan
+					context->runtime_stack_push(pushNaN());
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x29)
+				{
+					//pop
+					pop();
+#ifdef TAGGED_STACK_VALUES
+					ASObject* o=context->runtime_stack_pop_raw();
+					if(o && !isTaggedInt(o))
+						o->decRef();
+#else
+					ASObject* o=context->runtime_stack_pop();
+					if(o)
+						o->decRef();
+#endif
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x2a)
+				{
+					//dup
+					dup();
+#ifdef TAGGED_STACK_VALUES
+					if(TOP_IS_TAGGED_INT(1))
+					{
+						context->runtime_stack_push(context->stack[context->stack_index-1]);
+						break;
+					}
+#endif
+					ASObject* o=context->runtime_stack_peek();
+					o->incRef();
+					context->runtime_stack_push(o);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x2b)
+				{
+					//swap
+					swap();
+#ifdef TAGGED_STACK_VALUES
+					ASObject* v1=context->runtime_stack_pop_raw();
+					ASObject* v2=context->runtime_stack_pop_raw();
+#else
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+#endif
 
-				ASObject* ret=getProperty(obj,name);
-				name->resetNameIfObject();
+					context->runtime_stack_push(v1);
+					context->runtime_stack_push(v2);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x2c)
+				{
+					//pushstring
+					context->runtime_stack_push(pushString(context,data->uints[0]));
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x2d)
+				{
+					//pushint
+					int32_t t=data->ints[0];
+					instructionPointer+=4;
+					pushInt(context, t);
+#ifdef TAGGED_STACK_VALUES
+					context->runtime_stack_push_int(t);
+#else
+					ASObject* i=abstract_i(function->getSystemState(),t);
+					context->runtime_stack_push(i);
+#endif
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x2e)
+				{
+					//pushuint
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					pushUInt(context, t);
+
+					ASObject* i=abstract_ui(function->getSystemState(),t);
+					context->runtime_stack_push(i);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x2f)
+				{
+					//pushdouble
+					double t=data->doubles[0];
+					instructionPointer+=8;
+					pushDouble(context, t);
+
+					ASObject* d=abstract_d(function->getSystemState(),t);
+					context->runtime_stack_push(d);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x30)
+				{
+					//pushscope
+					pushScope(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x31)
+				{
+					//pushnamespace
+					context->runtime_stack_push( pushNamespace(context, data->uints[0]) );
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x32)
+				{
+					//hasnext2
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					instructionPointer+=8;
+
+					bool ret=hasNext2(context,t,t2);
+					context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
+					DISPATCH_NEXT;
+				}
+				//Alchemy opcodes
+				OPCODE_CASE(0x35)
+				{
+					//li8
+					LOG_CALL( "li8");
+					loadIntN<uint8_t>(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x36)
+				{
+					//li16
+					LOG_CALL( "li16");
+					loadIntN<uint16_t>(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x37)
+				{
+					//li32
+					LOG_CALL( "li32");
+					loadIntN<uint32_t>(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x38)
+				{
+					//lf32
+					LOG_CALL( "lf32");
+					loadFloat(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x39)
+				{
+					//lf32
+					LOG_CALL( "lf64");
+					loadDouble(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x3a)
+				{
+					//si8
+					LOG_CALL( "si8");
+					storeIntN<uint8_t>(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x3b)
+				{
+					//si16
+					LOG_CALL( "si16");
+					storeIntN<uint16_t>(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x3c)
+				{
+					//si32
+					LOG_CALL( "si32");
+					storeIntN<uint32_t>(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x3d)
+				{
+					//sf32
+					LOG_CALL( "sf32");
+					storeFloat(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x3e)
+				{
+					//sf32
+					LOG_CALL( "sf64");
+					storeDouble(context);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x40)
+				{
+					//newfunction
+					context->runtime_stack_push(newFunction(context,data->uints[0]));
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x41)
+				{
+					//call
+					uint32_t t=data->uints[0];
+					method_info* called_mi=NULL;
+					PROF_ACCOUNT_TIME(mi->profTime[context->exec_pos],profilingCheckpoint(startTime));
+					call(context,t,&called_mi);
+					if(called_mi)
+						PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+					else
+						PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x42)
+				{
+					//construct
+					construct(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x44)
+				{
+					//callstatic
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					method_info* called_mi=NULL;
+					PROF_ACCOUNT_TIME(mi->profTime[context->exec_pos],profilingCheckpoint(startTime));
+					callStatic(context,t,t2,&called_mi,true);
+					if(called_mi)
+						PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+					else
+						PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x45)
+				{
+					//callsuper
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					method_info* called_mi=NULL;
+					PROF_ACCOUNT_TIME(mi->profTime[context->exec_pos],profilingCheckpoint(startTime));
+					callSuper(context,t,t2,&called_mi,true);
+					if(called_mi)
+						PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+					else
+						PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+					instructionPointer+=8;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x46)
+				OPCODE_CASE(0x4c) //callproplex seems to be exactly like callproperty
+				{
+					//callproperty
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					inline_cache* ic=mi->body->getInlineCache(data->uints[2]);
+					method_info* called_mi=NULL;
+					PROF_ACCOUNT_TIME(mi->profTime[context->exec_pos],profilingCheckpoint(startTime));
+					callPropertyCached(context,t,t2,&called_mi,true,ic);
+					if(called_mi)
+						PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+					else
+						PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+					instructionPointer+=12;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x47)
+				{
+					//returnvoid
+					LOG_CALL(_("returnVoid"));
+					return NULL;
+				}
+				OPCODE_CASE(0x48)
+				{
+					//returnvalue
+					ASObject* ret=context->runtime_stack_pop();
+					LOG_CALL(_("returnValue ") << ret);
+					return ret;
+				}
+				OPCODE_CASE(0x49)
+				{
+					//constructsuper
+					constructSuper(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x4a)
+				{
+					//constructprop
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					instructionPointer+=8;
+					constructProp(context,t,t2);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x4e)
+				{
+					//callsupervoid
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					method_info* called_mi=NULL;
+					PROF_ACCOUNT_TIME(mi->profTime[context->exec_pos],profilingCheckpoint(startTime));
+					callSuper(context,t,t2,&called_mi,false);
+					if(called_mi)
+						PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+					else
+						PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+					instructionPointer+=8;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x4f)
+				{
+					//callpropvoid
+					uint32_t t=data->uints[0];
+					uint32_t t2=data->uints[1];
+					inline_cache* ic=mi->body->getInlineCache(data->uints[2]);
+					method_info* called_mi=NULL;
+					PROF_ACCOUNT_TIME(mi->profTime[context->exec_pos],profilingCheckpoint(startTime));
+					callPropertyCached(context,t,t2,&called_mi,false,ic);
+					if(called_mi)
+						PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+					else
+						PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+					instructionPointer+=12;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x50)
+				{
+					//sxi1
+					LOG_CALL( "sxi1");
+					ASObject* arg1=context->runtime_stack_pop();
+					int32_t ret=arg1->toUInt() & 0x1;
+					arg1->decRef();
+					context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x51)
+				{
+					//sxi8
+					LOG_CALL( "sxi8");
+					ASObject* arg1=context->runtime_stack_pop();
+					int32_t ret=(int8_t)arg1->toUInt();
+					arg1->decRef();
+					context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x52)
+				{
+					//sxi16
+					LOG_CALL( "sxi16");
+					ASObject* arg1=context->runtime_stack_pop();
+					int32_t ret=(int16_t)arg1->toUInt();
+					arg1->decRef();
+					context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x53)
+				{
+					//constructgenerictype
+					constructGenericType(context, data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x55)
+				{
+					//newobject
+					newObject(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x56)
+				{
+					//newarray
+					newArray(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x57)
+				{
+					//newactivation
+					context->runtime_stack_push(newActivation(context, mi));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x58)
+				{
+					//newclass
+					newClass(context,data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x59)
+				{
+					//getdescendants
+					getDescendants(context, data->uints[0]);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x5a)
+				{
+					//newcatch
+					context->runtime_stack_push(newCatch(context,data->uints[0]));
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x5d)
+				{
+					//findpropstrict
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					multiname* name=context->context->getMultiname(t,context);
+					context->runtime_stack_push(findPropStrict(context,name));
+					name->resetNameIfObject();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x5e)
+				{
+					//findproperty
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					multiname* name=context->context->getMultiname(t,context);
+					context->runtime_stack_push(findProperty(context,name));
+					name->resetNameIfObject();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x5f)
+				{
+					//finddef
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					multiname* name=context->context->getMultiname(t,context);
+					LOG(LOG_NOT_IMPLEMENTED,"opcode 0x5f (finddef) not implemented:"<< *name);
+					context->runtime_stack_push(function->getSystemState()->getNullRef());
+					name->resetNameIfObject();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x60)
+				{
+					//getlex
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					getLex(context,t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x61)
+				{
+					//setproperty
+					uint32_t t=data->uints[0];
+					inline_cache* ic=mi->body->getInlineCache(data->uints[1]);
+					instructionPointer+=8;
+#ifdef TAGGED_STACK_VALUES
+					ASObject* value=context->runtime_stack_pop_raw();
+#else
+					ASObject* value=context->runtime_stack_pop();
+#endif
 
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x68:
-			{
-				//initproperty
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				ASObject* value=context->runtime_stack_pop();
-			        multiname* name=context->context->getMultiname(t,context);
-			        ASObject* obj=context->runtime_stack_pop();
-				initProperty(obj,value,name);
-				name->resetNameIfObject();
-				break;
-			}
-			case 0x6a:
-			{
-				//deleteproperty
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name = context->context->getMultiname(t,context);
-				ASObject* obj=context->runtime_stack_pop();
-				bool ret = deleteProperty(obj,name);
-				name->resetNameIfObject();
-				context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
-				break;
-			}
-			case 0x6c:
-			{
-				//getslot
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				ASObject* obj=context->runtime_stack_pop();
-				ASObject* ret=getSlot(obj, t);
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x6d:
-			{
-				//setslot
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
+					multiname* name=context->context->getMultiname(t,context);
+
+					ASObject* obj=context->runtime_stack_pop();
+
+					uint32_t index;
+					bool vectorIndex=isVectorIndex(obj,name,index);
+#ifdef TAGGED_STACK_VALUES
+					if(isTaggedInt(value))
+					{
+						if(vectorIndex && obj->as<Vector>()->setIndexedInt(index,getTaggedInt(value)))
+						{
+							obj->decRef();
+							DISPATCH_NEXT;
+						}
+						value=context->boxInt(getTaggedInt(value));
+					}
+#endif
+					if(vectorIndex && obj->as<Vector>()->setIndexed(index,value))
+					{
+						obj->decRef();
+						DISPATCH_NEXT;
+					}
+					setPropertyCached(value,obj,name,ic);
+					name->resetNameIfObject();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x62)
+				{
+					//getlocal
+					uint32_t i=data->uints[0];
+					instructionPointer+=4;
+					if (!context->locals[i])
+					{
+						LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
+						context->runtime_stack_push(function->getSystemState()->getUndefinedRef());
+						break;
+					}
+					context->locals[i]->incRef();
+					LOG_CALL( _("getLocal ") << i << _(": ") << context->locals[i]->toDebugString() );
+					context->runtime_stack_push(context->locals[i]);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x63)
+				{
+					//setlocal
+					uint32_t i=data->uints[0];
+					instructionPointer+=4;
+					TAGGED_INT_SETLOCAL(i);
+					LOG_CALL( _("setLocal ") << i );
+					ASObject* obj=context->runtime_stack_pop();
+					assert_and_throw(obj);
+					if ((int)i != context->argarrayposition || obj->is<Array>())
+					{
+						if(context->locals[i])
+							context->locals[i]->decRef();
+						context->locals[i]=obj;
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x64)
+				{
+					//getglobalscope
+					context->runtime_stack_push(getGlobalScope(context));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x65)
+				{
+					//getscopeobject
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					context->runtime_stack_push(getScopeObject(context,t));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x66)
+				{
+					//getproperty
+					uint32_t t=data->uints[0];
+					inline_cache* ic=mi->body->getInlineCache(data->uints[1]);
+					instructionPointer+=8;
+					multiname* name=context->context->getMultiname(t,context);
+
+					ASObject* obj=context->runtime_stack_pop();
+
+					uint32_t index;
+					if(isVectorIndex(obj,name,index))
+					{
+						Vector* v=obj->as<Vector>();
+						ASObject* ret;
+#ifdef TAGGED_STACK_VALUES
+						int32_t i;
+						if(v->getIndexedInt(index,i))
+						{
+							obj->decRef();
+							context->runtime_stack_push_int(i);
+							DISPATCH_NEXT;
+						}
+#endif
+						if(v->getIndexed(index,ret))
+						{
+							obj->decRef();
+							context->runtime_stack_push(ret);
+							DISPATCH_NEXT;
+						}
+					}
+
+					ASObject* ret=getPropertyCached(obj,name,ic);
+					name->resetNameIfObject();
+
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x68)
+				{
+					//initproperty
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					ASObject* value=context->runtime_stack_pop();
+				        multiname* name=context->context->getMultiname(t,context);
+				        ASObject* obj=context->runtime_stack_pop();
+					initProperty(obj,value,name);
+					name->resetNameIfObject();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x6a)
+				{
+					//deleteproperty
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					multiname* name = context->context->getMultiname(t,context);
+					ASObject* obj=context->runtime_stack_pop();
+					bool ret = deleteProperty(obj,name);
+					name->resetNameIfObject();
+					context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x6c)
+				{
+					//getslot
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					ASObject* obj=context->runtime_stack_pop();
+					ASObject* ret=getSlot(obj, t);
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x6d)
+				{
+					//setslot
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
 
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
 
-				setSlot(v1, v2, t);
-				break;
-			}
-			case 0x6e:
-			{
-				//getglobalSlot
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
+					setSlot(v1, v2, t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x6e)
+				{
+					//getglobalSlot
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
 
-				Global* globalscope = getGlobalScope(context);
-				context->runtime_stack_push(globalscope->getSlot(t));
-				break;
-			}
-			case 0x6f:
-			{
-				//setglobalSlot
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-
-				Global* globalscope = getGlobalScope(context);
-				ASObject* obj=context->runtime_stack_pop();
-				globalscope->setSlot(t,obj);
-				break;
-			}
-			case 0x70:
-			{
-				//convert_s
-				ASObject* val=context->runtime_stack_pop();
-				context->runtime_stack_push(convert_s(val));
-				break;
-			}
-			case 0x71:
-			{
-				ASObject* val=context->runtime_stack_pop();
-				context->runtime_stack_push(esc_xelem(val));
-				break;
-			}
-			case 0x72:
-			{
-				ASObject* val=context->runtime_stack_pop();
-				context->runtime_stack_push(esc_xattr(val));
-				break;
-			}case 0x73:
-			{
-				//convert_i
-				ASObject* val=context->runtime_stack_peek();
-				if (!val || !val->is<Integer>())
+					Global* globalscope = getGlobalScope(context);
+					context->runtime_stack_push(globalscope->getSlot(t));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x6f)
 				{
-					context->runtime_stack_pop();
-					context->runtime_stack_push(abstract_i(function->getSystemState(),convert_i(val)));
+					//setglobalSlot
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+
+					Global* globalscope = getGlobalScope(context);
+					ASObject* obj=context->runtime_stack_pop();
+					globalscope->setSlot(t,obj);
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x74:
-			{
-				//convert_u
-				ASObject* val=context->runtime_stack_peek();
-				if (!val || !val->is<UInteger>())
+				OPCODE_CASE(0x70)
 				{
-					context->runtime_stack_pop(); // force exception
-					context->runtime_stack_push(abstract_ui(function->getSystemState(),convert_u(val)));
+					//convert_s
+					ASObject* val=context->runtime_stack_pop();
+					context->runtime_stack_push(convert_s(val));
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x75:
-			{
-				//convert_d
-				ASObject* val=context->runtime_stack_peek();
-				if (!val)
-					context->runtime_stack_pop(); // force exception
-				switch (val->getObjectType())
-				{
-					case T_INTEGER:
-					case T_BOOLEAN:
-					case T_UINTEGER:
-						val =context->runtime_stack_pop();
-						context->runtime_stack_push(abstract_di(function->getSystemState(),convert_di(val)));
-						break;
-					case T_NUMBER:
-						break;
-					default:
-						val =context->runtime_stack_pop();
-						context->runtime_stack_push(abstract_d(function->getSystemState(),convert_d(val)));
+				OPCODE_CASE(0x71)
+				{
+					ASObject* val=context->runtime_stack_pop();
+					context->runtime_stack_push(esc_xelem(val));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x72)
+				{
+					ASObject* val=context->runtime_stack_pop();
+					context->runtime_stack_push(esc_xattr(val));
+					break;
+				}
+				OPCODE_CASE(0x73)
+				{
+					//convert_i
+#ifdef TAGGED_STACK_VALUES
+					if(TOP_IS_TAGGED_INT(1))
 						break;
+#endif
+					ASObject* val=context->runtime_stack_peek();
+					if (!val || !val->is<Integer>())
+					{
+						context->runtime_stack_pop();
+						context->runtime_stack_push(abstract_i(function->getSystemState(),convert_i(val)));
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x76:
-			{
-				//convert_b
-				ASObject* val=context->runtime_stack_peek();
-				if (!val || !val->is<Boolean>())
+				OPCODE_CASE(0x74)
 				{
-					context->runtime_stack_pop();
-					context->runtime_stack_push(abstract_b(function->getSystemState(),convert_b(val)));
+					//convert_u
+					ASObject* val=context->runtime_stack_peek();
+					if (!val || !val->is<UInteger>())
+					{
+						context->runtime_stack_pop(); // force exception
+						context->runtime_stack_push(abstract_ui(function->getSystemState(),convert_u(val)));
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x77:
-			{
-				//convert_o
-				ASObject* val=context->runtime_stack_peek();
-				if (!val)
-					context->runtime_stack_pop(); // force exception
-				if (val->is<Null>())
+				OPCODE_CASE(0x75)
 				{
-					context->runtime_stack_pop();
-					LOG(LOG_ERROR,"trying to call convert_o on null");
-					throwError<TypeError>(kConvertNullToObjectError);
+					//convert_d
+					ASObject* val=context->runtime_stack_peek();
+					if (!val)
+						context->runtime_stack_pop(); // force exception
+					switch (val->getObjectType())
+					{
+						case T_INTEGER:
+						case T_BOOLEAN:
+						case T_UINTEGER:
+							val =context->runtime_stack_pop();
+							context->runtime_stack_push(abstract_di(function->getSystemState(),convert_di(val)));
+							break;
+						case T_NUMBER:
+							break;
+						default:
+							val =context->runtime_stack_pop();
+							context->runtime_stack_push(abstract_d(function->getSystemState(),convert_d(val)));
+							break;
+					}
+					DISPATCH_NEXT;
 				}
-				if (val->is<Undefined>())
+				OPCODE_CASE(0x76)
 				{
-					context->runtime_stack_pop();
-					LOG(LOG_ERROR,"trying to call convert_o on undefined");
-					throwError<TypeError>(kConvertUndefinedToObjectError);
+					//convert_b
+					ASObject* val=context->runtime_stack_peek();
+					if (!val || !val->is<Boolean>())
+					{
+						context->runtime_stack_pop();
+						context->runtime_stack_push(abstract_b(function->getSystemState(),convert_b(val)));
+					}
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0x78:
-			{
-				//checkfilter
-				ASObject* val=context->runtime_stack_pop();
-				context->runtime_stack_push(checkfilter(val));
-				break;
-			}
-			case 0x80:
-			{
-				//coerce
-				const multiname* name=data->names[0];
-				char* rewriteableCode = &(mi->body->code[0]);
-				const Type* type = Type::getTypeFromMultiname(name, context->context);
-				OpcodeData* rewritableData=reinterpret_cast<OpcodeData*>(rewriteableCode+instructionPointer);
-				//Rewrite this to a coerceEarly
-				rewriteableCode[instructionPointer-1]=0xfc;
-				rewritableData->types[0]=type;
-
-				LOG_CALL("coerceOnce " << *name);
-
-				ASObject* o=context->runtime_stack_pop();
-				o=type->coerce(o);
-				context->runtime_stack_push(o);
-
-				instructionPointer+=8;
-				break;
-			}
-			case 0x82:
-			{
-				//coerce_a
-				coerce_a();
-				break;
-			}
-			case 0x85:
-			{
-				//coerce_s
-				ASObject* val=context->runtime_stack_pop();
-				if (val->is<ASString>())
-					context->runtime_stack_push(val);
-				else
-					context->runtime_stack_push(coerce_s(val));
-				break;
-			}
-			case 0x86:
-			{
-				//astype
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name=context->context->getMultiname(t,NULL);
-
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret=asType(context->context, v1, name);
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x87:
-			{
-				//astypelate
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=asTypelate(v1, v2);
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x90:
-			{
-				//negate
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret;
-				if ((val->is<Integer>() || val->is<UInteger>() || (val->is<Number>() && !val->as<Number>()->isfloat)) && val->toInt64() != 0 && val->toInt64() == val->toInt())
-					ret=abstract_di(function->getSystemState(),negate_i(val));
-				else
-					ret=abstract_d(function->getSystemState(),negate(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x91:
-			{
-				//increment
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret;
-				if (val->is<Integer>() || (val->is<Number>() && !val->as<Number>()->isfloat))
-					ret=abstract_di(function->getSystemState(),increment_i(val));
-				else
-					ret=abstract_d(function->getSystemState(),increment(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x92:
-			{
-				//inclocal
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				incLocal(context, t);
-				break;
-			}
-			case 0x93:
-			{
-				//decrement
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret;
-				if (val->is<Integer>() || val->is<UInteger>() || (val->is<Number>() && !val->as<Number>()->isfloat))
-					ret=abstract_di(function->getSystemState(),decrement_di(val));
-				else
-					ret=abstract_d(function->getSystemState(),decrement(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x94:
-			{
-				//declocal
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				decLocal(context, t);
-				break;
-			}
-			case 0x95:
-			{
-				//typeof
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret=typeOf(val);
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x96:
-			{
-				//not
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret=abstract_b(function->getSystemState(),_not(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0x97:
-			{
-				//bitnot
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret=abstract_i(function->getSystemState(),bitNot(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa0:
-			{
-				//add
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret=add(v2, v1);
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa1:
-			{
-				//subtract
-				//Be careful, operands in subtract implementation are swapped
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret;
-				// if both values are Integers or int Numbers the result is also an int Number
-				if( (v1->is<Integer>() || v1->is<UInteger>() || (v1->is<Number>() && !v1->as<Number>()->isfloat)) &&
-					(v2->is<Integer>() || v2->is<UInteger>() || (v2->is<Number>() && !v2->as<Number>()->isfloat)))
-				{
-					int64_t num1=v1->toInt64();
-					int64_t num2=v2->toInt64();
-					LOG_CALL(_("subtractI ")  << num1 << '-' << num2);
-					v1->decRef();
-					v2->decRef();
-					ret = abstract_di(function->getSystemState(), num1-num2);
-				}
-				else
-					ret=abstract_d(function->getSystemState(),subtract(v2, v1));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa2:
-			{
-				//multiply
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret;
-				// if both values are Integers or int Numbers the result is also an int Number
-				if( (v1->is<Integer>() || v1->is<UInteger>() || (v1->is<Number>() && !v1->as<Number>()->isfloat)) &&
-					(v2->is<Integer>() || v2->is<UInteger>() || (v2->is<Number>() && !v2->as<Number>()->isfloat)))
-				{
-					int64_t num1=v1->toInt64();
-					int64_t num2=v2->toInt64();
-					LOG_CALL(_("multiplyI ")  << num1 << '*' << num2);
-					v1->decRef();
-					v2->decRef();
-					ret = abstract_di(function->getSystemState(), num1*num2);
-				}
-				else
-					ret=abstract_d(function->getSystemState(),multiply(v2, v1));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa3:
-			{
-				//divide
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_d(function->getSystemState(),divide(v2, v1));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa4:
-			{
-				//modulo
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret;
-				// if both values are Integers or int Numbers the result is also an int Number
-				if( (v1->is<Integer>() || v1->is<UInteger>() || (v1->is<Number>() && !v1->as<Number>()->isfloat)) &&
-					(v2->is<Integer>() || v2->is<UInteger>() || (v2->is<Number>() && !v2->as<Number>()->isfloat)))
-				{
-					int64_t num1=v1->toInt64();
-					int64_t num2=v2->toInt64();
-					LOG_CALL(_("moduloI ")  << num1 << '%' << num2);
-					v1->decRef();
-					v2->decRef();
-					if (num2 == 0)
-						ret=abstract_d(function->getSystemState(),Number::NaN);
+				OPCODE_CASE(0x77)
+				{
+					//convert_o
+					ASObject* val=context->runtime_stack_peek();
+					if (!val)
+						context->runtime_stack_pop(); // force exception
+					if (val->is<Null>())
+					{
+						context->runtime_stack_pop();
+						LOG(LOG_ERROR,"trying to call convert_o on null");
+						throwError<TypeError>(kConvertNullToObjectError);
+					}
+					if (val->is<Undefined>())
+					{
+						context->runtime_stack_pop();
+						LOG(LOG_ERROR,"trying to call convert_o on undefined");
+						throwError<TypeError>(kConvertUndefinedToObjectError);
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x78)
+				{
+					//checkfilter
+					ASObject* val=context->runtime_stack_pop();
+					context->runtime_stack_push(checkfilter(val));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x80)
+				{
+					//coerce
+					const multiname* name=data->names[0];
+					char* rewriteableCode = &(mi->body->code[0]);
+					const Type* type = Type::getTypeFromMultiname(name, context->context);
+					OpcodeData* rewritableData=reinterpret_cast<OpcodeData*>(rewriteableCode+instructionPointer);
+					//Rewrite this to a coerceEarly
+					rewriteableCode[instructionPointer-1]=0xfc;
+					rewritableData->types[0]=type;
+
+					LOG_CALL("coerceOnce " << *name);
+
+					ASObject* o=context->runtime_stack_pop();
+					o=type->coerce(o);
+					context->runtime_stack_push(o);
+
+					instructionPointer+=8;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x82)
+				{
+					//coerce_a
+					coerce_a();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x85)
+				{
+					//coerce_s
+					ASObject* val=context->runtime_stack_pop();
+					if (val->is<ASString>())
+						context->runtime_stack_push(val);
 					else
-						ret = abstract_di(function->getSystemState(), num1%num2);
+						context->runtime_stack_push(coerce_s(val));
+					DISPATCH_NEXT;
 				}
-				else
-					ret=abstract_d(function->getSystemState(),modulo(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa5:
-			{
-				//lshift
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_i(function->getSystemState(),lShift(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa6:
-			{
-				//rshift
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_i(function->getSystemState(),rShift(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa7:
-			{
-				//urshift
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_i(function->getSystemState(),urShift(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa8:
-			{
-				//bitand
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_i(function->getSystemState(),bitAnd(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xa9:
-			{
-				//bitor
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_i(function->getSystemState(),bitOr(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xaa:
-			{
-				//bitxor
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_i(function->getSystemState(),bitXor(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xab:
-			{
-				//equals
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_b(function->getSystemState(),equals(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xac:
-			{
-				//strictequals
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_b(function->getSystemState(),strictEquals(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xad:
-			{
-				//lessthan
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
-
-				ASObject* ret=abstract_b(function->getSystemState(),lessThan(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xae:
-			{
-				//lessequals
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
+				OPCODE_CASE(0x86)
+				{
+					//astype
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					multiname* name=context->context->getMultiname(t,NULL);
 
-				ASObject* ret=abstract_b(function->getSystemState(),lessEquals(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xaf:
-			{
-				//greaterthan
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_b(function->getSystemState(),greaterThan(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xb0:
-			{
-				//greaterequals
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
+					ASObject* ret=asType(context->context, v1, name);
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x87)
+				{
+					//astypelate
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_b(function->getSystemState(),greaterEquals(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xb1:
-			{
-				//instanceof
-				ASObject* type=context->runtime_stack_pop();
-				ASObject* value=context->runtime_stack_pop();
-				bool ret=instanceOf(value, type);
-				context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
-				break;
-			}
-			case 0xb2:
-			{
-				//istype
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				multiname* name=context->context->getMultiname(t,NULL);
+					ASObject* ret=asTypelate(v1, v2);
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x90)
+				{
+					//negate
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret;
+					if ((val->is<Integer>() || val->is<UInteger>() || (val->is<Number>() && !val->as<Number>()->isfloat)) && val->toInt64() != 0 && val->toInt64() == val->toInt())
+						ret=abstract_di(function->getSystemState(),negate_i(val));
+					else
+						ret=abstract_d(function->getSystemState(),negate(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x91)
+				{
+					//increment
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret;
+					if (val->is<Integer>() || (val->is<Number>() && !val->as<Number>()->isfloat))
+						ret=abstract_di(function->getSystemState(),increment_i(val));
+					else
+						ret=abstract_d(function->getSystemState(),increment(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x92)
+				{
+					//inclocal
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					incLocal(context, t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x93)
+				{
+					//decrement
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret;
+					if (val->is<Integer>() || val->is<UInteger>() || (val->is<Number>() && !val->as<Number>()->isfloat))
+						ret=abstract_di(function->getSystemState(),decrement_di(val));
+					else
+						ret=abstract_d(function->getSystemState(),decrement(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x94)
+				{
+					//declocal
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					decLocal(context, t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x95)
+				{
+					//typeof
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret=typeOf(val);
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x96)
+				{
+					//not
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret=abstract_b(function->getSystemState(),_not(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0x97)
+				{
+					//bitnot
+					TAGGED_INT_UNARY_OP(~a);
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret=abstract_i(function->getSystemState(),bitNot(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa0)
+				{
+					//add
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
 
-				ASObject* v1=context->runtime_stack_pop();
+					ASObject* ret=add(v2, v1);
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa1)
+				{
+					//subtract
+					//Be careful, operands in subtract implementation are swapped
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret;
+					// if both values are Integers or int Numbers the result is also an int Number
+					if( (v1->is<Integer>() || v1->is<UInteger>() || (v1->is<Number>() && !v1->as<Number>()->isfloat)) &&
+						(v2->is<Integer>() || v2->is<UInteger>() || (v2->is<Number>() && !v2->as<Number>()->isfloat)))
+					{
+						int64_t num1=v1->toInt64();
+						int64_t num2=v2->toInt64();
+						LOG_CALL(_("subtractI ")  << num1 << '-' << num2);
+						v1->decRef();
+						v2->decRef();
+						ret = abstract_di(function->getSystemState(), num1-num2);
+					}
+					else
+						ret=abstract_d(function->getSystemState(),subtract(v2, v1));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa2)
+				{
+					//multiply
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret;
+					// if both values are Integers or int Numbers the result is also an int Number
+					if( (v1->is<Integer>() || v1->is<UInteger>() || (v1->is<Number>() && !v1->as<Number>()->isfloat)) &&
+						(v2->is<Integer>() || v2->is<UInteger>() || (v2->is<Number>() && !v2->as<Number>()->isfloat)))
+					{
+						int64_t num1=v1->toInt64();
+						int64_t num2=v2->toInt64();
+						LOG_CALL(_("multiplyI ")  << num1 << '*' << num2);
+						v1->decRef();
+						v2->decRef();
+						ret = abstract_di(function->getSystemState(), num1*num2);
+					}
+					else
+						ret=abstract_d(function->getSystemState(),multiply(v2, v1));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa3)
+				{
+					//divide
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_b(function->getSystemState(),isType(context->context, v1, name));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xb3:
-			{
-				//istypelate
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
+					ASObject* ret=abstract_d(function->getSystemState(),divide(v2, v1));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa4)
+				{
+					//modulo
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret;
+					// if both values are Integers or int Numbers the result is also an int Number
+					if( (v1->is<Integer>() || v1->is<UInteger>() || (v1->is<Number>() && !v1->as<Number>()->isfloat)) &&
+						(v2->is<Integer>() || v2->is<UInteger>() || (v2->is<Number>() && !v2->as<Number>()->isfloat)))
+					{
+						int64_t num1=v1->toInt64();
+						int64_t num2=v2->toInt64();
+						LOG_CALL(_("moduloI ")  << num1 << '%' << num2);
+						v1->decRef();
+						v2->decRef();
+						if (num2 == 0)
+							ret=abstract_d(function->getSystemState(),Number::NaN);
+						else
+							ret = abstract_di(function->getSystemState(), num1%num2);
+					}
+					else
+						ret=abstract_d(function->getSystemState(),modulo(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa5)
+				{
+					//lshift
+					TAGGED_INT_BINARY_OP((int32_t)((uint32_t)a<<(b&0x1f)));
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),lShift(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa6)
+				{
+					//rshift
+					TAGGED_INT_BINARY_OP(a>>(b&0x1f));
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),rShift(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa7)
+				{
+					//urshift
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_b(function->getSystemState(),isTypelate(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xb4:
-			{
-				//in
-				ASObject* v1=context->runtime_stack_pop();
-				ASObject* v2=context->runtime_stack_pop();
+					ASObject* ret=abstract_i(function->getSystemState(),urShift(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa8)
+				{
+					//bitand
+					TAGGED_INT_BINARY_OP(a&b);
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),bitAnd(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xa9)
+				{
+					//bitor
+					TAGGED_INT_BINARY_OP(a|b);
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),bitOr(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xaa)
+				{
+					//bitxor
+					TAGGED_INT_BINARY_OP(a^b);
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),bitXor(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xab)
+				{
+					//equals
+					TAGGED_INT_COMPARISON(a==b);
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_b(function->getSystemState(),equals(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xac)
+				{
+					//strictequals
+					TAGGED_INT_COMPARISON(a==b);
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_b(function->getSystemState(),strictEquals(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xad)
+				{
+					//lessthan
+					TAGGED_INT_COMPARISON(a<b);
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_b(function->getSystemState(),lessThan(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xae)
+				{
+					//lessequals
+					TAGGED_INT_COMPARISON(a<=b);
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_b(function->getSystemState(),lessEquals(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xaf)
+				{
+					//greaterthan
+					TAGGED_INT_COMPARISON(a>b);
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_b(function->getSystemState(),greaterThan(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xb0)
+				{
+					//greaterequals
+					TAGGED_INT_COMPARISON(a>=b);
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_b(function->getSystemState(),greaterEquals(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xb1)
+				{
+					//instanceof
+					ASObject* type=context->runtime_stack_pop();
+					ASObject* value=context->runtime_stack_pop();
+					bool ret=instanceOf(value, type);
+					context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xb2)
+				{
+					//istype
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+					multiname* name=context->context->getMultiname(t,NULL);
 
-				ASObject* ret=abstract_b(function->getSystemState(),in(v1, v2));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xc0:
-			{
-				//increment_i
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret=abstract_i(function->getSystemState(),increment_i(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xc1:
-			{
-				//decrement_i
-				ASObject* val=context->runtime_stack_pop();
-				ASObject* ret=abstract_i(function->getSystemState(),decrement_i(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xc2:
-			{
-				//inclocal_i
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				incLocal_i(context, t);
-				break;
-			}
-			case 0xc3:
-			{
-				//declocal_i
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
-				decLocal_i(context, t);
-				break;
-			}
-			case 0xc4:
-			{
-				//negate_i
-				ASObject *val=context->runtime_stack_pop();
-				ASObject* ret=abstract_i(function->getSystemState(),negate_i(val));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xc5:
-			{
-				//add_i
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_i(function->getSystemState(),add_i(v2, v1));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xc6:
-			{
-				//subtract_i
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
+					ASObject* ret=abstract_b(function->getSystemState(),isType(context->context, v1, name));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xb3)
+				{
+					//istypelate
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_i(function->getSystemState(),subtract_i(v2, v1));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xc7:
-			{
-				//multiply_i
-				ASObject* v2=context->runtime_stack_pop();
-				ASObject* v1=context->runtime_stack_pop();
+					ASObject* ret=abstract_b(function->getSystemState(),isTypelate(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xb4)
+				{
+					//in
+					ASObject* v1=context->runtime_stack_pop();
+					ASObject* v2=context->runtime_stack_pop();
 
-				ASObject* ret=abstract_i(function->getSystemState(),multiply_i(v2, v1));
-				context->runtime_stack_push(ret);
-				break;
-			}
-			case 0xd0:
-			case 0xd1:
-			case 0xd2:
-			case 0xd3:
-			{
-				//getlocal_n
-				int i=opcode&3;
-				if (!context->locals[i])
+					ASObject* ret=abstract_b(function->getSystemState(),in(v1, v2));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xc0)
 				{
-					LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
-					context->runtime_stack_push(function->getSystemState()->getUndefinedRef());
-					break;
+					//increment_i
+					TAGGED_INT_UNARY_OP((int32_t)((uint32_t)a+1));
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret=abstract_i(function->getSystemState(),increment_i(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
 				}
-				LOG_CALL( "getLocal " << i << ": " << context->locals[i]->toDebugString() );
-				context->locals[i]->incRef();
-				context->runtime_stack_push(context->locals[i]);
-				break;
-			}
-			case 0xd4:
-			case 0xd5:
-			case 0xd6:
-			case 0xd7:
-			{
-				//setlocal_n
-				int i=opcode&3;
-				LOG_CALL( "setLocal " << i );
-				ASObject* obj=context->runtime_stack_pop();
-				if ((int)i != context->argarrayposition || obj->is<Array>())
+				OPCODE_CASE(0xc1)
 				{
-					if(context->locals[i])
-						context->locals[i]->decRef();
-					context->locals[i]=obj;
+					//decrement_i
+					TAGGED_INT_UNARY_OP((int32_t)((uint32_t)a-1));
+					ASObject* val=context->runtime_stack_pop();
+					ASObject* ret=abstract_i(function->getSystemState(),decrement_i(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
 				}
-				break;
-			}
-			case 0xf2:
-			{
-				//bkptline
-				LOG_CALL( _("bkptline") );
-				instructionPointer+=4;
-				break;
-			}
-			case 0xf3:
-			{
-				//timestamp
-				LOG_CALL( _("timestamp") );
-				instructionPointer+=4;
-				break;
-			}
-			//lightspark custom opcodes
-			case 0xfb:
-			{
-				//setslot_no_coerce
-				uint32_t t=data->uints[0];
-				instructionPointer+=4;
+				OPCODE_CASE(0xc2)
+				{
+					//inclocal_i
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+#ifdef TAGGED_STACK_VALUES
+					if(context->locals[t] && context->locals[t]->is<Integer>())
+					{
+						LOG_CALL( _("incLocal_i ") << t );
+						setLocalInt(context,t,(int32_t)((uint32_t)context->locals[t]->as<Integer>()->val+1));
+						break;
+					}
+#endif
+					incLocal_i(context, t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xc3)
+				{
+					//declocal_i
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
+#ifdef TAGGED_STACK_VALUES
+					if(context->locals[t] && context->locals[t]->is<Integer>())
+					{
+						LOG_CALL( _("decLocal_i ") << t );
+						setLocalInt(context,t,(int32_t)((uint32_t)context->locals[t]->as<Integer>()->val-1));
+						break;
+					}
+#endif
+					decLocal_i(context, t);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xc4)
+				{
+					//negate_i
+					TAGGED_INT_UNARY_OP((int32_t)(0-(uint32_t)a));
+					ASObject *val=context->runtime_stack_pop();
+					ASObject* ret=abstract_i(function->getSystemState(),negate_i(val));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xc5)
+				{
+					//add_i
+					TAGGED_INT_BINARY_OP((int32_t)((uint32_t)a+(uint32_t)b));
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),add_i(v2, v1));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xc6)
+				{
+					//subtract_i
+					TAGGED_INT_BINARY_OP((int32_t)((uint32_t)a-(uint32_t)b));
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),subtract_i(v2, v1));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xc7)
+				{
+					//multiply_i
+					TAGGED_INT_BINARY_OP((int32_t)((uint32_t)a*(uint32_t)b));
+					ASObject* v2=context->runtime_stack_pop();
+					ASObject* v1=context->runtime_stack_pop();
+
+					ASObject* ret=abstract_i(function->getSystemState(),multiply_i(v2, v1));
+					context->runtime_stack_push(ret);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xd0)
+				OPCODE_CASE(0xd1)
+				OPCODE_CASE(0xd2)
+				OPCODE_CASE(0xd3)
+				{
+					//getlocal_n
+					int i=opcode&3;
+					if (!context->locals[i])
+					{
+						LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
+						context->runtime_stack_push(function->getSystemState()->getUndefinedRef());
+						break;
+					}
+					LOG_CALL( "getLocal " << i << ": " << context->locals[i]->toDebugString() );
+					context->locals[i]->incRef();
+					context->runtime_stack_push(context->locals[i]);
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xd4)
+				OPCODE_CASE(0xd5)
+				OPCODE_CASE(0xd6)
+				OPCODE_CASE(0xd7)
+				{
+					//setlocal_n
+					int i=opcode&3;
+					TAGGED_INT_SETLOCAL(i);
+					LOG_CALL( "setLocal " << i );
+					ASObject* obj=context->runtime_stack_pop();
+					if ((int)i != context->argarrayposition || obj->is<Array>())
+					{
+						if(context->locals[i])
+							context->locals[i]->decRef();
+						context->locals[i]=obj;
+					}
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xf2)
+				{
+					//bkptline
+					LOG_CALL( _("bkptline") );
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xf3)
+				{
+					//timestamp
+					LOG_CALL( _("timestamp") );
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				//lightspark custom opcodes
+				OPCODE_CASE(0xfb)
+				{
+					//setslot_no_coerce
+					uint32_t t=data->uints[0];
+					instructionPointer+=4;
 
-				ASObject* value=context->runtime_stack_pop();
-				ASObject* obj=context->runtime_stack_pop();
+					ASObject* value=context->runtime_stack_pop();
+					ASObject* obj=context->runtime_stack_pop();
 
-				LOG_CALL("setSlotNoCoerce " << t);
-				obj->setSlotNoCoerce(t,value);
-				obj->decRef();
-				break;
-			}
-			case 0xfc:
-			{
-				//coerceearly
-				const Type* type = data->types[0];
-				LOG_CALL("coerceEarly " << type);
+					LOG_CALL("setSlotNoCoerce " << t);
+					obj->setSlotNoCoerce(t,value);
+					obj->decRef();
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xfc)
+				{
+					//coerceearly
+					const Type* type = data->types[0];
+					LOG_CALL("coerceEarly " << type);
 
-				ASObject* o=context->runtime_stack_pop();
-				o=type->coerce(o);
-				context->runtime_stack_push(o);
+					ASObject* o=context->runtime_stack_pop();
+					o=type->coerce(o);
+					context->runtime_stack_push(o);
 
-				instructionPointer+=8;
-				break;
-			}
-			case 0xfd:
-			{
-				//getscopeatindex
-				//This opcode is similar to getscopeobject, but it allows access to any
-				//index of the scope stack
-				uint32_t t=data->uints[0];
-				LOG_CALL( "getScopeAtIndex " << t);
-				ASObject* obj;
-				uint32_t parentsize = context->parent_scope_stack.isNull() ? 0 :context->parent_scope_stack->scope.size();
-				if (!context->parent_scope_stack.isNull() && t<parentsize)
-					obj = context->parent_scope_stack->scope[t].object.getPtr();
-				else
-				{
-					assert_and_throw(t-parentsize <context->curr_scope_stack);
-					obj=context->scope_stack[t-parentsize];
-				}
-				obj->incRef();
-				context->runtime_stack_push(obj);
-				instructionPointer+=4;
-				break;
-			}
-			case 0xfe:
-			{
-				//getlexonce
-				//This opcode execute a lookup on the application domain
-				//and rewrites itself to a pushearly
-				const multiname* name=data->names[0];
-				LOG_CALL( "getLexOnce " << *name);
-				ASObject* target;
-				ASObject* obj=ABCVm::getCurrentApplicationDomain(context)->getVariableAndTargetByMultiname(*name,target);
-				//The object must exists, since it was found during optimization
-				assert_and_throw(obj);
-				char* rewriteableCode = &(mi->body->code[0]);
-				OpcodeData* rewritableData=reinterpret_cast<OpcodeData*>(rewriteableCode+instructionPointer);
-				//Rewrite this to a pushearly
-				rewriteableCode[instructionPointer-1]=0xff;
-				rewritableData->objs[0]=obj;
-				//Also push the object right away
-				obj->incRef();
-				context->runtime_stack_push(obj);
-				//Move to the next instruction
-				instructionPointer+=8;
-				break;
-			}
-			case 0xff:
-			{
-				//pushearly
-				ASObject* o=data->objs[0];
-				instructionPointer+=8;
-				LOG_CALL( "pushEarly " << o);
-				o->incRef();
-				context->runtime_stack_push(o);
-				break;
+					instructionPointer+=8;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xfd)
+				{
+					//getscopeatindex
+					//This opcode is similar to getscopeobject, but it allows access to any
+					//index of the scope stack
+					uint32_t t=data->uints[0];
+					LOG_CALL( "getScopeAtIndex " << t);
+					ASObject* obj;
+					uint32_t parentsize = context->parent_scope_stack.isNull() ? 0 :context->parent_scope_stack->scope.size();
+					if (!context->parent_scope_stack.isNull() && t<parentsize)
+						obj = context->parent_scope_stack->scope[t].object.getPtr();
+					else
+					{
+						assert_and_throw(t-parentsize <context->curr_scope_stack);
+						obj=context->scope_stack[t-parentsize];
+					}
+					obj->incRef();
+					context->runtime_stack_push(obj);
+					instructionPointer+=4;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xfe)
+				{
+					//getlexonce
+					//This opcode execute a lookup on the application domain
+					//and rewrites itself to a pushearly
+					const multiname* name=data->names[0];
+					LOG_CALL( "getLexOnce " << *name);
+					ASObject* target;
+					ASObject* obj=ABCVm::getCurrentApplicationDomain(context)->getVariableAndTargetByMultiname(*name,target);
+					//The object must exists, since it was found during optimization
+					assert_and_throw(obj);
+					char* rewriteableCode = &(mi->body->code[0]);
+					OpcodeData* rewritableData=reinterpret_cast<OpcodeData*>(rewriteableCode+instructionPointer);
+					//Rewrite this to a pushearly
+					rewriteableCode[instructionPointer-1]=0xff;
+					rewritableData->objs[0]=obj;
+					//Also push the object right away
+					obj->incRef();
+					context->runtime_stack_push(obj);
+					//Move to the next instruction
+					instructionPointer+=8;
+					DISPATCH_NEXT;
+				}
+				OPCODE_CASE(0xff)
+				{
+					//pushearly
+					ASObject* o=data->objs[0];
+					instructionPointer+=8;
+					LOG_CALL( "pushEarly " << o);
+					o->incRef();
+					context->runtime_stack_push(o);
+					DISPATCH_NEXT;
+				}
+				default: OPCODE_LABEL(default)
+					LOG(LOG_ERROR,_("Not interpreted instruction @") << instructionPointer);
+					LOG(LOG_ERROR,_("dump ") << hex << (unsigned int)opcode << dec);
+					throw ParseException("Not implemented instruction in fast interpreter");
 			}
-			default:
-				LOG(LOG_ERROR,_("Not interpreted instruction @") << instructionPointer);
-				LOG(LOG_ERROR,_("dump ") << hex << (unsigned int)opcode << dec);
-				throw ParseException("Not implemented instruction in fast interpreter");
+			PROF_ACCOUNT_INSTRUCTION();
 		}
-		PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
+	}
+	catch(...)
+	{
+		if(data)
+			context->exec_pos = CURRENT_INSTRUCTION;
+		throw;
 	}
 
 #undef PROF_ACCOUNT_TIME 
 #undef PROF_IGNORE_TIME
+#undef PROF_ACCOUNT_INSTRUCTION
+#undef OPCODE_LABEL
+#undef DISPATCH_NEXT
+#undef CURRENT_INSTRUCTION
 	//We managed to execute all the function
 	return context->runtime_stack_pop();
 }
@@ -36,6 +36,16 @@ uint64_t ABCVm::profilingCheckpoint(uint64_t& startTime)
 	return ret;
 }
 
+#ifdef PROFILING_SUPPORT
+uint64_t ABCVm::profilingBoxesCheckpoint(uint64_t& startBoxes)
+{
+	uint64_t cur=numericBoxCount.load(std::memory_order_relaxed);
+	uint64_t ret=cur-startBoxes;
+	startBoxes=cur;
+	return ret;
+}
+#endif
+
 void ABCVm::executeFunction(const SyntheticFunction* function, call_context* context)
 {
 	method_info* mi=function->mi;
@@ -48,7 +58,10 @@ void ABCVm::executeFunction(const SyntheticFunction* function, call_context* con
 #ifdef PROFILING_SUPPORT
 	if(mi->profTime.empty())
 		mi->profTime.resize(code_len,0);
+	if(mi->profBoxes.empty())
+		mi->profBoxes.resize(code_len,0);
 	uint64_t startTime=compat_get_thread_cputime_us();
+	uint64_t startBoxes=numericBoxCount.load(std::memory_order_relaxed);
 #define PROF_ACCOUNT_TIME(a, b)  do{a+=b;}while(0)
 #define PROF_IGNORE_TIME(a) do{ a; } while(0)
 #else
@@ -59,21 +72,24 @@ void ABCVm::executeFunction(const SyntheticFunction* function, call_context* con
 	//Each case block builds the correct parameters for the interpreter function and call it
 	while(1)
 	{
-#ifdef PROFILING_SUPPORT
 		uint32_t instructionPointer=code.tellg();
-#endif
 		uint8_t opcode = code.readbyte();
 
 		//Save ip for exception handling in SyntheticFunction::callImpl
 		context->exec_pos = code.tellg();
 		abcfunctions[opcode](function,context,code);
+		//Backward jumps are counted as loop iterations for tiered execution
+		if(code.tellg()<=instructionPointer && mi->body->backedge_count!=UINT32_MAX)
+			++mi->body->backedge_count;
 		
 		if (context->returning)
 		{
 			PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
+			PROF_ACCOUNT_TIME(mi->profBoxes[instructionPointer],profilingBoxesCheckpoint(startBoxes));
 			return;
 		}
 		PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
+		PROF_ACCOUNT_TIME(mi->profBoxes[instructionPointer],profilingBoxesCheckpoint(startBoxes));
 	}
 
 #undef PROF_ACCOUNT_TIME 
@@ -70,6 +70,17 @@ void ABCVm::setProperty(ASObject* value,ASObject* obj,multiname* name)
 	obj->decRef();
 }
 
+void ABCVm::setPropertyCached(ASObject* value,ASObject* obj,multiname* name,inline_cache* ic)
+{
+	if(ic==NULL || !obj->setVariableByMultinameCached(*name,value,ic))
+	{
+		setProperty(value,obj,name);
+		return;
+	}
+	LOG_CALL(_("setProperty cached ") << *name << ' ' << obj);
+	obj->decRef();
+}
+
 void ABCVm::setProperty_i(int32_t value,ASObject* obj,multiname* name)
 {
 	LOG_CALL(_("setProperty_i ") << *name << ' ' <<obj);
@@ -315,6 +326,11 @@ int32_t ABCVm::bitOr(ASObject* val2, ASObject* val1)
 }
 
 void ABCVm::callProperty(call_context* th, int n, int m, method_info** called_mi, bool keepReturn)
+{
+	callPropertyCached(th, n, m, called_mi, keepReturn, NULL);
+}
+
+void ABCVm::callPropertyCached(call_context* th, int n, int m, method_info** called_mi, bool keepReturn, inline_cache* ic)
 {
 	ASObject** args=g_newa(ASObject*, m);
 	for(int i=0;i<m;i++)
@@ -338,7 +354,9 @@ void ABCVm::callProperty(call_context* th, int n, int m, method_info** called_mi
 	}
 
 	//We should skip the special implementation of get
-	_NR<ASObject> o=obj->getVariableByMultiname(*name, ASObject::SKIP_IMPL);
+	_NR<ASObject> o;
+	if(ic==NULL || !obj->getVariableByMultinameCached(*name, ic, o))
+		o=obj->getVariableByMultiname(*name, ASObject::SKIP_IMPL);
 	name->resetNameIfObject();
 	if(o.isNull() && obj->is<Class_base>())
 	{
@@ -476,6 +494,19 @@ int32_t ABCVm::getProperty_i(ASObject* obj, multiname* name)
 	return ret;
 }
 
+ASObject* ABCVm::getPropertyCached(ASObject* obj, multiname* name, inline_cache* ic)
+{
+	checkDeclaredTraits(obj);
+	_NR<ASObject> prop;
+	if(ic==NULL || !obj->getVariableByMultinameCached(*name,ic,prop))
+		return getProperty(obj,name);
+	LOG_CALL( _("getProperty cached ") << *name << ' ' << obj);
+	ASObject* ret=prop.getPtr();
+	ret->incRef();
+	obj->decRef();
+	return ret;
+}
+
 ASObject* ABCVm::getProperty(ASObject* obj, multiname* name)
 {
 	LOG_CALL( _("getProperty ") << *name << ' ' << obj->toDebugString() << ' '<<obj->isInitialized());
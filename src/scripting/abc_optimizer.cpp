@@ -198,7 +198,8 @@ EARLY_BIND_STATUS ABCVm::earlyBindForScopeStack(ostream& out, const SyntheticFun
 }
 
 InferenceData ABCVm::earlyBindFindPropStrict(ostream& out, const SyntheticFunction* f,
-		const std::vector<InferenceData>& scopeStack, const multiname* name)
+		const std::vector<InferenceData>& scopeStack, const multiname* name, uint32_t nameIndex,
+		std::vector<code_relocation>& relocations)
 {
 	InferenceData ret;
 	EARLY_BIND_STATUS status=earlyBindForScopeStack(out, f, scopeStack, name, ret);
@@ -212,6 +213,7 @@ InferenceData ABCVm::earlyBindFindPropStrict(ostream& out, const SyntheticFuncti
 		//If we found the property on the application domain we can safely use the target verbatim
 		std::cerr << "OPT EARLY" << *name << std::endl;
 		out << (uint8_t)PUSH_EARLY;
+		relocations.push_back(code_relocation(out.tellp(),code_relocation::APPDOMAIN_TARGET,nameIndex));
 		writePtr(out, target);
 		ret.obj=target;
 		return ret;
@@ -220,7 +222,7 @@ InferenceData ABCVm::earlyBindFindPropStrict(ostream& out, const SyntheticFuncti
 }
 
 InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, const std::vector<InferenceData>& scopeStack,
-		const multiname* name, uint32_t nameIndex)
+		const multiname* name, uint32_t nameIndex, std::vector<code_relocation>& relocations)
 {
 	InferenceData ret;
 	EARLY_BIND_STATUS status=earlyBindForScopeStack(out, f, scopeStack, name, ret);
@@ -230,6 +232,7 @@ InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, c
 		std::cerr << "SYNT GET " << *name << std::endl;
 		out << (uint8_t)0x66;
 		writeInt32(out,nameIndex);
+		writeInlineCache(out,f->mi,nameIndex);
 		//We can't return the inferredData directly, since we don't know the type of the getted object
 		return InferenceData(Type::anyType);
 	}
@@ -244,6 +247,7 @@ InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, c
 	{
 		//Output a special opcode
 		out << (uint8_t)PUSH_EARLY;
+		relocations.push_back(code_relocation(out.tellp(),code_relocation::SYSTEMDOMAIN_VARIABLE,nameIndex));
 		writePtr(out, o);
 		ret.obj=o;
 		return ret;
@@ -256,6 +260,7 @@ InferenceData ABCVm::earlyBindGetLex(ostream& out, const SyntheticFunction* f, c
 	{
 		out << (uint8_t)GET_LEX_ONCE;
 		//Write directly the multiname pointer
+		relocations.push_back(code_relocation(out.tellp(),code_relocation::MULTINAME,nameIndex));
 		writePtr(out, name);
 		//We need to set the returned InferenceData to a valid state
 		ret.type=Type::anyType;
@@ -289,6 +294,18 @@ void ABCVm::writePtr(std::ostream& o, const void* val)
 	o.write((char*)&val, 8);
 }
 
+void ABCVm::writeInlineCache(std::ostream& o, const method_info* mi, uint32_t nameIndex)
+{
+	//Runtime names change at every access, caching them would only evict the other entries
+	if(mi->context->getMultinameRTData(nameIndex)!=0)
+	{
+		writeInt32(o, NO_INLINE_CACHE);
+		return;
+	}
+	writeInt32(o, mi->body->inlineCaches.size());
+	mi->body->inlineCaches.push_back(inline_cache());
+}
+
 void ABCVm::verifyBranch(std::set<uint32_t>& pendingBlocks,
 		std::map<uint32_t,BasicBlock>& basicBlocks, int oldStart,
 			 int here, int offset, int code_len)
@@ -335,17 +352,31 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 {
 	method_info* mi=function->mi;
 	SystemState* sys = function->getSystemState();
+
+	//Hot optimized methods are compiled later from the original code
+	if(sys->useJit && mi->body->originalCode.empty())
+		mi->body->originalCode=mi->body->code;
+
+	//Optimized code may be already available from a previous session
+	if(mi->context->codeCache && mi->context->codeCache->lookup(mi))
+	{
+		mi->body->codeStatus = method_body_info::OPTIMIZED;
+		return;
+	}
 	
 	ActivationType activationType(mi);
 
 	istringstream code(mi->body->code);
 	const int code_len=mi->body->code.size();
 	ostringstream out;
+	mi->body->inlineCaches.clear();
 
 	u8 opcode;
 
 	std::map<uint32_t, BasicBlock> basicBlocks;
 	std::set<uint32_t> pendingBlocks;
+	//Offsets of the pointers written in the optimized code
+	std::vector<code_relocation> relocations;
 
 	uint32_t curStart=0;
 	BasicBlock* curBlock=NULL;
@@ -952,6 +983,8 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				out << (uint8_t)opcode;
 				writeInt32(out,t);
 				writeInt32(out,t2);
+				if(opcode!=0x45)
+					writeInlineCache(out,mi,t);
 				
 				int numRT=mi->context->getMultinameRTData(t);
 				curBlock->popStack(numRT+t2);
@@ -1021,6 +1054,8 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				out << (uint8_t)opcode;
 				writeInt32(out,t);
 				writeInt32(out,t2);
+				if(opcode==0x4f)
+					writeInlineCache(out,mi,t);
 				
 				int numRT=mi->context->getMultinameRTData(t);
 				curBlock->popStack(numRT+1+t2);
@@ -1118,7 +1153,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				{
 					//Attempt early binding
 					const multiname* name=mi->context->getMultiname(t,NULL);
-					inferredData=earlyBindFindPropStrict(out, function, curBlock->scopeStackTypes, name);
+					inferredData=earlyBindFindPropStrict(out, function, curBlock->scopeStackTypes, name, t, relocations);
 				}
 
 				curBlock->popStack(numRT);
@@ -1158,7 +1193,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//Only methods can be early binded, anonymous functions do
 				//not have a fixed function scope stack
 				if(function->isMethod())
-					inferredData=earlyBindGetLex(out, function, curBlock->scopeStackTypes, name, t);
+					inferredData=earlyBindGetLex(out, function, curBlock->scopeStackTypes, name, t, relocations);
 				if(!inferredData.isValid())
 				{
 					//Early binding failed, use normal translation
@@ -1176,6 +1211,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				code >> t;
 				out << (uint8_t)opcode;
 				writeInt32(out,t);
+				writeInlineCache(out,mi,t);
 
 				int numRT=mi->context->getMultinameRTData(t);
 				curBlock->popStack(numRT+2);
@@ -1230,6 +1266,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				code >> t;
 				out << (uint8_t)opcode;
 				writeInt32(out,t);
+				writeInlineCache(out,mi,t);
 
 				int numRT=mi->context->getMultinameRTData(t);
 				curBlock->popStack(numRT+1);
@@ -1405,6 +1442,7 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//Translate coerce to a rewriting opcode
 				//The pointer to the multiname will become the pointer to
 				//the type after the first execution
+				relocations.push_back(code_relocation(out.tellp(),code_relocation::MULTINAME,t));
 				writePtr(out,name);
 				curBlock->popStack(1);
 				curBlock->pushStack(inferredData);
@@ -1727,4 +1765,6 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 	//Overwrite the old code
 	mi->body->code=out.str();
 	mi->body->codeStatus = method_body_info::OPTIMIZED;
+	if(mi->context->codeCache)
+		mi->context->codeCache->store(mi, relocations);
 }
@@ -258,6 +258,35 @@ struct method_info_simple
 	std::vector<option_detail> options;
 	std::vector<u30> param_names;
 };
+class Class_base;
+class variables_shape;
+/* Inline cache of a property access site of the optimized code.
+ * Each entry remembers where the property was found for objects of a given
+ * class and shape, so that the lookup by name can be skipped on the next access */
+#define INLINE_CACHE_SIZE 4
+struct inline_cache_entry
+{
+	const Class_base* cls;
+	const variables_shape* shape;
+	//Position of the variable in the object or in the borrowed variables of the class
+	uint32_t position;
+	//Name of the variable, checked on every hit since the multiname may be rewritten
+	uint32_t nameId;
+	uint32_t nsId;
+	bool borrowed;
+};
+
+//Operand of the access sites which have no inline cache, since their name is known only at runtime
+#define NO_INLINE_CACHE UINT32_MAX
+
+struct inline_cache
+{
+	inline_cache():entries(),next(0) {}
+	inline_cache_entry entries[INLINE_CACHE_SIZE];
+	//Entry to be replaced when all of them are used
+	uint32_t next;
+};
+
 struct method_body_info_cache
 {
 	enum method_body_info_cache_type { CACHE_TYPE_NONE = 0,CACHE_TYPE_UINTEGER,CACHE_TYPE_INTEGER, CACHE_TYPE_OBJECT };
@@ -273,7 +302,7 @@ struct method_body_info_cache
 
 struct method_body_info
 {
-	method_body_info():hit_count(0),codeStatus(ORIGINAL){}
+	method_body_info():hit_count(0),backedge_count(0),codeStatus(ORIGINAL),jitQueued(false){}
 	~method_body_info() { delete[] codecache; }
 	u30 method;
 	u30 max_stack;
@@ -281,15 +310,28 @@ struct method_body_info
 	u30 init_scope_depth;
 	u30 max_scope_depth;
 	std::string code;
+	//The ABC code as it was before being optimized, the JIT can only translate this one
+	std::string originalCode;
+	const std::string& abcCode() const { return originalCode.empty() ? code : originalCode; }
 	std::vector<exception_info> exceptions;
 	u30 trait_count;
 	std::vector<traits_info> traits;
 	//The hit_count belongs here, since it is used to manipulate the code
-	uint16_t hit_count;
+	uint32_t hit_count;
+	//Number of backward jumps taken, a measure of how hot the loops are
+	uint32_t backedge_count;
 	//The code status
 	enum CODE_STATUS { ORIGINAL = 0, USED, OPTIMIZED, JITTED, PRELOADED };
 	CODE_STATUS codeStatus;
+	//Set when the method has been queued for background compilation
+	bool jitQueued;
 	method_body_info_cache* codecache;
+	//Inline caches of the optimized code, referenced by index
+	std::vector<inline_cache> inlineCaches;
+	inline_cache* getInlineCache(uint32_t index)
+	{
+		return (index==NO_INLINE_CACHE) ? NULL : &inlineCaches[index];
+	}
 };
 
 std::istream& operator>>(std::istream& in, u8& v);
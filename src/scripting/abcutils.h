@@ -44,6 +44,33 @@ class scope_entry_list: public RefCountable
 public:
 	std::vector<scope_entry> scope;
 };
+
+#ifdef TAGGED_STACK_VALUES
+/* When tagged stack values are enabled the fast interpreter may store ints
+ * directly in the runtime stack slots instead of boxing them in an Integer.
+ * ASObjects are always aligned, so the lowest bit is used as the tag and the
+ * value is kept in the remaining bits. Tagged values are boxed as soon as
+ * they are read through the generic stack accessors, so they never escape
+ * to code that expects a real ASObject.
+ */
+inline bool isTaggedInt(const ASObject* o)
+{
+	return ((uintptr_t)o)&1;
+}
+inline bool canTagInt(int64_t i)
+{
+	return i>=INT32_MIN && i<=INT32_MAX &&
+		i>=(INTPTR_MIN>>1) && i<=(INTPTR_MAX>>1);
+}
+inline ASObject* makeTaggedInt(int32_t i)
+{
+	return reinterpret_cast<ASObject*>((((intptr_t)i)<<1)|1);
+}
+inline int32_t getTaggedInt(const ASObject* o)
+{
+	return ((intptr_t)o)>>1;
+}
+#endif
 struct call_context
 {
 #include "packed_begin.h"
@@ -77,11 +104,41 @@ struct call_context
 	bool returning;
 	~call_context();
 	static void handleError(int errorcode);
+#ifdef TAGGED_STACK_VALUES
+	/* Allocates an Integer for an int that is not stored in an ASObject */
+	ASObject* boxInt(int32_t i) const;
+	inline void runtime_stack_clear()
+	{
+		while(stack_index > 0)
+		{
+			ASObject* o=stack[--stack_index];
+			if(!isTaggedInt(o))
+				o->decRef();
+		}
+	}
+	inline void runtime_stack_push_int(int32_t i)
+	{
+		if(canTagInt(i))
+			runtime_stack_push(makeTaggedInt(i));
+		else
+			runtime_stack_push(boxInt(i));
+	}
+	/* Pops a stack slot without boxing tagged values */
+	inline ASObject* runtime_stack_pop_raw()
+	{
+		if(stack_index)
+			return stack[--stack_index];
+		else
+			handleError(kStackUnderflowError);
+		return NULL;
+	}
+#else
 	inline void runtime_stack_clear()
 	{
 		while(stack_index > 0)
 			stack[--stack_index]->decRef();
 	}
+#endif
 	inline void runtime_stack_push(ASObject* s)
 	{
 		if(stack_index<max_stack)
@@ -92,7 +149,16 @@ struct call_context
 	inline ASObject* runtime_stack_pop()
 	{
 		if(stack_index)
+		{
+#ifdef TAGGED_STACK_VALUES
+			ASObject* ret=stack[--stack_index];
+			if(isTaggedInt(ret))
+				return boxInt(getTaggedInt(ret));
+			return ret;
+#else
 			return stack[--stack_index];
+#endif
+		}
 		else
 			handleError(kStackUnderflowError);
 		return NULL;
@@ -100,14 +166,26 @@ struct call_context
 	inline ASObject* runtime_stack_peek()
 	{
 		if(stack_index)
+		{
+#ifdef TAGGED_STACK_VALUES
+			if(isTaggedInt(stack[stack_index-1]))
+				stack[stack_index-1]=boxInt(getTaggedInt(stack[stack_index-1]));
+#endif
 			return stack[stack_index-1];
+		}
 		LOG(LOG_ERROR,_("Empty stack"));
 		return NULL;
 	}
 	inline ASObject** runtime_stack_pointer()
 	{
 		if(stack_index)
+		{
+#ifdef TAGGED_STACK_VALUES
+			if(isTaggedInt(stack[stack_index-1]))
+				stack[stack_index-1]=boxInt(getTaggedInt(stack[stack_index-1]));
+#endif
 			return &stack[stack_index-1];
+		}
 		else
 			handleError(kStackUnderflowError);
 		return NULL;
@@ -21,6 +21,7 @@
 #include "scripting/flash/display/BitmapContainer.h"
 #include "backends/rendering_context.h"
 #include "backends/image.h"
+#include "platforms/fastpaths.h"
 
 using namespace std;
 using namespace lightspark;
@@ -163,24 +164,28 @@ void BitmapContainer::copyRectangle(_R<BitmapContainer> source,
 
 	int sx = clippedSourceRect.Xmin;
 	int sy = clippedSourceRect.Ymin;
-	if (mergeAlpha==false)
+	//When copying inside the same bitmap go bottom up if the
+	//destination is below the source, to not overwrite it
+	bool sameBitmap = (source.getPtr() == this);
+	bool bottomUp = sameBitmap && clippedY > sy;
+	std::vector<uint32_t> sourceRow;
+	for (int i=0; i<copyHeight; i++)
 	{
-		//Fast path using memmove
-		for (int i=0; i<copyHeight; i++)
+		int row = bottomUp ? copyHeight - i - 1 : i;
+		uint32_t* dest = getPixelPtr(clippedX, clippedY+row);
+		const uint32_t* src = source->getPixelPtr(sx, sy+row);
+		if (mergeAlpha==false)
+			memmove(dest, src, 4*copyWidth);
+		else
 		{
-			memmove(&data[(clippedY+i)*stride + 4*clippedX],
-				&source->data[(sy+i)*source->stride + 4*sx],
-				4*copyWidth);
+			if (sameBitmap)
+			{
+				sourceRow.assign(src, src+copyWidth);
+				src = &sourceRow[0];
+			}
+			fastBlendPixels(dest, src, copyWidth);
 		}
 	}
-	else
-	{
-		//Slow path using Cairo
-		CairoRenderContext ctxt(&data[0], width, height);
-		ctxt.simpleBlit(clippedX, clippedY, &source->data[0],
-				source->getWidth(), source->getHeight(),
-				sx, sy, copyWidth, copyHeight);
-	}
 }
 
 void BitmapContainer::fillRectangle(const RECT& inputRect, uint32_t color, bool useAlpha)
@@ -188,18 +193,14 @@ void BitmapContainer::fillRectangle(const RECT& inputRect, uint32_t color, bool
 	RECT clippedRect;
 	clipRect(inputRect, clippedRect);
 
+	int32_t fillWidth = clippedRect.Xmax - clippedRect.Xmin;
+	if (fillWidth <= 0)
+		return;
+
+	if (!useAlpha)
+		color = 0xFF000000 | (color & 0xFFFFFF);
 	for(int32_t y=clippedRect.Ymin;y<clippedRect.Ymax;y++)
-	{
-		for(int32_t x=clippedRect.Xmin;x<clippedRect.Xmax;x++)
-		{
-			uint32_t offset=y*stride + x*4;
-			uint32_t* ptr=(uint32_t*)(getData()+offset);
-			if (useAlpha)
-				*ptr = color;
-			else
-				*ptr = 0xFF000000 | (color & 0xFFFFFF);
-		}
-	}
+		fastFillPixels(getPixelPtr(clippedRect.Xmin, y), fillWidth, color);
 }
 
 bool BitmapContainer::scroll(int32_t x, int32_t y)
@@ -410,10 +411,8 @@ std::vector<uint32_t> BitmapContainer::getPixelVector(const RECT& inputRect) con
 	result.reserve((rect.Xmax - rect.Xmin)*(rect.Ymax - rect.Ymin));
 	for (int32_t y=rect.Ymin; y<rect.Ymax; y++)
 	{
-		for (int32_t x=rect.Xmin; x<rect.Xmax; x++)
-		{
-			result.push_back(*getDataNoBoundsChecking(x, y));
-		}
+		const uint32_t* row = getPixelPtr(rect.Xmin, y);
+		result.insert(result.end(), row, row + (rect.Xmax - rect.Xmin));
 	}
 
 	return result;
@@ -46,6 +46,10 @@ public:
 	BitmapContainer(MemoryAccount* m);
 	uint8_t* getData() { return &data[0]; }
 	const uint8_t* getData() const { return &data[0]; }
+	// Pointer to the pixel at (x, y), no bounds checking is
+	// done. The pixels of a row are contiguous.
+	uint32_t* getPixelPtr(int32_t x, int32_t y) { return reinterpret_cast<uint32_t*>(&data[y*stride + 4*x]); }
+	const uint32_t* getPixelPtr(int32_t x, int32_t y) const { return reinterpret_cast<const uint32_t*>(&data[y*stride + 4*x]); }
 	bool fromRGB(uint8_t* rgb, uint32_t width, uint32_t height, BITMAP_FORMAT format);
 	bool fromJPEG(uint8_t* data, int len, const uint8_t *tablesData=NULL, int tablesLen=0);
 	bool fromJPEG(std::istream& s);
@@ -27,6 +27,7 @@
 #include "scripting/flash/utils/ByteArray.h"
 #include "scripting/flash/filters/flashfilters.h"
 #include "backends/rendering_context.h"
+#include "platforms/fastpaths.h"
 
 using namespace lightspark;
 using namespace std;
@@ -160,12 +161,14 @@ ASFUNCTIONBODY(BitmapData,dispose)
 	return NULL;
 }
 
-void BitmapData::drawDisplayObject(DisplayObject* d, const MATRIX& initialMatrix)
+void BitmapData::drawDisplayObject(DisplayObject* d, const MATRIX& initialMatrix, const ClipRect* clip)
 {
 	//Create an InvalidateQueue to store all the hierarchy of objects that must be drawn
 	SoftwareInvalidateQueue queue;
 	d->requestInvalidation(&queue);
 	CairoRenderContext ctxt(pixels->getData(), pixels->getWidth(), pixels->getHeight());
+	if(clip)
+		ctxt.setClipRect(*clip);
 	for(auto it=queue.queue.begin();it!=queue.queue.end();it++)
 	{
 		DisplayObject* target=(*it).getPtr();
@@ -173,6 +176,13 @@ void BitmapData::drawDisplayObject(DisplayObject* d, const MATRIX& initialMatrix
 		IDrawable* drawable=target->invalidate(d, initialMatrix);
 		if(drawable==NULL)
 			continue;
+		//Objects completely outside of the clipped area are not rasterized at all
+		if(clip && !clip->intersects(ClipRect(drawable->getXOffset(), drawable->getYOffset(),
+				drawable->getXOffset()+drawable->getWidth(), drawable->getYOffset()+drawable->getHeight())))
+		{
+			delete drawable;
+			continue;
+		}
 
 		//Compute the matrix for this object
 		uint8_t* buf=drawable->getPixelBuffer();
@@ -207,9 +217,16 @@ ASFUNCTIONBODY(BitmapData,draw)
 				      drawable->getClassName(),
 				      "IBitmapDrawable");
 
-	if(!ctransform.isNull() || !blendMode.isNull() || !clipRect.isNull() || smoothing)
+	if(!ctransform.isNull() || !blendMode.isNull() || smoothing)
 		LOG(LOG_NOT_IMPLEMENTED,"BitmapData.draw does not support many parameters");
 
+	ClipRect clip;
+	if(!clipRect.isNull())
+	{
+		clip=ClipRect(floor(clipRect->x), floor(clipRect->y),
+				ceil(clipRect->x+clipRect->width), ceil(clipRect->y+clipRect->height));
+	}
+
 	if(drawable->is<BitmapData>())
 	{
 		BitmapData* data=drawable->as<BitmapData>();
@@ -218,6 +235,8 @@ ASFUNCTIONBODY(BitmapData,draw)
 		if(!matrix.isNull())
 			initialMatrix=matrix->getMATRIX();
 		CairoRenderContext ctxt(th->pixels->getData(), th->pixels->getWidth(), th->pixels->getHeight());
+		if(!clipRect.isNull())
+			ctxt.setClipRect(clip);
 		//Blit the data while transforming it
 		ctxt.transformedBlit(initialMatrix, data->pixels->getData(),
 				data->pixels->getWidth(), data->pixels->getHeight(),
@@ -230,7 +249,7 @@ ASFUNCTIONBODY(BitmapData,draw)
 		MATRIX initialMatrix;
 		if(!matrix.isNull())
 			initialMatrix=matrix->getMATRIX();
-		th->drawDisplayObject(d, initialMatrix);
+		th->drawDisplayObject(d, initialMatrix, clipRect.isNull() ? NULL : &clip);
 	}
 	else
 		LOG(LOG_NOT_IMPLEMENTED,"BitmapData.draw does not support " << drawable->toDebugString());
@@ -470,26 +489,25 @@ ASFUNCTIONBODY(BitmapData,copyChannel)
 	int regionWidth = clippedSourceRect.Xmax - clippedSourceRect.Xmin;
 	int regionHeight = clippedSourceRect.Ymax - clippedSourceRect.Ymin;
 
-	if (regionWidth < 0 || regionHeight < 0)
+	if (regionWidth <= 0 || regionHeight <= 0)
 		return NULL;
 
-	uint32_t constantChannelsMask = ~(0xFF << destShift);
-	for (int32_t y=0; y<regionHeight; y++)
+	//Rows of the same bitmap are copied first, as they may overlap,
+	//and go bottom up if the destination is below the source
+	bool sameBitmap = (source->pixels.getPtr() == th->pixels.getPtr());
+	bool bottomUp = sameBitmap && clippedDestY > clippedSourceRect.Ymin;
+	vector<uint32_t> sourceRow;
+	for (int32_t i=0; i<regionHeight; i++)
 	{
-		for (int32_t x=0; x<regionWidth; x++)
+		int32_t y = bottomUp ? regionHeight - i - 1 : i;
+		const uint32_t* src = source->pixels->getPixelPtr(clippedSourceRect.Xmin, clippedSourceRect.Ymin+y);
+		if (sameBitmap)
 		{
-			int32_t sx = clippedSourceRect.Xmin+x;
-			int32_t sy = clippedSourceRect.Ymin+y;
-			uint32_t sourcePixel = source->pixels->getPixel(sx, sy);
-			uint32_t channel = (sourcePixel >> sourceShift) & 0xFF;
-			uint32_t destChannelValue = channel << destShift;
-
-			int32_t dx = clippedDestX + x;
-			int32_t dy = clippedDestY + y;
-			uint32_t oldPixel = th->pixels->getPixel(dx, dy);
-			uint32_t newColor = (oldPixel & constantChannelsMask) | destChannelValue;
-			th->pixels->setPixel(dx, dy, newColor, true);
+			sourceRow.assign(src, src+regionWidth);
+			src = &sourceRow[0];
 		}
+		fastCopyChannel(th->pixels->getPixelPtr(clippedDestX, clippedDestY+y), src, regionWidth,
+				sourceShift, destShift);
 	}
 
 	th->notifyUsers();
@@ -558,17 +576,11 @@ ASFUNCTIONBODY(BitmapData,histogram)
 		th->pixels->clipRect(inputRect->getRect(), rect);
 	}
 
-	unsigned int counts[4][256] = {{0}};
-	for (int32_t x=rect.Xmin; x<rect.Xmax; x++)
+	uint32_t counts[4][256] = {{0}};
+	if (rect.Xmax > rect.Xmin)
 	{
 		for (int32_t y=rect.Ymin; y<rect.Ymax; y++)
-		{
-			uint32_t pixel = th->pixels->getPixel(x, y);
-			for (int i=0; i<4; i++)
-			{
-				counts[i][(pixel >> (8*i)) & 0xFF]++;
-			}
-		}
+			fastHistogramPixels(th->pixels->getPixelPtr(rect.Xmin, y), rect.Xmax - rect.Xmin, counts);
 	}
 
 	Vector *result = Template<Vector>::getInstanceS(obj->getSystemState(),Template<Vector>::getTemplateInstance(obj->getSystemState(),Class<Number>::getClass(obj->getSystemState()),NullRef).getPtr(),NullRef);
@@ -645,10 +657,26 @@ ASFUNCTIONBODY(BitmapData,getPixels)
 		throwError<TypeError>(kNullPointerError, "rect");
 
 	ByteArray *ba = Class<ByteArray>::getInstanceS(obj->getSystemState());
-	vector<uint32_t> pixelvec = th->pixels->getPixelVector(rect->getRect());
-	vector<uint32_t>::const_iterator it;
-	for (it=pixelvec.begin(); it!=pixelvec.end(); ++it)
-		ba->writeUnsignedInt(ba->endianIn(*it));
+	RECT clippedRect;
+	th->pixels->clipRect(rect->getRect(), clippedRect);
+	int32_t width = clippedRect.Xmax - clippedRect.Xmin;
+	int32_t height = clippedRect.Ymax - clippedRect.Ymin;
+	if (width <= 0 || height <= 0)
+		return ba;
+
+	//Write whole rows, swapping the bytes if the ByteArray endianness is not the native one
+	bool swap = ba->endianIn((uint32_t)0x01020304) != 0x01020304;
+	uint32_t size = width*height*4;
+	uint32_t* buf = reinterpret_cast<uint32_t*>(ba->getBuffer(size, true));
+	for (int32_t y=0; y<height; y++)
+	{
+		const uint32_t* row = th->pixels->getPixelPtr(clippedRect.Xmin, clippedRect.Ymin+y);
+		if (swap)
+			fastSwapPixels(buf+y*width, row, width);
+		else
+			memcpy(buf+y*width, row, width*4);
+	}
+	ba->setPosition(size);
 	return ba;
 }
 
@@ -689,17 +717,41 @@ ASFUNCTIONBODY(BitmapData,setPixels)
 
 	RECT rect;
 	th->pixels->clipRect(inputRect->getRect(), rect);
+	int32_t width = rect.Xmax - rect.Xmin;
+	if (width <= 0 || rect.Ymax <= rect.Ymin)
+		return NULL;
 
+	//Read whole rows, swapping the bytes if the ByteArray endianness is not the native one
+	bool swap = inputByteArray->endianIn((uint32_t)0x01020304) != 0x01020304;
+	uint32_t position = inputByteArray->getPosition();
+	uint32_t available = (inputByteArray->getLength() > position) ? (inputByteArray->getLength() - position)/4 : 0;
+	const uint8_t* bytes = available ? inputByteArray->getBuffer(inputByteArray->getLength(), false) : NULL;
+	vector<uint32_t> row(width);
 	for (int32_t y=rect.Ymin; y<rect.Ymax; y++)
 	{
-		for (int32_t x=rect.Xmin; x<rect.Xmax; x++)
+		uint32_t count = imin(width, available);
+		if (count > 0)
 		{
-			uint32_t pixel;
-			if (!inputByteArray->readUnsignedInt(pixel))
-				throwError<EOFError>(kEOFError);
-			th->pixels->setPixel(x, y, pixel, th->transparent);
+			memcpy(&row[0], bytes+position, count*4);
+			if (swap)
+				fastSwapPixels(&row[0], &row[0], count);
+			uint32_t* dest = th->pixels->getPixelPtr(rect.Xmin, y);
+			if (th->transparent)
+				memcpy(dest, &row[0], count*4);
+			else
+				fastMaskedCopyPixels(dest, &row[0], count, 0x00FFFFFF);
+			position += count*4;
+			available -= count;
+		}
+		if (count < (uint32_t)width)
+		{
+			inputByteArray->setPosition(position);
+			th->notifyUsers();
+			throwError<EOFError>(kEOFError);
 		}
 	}
+	inputByteArray->setPosition(position);
+	th->notifyUsers();
 
 	return NULL;
 }
@@ -730,7 +782,7 @@ ASFUNCTIONBODY(BitmapData,setVector)
 			if (i >= inputVector->size())
 				throwError<RangeError>(kParamRangeError);
 
-			uint32_t pixel = inputVector->at(i)->toUInt();
+			uint32_t pixel = inputVector->uintAt(i);
 			th->pixels->setPixel(x, y, pixel, th->transparent);
 			i++;
 		}
@@ -751,40 +803,33 @@ ASFUNCTIONBODY(BitmapData,colorTransform)
 		throwError<TypeError>(kNullPointerError, "rect");
 	if (inputColorTransform.isNull())
 		throwError<TypeError>(kNullPointerError, "inputVector");
+	if(th->pixels.isNull())
+		throw Class<ArgumentError>::getInstanceS(obj->getSystemState(),"Disposed BitmapData", 2015);
 
 	RECT rect;
 	th->pixels->clipRect(inputRect->getRect(), rect);
-	
-	vector<uint32_t> pixelvec = th->pixels->getPixelVector(rect);
+	int32_t width = rect.Xmax - rect.Xmin;
+	if (width <= 0)
+		return NULL;
 
-	unsigned int i = 0;
+	//In the byte order of the pixels: blue, green, red, alpha
+	float multipliers[4] = { (float)inputColorTransform->blueMultiplier, (float)inputColorTransform->greenMultiplier,
+		(float)inputColorTransform->redMultiplier, (float)inputColorTransform->alphaMultiplier };
+	float offsets[4] = { (float)inputColorTransform->blueOffset, (float)inputColorTransform->greenOffset,
+		(float)inputColorTransform->redOffset, (float)inputColorTransform->alphaOffset };
+
+	vector<uint32_t> row(width);
 	for (int32_t y=rect.Ymin; y<rect.Ymax; y++)
 	{
-		for (int32_t x=rect.Xmin; x<rect.Xmax; x++)
-		{
-
-			uint32_t pixel = pixelvec[i];
-
-			int a, r, g, b;
-			a = ((pixel >> 24 )&0xff) * inputColorTransform->alphaMultiplier + inputColorTransform->alphaOffset;
-			if (a > 255) a = 255;
-			if (a < 0) a = 0;
-			r = ((pixel >> 16 )&0xff) * inputColorTransform->redMultiplier + inputColorTransform->redOffset;
-			if (r > 255) r = 255;
-			if (r < 0) r = 0;
-			g = ((pixel >> 8 )&0xff) * inputColorTransform->greenMultiplier + inputColorTransform->greenOffset;
-			if (g > 255) g = 255;
-			if (g < 0) g = 0;
-			b = ((pixel )&0xff) * inputColorTransform->blueMultiplier + inputColorTransform->blueOffset;
-			if (b > 255) b = 255;
-			if (b < 0) b = 0;
-			
-			pixel = (a<<24) | (r<<16) | (g<<8) | b;
-			
-			th->pixels->setPixel(x, y, pixel, th->transparent);
-			i++;
-		}
+		uint32_t* dest = th->pixels->getPixelPtr(rect.Xmin, y);
+		memcpy(&row[0], dest, width*4);
+		fastColorTransformPixels(&row[0], width, multipliers, offsets);
+		if (th->transparent)
+			memcpy(dest, &row[0], width*4);
+		else
+			fastMaskedCopyPixels(dest, &row[0], width, 0x00FFFFFF);
 	}
+	th->notifyUsers();
 
 	return NULL;
 }
@@ -797,6 +842,8 @@ ASFUNCTIONBODY(BitmapData,compare)
 
 	if (otherBitmapData.isNull())
 		throwError<TypeError>(kNullPointerError, "otherBitmapData");
+	if (th->pixels.isNull() || otherBitmapData->pixels.isNull())
+		throw Class<ArgumentError>::getInstanceS(obj->getSystemState(),"Disposed BitmapData", 2015);
 
 	if (th->getWidth() != otherBitmapData->getWidth())
 		return abstract_d(obj->getSystemState(),-3);
@@ -808,36 +855,19 @@ ASFUNCTIONBODY(BitmapData,compare)
 	rect.Ymin = 0;
 	rect.Ymax = th->getHeight();
 	
-	vector<uint32_t> pixelvec = th->pixels->getPixelVector(rect);
-	vector<uint32_t> otherpixelvec = otherBitmapData->pixels->getPixelVector(rect);
-	
 	BitmapData* res = Class<BitmapData>::getInstanceS(obj->getSystemState(),rect.Xmax,rect.Ymax);
-	unsigned int i = 0;
 	bool different = false;
 	for (int32_t y=rect.Ymin; y<rect.Ymax; y++)
 	{
-		for (int32_t x=rect.Xmin; x<rect.Xmax; x++)
-		{
-
-			uint32_t pixel = pixelvec[i];
-			uint32_t otherpixel = otherpixelvec[i];
-			if (pixel == otherpixel)
-				res->pixels->setPixel(x, y, 0, true);
-			else if ((pixel & 0x00FFFFFF) == (otherpixel & 0x00FFFFFF))
-			{
-				different = true;
-				res->pixels->setPixel(x, y, ((pixel & 0xFF000000) - (otherpixel & 0xFF000000)) | 0x00FFFFFF , true);
-			}
-			else 
-			{
-				different = true;
-				res->pixels->setPixel(x, y, ((pixel & 0x00FFFFFF) - (otherpixel & 0x00FFFFFF)), true);
-			}
-			i++;
-		}
+		different |= fastComparePixels(res->pixels->getPixelPtr(0, y),
+				th->pixels->getPixelPtr(0, y),
+				otherBitmapData->pixels->getPixelPtr(0, y), rect.Xmax);
 	}
 	if (!different)
+	{
+		res->decRef();
 		return abstract_d(obj->getSystemState(),0);
+	}
 	return res;
 }
 
@@ -881,6 +911,10 @@ ASFUNCTIONBODY(BitmapData,perlinNoise)
 }
 ASFUNCTIONBODY(BitmapData,threshold)
 {
+	BitmapData* th = obj->as<BitmapData>();
+	if(th->pixels.isNull())
+		throw Class<ArgumentError>::getInstanceS(obj->getSystemState(),"Disposed BitmapData", 2015);
+
 	_NR<BitmapData> sourceBitmapData;
 	_NR<Rectangle> sourceRect;
 	_NR<Point> destPoint;
@@ -891,6 +925,65 @@ ASFUNCTIONBODY(BitmapData,threshold)
 	bool copySource;
 	ARG_UNPACK(sourceBitmapData)(sourceRect)(destPoint)(operation)(threshold) (color,0) (mask, 0xFFFFFFFF) (copySource, false);
 
-	LOG(LOG_NOT_IMPLEMENTED,"BitmapData.threshold not implemented");
-	return NULL;
+	if (sourceBitmapData.isNull())
+		throwError<TypeError>(kNullPointerError, "sourceBitmapData");
+	if (sourceRect.isNull())
+		throwError<TypeError>(kNullPointerError, "sourceRect");
+	if (destPoint.isNull())
+		throwError<TypeError>(kNullPointerError, "destPoint");
+	if (sourceBitmapData->pixels.isNull())
+		throw Class<ArgumentError>::getInstanceS(obj->getSystemState(),"Disposed BitmapData", 2015);
+
+	THRESHOLD_OP op = THRESHOLD_LESS;
+	if (operation == "<")
+		op = THRESHOLD_LESS;
+	else if (operation == "<=")
+		op = THRESHOLD_LESS_EQUAL;
+	else if (operation == ">")
+		op = THRESHOLD_GREATER;
+	else if (operation == ">=")
+		op = THRESHOLD_GREATER_EQUAL;
+	else if (operation == "==")
+		op = THRESHOLD_EQUAL;
+	else if (operation == "!=")
+		op = THRESHOLD_NOT_EQUAL;
+	else
+		throwError<ArgumentError>(kInvalidEnumError, "operation");
+
+	if (!th->transparent)
+		color = 0xFF000000 | color;
+
+	RECT clippedSourceRect;
+	int32_t clippedDestX;
+	int32_t clippedDestY;
+	th->pixels->clipRect(sourceBitmapData->pixels, sourceRect->getRect(),
+			     destPoint->getX(), destPoint->getY(),
+			     clippedSourceRect, clippedDestX, clippedDestY);
+	int regionWidth = clippedSourceRect.Xmax - clippedSourceRect.Xmin;
+	int regionHeight = clippedSourceRect.Ymax - clippedSourceRect.Ymin;
+
+	uint32_t changed = 0;
+	if (regionWidth <= 0 || regionHeight <= 0)
+		return abstract_ui(obj->getSystemState(),changed);
+
+	//Rows of the same bitmap are copied first, as they may overlap,
+	//and go bottom up if the destination is below the source
+	bool sameBitmap = (sourceBitmapData->pixels.getPtr() == th->pixels.getPtr());
+	bool bottomUp = sameBitmap && clippedDestY > clippedSourceRect.Ymin;
+	vector<uint32_t> sourceRow;
+	for (int32_t i=0; i<regionHeight; i++)
+	{
+		int32_t y = bottomUp ? regionHeight - i - 1 : i;
+		const uint32_t* src = sourceBitmapData->pixels->getPixelPtr(clippedSourceRect.Xmin, clippedSourceRect.Ymin+y);
+		if (sameBitmap)
+		{
+			sourceRow.assign(src, src+regionWidth);
+			src = &sourceRow[0];
+		}
+		changed += fastThresholdPixels(th->pixels->getPixelPtr(clippedDestX, clippedDestY+y), src, regionWidth,
+				op, threshold, color, mask, copySource);
+	}
+	th->notifyUsers();
+
+	return abstract_ui(obj->getSystemState(),changed);
 }
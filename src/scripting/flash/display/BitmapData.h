@@ -28,6 +28,7 @@ namespace lightspark
 {
 
 class Bitmap;
+class ClipRect;
 class DisplayObject;
 
 class BitmapData: public ASObject, public IBitmapDrawable
@@ -52,8 +53,9 @@ public:
 	void removeUser(Bitmap* b);
 	/*
 	 * Utility method to draw a DisplayObject on the surface
+	 * Only the area inside clip, if any, is modified
 	 */
-	void drawDisplayObject(DisplayObject* d, const MATRIX& initialMatrix);
+	void drawDisplayObject(DisplayObject* d, const MATRIX& initialMatrix, const ClipRect* clip=NULL);
 	ASPROPERTY_GETTER(bool, transparent);
 	ASFUNCTION(_constructor);
 	ASFUNCTION(dispose);
@@ -325,7 +325,17 @@ void DisplayObject::defaultRender(RenderContext& ctxt) const
 	/* surface is only modified from within the render thread
 	 * so we need no locking here */
 	if(!surface.tex.isValid())
+	{
+		//The texture was evicted to stay in the memory budget, draw it again
+		if(surface.tex.isEvicted())
+		{
+			surface.tex.clearEvicted();
+			DisplayObject* th=const_cast<DisplayObject*>(this);
+			th->incRef();
+			getSystemState()->addToInvalidateQueue(_MR(th));
+		}
 		return;
+	}
 
 	ctxt.lsglLoadIdentity();
 	ctxt.renderTextured(surface.tex, surface.xOffset, surface.yOffset,
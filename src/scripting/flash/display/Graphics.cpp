@@ -420,36 +420,33 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 	if (winding != "evenOdd")
 		LOG(LOG_NOT_IMPLEMENTED, "Only event-odd winding implemented in Graphics.drawPath");
 
-	_R<ASObject> zeroRef = _MR(abstract_d(commands->getSystemState(),0));
-	ASObject *zero = zeroRef.getPtr();
-
 	int k = 0;
 	for (unsigned int i=0; i<commands->size(); i++)
 	{
-		switch (commands->at(i)->toInt())
+		switch (commands->intAt(i))
 		{
 			case GraphicsPathCommand::MOVE_TO:
 			{
-				number_t x = data->at(k++, zero)->toNumber();
-				number_t y = data->at(k++, zero)->toNumber();
+				number_t x = data->numberAt(k++);
+				number_t y = data->numberAt(k++);
 				tokens.emplace_back(GeomToken(MOVE, Vector2(x, y)));
 				break;
 			}
 
 			case GraphicsPathCommand::LINE_TO:
 			{
-				number_t x = data->at(k++, zero)->toNumber();
-				number_t y = data->at(k++, zero)->toNumber();
+				number_t x = data->numberAt(k++);
+				number_t y = data->numberAt(k++);
 				tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x, y)));
 				break;
 			}
 
 			case GraphicsPathCommand::CURVE_TO:
 			{
-				number_t cx = data->at(k++, zero)->toNumber();
-				number_t cy = data->at(k++, zero)->toNumber();
-				number_t x = data->at(k++, zero)->toNumber();
-				number_t y = data->at(k++, zero)->toNumber();
+				number_t cx = data->numberAt(k++);
+				number_t cy = data->numberAt(k++);
+				number_t x = data->numberAt(k++);
+				number_t y = data->numberAt(k++);
 				tokens.emplace_back(GeomToken(CURVE_QUADRATIC,
 							      Vector2(cx, cy),
 							      Vector2(x, y)));
@@ -459,8 +456,8 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 			case GraphicsPathCommand::WIDE_MOVE_TO:
 			{
 				k+=2;
-				number_t x = data->at(k++, zero)->toNumber();
-				number_t y = data->at(k++, zero)->toNumber();
+				number_t x = data->numberAt(k++);
+				number_t y = data->numberAt(k++);
 				tokens.emplace_back(GeomToken(MOVE, Vector2(x, y)));
 				break;
 			}
@@ -468,20 +465,20 @@ void Graphics::pathToTokens(_NR<Vector> commands, _NR<Vector> data,
 			case GraphicsPathCommand::WIDE_LINE_TO:
 			{
 				k+=2;
-				number_t x = data->at(k++, zero)->toNumber();
-				number_t y = data->at(k++, zero)->toNumber();
+				number_t x = data->numberAt(k++);
+				number_t y = data->numberAt(k++);
 				tokens.emplace_back(GeomToken(STRAIGHT, Vector2(x, y)));
 				break;
 			}
 
 			case GraphicsPathCommand::CUBIC_CURVE_TO:
 			{
-				number_t c1x = data->at(k++, zero)->toNumber();
-				number_t c1y = data->at(k++, zero)->toNumber();
-				number_t c2x = data->at(k++, zero)->toNumber();
-				number_t c2y = data->at(k++, zero)->toNumber();
-				number_t x = data->at(k++, zero)->toNumber();
-				number_t y = data->at(k++, zero)->toNumber();
+				number_t c1x = data->numberAt(k++);
+				number_t c1y = data->numberAt(k++);
+				number_t c2x = data->numberAt(k++);
+				number_t c2y = data->numberAt(k++);
+				number_t x = data->numberAt(k++);
+				number_t y = data->numberAt(k++);
 				tokens.emplace_back(GeomToken(CURVE_CUBIC,
 							      Vector2(c1x, c1y),
 							      Vector2(c2x, c2y),
@@ -617,15 +614,15 @@ void Graphics::drawTrianglesToTokens(_NR<Vector> vertices, _NR<Vector> indices,
 			if (indices.isNull())
 				vertex=3*i+j;
 			else
-				vertex=indices->at(3*i+j)->toInt();
+				vertex=indices->intAt(3*i+j);
 
-			x[j]=vertices->at(2*vertex)->toNumber();
-			y[j]=vertices->at(2*vertex+1)->toNumber();
+			x[j]=vertices->numberAt(2*vertex);
+			y[j]=vertices->numberAt(2*vertex+1);
 
 			if (has_uvt)
 			{
-				u[j]=uvtData->at(vertex*uvtElemSize)->toNumber()*texturewidth;
-				v[j]=uvtData->at(vertex*uvtElemSize+1)->toNumber()*textureheight;
+				u[j]=uvtData->numberAt(vertex*uvtElemSize)*texturewidth;
+				v[j]=uvtData->numberAt(vertex*uvtElemSize+1)*textureheight;
 			}
 		}
 		
@@ -673,7 +670,8 @@ ASFUNCTIONBODY(Graphics,drawGraphicsData)
 
 	for (unsigned int i=0; i<graphicsData->size(); i++)
 	{
-		IGraphicsData *graphElement = dynamic_cast<IGraphicsData *>(graphicsData->at(i));
+		_R<ASObject> element = graphicsData->at(i);
+		IGraphicsData *graphElement = dynamic_cast<IGraphicsData *>(element.getPtr());
 		if (!graphElement)
 		{
 			LOG(LOG_ERROR, "Invalid type in Graphics::drawGraphicsData()");
@@ -245,11 +245,12 @@ void TokenContainer::getTextureSize(tokensVector& tokens, int *width, int *heigh
 		    fstype==CLIPPED_BITMAP ||
 		    fstype==NON_SMOOTHED_CLIPPED_BITMAP))
 		{
-			if (style.bitmap.isNull())
+			_NR<BitmapContainer> bm(style.getBitmap());
+			if (bm.isNull())
 				return;
 
-			*width=style.bitmap->getWidth();
-			*height=style.bitmap->getHeight();
+			*width=bm->getWidth();
+			*height=bm->getHeight();
 			return;
 		}
 	}
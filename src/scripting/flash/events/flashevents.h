@@ -33,7 +33,7 @@ namespace lightspark
 
 enum EVENT_TYPE { EVENT=0, BIND_CLASS, SHUTDOWN, SYNC, MOUSE_EVENT,
 	FUNCTION, EXTERNAL_CALL, CONTEXT_INIT, INIT_FRAME,
-	FLUSH_INVALIDATION_QUEUE, ADVANCE_FRAME, PARSE_RPC_MESSAGE };
+	FLUSH_INVALIDATION_QUEUE, ADVANCE_FRAME, PARSE_RPC_MESSAGE, RENDER_FRAME };
 
 class ABCContext;
 class DictionaryTag;
@@ -41,6 +41,7 @@ class InteractiveObject;
 class PlaceObject2Tag;
 class DisplayObject;
 class Responder;
+class HeadlessRenderer;
 
 class Event: public ASObject
 {
@@ -487,6 +488,15 @@ public:
 	EVENT_TYPE getEventType() const { return ADVANCE_FRAME; }
 };
 
+//Event to rasterize the display list for a HeadlessRenderer in the VM thread
+class RenderFrameEvent: public WaitableEvent
+{
+public:
+	HeadlessRenderer* renderer;
+	RenderFrameEvent(HeadlessRenderer* r): WaitableEvent("RenderFrameEvent"), renderer(r) {}
+	EVENT_TYPE getEventType() const { return RENDER_FRAME; }
+};
+
 //Event to flush the invalidation queue
 class FlushInvalidationQueueEvent: public Event
 {
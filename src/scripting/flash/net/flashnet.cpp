@@ -19,6 +19,7 @@
 
 #include <map>
 #include "backends/security.h"
+#include "backends/sharedobjectstore.h"
 #include "scripting/abc.h"
 #include "scripting/flash/net/flashnet.h"
 #include "scripting/flash/net/URLRequestHeader.h"
@@ -31,6 +32,7 @@
 #include "backends/rendering.h"
 #include "backends/streamcache.h"
 #include "scripting/argconv.h"
+#include "parsing/amf3_generator.h"
 
 using namespace std;
 using namespace lightspark;
@@ -677,14 +679,36 @@ ASFUNCTIONBODY(SharedObject,getLocal)
 		LOG(LOG_NOT_IMPLEMENTED,"SharedObject.getLocal: parameter 'secure' is ignored");
 
 
+	//Objects belong to the host of the SWF and to a part of its path, by default the whole path
+	RootMovieClip* root = obj->getSystemState()->mainClip;
+	call_context* cc = getVm(obj->getSystemState())->currentCallContext;
+	if (cc)
+		root = cc->context->root.getPtr();
+	const URLInfo& origin = root->getOrigin();
+	const tiny_string& swfPath = origin.getPath();
+	if (localPath.empty())
+		localPath = swfPath;
+	else if (!URLInfo::isSubPathOf(localPath, swfPath) ||
+		 (localPath.numBytes() < swfPath.numBytes() && !localPath.endsWith("/") &&
+		  swfPath.raw_buf()[localPath.numBytes()] != '/'))
+		throwError<ASError>(0,"invalid localPath");
+
 	tiny_string fullname = localPath + "|";
 	fullname += name;
 	SharedObject* res = Class<SharedObject>::getInstanceS(obj->getSystemState());
-	std::map<tiny_string, ASObject* >::iterator it = sharedobjectmap.find(fullname);
+	res->host = origin.getHostname();
+	res->name = fullname;
+	//The map is shared by all the SWFs, so its key includes the host
+	tiny_string key = res->host + "|";
+	key += fullname;
+	std::map<tiny_string, ASObject* >::iterator it = sharedobjectmap.find(key);
 	if (it == sharedobjectmap.end())
 	{
-		sharedobjectmap.insert(make_pair(fullname,Class<ASObject>::getInstanceS(obj->getSystemState())));
-		it = sharedobjectmap.find(fullname);
+		//The stored data is read only the first time the object is requested
+		ASObject* data = loadData(obj->getSystemState(),res->host,fullname);
+		if (data == NULL)
+			data = Class<ASObject>::getInstanceS(obj->getSystemState());
+		it = sharedobjectmap.insert(make_pair(key,data)).first;
 	}
 	it->second->incRef();
 	res->data = _NR<ASObject>(it->second);
@@ -698,16 +722,54 @@ ASFUNCTIONBODY(SharedObject,getRemote)
 	return NULL;
 }
 
-ASFUNCTIONBODY(SharedObject,flush)
+ASObject* SharedObject::loadData(SystemState* sys, const tiny_string& host, const tiny_string& name)
 {
-	LOG(LOG_NOT_IMPLEMENTED,"SharedObject.flush not implemented");
+	std::vector<uint8_t> buf;
+	if (!sys->sharedObjectStore->load(host,name,buf))
+		return NULL;
+	_R<ByteArray> bytes = _MR(Class<ByteArray>::getInstanceS(sys));
+	bytes->writeBytes(&buf[0],buf.size());
+	bytes->setPosition(0);
+	Amf3Deserializer d(bytes.getPtr());
+	try
+	{
+		_R<ASObject> ret = d.readObject();
+		if (ret->getObjectType() == T_OBJECT)
+		{
+			ret->incRef();
+			return ret.getPtr();
+		}
+		LOG(LOG_ERROR,"SharedObject " << name << " does not contain an object");
+	}
+	catch(LightsparkException& e)
+	{
+		LOG(LOG_ERROR,"Exception caught while loading SharedObject " << name << ": " << e.cause);
+	}
 	return NULL;
 }
 
+ASFUNCTIONBODY(SharedObject,flush)
+{
+	SharedObject* th=static_cast<SharedObject*>(obj);
+	if (!th->name.empty())
+	{
+		//Only the serialization happens here, the store writes the data from its own thread
+		_R<ByteArray> bytes = _MR(Class<ByteArray>::getInstanceS(obj->getSystemState()));
+		bytes->setObjectEncoding(ObjectEncoding::AMF3);
+		bytes->writeObject(th->data.getPtr());
+		uint8_t* buf = bytes->getBuffer(bytes->getLength(),false);
+		std::vector<uint8_t> data(buf,buf+bytes->getLength());
+		obj->getSystemState()->sharedObjectStore->store(th->host,th->name,data);
+	}
+	return abstract_s(obj->getSystemState(),"flushed");
+}
+
 ASFUNCTIONBODY(SharedObject,clear)
 {
 	SharedObject* th=static_cast<SharedObject*>(obj);
 	th->data->destroyContents();
+	if (!th->name.empty())
+		obj->getSystemState()->sharedObjectStore->remove(th->host,th->name);
 	return NULL;
 }
 
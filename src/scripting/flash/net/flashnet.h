@@ -108,6 +108,12 @@ class SharedObject: public EventDispatcher
 {
 private:
 	static std::map<tiny_string, ASObject* > sharedobjectmap;
+	//Host of the SWF that created the object
+	tiny_string host;
+	//Local path and name of the object, empty if not created by getLocal
+	tiny_string name;
+	//Returns the stored data of the named object, or NULL if there is none
+	static ASObject* loadData(SystemState* sys, const tiny_string& host, const tiny_string& name);
 public:
 	SharedObject(Class_base* c);
 	static void sinit(Class_base*);
@@ -134,7 +134,7 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 	if (size > BA_MAX_SIZE) 
 		throwError<ASError>(kOutOfMemoryError);
 	// The first allocation is exactly the size we need,
-	// the subsequent reallocations happen in increments of BA_CHUNK_SIZE bytes
+	// the subsequent reallocations at least double the buffer, in multiples of BA_CHUNK_SIZE bytes
 	uint32_t prevLen = len;
 	if(bytes==NULL)
 	{
@@ -154,9 +154,13 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 #ifdef MEMORY_USAGE_PROFILING
 		uint32_t prev_real_len = real_len;
 #endif
-		while(real_len < size)
-			real_len += BA_CHUNK_SIZE;
-		// Reallocate the buffer, in chunks of BA_CHUNK_SIZE bytes
+		// Grow geometrically, so that sequences of small writes
+		// (like the serialization of big objects) take amortized constant time
+		uint32_t newLen = (real_len > BA_MAX_SIZE/2) ? BA_MAX_SIZE : real_len*2;
+		real_len = (size + BA_CHUNK_SIZE - 1) & ~(BA_CHUNK_SIZE - 1);
+		if(real_len < newLen)
+			real_len = newLen;
+		// Reallocate the buffer
 		uint8_t* bytes2 = (uint8_t*) realloc(bytes, real_len);
 #ifdef MEMORY_USAGE_PROFILING
 		getClass()->memoryAccount->addBytes(real_len-prev_real_len);
@@ -553,9 +557,9 @@ uint32_t ByteArray::writeObject(ASObject* obj)
 	//Return the length of the serialized object
 
 	//TODO: support custom serialization
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	uint32_t oldPosition=position;
 	obj->serialize(this, stringMap, objMap,traitsMap);
 	return position-oldPosition;
@@ -1118,37 +1122,46 @@ void ByteArray::acquireBuffer(uint8_t* buf, int bufLen)
 
 void ByteArray::writeU29(uint32_t val)
 {
-	for(uint32_t i=0;i<4;i++)
+	uint8_t buf[4];
+	uint32_t n=0;
+	for(uint32_t i=0;i<3;i++)
 	{
-		uint8_t b;
-		if(i<3)
-		{
-			uint32_t tmp=(val >> ((3-i)*7));
-			if(tmp==0)
-				continue;
+		uint32_t tmp=(val >> ((3-i)*7));
+		if(tmp==0)
+			continue;
+		buf[n++]=(tmp&0x7f)|0x80;
+	}
+	buf[n++]=val&0x7f;
+	memcpy(reserveBytes(n),buf,n);
+}
 
-			b=(tmp&0x7f)|0x80;
-		}
-		else
-			b=val&0x7f;
+uint8_t* ByteArray::reserveBytes(uint32_t size)
+{
+	getBuffer(position+size,true);
+	uint8_t* ret=bytes+position;
+	position+=size;
+	return ret;
+}
 
-		writeByte(b);
-	}
+const uint8_t* ByteArray::consumeBytes(uint32_t size)
+{
+	if(position>len || len-position<size)
+		return NULL;
+	const uint8_t* ret=bytes+position;
+	position+=size;
+	return ret;
 }
 
 void ByteArray::serializeDouble(number_t val)
 {
 	//We have to write the double in network byte order (big endian)
-	const uint64_t* tmpPtr=reinterpret_cast<const uint64_t*>(&val);
-	uint64_t bigEndianVal=GINT64_FROM_BE(*tmpPtr);
-	uint8_t* bigEndianPtr=reinterpret_cast<uint8_t*>(&bigEndianVal);
-		
-	for(uint32_t i=0;i<8;i++)
-		writeByte(bigEndianPtr[i]);
-	
+	uint64_t tmp;
+	memcpy(&tmp,&val,8);
+	uint64_t bigEndianVal=GUINT64_TO_BE(tmp);
+	memcpy(reserveBytes(8),&bigEndianVal,8);
 }
 
-void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
+void ByteArray::writeStringVR(unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
 {
 	const uint32_t len=s.numBytes();
 	if(len >= 1<<28)
@@ -1172,10 +1185,7 @@ void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_
 		//The first bit must be 1, the next 29 bits
 		//store the number of bytes of the string
 		writeU29((len<<1) | 1);
-
-		getBuffer(position+len,true);
-		memcpy(bytes+position,s.raw_buf(),len);
-		position+=len;
+		memcpy(reserveBytes(len),s.raw_buf(),len);
 	}
 }
 
@@ -1196,7 +1206,7 @@ void ByteArray::writeStringAMF0(const tiny_string& s)
 	}
 }
 
-void ByteArray::writeXMLString(std::map<const ASObject*, uint32_t>& objMap,
+void ByteArray::writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap,
 			       ASObject *xml,
 			       const tiny_string& xmlstr)
 {
@@ -1484,16 +1494,20 @@ ASFUNCTIONBODY(ByteArray,_toJSON)
 	return abstract_s(getSys(),"ByteArray");
 }
 
-void ByteArray::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ByteArray::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
 		LOG(LOG_NOT_IMPLEMENTED,"serializing ByteArray in AMF0 not implemented");
 		return;
 	}
-	assert_and_throw(objMap.find(this)==objMap.end());
+	//When a ByteArray is written into itself the marker may overwrite
+	//the data to be copied, and the copy may overlap the source
+	std::vector<uint8_t> snapshot;
+	if (out == this && objMap.find(this) == objMap.end() && len)
+		snapshot.assign(bytes, bytes+len);
 	out->writeByte(byte_array_marker);
 	//Check if the bytearray has been already serialized
 	auto it=objMap.find(this);
@@ -1507,11 +1521,15 @@ void ByteArray::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& strin
 		//Add the dictionary to the map
 		objMap.insert(make_pair(this, objMap.size()));
 
-		assert_and_throw(len<0x20000000);
-		uint32_t value = (len << 1) | 1;
+		const uint32_t count = len;
+		assert_and_throw(count<0x20000000);
+		uint32_t value = (count << 1) | 1;
 		out->writeU29(value);
-		// TODO faster implementation
-		for (unsigned int i = 0; i < len; i++)
-			out->writeByte(this->bytes[i]);
+		if (count)
+		{
+			//Reserve first, out may be this ByteArray
+			uint8_t* dst = out->reserveBytes(count);
+			memcpy(dst,snapshot.empty() ? bytes : &snapshot[0],count);
+		}
 	}
 }
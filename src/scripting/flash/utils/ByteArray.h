@@ -62,10 +62,19 @@ public:
 	void writeUnsignedInt(uint32_t val);
 	void writeUTF(const tiny_string& str);
 	uint32_t writeObject(ASObject* obj);
-	void writeStringVR(std::map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
+	void writeStringVR(std::unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
 	void writeStringAMF0(const tiny_string& s);
-	void writeXMLString(std::map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
+	void writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
 	void writeU29(uint32_t val);
+	/*
+	 * Grow the buffer by size bytes at the current position and move past them.
+	 * The returned pointer must be filled before any other write
+	 */
+	uint8_t* reserveBytes(uint32_t size);
+	/*
+	 * Return the next size bytes and move past them, or NULL if less are available
+	 */
+	const uint8_t* consumeBytes(uint32_t size);
 
 	void serializeDouble(number_t val);
 
@@ -165,9 +174,9 @@ public:
 	void setVariableByMultiname_i(const multiname& name, int32_t value);
 	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
 
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 }
@@ -25,12 +25,16 @@
 #include "scripting/argconv.h"
 #include "scripting/flash/errors/flasherrors.h"
 #include "scripting/flash/utils/Dictionary.h"
+#include "scripting/toplevel/toplevel.h"
 
 using namespace std;
 using namespace lightspark;
 
+/* Minimum number of slots of a non empty table, must be a power of 2 */
+#define DICTIONARY_MIN_SIZE 8
+
 Dictionary::Dictionary(Class_base* c):ASObject(c),
-	data(std::less<dictType::key_type>(), reporter_allocator<dictType::value_type>(c->memoryAccount))
+	data(reporter_allocator<dictType::value_type>(c->memoryAccount)),used(0),filled(0)
 {
 }
 
@@ -58,16 +62,129 @@ ASFUNCTIONBODY(Dictionary,_toJSON)
 	return abstract_s(getSys(),"Dictionary");
 }
 
-Dictionary::dictType::iterator Dictionary::findKey(ASObject *o)
+static inline uint32_t hashPointer(const void* p)
+{
+	uint64_t h=(uintptr_t)p;
+	h^=h>>33;
+	h*=0xff51afd7ed558ccdULL;
+	h^=h>>33;
+	return h;
+}
+
+uint32_t Dictionary::hashKey(ASObject* key)
+{
+	/* The hash must be consistent with isEqualStrict, which is used to compare keys.
+	 * Most objects are compared by identity, the others are hashed on the data
+	 * used by their isEqual */
+	switch(key->getObjectType())
+	{
+		case T_NULL:
+		case T_UNDEFINED:
+		case T_QNAME:
+		case T_NAMESPACE:
+			return key->getObjectType();
+		case T_FUNCTION:
+			if(key->is<SyntheticFunction>())
+				return hashPointer(key->as<SyntheticFunction>()->mi);
+			if(key->is<Function>())
+				return hashPointer((const void*)key->as<Function>()->val);
+			break;
+		case T_OBJECT:
+			//These compare by their (mutable) value
+			if(key->is<XML>() || key->is<XMLList>() || key->is<Date>())
+				return T_OBJECT;
+			break;
+		default:
+			break;
+	}
+	return hashPointer(key);
+}
+
+int32_t Dictionary::findKey(ASObject* key, uint32_t hash) const
+{
+	if(data.empty())
+		return -1;
+	uint32_t mask=data.size()-1;
+	for(uint32_t i=hash&mask;;i=(i+1)&mask)
+	{
+		const dictEntry& e=data[i];
+		if(e.key==NULL)
+		{
+			//Deleted slots do not stop the probing
+			if(!e.deleted)
+				return -1;
+		}
+		else if(e.key==key || (e.hash==hash && e.key->isEqualStrict(key)))
+			return i;
+	}
+}
+
+void Dictionary::rehash(uint32_t newSize)
 {
-	Dictionary::dictType::iterator it = data.begin();
-	for(; it!=data.end(); ++it)
+	dictType oldData(data.get_allocator());
+	oldData.swap(data);
+	dictEntry empty={NULL, NULL, 0, false};
+	data.resize(newSize, empty);
+	filled=used;
+	uint32_t mask=newSize-1;
+	for(auto it=oldData.begin();it!=oldData.end();++it)
 	{
-		if (it->first->isEqualStrict(o))
-			return it;
+		if(it->key==NULL)
+			continue;
+		uint32_t i=it->hash&mask;
+		while(data[i].key!=NULL)
+			i=(i+1)&mask;
+		data[i]=*it;
 	}
+}
 
-	return data.end();
+void Dictionary::insertKey(ASObject* key, ASObject* value)
+{
+	uint32_t hash=hashKey(key);
+	int32_t index=findKey(key, hash);
+	if(index>=0)
+	{
+		data[index].value->decRef();
+		data[index].value=value;
+		key->decRef();
+		return;
+	}
+	//Keep the load factor (including deleted slots) below 3/4
+	if((filled+1)*4>data.size()*3)
+	{
+		uint32_t newSize=DICTIONARY_MIN_SIZE;
+		while(newSize*3<=(used+1)*4*2)
+			newSize*=2;
+		rehash(newSize);
+	}
+	uint32_t mask=data.size()-1;
+	uint32_t i=hash&mask;
+	while(data[i].key!=NULL)
+		i=(i+1)&mask;
+	if(!data[i].deleted)
+		filled++;
+	used++;
+	dictEntry& e=data[i];
+	e.key=key;
+	e.value=value;
+	e.hash=hash;
+	e.deleted=false;
+}
+
+void Dictionary::clearData()
+{
+	dictType oldData(data.get_allocator());
+	oldData.swap(data);
+	used=0;
+	filled=0;
+	//Releasing the keys may cause reentrant accesses to this dictionary
+	for(auto it=oldData.begin();it!=oldData.end();++it)
+	{
+		if(it->key==NULL)
+			continue;
+		it->key->decRef();
+		it->value->decRef();
+	}
 }
 
 void Dictionary::setVariableByMultiname_i(const multiname& name, int32_t value)
@@ -110,13 +227,7 @@ void Dictionary::setVariableByMultiname(const multiname& name, ASObject* o, CONS
 				break;
 		}
 		name.name_o->incRef();
-		_R<ASObject> name_o(name.name_o);
-
-		Dictionary::dictType::iterator it=findKey(name_o.getPtr());
-		if(it!=data.end())
-			it->second=_MR(o);
-		else
-			data.insert(make_pair(name_o,_MR(o)));
+		insertKey(name.name_o, o);
 	}
 	else
 	{
@@ -160,13 +271,19 @@ bool Dictionary::deleteVariableByMultiname(const multiname& name)
 			default:
 				break;
 		}
-		name.name_o->incRef();
-		_R<ASObject> name_o(name.name_o);
-
-		Dictionary::dictType::iterator it=findKey(name_o.getPtr());
-		if(it != data.end())
+		int32_t index=findKey(name.name_o, hashKey(name.name_o));
+		if(index>=0)
 		{
-			data.erase(it);
+			//Keep the slot as deleted, so that enumeration indexes do not change
+			dictEntry& e=data[index];
+			ASObject* key=e.key;
+			ASObject* value=e.value;
+			e.key=NULL;
+			e.value=NULL;
+			e.deleted=true;
+			used--;
+			key->decRef();
+			value->decRef();
 			return true;
 		}
 		return false;
@@ -213,12 +330,12 @@ _NR<ASObject> Dictionary::getVariableByMultiname(const multiname& name, GET_VARI
 				default:
 					break;
 			}
-			name.name_o->incRef();
-			_R<ASObject> name_o(name.name_o);
-
-			Dictionary::dictType::iterator it=findKey(name_o.getPtr());
-			if(it != data.end())
-				return it->second;
+			int32_t index=findKey(name.name_o, hashKey(name.name_o));
+			if(index>=0)
+			{
+				data[index].value->incRef();
+				return _MNR(data[index].value);
+			}
 			else
 				return NullRef;
 		}
@@ -275,11 +392,7 @@ bool Dictionary::hasPropertyByMultiname(const multiname& name, bool considerDyna
 				break;
 		}
 
-		name.name_o->incRef();
-		_R<ASObject> name_o(name.name_o);
-
-		Dictionary::dictType::iterator it=findKey(name_o.getPtr());
-		return it != data.end();
+		return findKey(name.name_o, hashKey(name.name_o))>=0;
 	}
 	else
 	{
@@ -296,18 +409,18 @@ bool Dictionary::hasPropertyByMultiname(const multiname& name, bool considerDyna
 uint32_t Dictionary::nextNameIndex(uint32_t cur_index)
 {
 	assert_and_throw(implEnable);
-	if(cur_index<data.size())
-		return cur_index+1;
-	else
+	//Indexes from 1 to data.size() are the slots of the table, empty slots are skipped
+	for(uint32_t i=cur_index;i<data.size();i++)
 	{
-		//Fall back on object properties
-		uint32_t ret=ASObject::nextNameIndex(cur_index-data.size());
-		if(ret==0)
-			return 0;
-		else
-			return ret+data.size();
-
+		if(data[i].key!=NULL)
+			return i+1;
 	}
+	//Fall back on object properties
+	uint32_t ret=ASObject::nextNameIndex(cur_index<data.size() ? 0 : cur_index-data.size());
+	if(ret==0)
+		return 0;
+	else
+		return ret+data.size();
 }
 
 _R<ASObject> Dictionary::nextName(uint32_t index)
@@ -315,11 +428,10 @@ _R<ASObject> Dictionary::nextName(uint32_t index)
 	assert_and_throw(implEnable);
 	if(index<=data.size())
 	{
-		map<_R<ASObject>,_R<ASObject> >::iterator it=data.begin();
-		for(unsigned int i=1;i<index;i++)
-			++it;
-
-		return it->first;
+		ASObject* key=data[index-1].key;
+		assert_and_throw(key);
+		key->incRef();
+		return _MR(key);
 	}
 	else
 	{
@@ -333,11 +445,10 @@ _R<ASObject> Dictionary::nextValue(uint32_t index)
 	assert_and_throw(implEnable);
 	if(index<=data.size())
 	{
-		map<_R<ASObject>,_R<ASObject> >::iterator it=data.begin();
-		for(unsigned int i=1;i<index;i++)
-			++it;
-
-		return it->second;
+		ASObject* value=data[index-1].value;
+		assert_and_throw(value);
+		value->incRef();
+		return _MR(value);
 	}
 	else
 	{
@@ -350,13 +461,15 @@ tiny_string Dictionary::toString()
 {
 	std::stringstream retstr;
 	retstr << "{";
-	map<_R<ASObject>,_R<ASObject> >::iterator it=data.begin();
-	while(it != data.end())
+	bool first=true;
+	for(auto it=data.begin();it!=data.end();++it)
 	{
-		if(it != data.begin())
+		if(it->key==NULL)
+			continue;
+		if(!first)
 			retstr << ", ";
-		retstr << "{" << it->first->toString() << ", " << it->second->toString() << "}";
-		++it;
+		first=false;
+		retstr << "{" << it->key->toString() << ", " << it->value->toString() << "}";
 	}
 	retstr << "}";
 
@@ -364,9 +477,9 @@ tiny_string Dictionary::toString()
 }
 
 
-void Dictionary::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Dictionary::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -388,11 +501,9 @@ void Dictionary::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stri
 		objMap.insert(make_pair(this, objMap.size()));
 
 		uint32_t count = 0;
-		uint32_t tmp;
-		while ((tmp = nextNameIndex(count)) != 0)
-		{
-			count = tmp;
-		}
+		uint32_t tmp = 0;
+		while ((tmp = nextNameIndex(tmp)) != 0)
+			count++;
 		assert_and_throw(count<0x20000000);
 		uint32_t value = (count << 1) | 1;
 		out->writeU29(value);
@@ -31,15 +31,33 @@ class Dictionary: public ASObject
 {
 friend class ABCVm;
 private:
-	typedef std::map<_R<ASObject>,_R<ASObject>,std::less<_R<ASObject>>,
-	       reporter_allocator<std::pair<const _R<ASObject>, _R<ASObject>>>> dictType;
+	/* Object keys are stored in an open addressing hash table with linear
+	 * probing. Primitive keys are stored as normal dynamic properties */
+	struct dictEntry
+	{
+		//NULL for empty and deleted slots
+		ASObject* key;
+		ASObject* value;
+		uint32_t hash;
+		bool deleted;
+	};
+	typedef std::vector<dictEntry, reporter_allocator<dictEntry>> dictType;
 	dictType data;
-	dictType::iterator findKey(ASObject *);
+	//Number of live keys
+	uint32_t used;
+	//Number of live keys and deleted slots, used to trigger a rehash
+	uint32_t filled;
+	static uint32_t hashKey(ASObject* key);
+	//Returns the slot of the key or -1
+	int32_t findKey(ASObject* key, uint32_t hash) const;
+	void insertKey(ASObject* key, ASObject* value);
+	void rehash(uint32_t newSize);
+	void clearData();
 public:
 	Dictionary(Class_base* c);
 	bool destruct()
 	{
-		data.clear();
+		clearData();
 		return ASObject::destruct();
 	}
 	
@@ -63,9 +81,9 @@ public:
 	_R<ASObject> nextName(uint32_t index);
 	_R<ASObject> nextValue(uint32_t index);
 
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 }
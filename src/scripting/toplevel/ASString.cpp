@@ -167,36 +167,23 @@ ASFUNCTIONBODY(ASString,search)
 		restr = args[0]->toString();
 	}
 
-	const char* error;
-	int errorOffset;
-	pcre* pcreRE=pcre_compile(restr.raw_buf(), options, &error, &errorOffset,NULL);
-	if(error)
+	_NR<CompiledRegExp> pcreRE=CompiledRegExp::get(restr, options);
+	if(pcreRE.isNull())
 		return abstract_i(obj->getSystemState(),ret);
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return abstract_i(obj->getSystemState(),ret);
-	}
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	int capturingGroups=pcreRE->capturingGroups;
 	int ovector[(capturingGroups+1)*3];
 	int offset=0;
 	//Global is not used in search
-	int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc=pcreRE->exec(data, offset, true, ovector, (capturingGroups+1)*3);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		return abstract_i(obj->getSystemState(),ret);
 	}
 	ret=ovector[0];
 	// pcre_exec returns byte position, so we have to convert it to character position 
 	tiny_string tmp = data.substr_bytes(0, ret);
 	ret = tmp.numChars();
-	pcre_free(pcreRE);
 	return abstract_i(obj->getSystemState(),ret);
 }
 
@@ -306,19 +293,10 @@ ASFUNCTIONBODY(ASString,split)
 			return ret;
 		}
 
-		pcre* pcreRE = re->compile();
-		if (!pcreRE)
-			return ret;
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
+		_NR<CompiledRegExp> pcreRE = re->compile();
+		if (pcreRE.isNull())
 			return ret;
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		int capturingGroups=pcreRE->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
 		int offset=0;
 		unsigned int end;
@@ -326,7 +304,7 @@ ASFUNCTIONBODY(ASString,split)
 		do
 		{
 			//offset is a byte offset that must point to the beginning of an utf8 character
-			int rc=pcre_exec(pcreRE, &extra, data.raw_buf(), data.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+			int rc=pcreRE->exec(data, offset, true, ovector, (capturingGroups+1)*3);
 			end=ovector[0];
 			if(rc<0)
 				break;
@@ -358,7 +336,6 @@ ASFUNCTIONBODY(ASString,split)
 			ASString* s=abstract_s(obj->getSystemState(),data.substr_bytes(lastMatch,data.numBytes()-lastMatch));
 			ret->push(_MR(s));
 		}
-		pcre_free(pcreRE);
 	}
 	else
 	{
@@ -593,9 +570,9 @@ TRISTATE ASString::isLess(ASObject* r)
 	return (a<b)?TTRUE:TFALSE;
 }
 
-void ASString::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ASString::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -795,20 +772,11 @@ ASFUNCTIONBODY(ASString,replace)
 	{
 		RegExp* re=static_cast<RegExp*>(args[0]);
 
-		pcre* pcreRE = re->compile();
-		if (!pcreRE)
+		_NR<CompiledRegExp> pcreRE = re->compile();
+		if (pcreRE.isNull())
 			return ret;
 
-		int capturingGroups;
-		int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-		if(infoOk!=0)
-		{
-			pcre_free(pcreRE);
-			return ret;
-		}
-		pcre_extra extra;
-		extra.match_limit_recursion=200;
-		extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+		int capturingGroups=pcreRE->capturingGroups;
 		int ovector[(capturingGroups+1)*3];
 		int offset=0;
 		int retDiff=0;
@@ -816,11 +784,10 @@ ASFUNCTIONBODY(ASString,replace)
 		do
 		{
 			tiny_string replaceWithTmp = replaceWith;
-			int rc=pcre_exec(pcreRE, &extra, ret->getData().raw_buf(), ret->getData().numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+			int rc=pcreRE->exec(ret->getData(), offset, true, ovector, (capturingGroups+1)*3);
 			if(rc<0)
 			{
 				//No matches or error
-				pcre_free(pcreRE);
 				return ret;
 			}
 			prevsubstring += ret->getData().substr_bytes(offset,ovector[0]-offset);
@@ -890,8 +857,6 @@ ASFUNCTIONBODY(ASString,replace)
 			retDiff+=replaceWithTmp.numBytes()-(ovector[1]-ovector[0]);
 		}
 		while(re->global);
-
-		pcre_free(pcreRE);
 	}
 	else
 	{
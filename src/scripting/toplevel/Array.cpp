@@ -29,10 +29,92 @@ using namespace std;
 using namespace lightspark;
 
 Array::Array(Class_base* c):ASObject(c,T_ARRAY),currentsize(0),
-	data(std::less<uint32_t>(), reporter_allocator<std::pair<uint32_t, data_slot>>(c->memoryAccount)),currentpos(0)
+	data_first(reporter_allocator<data_slot>(c->memoryAccount)),
+	data_second(std::less<uint32_t>(), reporter_allocator<std::pair<uint32_t, data_slot>>(c->memoryAccount)),currentpos(0)
 {
 }
 
+data_slot* Array::findNextSlot(uint32_t& index)
+{
+	if(index<data_first.size())
+		return &data_first[index];
+	auto it=data_second.lower_bound(index);
+	if(it==data_second.end())
+		return NULL;
+	index=it->first;
+	return &it->second;
+}
+
+void Array::setSlot(uint32_t index, const data_slot& ds)
+{
+	if(index<data_first.size())
+		data_first[index]=ds;
+	else if(index==data_first.size())
+	{
+		data_first.push_back(ds);
+		if(data_second.empty())
+			return;
+		//The hole has been filled, move the following elements out of the sparse map
+		auto it=data_second.begin();
+		for(;it!=data_second.end() && it->first==data_first.size();++it)
+			data_first.push_back(it->second);
+		data_second.erase(data_second.begin(),it);
+		currentpos=0;
+	}
+	else
+		data_second[index]=ds;
+}
+
+void Array::eraseSlot(uint32_t index)
+{
+	if(index+1==data_first.size())
+		data_first.pop_back();
+	else if(index<data_first.size())
+	{
+		//A hole appears, the following elements become sparse. They all
+		//come before the elements already in the map.
+		arrayType newSecond(data_second.get_allocator());
+		newSecond.reserve(data_first.size()-index-1+data_second.size());
+		for(uint32_t i=index+1;i<data_first.size();i++)
+			newSecond.insert(newSecond.end(), make_pair(i, data_first[i]));
+		for(auto it=data_second.begin();it!=data_second.end();++it)
+			newSecond.insert(newSecond.end(), *it);
+		data_second.swap(newSecond);
+		data_first.erase(data_first.begin()+index, data_first.end());
+	}
+	else
+	{
+		auto it=data_second.find(index);
+		if(it!=data_second.end())
+			data_second.erase(it);
+	}
+	currentpos=0;
+}
+
+void Array::clearSlots()
+{
+	data_first.clear();
+	data_second.clear();
+	currentpos=0;
+}
+
+void Array::moveSlots(uint32_t index, int32_t delta)
+{
+	std::vector<std::pair<uint32_t,data_slot>> moved;
+	for(uint32_t i=index;i<data_first.size();i++)
+		moved.push_back(make_pair(i, data_first[i]));
+	auto it=data_second.lower_bound(index);
+	moved.insert(moved.end(), it, data_second.end());
+	//Everything before keep stays where it is
+	uint32_t keep=delta<0 ? index+delta : index;
+	if(keep<data_first.size())
+		data_first.erase(data_first.begin()+keep, data_first.end());
+	data_second.erase(data_second.lower_bound(keep), data_second.end());
+	for(auto m=moved.begin();m!=moved.end();++m)
+		setSlot(m->first+delta, m->second);
+	currentpos=0;
+}
+
 void Array::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_DYNAMIC_NOT_FINAL);
@@ -141,12 +223,14 @@ ASFUNCTIONBODY(Array,_concat)
 	
 	// copy values into new array
 	ret->resize(th->size());
-	auto it=th->data.begin();
-	for(;it != th->data.end();++it)
+	ret->data_first.reserve(th->data_first.size());
+	uint32_t index=0;
+	while(data_slot* sl=th->findNextSlot(index))
 	{
-		ret->data[it->first]=it->second;
-		if(ret->data[it->first].type==DATA_OBJECT && ret->data[it->first].data)
-			ret->data[it->first].data->incRef();
+		ret->setSlot(index,*sl);
+		if(sl->type==DATA_OBJECT && sl->data)
+			sl->data->incRef();
+		index++;
 	}
 
 	for(unsigned int i=0;i<argslen;i++)
@@ -156,13 +240,13 @@ ASFUNCTIONBODY(Array,_concat)
 			// Insert the contents of the array argument
 			uint64_t oldSize=ret->size();
 			Array* otherArray=args[i]->as<Array>();
-			auto itother=otherArray->data.begin();
-			for(;itother!=otherArray->data.end(); ++itother)
+			uint32_t otherIndex=0;
+			while(data_slot* sl=otherArray->findNextSlot(otherIndex))
 			{
-				uint32_t newIndex=ret->size()+itother->first;
-				ret->data[newIndex]=itother->second;
-				if(ret->data[newIndex].type==DATA_OBJECT && ret->data[newIndex].data)
-					ret->data[newIndex].data->incRef();
+				ret->setSlot(oldSize+otherIndex,*sl);
+				if(sl->type==DATA_OBJECT && sl->data)
+					sl->data->incRef();
+				otherIndex++;
 			}
 			ret->resize(oldSize+otherArray->size());
 		}
@@ -189,16 +273,18 @@ ASFUNCTIONBODY(Array,filter)
 	ASObject* params[3];
 	ASObject *funcRet;
 
-	for(auto it=th->data.begin();it != th->data.end();++it)
+	uint32_t index=0;
+	//The callback may modify the array, so the slot is looked up at every iteration
+	for(data_slot* sl=th->findNextSlot(index);sl;sl=th->findNextSlot(++index))
 	{
-		if (it->second.type==DATA_OBJECT)
+		if (sl->type==DATA_OBJECT)
 		{
-			params[0] = it->second.data;
-			it->second.data->incRef();
+			params[0] = sl->data;
+			sl->data->incRef();
 		}
 		else
-			params[0] =abstract_di(obj->getSystemState(),it->second.data_i);
-		params[1] = abstract_i(obj->getSystemState(),it->first);
+			params[0] =abstract_di(obj->getSystemState(),sl->data_i);
+		params[1] = abstract_i(obj->getSystemState(),index);
 		params[2] = th;
 		th->incRef();
 
@@ -237,17 +323,17 @@ ASFUNCTIONBODY(Array, some)
 	ASObject* params[3];
 	ASObject *funcRet;
 
-	auto it=th->data.begin();
-	for(;it != th->data.end();++it)
+	uint32_t index=0;
+	for(data_slot* sl=th->findNextSlot(index);sl;sl=th->findNextSlot(++index))
 	{
-		if (it->second.type==DATA_OBJECT)
+		if (sl->type==DATA_OBJECT)
 		{
-			params[0] = it->second.data;
-			it->second.data->incRef();
+			params[0] = sl->data;
+			sl->data->incRef();
 		}
 		else
-			params[0] =abstract_di(obj->getSystemState(),it->second.data_i);
-		params[1] = abstract_i(obj->getSystemState(),it->first);
+			params[0] =abstract_di(obj->getSystemState(),sl->data_i);
+		params[1] = abstract_i(obj->getSystemState(),index);
 		params[2] = th;
 		th->incRef();
 
@@ -283,17 +369,17 @@ ASFUNCTIONBODY(Array, every)
 	ASObject* params[3];
 	ASObject *funcRet;
 
-	auto it=th->data.begin();
-	for(;it != th->data.end();++it)
+	uint32_t index=0;
+	for(data_slot* sl=th->findNextSlot(index);sl;sl=th->findNextSlot(++index))
 	{
-		if (it->second.type==DATA_OBJECT)
+		if (sl->type==DATA_OBJECT)
 		{
-			params[0] = it->second.data;
-			it->second.data->incRef();
+			params[0] = sl->data;
+			sl->data->incRef();
 		}
 		else
-			params[0] =abstract_di(obj->getSystemState(),it->second.data_i);
-		params[1] = abstract_i(obj->getSystemState(),it->first);
+			params[0] =abstract_di(obj->getSystemState(),sl->data_i);
+		params[1] = abstract_i(obj->getSystemState(),index);
 		params[2] = th;
 		th->incRef();
 
@@ -351,14 +437,14 @@ ASFUNCTIONBODY(Array,forEach)
 	uint32_t s = th->size();
 	for (uint32_t i=0; i < s; i++ )
 	{
-		auto it = th->data.find(i);
-		if (it != th->data.end())
+		data_slot* sl = th->findSlot(i);
+		if (sl)
 		{
-			if(it->second.type==DATA_INT)
-				params[0]=abstract_i(obj->getSystemState(),it->second.data_i);
-			else if(it->second.type==DATA_OBJECT && it->second.data)
+			if(sl->type==DATA_INT)
+				params[0]=abstract_i(obj->getSystemState(),sl->data_i);
+			else if(sl->type==DATA_OBJECT && sl->data)
 			{
-				params[0]=it->second.data;
+				params[0]=sl->data;
 				params[0]->incRef();
 			}
 			else
@@ -391,13 +477,19 @@ ASFUNCTIONBODY(Array, _reverse)
 {
 	Array* th = static_cast<Array*>(obj);
 
-	std::map<uint32_t, data_slot> tmp = std::map<uint32_t, data_slot>(th->data.begin(),th->data.end());
 	uint32_t size = th->size();
-	th->data.clear();
-	auto it=tmp.begin();
-	for(;it != tmp.end();++it)
- 	{
-		th->data[size-(it->first+1)]=it->second;
+	if(th->data_second.empty() && th->data_first.size()==size)
+		std::reverse(th->data_first.begin(),th->data_first.end());
+	else
+	{
+		std::vector<std::pair<uint32_t,data_slot>> tmp(th->data_first.size());
+		for(uint32_t i=0;i<th->data_first.size();i++)
+			tmp[i]=make_pair(i,th->data_first[i]);
+		tmp.insert(tmp.end(),th->data_second.begin(),th->data_second.end());
+		th->clearSlots();
+		//Insert in increasing order of the new indexes
+		for(auto it=tmp.rbegin();it != tmp.rend();++it)
+			th->setSlot(size-(it->first+1),it->second);
 	}
 	th->incRef();
 	th->currentpos = 0;
@@ -412,7 +504,7 @@ ASFUNCTIONBODY(Array,lastIndexOf)
 	ARG_UNPACK(arg0) (index, 0x7fffffff);
 	int ret=-1;
 
-	if(argslen == 1 && th->data.empty())
+	if(argslen == 1 && th->slotCount()==0)
 		return abstract_di(obj->getSystemState(),-1);
 
 	size_t i = th->size()-1;
@@ -437,13 +529,13 @@ ASFUNCTIONBODY(Array,lastIndexOf)
 	}
 	do
 	{
-		auto it = th->data.find(i);
-		if (it == th->data.end())
+		data_slot* sl = th->findSlot(i);
+		if (!sl)
 		    continue;
-		DATA_TYPE dtype = it->second.type;
+		DATA_TYPE dtype = sl->type;
 		assert_and_throw(dtype==DATA_OBJECT || dtype==DATA_INT);
-		if((dtype == DATA_OBJECT && it->second.data->isEqualStrict(arg0.getPtr())) ||
-			(dtype == DATA_INT && arg0->toInt() == it->second.data_i))
+		if((dtype == DATA_OBJECT && sl->data->isEqualStrict(arg0.getPtr())) ||
+			(dtype == DATA_INT && arg0->toInt() == sl->data_i))
 		{
 			ret=i;
 			break;
@@ -480,27 +572,18 @@ ASFUNCTIONBODY(Array,shift)
 	if(!th->size())
 		return obj->getSystemState()->getUndefinedRef();
 	ASObject* ret;
-	auto it = th->data.find(0);
-	if(it == th->data.end())
+	data_slot* sl = th->findSlot(0);
+	if(!sl)
 		ret = obj->getSystemState()->getUndefinedRef();
 	else
 	{
-		if(it->second.type==DATA_OBJECT)
-			ret=it->second.data;
+		if(sl->type==DATA_OBJECT)
+			ret=sl->data;
 		else
-			ret = abstract_i(obj->getSystemState(),it->second.data_i);
+			ret = abstract_i(obj->getSystemState(),sl->data_i);
 	}
-	std::map<uint32_t,data_slot> tmp;
-	it=th->data.begin();
-	for (; it != th->data.end(); ++it )
-	{
-		if(it->first)
-		{
-			tmp[it->first-1]=it->second;
-		}
-	}
-	th->data.clear();
-	th->data.insert(tmp.begin(),tmp.end());
+	//The first element is dropped, its reference is returned
+	th->moveSlots(1,-1);
 	th->resize(th->size()-1);
 	th->currentpos = 0;
 	return ret;
@@ -539,12 +622,12 @@ ASFUNCTIONBODY(Array,slice)
 	int j = 0;
 	for(int i=startIndex; i<endIndex; i++) 
 	{
-		auto it = th->data.find(i);
-		if (it != th->data.end())
+		data_slot* sl = th->findSlot(i);
+		if (sl)
 		{
-			if(it->second.type == DATA_OBJECT)
-				it->second.data->incRef();
-			ret->data[j]=it->second;
+			if(sl->type == DATA_OBJECT)
+				sl->data->incRef();
+			ret->setSlot(j,*sl);
 		}
 		j++;
 	}
@@ -566,56 +649,47 @@ ASFUNCTIONBODY(Array,splice)
 
 	startIndex=th->capIndex(startIndex);
 
+	if(deleteCount<0)
+		deleteCount=0;
 	if((startIndex+deleteCount)>totalSize)
 		deleteCount=totalSize-startIndex;
 
+	int insertCount=(argslen > 2 ? argslen-2 : 0);
+	// Derived classes may be sealed!
+	if (insertCount && th->getClass() && th->getClass()->isSealed)
+		throwError<ReferenceError>(kWriteSealedError,"splice",th->getClass()->getQualifiedClassName());
+
 	ret->resize(deleteCount);
-	if(deleteCount)
-	{
-		// write deleted items to return array
-		for(int i=0;i<deleteCount;i++)
-		{
-			auto it = th->data.find(startIndex+i);
-			if (it != th->data.end())
-				ret->data[i] = it->second;
-		}
-		// delete items from current array
-		for (int i = 0; i < deleteCount; i++)
-		{
-			auto it = th->data.find(startIndex+i);
-			if (it != th->data.end())
-			{
-				th->data.erase(it);
-			}
-		}
-	}
-	// remember items in current array that have to be moved to new position
-	vector<data_slot> tmp = vector<data_slot>(totalSize- (startIndex+deleteCount));
-	for (int i = startIndex+deleteCount; i < totalSize ; i++)
+	// move deleted items to return array
+	for(int i=0;i<deleteCount;i++)
 	{
-		auto it = th->data.find(i);
-		if (it != th->data.end())
-		{
-			tmp[i-(startIndex+deleteCount)] = it->second;
-			th->data.erase(it);
-		}
+		data_slot* sl = th->findSlot(startIndex+i);
+		if (sl)
+			ret->setSlot(i,*sl);
 	}
-	th->resize(startIndex);
+	// move the following items to their new position, this drops the deleted items
+	// that are not going to be overwritten by the inserted values
+	th->moveSlots(startIndex+deleteCount,insertCount-deleteCount);
 
-	
 	//Insert requested values starting at startIndex
-	for(unsigned int i=2;i<argslen;i++)
-	{
-		args[i]->incRef();
-		th->push(_MR(args[i]));
-	}
-	// move remembered items to new position
-	for(int i=0;i<totalSize- (startIndex+deleteCount);i++)
+	for(int i=0;i<insertCount;i++)
 	{
-		if (tmp[i].type != DATA_OBJECT || tmp[i].data != NULL)
-			th->data[startIndex+i+(argslen > 2 ? argslen-2 : 0)] = tmp[i];
+		ASObject* o=args[i+2];
+		data_slot ds;
+		if(o->getObjectType()==T_INTEGER)
+		{
+			ds.data_i=o->as<Integer>()->val;
+			ds.type=DATA_INT;
+		}
+		else
+		{
+			o->incRef();
+			ds.data=o;
+			ds.type=DATA_OBJECT;
+		}
+		th->setSlot(startIndex+i,ds);
 	}
-	th->resize((totalSize-deleteCount)+(argslen > 2 ? argslen-2 : 0));
+	th->currentsize=(totalSize-deleteCount)+insertCount;
 	th->currentpos = 0;
 	return ret;
 }
@@ -627,12 +701,18 @@ ASFUNCTIONBODY(Array,join)
 	tiny_string del;
 	ARG_UNPACK(del, ",");
 
-	for(uint32_t i=0;i<th->size();i++)
+	uint32_t size=th->size();
+	for(uint32_t i=0;i<size;i++)
 	{
-		_R<ASObject> o = th->at(i);
-		if (!o->is<Undefined>() && !o->is<Null>())
-			ret+= o->toString().raw_buf();
-		if(i!=th->size()-1)
+		data_slot* sl = th->findSlot(i);
+		if (sl)
+		{
+			if(sl->type==DATA_INT)
+				ret+= Integer::toString(sl->data_i).raw_buf();
+			else if (sl->data && !sl->data->is<Undefined>() && !sl->data->is<Null>())
+				ret+= sl->data->toString().raw_buf();
+		}
+		if(i!=size-1)
 			ret+=del.raw_buf();
 	}
 	return abstract_s(obj->getSystemState(),ret);
@@ -649,17 +729,15 @@ ASFUNCTIONBODY(Array,indexOf)
 	if (index < 0) index = 0;
 
 	DATA_TYPE dtype;
-	for (auto it=th->data.begin() ; it != th->data.end(); ++it )
+	uint32_t i=index;
+	for (data_slot* sl=th->findNextSlot(i); sl; sl=th->findNextSlot(++i))
 	{
-		if (it->first < (uint32_t)index)
-			continue;
-		data_slot sl = it->second;
-		dtype = sl.type;
+		dtype = sl->type;
 		assert_and_throw(dtype==DATA_OBJECT || dtype==DATA_INT);
-		if((dtype == DATA_OBJECT && sl.data->isEqualStrict(arg0.getPtr())) ||
-			(dtype == DATA_INT && abstract_di(obj->getSystemState(),sl.data_i)->isEqualStrict(arg0.getPtr())))
+		if((dtype == DATA_OBJECT && sl->data->isEqualStrict(arg0.getPtr())) ||
+			(dtype == DATA_INT && abstract_di(obj->getSystemState(),sl->data_i)->isEqualStrict(arg0.getPtr())))
 		{
-			ret=it->first;
+			ret=i;
 			break;
 		}
 	}
@@ -695,14 +773,14 @@ ASFUNCTIONBODY(Array,_pop)
 		return obj->getSystemState()->getUndefinedRef();
 	ASObject* ret;
 	
-	auto it = th->data.find(size-1);
-	if (it != th->data.end())
+	data_slot* sl = th->findSlot(size-1);
+	if (sl)
 	{
-		if(it->second.type==DATA_OBJECT)
-			ret=it->second.data;
+		if(sl->type==DATA_OBJECT)
+			ret=sl->data;
 		else
-			ret = abstract_i(obj->getSystemState(),it->second.data_i);
-		th->data.erase(it);
+			ret = abstract_i(obj->getSystemState(),sl->data_i);
+		th->eraseSlot(size-1);
 	}
 	else
 		ret = obj->getSystemState()->getUndefinedRef();
@@ -801,6 +879,26 @@ bool Array::sortComparatorWrapper::operator()(const data_slot& d1, const data_sl
 	return (ret->toNumber()<0); //Less
 }
 
+void Array::getSortableSlots(std::vector<data_slot>& tmp)
+{
+	tmp.reserve(slotCount());
+	uint32_t index=0;
+	for(data_slot* sl=findNextSlot(index);sl;sl=findNextSlot(++index))
+	{
+		if (sl->type==DATA_OBJECT &&
+				(!sl->data || sl->data->is<Undefined>()))
+			continue;
+		tmp.push_back(*sl);
+	}
+}
+
+void Array::setSortedSlots(const std::vector<data_slot>& tmp)
+{
+	//The sorted elements are always dense
+	clearSlots();
+	data_first.assign(tmp.begin(),tmp.end());
+}
+
 ASFUNCTIONBODY(Array,_sort)
 {
 	Array* th=static_cast<Array*>(obj);
@@ -829,27 +927,30 @@ ASFUNCTIONBODY(Array,_sort)
 		}
 	}
 	std::vector<data_slot> tmp;
-	auto it=th->data.begin();
-	for(;it != th->data.end();++it)
-	{
-		if (it->second.type==DATA_OBJECT &&
-				(!it->second.data || it->second.data->is<Undefined>()))
-			continue;
-		tmp.push_back(it->second);
-	}
+	th->getSortableSlots(tmp);
 	
 	if(comp)
 		sort(tmp.begin(),tmp.end(),sortComparatorWrapper(comp));
+	else if(isNumeric && tmp.size()>1)
+	{
+		//Convert every value only once, instead of at every comparison
+		std::vector<std::pair<number_t,data_slot>> numbers(tmp.size());
+		for(uint32_t i=0;i<tmp.size();i++)
+		{
+			const data_slot& sl=tmp[i];
+			numbers[i].first=(sl.type==DATA_INT) ? sl.data_i : sl.data->toNumber();
+			numbers[i].second=sl;
+			if(std::isnan(numbers[i].first))
+				throw RunTimeException("Cannot sort non number with Array.NUMERIC option");
+		}
+		sort(numbers.begin(),numbers.end(),sortComparatorNumeric(isDescending));
+		for(uint32_t i=0;i<tmp.size();i++)
+			tmp[i]=numbers[i].second;
+	}
 	else
 		sort(tmp.begin(),tmp.end(),sortComparatorDefault(isNumeric,isCaseInsensitive,isDescending));
 
-	th->data.clear();
-	std::vector<data_slot>::iterator ittmp=tmp.begin();
-	int i = 0;
-	for(;ittmp != tmp.end();++ittmp)
-	{
-		th->data[i++]= *ittmp;
-	}
+	th->setSortedSlots(tmp);
 	obj->incRef();
 	th->currentpos = 0;
 	return obj;
@@ -922,14 +1023,14 @@ ASFUNCTIONBODY(Array,sortOn)
 	{
 		Array* obj=static_cast<Array*>(args[0]);
 		int n = 0;
-		auto it=obj->data.begin();
-		for(;it != obj->data.end();++it)
+		uint32_t index=0;
+		for(data_slot* sl=obj->findNextSlot(index);sl;sl=obj->findNextSlot(++index))
 		{
 			multiname sortfieldname(NULL);
 			sortfieldname.ns.push_back(nsNameAndKind(obj->getSystemState(),"",NAMESPACE));
-			if (it->second.type == DATA_OBJECT)
+			if (sl->type == DATA_OBJECT)
 			{
-				sortfieldname.setName(it->second.data);
+				sortfieldname.setName(sl->data);
 			}
 			sorton_field sf(sortfieldname);
 			sortfields.push_back(sf);
@@ -937,15 +1038,15 @@ ASFUNCTIONBODY(Array,sortOn)
 		if (argslen == 2 && args[1]->is<Array>())
 		{
 			Array* opts=static_cast<Array*>(args[1]);
-			auto itopt=opts->data.begin();
+			uint32_t optIndex=0;
 			int nopt = 0;
-			for(;itopt != opts->data.end() && nopt < n;++itopt)
+			for(data_slot* sl=opts->findNextSlot(optIndex);sl && nopt < n;sl=opts->findNextSlot(++optIndex))
 			{
 				uint32_t options=0;
-				if (itopt->second.type == DATA_OBJECT)
-					options = itopt->second.data->toInt();
+				if (sl->type == DATA_OBJECT)
+					options = sl->data->toInt();
 				else
-					options = itopt->second.data_i;
+					options = sl->data_i;
 				if(options&NUMERIC)
 					sortfields[nopt].isNumeric=true;
 				if(options&CASEINSENSITIVE)
@@ -980,24 +1081,11 @@ ASFUNCTIONBODY(Array,sortOn)
 	}
 	
 	std::vector<data_slot> tmp;
-	auto it=th->data.begin();
-	for(;it != th->data.end();++it)
-	{
-		if (it->second.type==DATA_OBJECT &&
-				(!it->second.data || it->second.data->is<Undefined>()))
-			continue;
-		tmp.push_back(it->second);
-	}
+	th->getSortableSlots(tmp);
 	
 	sort(tmp.begin(),tmp.end(),sortOnComparator(sortfields));
 
-	th->data.clear();
-	std::vector<data_slot>::iterator ittmp=tmp.begin();
-	int i = 0;
-	for(;ittmp != tmp.end();++ittmp)
-	{
-		th->data[i++]= *ittmp;
-	}
+	th->setSortedSlots(tmp);
 	obj->incRef();
 	th->currentpos = 0;
 	return obj;
@@ -1031,19 +1119,12 @@ ASFUNCTIONBODY(Array,unshift)
 	if (argslen > 0)
 	{
 		th->resize(th->size()+argslen);
-		std::map<uint32_t,data_slot> tmp;
-		for (auto it=th->data.rbegin(); it != th->data.rend(); ++it )
-		{
-			tmp[it->first+argslen]=it->second;
-		}
-		
+		th->moveSlots(0,argslen);
 		for(uint32_t i=0;i<argslen;i++)
 		{
-			tmp[i] = data_slot(args[i]);
+			th->setSlot(i,data_slot(args[i]));
 			args[i]->incRef();
 		}
-		th->data.clear();
-		th->data.insert(tmp.begin(),tmp.end());
 	}
 	th->currentpos = 0;
 	return abstract_i(obj->getSystemState(),th->size());
@@ -1132,14 +1213,14 @@ ASFUNCTIONBODY(Array,_map)
 	for (uint32_t i=0; i < s; i++ )
 	{
 		ASObject* funcArgs[3];
-		auto it = th->data.find(i);
-		if (it != th->data.end())
+		data_slot* sl = th->findSlot(i);
+		if (sl)
 		{
-			if(it->second.type==DATA_INT)
-				funcArgs[0]=abstract_i(obj->getSystemState(),it->second.data_i);
-			else if(it->second.type==DATA_OBJECT && it->second.data)
+			if(sl->type==DATA_INT)
+				funcArgs[0]=abstract_i(obj->getSystemState(),sl->data_i);
+			else if(sl->type==DATA_OBJECT && sl->data)
 			{
-				funcArgs[0]=it->second.data;
+				funcArgs[0]=sl->data;
 				funcArgs[0]->incRef();
 			}
 			else
@@ -1211,15 +1292,7 @@ ASFUNCTIONBODY(Array,insertAt)
 	}
 	else
 	{
-		std::map<uint32_t,data_slot> tmp;
-		auto it=th->data.begin();
-		for (; it != th->data.end(); ++it )
-		{
-			tmp[it->first+(it->first >= (uint32_t)index ? 1 : 0)]=it->second;
-		}
-		th->data.clear();
-		th->data.insert(tmp.begin(),tmp.end());
-		
+		th->moveSlots(index,1);
 		th->currentsize++;
 		th->set(index,o);
 	}
@@ -1237,35 +1310,24 @@ ASFUNCTIONBODY(Array,removeAt)
 	if (index < 0)
 		index = 0;
 	ASObject* o = NULL;
-	auto it = th->data.find(index);
-	if(it != th->data.end())
+	data_slot* sl = th->findSlot(index);
+	if(sl)
 	{
-		const data_slot& sl = it->second;
-		switch(sl.type)
+		switch(sl->type)
 		{
 			case DATA_OBJECT:
-				assert(sl.data!=NULL);
-				o = sl.data;
-				o->incRef();
+				assert(sl->data!=NULL);
+				o = sl->data;
 				break;
 			case DATA_INT:
-				o = abstract_i(th->getSystemState(),sl.data_i);
+				o = abstract_i(th->getSystemState(),sl->data_i);
 				break;
 		}
-		it->second.clear();
-		th->data.erase(it);
 	}
 	if (index < th->currentsize)
 		th->currentsize--;
-	std::map<uint32_t,data_slot> tmp;
-	it=th->data.begin();
-	for (; it != th->data.end(); ++it )
-	{
-		tmp[it->first-(it->first > (uint32_t)index ? 1 : 0)]=it->second;
-	}
-	th->data.clear();
-	th->data.insert(tmp.begin(),tmp.end());
-	th->currentpos =0;
+	//This also drops the removed element, its reference is returned
+	th->moveSlots(index+1,-1);
 	return o;
 }
 int32_t Array::getVariableByMultiname_i(const multiname& name)
@@ -1277,10 +1339,10 @@ int32_t Array::getVariableByMultiname_i(const multiname& name)
 
 	if(index<size())
 	{
-		auto it = data.find(index);
-		if (it == data.end())
+		const data_slot* it = findSlot(index);
+		if (it == NULL)
 			return 0;
-		const data_slot& sl = it->second;
+		const data_slot& sl = *it;
 		switch(sl.type)
 		{
 			case DATA_OBJECT:
@@ -1319,11 +1381,11 @@ _NR<ASObject> Array::getVariableByMultiname(const multiname& name, GET_VARIABLE_
 	uint32_t index=0;
 	if(!isValidMultiname(getSystemState(),name,index))
 		return ASObject::getVariableByMultiname(name,opt);
-	auto it = data.find(index);
-	if(it != data.end())
+	const data_slot* it = findSlot(index);
+	if(it != NULL)
 	{
 		ASObject* ret=NULL;
-		const data_slot& sl = it->second;
+		const data_slot& sl = *it;
 		switch(sl.type)
 		{
 			case DATA_OBJECT:
@@ -1370,13 +1432,13 @@ void Array::setVariableByMultiname_i(const multiname& name, int32_t value)
 		return;
 	if(index>=size())
 		resize(index+1);
-	auto it = data.find(index);
-	if(it != data.end())
-		it->second.clear();
+	data_slot* it = findSlot(index);
+	if(it != NULL)
+		it->clear();
 	data_slot ds;
 	ds.data_i=value;
 	ds.type=DATA_INT;
-	data[index] = ds;
+	setSlot(index,ds);
 	currentpos = 0;
 }
 
@@ -1392,7 +1454,7 @@ bool Array::hasPropertyByMultiname(const multiname& name, bool considerDynamic,
 	if(!isValidMultiname(getSystemState(),name,index))
 		return ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype);
 
-	return (data.find(index) != data.end());
+	return findSlot(index) != NULL;
 }
 
 bool Array::isValidMultiname(SystemState* sys, const multiname& name, uint32_t& index)
@@ -1462,9 +1524,9 @@ void Array::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALL
 		resize((uint64_t)index+1);
 
 	data_slot ds;
-	auto it = data.find(index);
-	if(it != data.end())
-		it->second.clear();
+	data_slot* it = findSlot(index);
+	if(it != NULL)
+		it->clear();
 
 	if(o->getObjectType()==T_INTEGER)
 	{
@@ -1478,7 +1540,7 @@ void Array::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALL
 		ds.data=o;
 		ds.type=DATA_OBJECT;
 	}
-	data[index] = ds;
+	setSlot(index,ds);
 	currentpos = 0;
 }
 
@@ -1493,12 +1555,11 @@ bool Array::deleteVariableByMultiname(const multiname& name)
 
 	if(index>=size())
 		return true;
-	auto it = data.find(index);
-	if(it == data.end())
+	data_slot* it = findSlot(index);
+	if(it == NULL)
 		return true;
-	it->second.clear();
-	data.erase(it);
-	currentpos = 0;
+	it->clear();
+	eraseSlot(index);
 	return true;
 }
 
@@ -1530,12 +1591,13 @@ tiny_string Array::toString()
 tiny_string Array::toString_priv(bool localized)
 {
 	string ret;
-	for(uint32_t i=0;i<size();i++)
+	uint32_t size=this->size();
+	for(uint32_t i=0;i<size;i++)
 	{
-		auto it = data.find(i);
-		if(it != data.end())
+		const data_slot* it = findSlot(i);
+		if(it != NULL)
 		{
-			const data_slot& sl = it->second;
+			const data_slot& sl = *it;
 			if(sl.type==DATA_OBJECT)
 			{
 				if(sl.data && !sl.data->is<Undefined>() && !sl.data->is<Null>())
@@ -1555,7 +1617,7 @@ tiny_string Array::toString_priv(bool localized)
 			else
 				throw UnsupportedException("Array::toString not completely implemented");
 		}
-		if(i!=size()-1)
+		if(i!=size-1)
 			ret+=',';
 	}
 	return ret;
@@ -1567,15 +1629,23 @@ _R<ASObject> Array::nextValue(uint32_t index)
 	if(index<=size())
 	{
 		--index;
-		data_iterator it;
-		if (currentpos < data.size() && (data.begin()+currentpos)->first == index-1)
-			it = data.begin()+currentpos+1;
+		const data_slot* slot;
+		if(index<data_first.size())
+			slot = &data_first[index];
 		else
-			it = data.find(index);
-		if(it == data.end() || it->first != index)
-			return _MR(getSystemState()->getUndefinedRef());
-		currentpos = it-data.begin();
-		const data_slot& sl = it->second;
+		{
+			//Enumerating the sparse elements in order does not need a lookup
+			data_iterator it;
+			if (currentpos+1 < data_second.size() && (data_second.begin()+currentpos+1)->first == index)
+				it = data_second.begin()+currentpos+1;
+			else
+				it = data_second.find(index);
+			if(it == data_second.end() || it->first != index)
+				return _MR(getSystemState()->getUndefinedRef());
+			currentpos = it-data_second.begin();
+			slot = &it->second;
+		}
+		const data_slot& sl = *slot;
 		if(sl.type==DATA_OBJECT)
 		{
 			if(sl.data==NULL)
@@ -1601,21 +1671,20 @@ _R<ASObject> Array::nextValue(uint32_t index)
 uint32_t Array::nextNameIndex(uint32_t cur_index)
 {
 	assert_and_throw(implEnable);
-	if(cur_index<size())
+	uint32_t size=this->size();
+	if(cur_index<size)
 	{
-		while (!data.count(cur_index) && cur_index<size())
-		{
-			cur_index++;
-		}
-		if(cur_index<size())
-			return cur_index+1;
+		uint32_t index=cur_index;
+		if(findNextSlot(index) && index<size)
+			return index+1;
+		cur_index=size;
 	}
 	//Fall back on object properties
-	uint32_t ret=ASObject::nextNameIndex(cur_index-size());
+	uint32_t ret=ASObject::nextNameIndex(cur_index-size);
 	if(ret==0)
 		return 0;
 	else
-		return ret+size();
+		return ret+size;
 	
 }
 
@@ -1636,10 +1705,10 @@ _R<ASObject> Array::at(unsigned int index)
 	if(size()<=index)
 		outofbounds(index);
 
-	auto it = data.find(index);
-	if(it == data.end())
+	const data_slot* it = findSlot(index);
+	if(it == NULL)
 		return _MR(getSystemState()->getUndefinedRef());
-	const data_slot& sl = it->second;
+	const data_slot& sl = *it;
 	switch(sl.type)
 	{
 		case DATA_OBJECT:
@@ -1670,26 +1739,23 @@ void Array::resize(uint64_t n)
 	if (n > 0xFFFFFFFF)
 		n = (n % 0x100000000);
 
-	boost::container::flat_map<uint32_t,data_slot>::reverse_iterator it;
-	boost::container::flat_map<uint32_t,data_slot>::iterator itstart = n ? data.end() : data.begin();
-	for ( it=data.rbegin() ; it != data.rend(); ++it )
+	if (n < data_first.size())
 	{
-		if (it->first < n)
-		{
-			itstart = it.base();
-			break;
-		}
-		it->second.clear();
+		for (auto it=data_first.begin()+n ; it != data_first.end(); ++it)
+			it->clear();
+		data_first.erase(data_first.begin()+n,data_first.end());
 	}
-	if (itstart != data.end())
-		data.erase(itstart,data.end());
+	auto itstart = data_second.lower_bound(n);
+	for (auto it=itstart ; it != data_second.end(); ++it)
+		it->second.clear();
+	data_second.erase(itstart,data_second.end());
 	currentsize = n;
 	currentpos = 0;
 }
 
-void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Array::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -1717,20 +1783,21 @@ void Array::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap
 		serializeDynamicProperties(out, stringMap, objMap, traitsMap);
 		for(uint32_t i=0;i<denseCount;i++)
 		{
-			if (data.find(i) == data.end())
+			const data_slot* sl = findSlot(i);
+			if (sl == NULL)
 			{
 				out->writeByte(null_marker);
 			}
 			else
 			{
-				switch(data.at(i).type)
+				switch(sl->type)
 				{
 					case DATA_INT:
 						out->writeByte(double_marker);
-						out->serializeDouble(data.at(i).data_i);
+						out->serializeDouble(sl->data_i);
 						break;
 					case DATA_OBJECT:
-						data.at(i).data->serialize(out, stringMap, objMap, traitsMap);
+						sl->data->serialize(out, stringMap, objMap, traitsMap);
 						break;
 				}
 			}
@@ -1752,15 +1819,16 @@ tiny_string Array::toJSON(std::vector<ASObject *> &path, IFunction *replacer, co
 	res += "[";
 	bool bfirst = true;
 	tiny_string newline = (spaces.empty() ? "" : "\n");
-	for (auto it=data.begin() ; it != data.end(); ++it)
+	uint32_t index=0;
+	for (data_slot* it=findNextSlot(index) ; it != NULL; it=findNextSlot(++index))
 	{
 		tiny_string subres;
-		ASObject* o = it->second.type==DATA_OBJECT ? it->second.data : abstract_i(getSystemState(),it->second.data_i);
+		ASObject* o = it->type==DATA_OBJECT ? it->data : abstract_i(getSystemState(),it->data_i);
 		if (replacer != NULL)
 		{
 			ASObject* params[2];
 			
-			params[0] = abstract_di(getSystemState(),it->first);
+			params[0] = abstract_di(getSystemState(),index);
 			params[0]->incRef();
 			params[1] = o;
 			params[1]->incRef();
@@ -1770,10 +1838,10 @@ tiny_string Array::toJSON(std::vector<ASObject *> &path, IFunction *replacer, co
 		}
 		else
 		{
-			if(it->second.type==DATA_OBJECT)
+			if(it->type==DATA_OBJECT)
 			{
-				if (it->second.data)
-					subres = it->second.data->toJSON(path,replacer,spaces,filter);
+				if (it->data)
+					subres = it->data->toJSON(path,replacer,spaces,filter);
 				else
 					continue;
 			}
@@ -1807,8 +1875,9 @@ void Array::set(unsigned int index, _R<ASObject> o)
 	if(index<currentsize)
 	{
 		data_slot ds;
-		if(data.find(index) != data.end())
-			data[index].clear();
+		data_slot* it = findSlot(index);
+		if(it != NULL)
+			it->clear();
 		if(o->getObjectType()==T_INTEGER)
 		{
 			Integer* i=o->as<Integer>();
@@ -1821,8 +1890,7 @@ void Array::set(unsigned int index, _R<ASObject> o)
 			ds.data=o.getPtr();
 			ds.type=DATA_OBJECT;
 		}
-		data[index]=ds;
-		currentpos = 0;
+		setSlot(index,ds);
 	}
 	else
 		outofbounds(index);
@@ -58,14 +58,42 @@ class Array: public ASObject
 friend class ABCVm;
 protected:
 	uint64_t currentsize;
+	/* Elements are stored in a contiguous vector as long as the array
+	 * is dense: data_first holds all the indexes in [0,data_first.size()).
+	 * Elements after the first hole are stored in the sparse map, which
+	 * only contains indexes bigger than data_first.size() */
+	typedef std::vector<data_slot, reporter_allocator<data_slot>> arrayDenseType;
 	typedef boost::container::flat_map<uint32_t,data_slot,std::less<uint32_t>,
 		reporter_allocator<std::pair<uint32_t, data_slot>>> arrayType;
 	
-	typedef boost::container::flat_map<uint32_t,data_slot>::iterator data_iterator;
-	arrayType data;
+	typedef arrayType::iterator data_iterator;
+	arrayDenseType data_first;
+	arrayType data_second;
+	//Position in data_second of the last element returned by nextValue
 	uint32_t currentpos;
 	void outofbounds(unsigned int index) const;
 	~Array();
+	data_slot* findSlot(uint32_t index)
+	{
+		if(index<data_first.size())
+			return &data_first[index];
+		if(data_second.empty())
+			return NULL;
+		auto it=data_second.find(index);
+		return it!=data_second.end() ? &it->second : NULL;
+	}
+	/* Finds the first element at or after index, and updates index.
+	 * Returns NULL if there are no more elements */
+	data_slot* findNextSlot(uint32_t& index);
+	/* These do not change the reference count of the stored values */
+	void setSlot(uint32_t index, const data_slot& ds);
+	void eraseSlot(uint32_t index);
+	void clearSlots();
+	/* Moves the elements at or after index by delta positions. When delta
+	 * is negative the elements in [index+delta,index) are dropped */
+	void moveSlots(uint32_t index, int32_t delta);
+	//Number of stored elements
+	uint32_t slotCount() const { return data_first.size()+data_second.size(); }
 private:
 	class sortComparatorDefault
 	{
@@ -77,6 +105,17 @@ private:
 		sortComparatorDefault(bool n, bool ci, bool d):isNumeric(n),isCaseInsensitive(ci),isDescending(d){}
 		bool operator()(const data_slot& d1, const data_slot& d2);
 	};
+	class sortComparatorNumeric
+	{
+	private:
+		bool isDescending;
+	public:
+		sortComparatorNumeric(bool d):isDescending(d){}
+		bool operator()(const std::pair<number_t,data_slot>& d1, const std::pair<number_t,data_slot>& d2)
+		{
+			return isDescending ? d1.first>d2.first : d1.first<d2.first;
+		}
+	};
 	class sortComparatorWrapper
 	{
 	private:
@@ -93,6 +132,9 @@ private:
 		sortOnComparator(const std::vector<sorton_field>& sf):fields(sf){}
 		bool operator()(const data_slot& d1, const data_slot& d2);
 	};
+	//Elements which are not undefined, as sort and sortOn drop the others
+	void getSortableSlots(std::vector<data_slot>& tmp);
+	void setSortedSlots(const std::vector<data_slot>& tmp);
 	void constructorImpl(ASObject* const* args, const unsigned int argslen);
 	tiny_string toString_priv(bool localized=false);
 	int capIndex(int i);
@@ -102,12 +144,11 @@ public:
 	Array(Class_base* c);
 	bool destruct()
 	{
-		for (auto it=data.begin() ; it != data.end(); ++it)
-		{
-			if(it->second.type==DATA_OBJECT && it->second.data)
-				it->second.data->decRef();
-		}
-		data.clear();
+		for (auto it=data_first.begin() ; it != data_first.end(); ++it)
+			it->clear();
+		for (auto it=data_second.begin() ; it != data_second.end(); ++it)
+			it->second.clear();
+		clearSlots();
 		currentsize=0;
 		currentpos = 0;
 		return ASObject::destruct();
@@ -164,9 +205,9 @@ public:
 	_R<ASObject> nextName(uint32_t index);
 	_R<ASObject> nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	virtual tiny_string toJSON(std::vector<ASObject *> &path,IFunction* replacer, const tiny_string &spaces,const tiny_string& filter);
 };
 
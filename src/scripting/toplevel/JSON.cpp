@@ -19,6 +19,16 @@
 
 #include "scripting/argconv.h"
 #include "scripting/toplevel/JSON.h"
+#include "scripting/toplevel/Array.h"
+#include <unordered_map>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 using namespace std;
 using namespace lightspark;
@@ -49,554 +59,521 @@ ASFUNCTIONBODY(JSON,generator)
 	return NULL;
 }
 
-ASObject *JSON::doParse(const tiny_string &jsonstring, IFunction *reviver)
+/*
+ * Single pass JSON parser working directly on the UTF-8 bytes of the input.
+ * Values are built as soon as they are parsed and stored into their container
+ */
+class JSONParser
+{
+private:
+	SystemState* sys;
+	const char* cur;
+	const char* end;
+	IFunction* reviver;
+	//Decoded contents of the last string, reused to avoid allocations
+	std::string scratch;
+	//Keys are repeated in most documents, remember their ids to skip the global pool
+	std::unordered_map<std::string, uint32_t> keyIds;
+	multiname keyName;
+	multiname indexName;
+	void skipWhitespace()
+	{
+		while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\n' || *cur == '\r'))
+			cur++;
+	}
+	void revive(ASObject* holder, const multiname& name, ASObject* value);
+	void parseString();
+	uint32_t parseKey();
+	ASObject* parseValue();
+	ASObject* parseLiteral(const char* literal, uint32_t len, ASObject* value);
+	ASObject* parseNumber();
+	ASObject* parseObject();
+	ASObject* parseArray();
+public:
+	JSONParser(SystemState* s, const tiny_string& jsonstring, IFunction* r);
+	ASObject* parseAll();
+};
+
+/*
+ * Return the first byte in [p,end) that is a quote, a backslash or a control
+ * character, that is the end of the part of a string that can be copied as is
+ */
+static inline const char* scanStringBoundary(const char* p, const char* end)
+{
+#if defined(__SSE2__)
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1f);
+	while (end - p >= 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		//Unsigned v <= 0x1f is max(v,0x1f) == 0x1f
+		__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+					 _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+		int mask = _mm_movemask_epi8(m);
+		if (mask)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const uint8x16_t quote = vdupq_n_u8('"');
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	const uint8x16_t control = vdupq_n_u8(0x1f);
+	while (end - p >= 16)
+	{
+		uint8x16_t v = vld1q_u8((const uint8_t*)p);
+		uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)), vcleq_u8(v, control));
+		if (vmaxvq_u8(m))
+			break;
+		p += 16;
+	}
+#endif
+	while (p < end && *p != '"' && *p != '\\' && (uint8_t)*p >= 0x20)
+		p++;
+	return p;
+}
+
+static inline int hexDigitValue(char c)
 {
-	ASObject* res = NULL;
-	multiname dummy(NULL);
-	
-	parseAll(jsonstring,&res,dummy,reviver);
-	return res;
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
 }
 
-ASFUNCTIONBODY(JSON,_parse)
+JSONParser::JSONParser(SystemState* s, const tiny_string& jsonstring, IFunction* r):
+	sys(s),cur(jsonstring.raw_buf()),end(jsonstring.raw_buf()+jsonstring.numBytes()),reviver(r),
+	keyName(NULL),indexName(NULL)
 {
-	tiny_string text;
-	IFunction* reviver = NULL;
+	keyName.name_type = multiname::NAME_STRING;
+	keyName.ns.push_back(nsNameAndKind(sys,"",NAMESPACE));
+	keyName.isAttribute = false;
+	indexName.name_type = multiname::NAME_UINT;
+	indexName.ns.push_back(nsNameAndKind(sys,"",NAMESPACE));
+	indexName.isAttribute = false;
+}
 
-	if (argslen > 0 && (args[0]->is<Null>() ||args[0]->is<Undefined>()))
+ASObject* JSONParser::parseAll()
+{
+	skipWhitespace();
+	if (cur == end)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
-	ARG_UNPACK_MORE_ALLOWED(text);
-	if (argslen > 1)
+	_R<ASObject> res = _MR(parseValue());
+	skipWhitespace();
+	if (cur != end)
+		throwError<SyntaxError>(kJSONInvalidParseInput);
+	if (reviver)
 	{
-		if (!args[1]->is<IFunction>())
-			throwError<TypeError>(kCheckTypeFailedError);
-		reviver = args[1]->as<IFunction>();
+		ASObject* params[2];
+		params[0] = abstract_s(sys,"");
+		res->incRef();
+		params[1] = res.getPtr();
+		ASObject* funcret = reviver->call(sys->getNullRef(), params, 2);
+		if (funcret)
+			res = _MR(funcret);
 	}
-	return doParse(text,reviver);
+	res->incRef();
+	return res.getPtr();
 }
 
-ASFUNCTIONBODY(JSON,_stringify)
+void JSONParser::revive(ASObject* holder, const multiname& name, ASObject* value)
 {
-	_NR<ASObject> value;
-	ARG_UNPACK_MORE_ALLOWED(value);
-	std::vector<ASObject *> path;
-	tiny_string filter;
-	IFunction* replacer = NULL;
-	if (argslen > 1 && !args[1]->is<Null>() && !args[1]->is<Undefined>())
+	ASObject* params[2];
+	params[0] = abstract_s(sys,name.normalizedName(sys));
+	value->incRef();
+	params[1] = value;
+	ASObject* funcret = reviver->call(sys->getNullRef(), params, 2);
+	if (funcret)
 	{
-		if (args[1]->is<IFunction>())
+		if (funcret->is<Undefined>())
 		{
-			replacer = args[1]->as<IFunction>();
-		}
-		else if (args[1]->is<Array>())
-		{
-			filter = " ";
-			Array* ar = args[1]->as<Array>();
-			for (uint64_t i = 0; i < ar->size(); i++)
-			{
-				filter += ar->at(i)->toString();
-				filter += " ";
-			}
+			holder->deleteVariableByMultiname(name);
+			funcret->decRef();
 		}
 		else
-			throwError<TypeError>(kJSONInvalidReplacer);
+			holder->setVariableByMultiname(name,funcret,ASObject::CONST_NOT_ALLOWED);
 	}
+}
 
-	tiny_string spaces = "";
-	if (argslen > 2)
+ASObject* JSONParser::parseValue()
+{
+	if (cur == end)
+		throwError<SyntaxError>(kJSONInvalidParseInput);
+	switch (*cur)
 	{
-		ASObject* space = args[2];
-		spaces = "          ";
-		if (space->is<Number>() || space->is<Integer>() || space->is<UInteger>())
-		{
-			int32_t v = space->toInt();
-			if (v < 0) v = 0;
-			if (v > 10) v = 10;
-			spaces = spaces.substr_bytes(0,v);
-		}
-		else if (space->is<Boolean>() || space->is<Null>())
-		{
-			spaces = "";
-		}
-		else
-		{
-			if(space->has_toString())
-			{
-				_R<ASObject> ret = space->call_toString();
-				spaces = ret->toString();
-			}
-			else
-				spaces = space->toString();
-			if (spaces.numBytes() > 10)
-				spaces = spaces.substr_bytes(0,10);
-		}
+		case '{':
+			return parseObject();
+		case '[':
+			return parseArray();
+		case '"':
+			parseString();
+			return abstract_s(sys,tiny_string(scratch));
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+		case '-':
+			return parseNumber();
+		case 't':
+			return parseLiteral("true",4,abstract_b(sys,true));
+		case 'f':
+			return parseLiteral("false",5,abstract_b(sys,false));
+		case 'n':
+			return parseLiteral("null",4,sys->getNullRef());
+		default:
+			throwError<SyntaxError>(kJSONInvalidParseInput);
 	}
-	tiny_string res = value->toJSON(path,replacer,spaces,filter);
-
-	return abstract_s(obj->getSystemState(),res);
+	return NULL;
 }
-void JSON::parseAll(const tiny_string &jsonstring, ASObject** parent , const multiname& key, IFunction *reviver)
+
+ASObject* JSONParser::parseLiteral(const char* literal, uint32_t len, ASObject* value)
 {
-	int len = jsonstring.numChars();
-	int pos = 0;
-	while (pos < len)
+	if (uint32_t(end - cur) < len || memcmp(cur, literal, len) != 0)
 	{
-		if (*parent && (*parent)->isPrimitive())
-			throwError<SyntaxError>(kJSONInvalidParseInput);
-		pos = parse(jsonstring, pos, parent , key, reviver);
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
+		value->decRef();
+		throwError<SyntaxError>(kJSONInvalidParseInput);
 	}
+	cur += len;
+	return value;
 }
-int JSON::parse(const tiny_string &jsonstring, int pos, ASObject** parent , const multiname& key, IFunction *reviver)
+
+void JSONParser::parseString()
 {
-	while (jsonstring.charAt(pos) == ' ' ||
-		   jsonstring.charAt(pos) == '\t' ||
-		   jsonstring.charAt(pos) == '\n' ||
-		   jsonstring.charAt(pos) == '\r'
-		   )
-		   pos++;
-	int len = jsonstring.numChars();
-	if (pos < len)
+	cur++; // ignore starting quotes
+	scratch.clear();
+	while (true)
 	{
-		char c = jsonstring.charAt(pos);
-		switch(c)
+		const char* plain = cur;
+		cur = scanStringBoundary(cur, end);
+		scratch.append(plain, cur - plain);
+		if (cur == end)
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		char c = *cur++;
+		if (c == '"')
+			return;
+		if (c != '\\')
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		if (cur == end)
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		c = *cur++;
+		switch (c)
 		{
-			case '{':
-				pos = parseObject(jsonstring,pos,parent,key, reviver);
-				break;
-			case '[': 
-				pos = parseArray(jsonstring,pos,parent,key, reviver);
-				break;
 			case '"':
-				pos = parseString(jsonstring,pos,parent,key);
+			case '\\':
+			case '/':
+				scratch += c;
 				break;
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-			case '-':
-				pos = parseNumber(jsonstring,pos,parent,key);
-				break;
-			case 't':
-				pos = parseTrue(jsonstring,pos,parent,key);
+			case 'b':
+				scratch += '\b';
 				break;
 			case 'f':
-				pos = parseFalse(jsonstring,pos,parent,key);
+				scratch += '\f';
 				break;
 			case 'n':
-				pos = parseNull(jsonstring,pos,parent,key);
+				scratch += '\n';
 				break;
-			default:
-				throwError<SyntaxError>(kJSONInvalidParseInput);
-		}
-	}
-	if (reviver)
-	{
-		bool haskey = key.name_type!= multiname::NAME_OBJECT;
-		ASObject* params[2];
-		
-		if (haskey)
-		{
-			params[0] = abstract_s(getSys(),key.normalizedName(getSys()));
-			if ((*parent)->hasPropertyByMultiname(key,true,false))
-			{
-				params[1] = (*parent)->getVariableByMultiname(key).getPtr();
-				params[1]->incRef();
-			}
-			else
-				params[1] = getSys()->getNullRef();
-		}
-		else
-		{
-			params[0] = abstract_s(getSys(),"");
-			params[1] = *parent;
-			params[1]->incRef();
-		}
-
-		ASObject *funcret=reviver->call(getSys()->getNullRef(), params, 2);
-		if(funcret)
-		{
-			if (haskey)
+			case 'r':
+				scratch += '\r';
+				break;
+			case 't':
+				scratch += '\t';
+				break;
+			case 'u':
 			{
-				if (funcret->is<Undefined>())
+				uint32_t hexnum = 0;
+				for (int i = 0; i < 4; i++)
 				{
-					(*parent)->deleteVariableByMultiname(key);
-					funcret->decRef();
+					int d = (cur < end) ? hexDigitValue(*cur) : -1;
+					if (d < 0)
+						throwError<SyntaxError>(kJSONInvalidParseInput);
+					hexnum = (hexnum << 4) | d;
+					cur++;
 				}
-				else
+				if (hexnum < 0x20 && hexnum != 0xf)
+					throwError<SyntaxError>(kJSONInvalidParseInput);
+				//Join surrogate pairs into a single character
+				if (hexnum >= 0xd800 && hexnum < 0xdc00 && end - cur >= 6 && cur[0] == '\\' && cur[1] == 'u')
 				{
-					(*parent)->setVariableByMultiname(key,funcret,ASObject::CONST_NOT_ALLOWED);
+					uint32_t low = 0;
+					int i;
+					for (i = 2; i < 6; i++)
+					{
+						int d = hexDigitValue(cur[i]);
+						if (d < 0)
+							break;
+						low = (low << 4) | d;
+					}
+					if (i == 6 && low >= 0xdc00 && low < 0xe000)
+					{
+						hexnum = 0x10000 + ((hexnum - 0xd800) << 10) + (low - 0xdc00);
+						cur += 6;
+					}
 				}
+				char utf8[6];
+				scratch.append(utf8, g_unichar_to_utf8(hexnum, utf8));
+				break;
 			}
-			else 
-				*parent= funcret;
+			default:
+				throwError<SyntaxError>(kJSONInvalidParseInput);
 		}
 	}
-	return pos;
 }
-int JSON::parseTrue(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
+
+uint32_t JSONParser::parseKey()
 {
-	int len = jsonstring.numChars();
-	if (len >= pos+4)
+	parseString();
+	auto it = keyIds.find(scratch);
+	if (it != keyIds.end())
+		return it->second;
+	uint32_t id = sys->getUniqueStringId(tiny_string(scratch));
+	keyIds.insert(make_pair(scratch, id));
+	return id;
+}
+
+ASObject* JSONParser::parseNumber()
+{
+	const char* start = cur;
+	while (cur < end)
 	{
-		if (jsonstring.charAt(pos) == 't' && 
-				jsonstring.charAt(pos + 1) == 'r' &&
-				jsonstring.charAt(pos + 2) == 'u' && 
-				jsonstring.charAt(pos + 3) == 'e')
-		{
-			pos += 4;
-			if (*parent == NULL)
-				*parent = abstract_b(getSys(),true);
-			else 
-				(*parent)->setVariableByMultiname(key,abstract_b((*parent)->getSystemState(),true),ASObject::CONST_NOT_ALLOWED);
-		}
+		char c = *cur;
+		if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+			cur++;
 		else
-			throwError<SyntaxError>(kJSONInvalidParseInput);
+			break;
 	}
-	else
+	//Check the JSON grammar, which is stricter than strtod: no leading
+	//zeros, no '+' sign and digits on both sides of the '.'
+	const char* digits = (*start == '-') ? start + 1 : start;
+	const char* p = digits;
+	if (p == cur || *p < '0' || *p > '9' || (*p == '0' && p + 1 < cur && p[1] >= '0' && p[1] <= '9'))
 		throwError<SyntaxError>(kJSONInvalidParseInput);
-	return pos;
-}
-int JSON::parseFalse(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
-{
-	int len = jsonstring.numChars();
-	if (len >= pos+5)
+	while (p < cur && *p >= '0' && *p <= '9')
+		p++;
+	const char* intEnd = p;
+	if (p < cur && *p == '.')
 	{
-		if (jsonstring.charAt(pos) == 'f' && 
-				jsonstring.charAt(pos + 1) == 'a' &&
-				jsonstring.charAt(pos + 2) == 'l' && 
-				jsonstring.charAt(pos + 3) == 's' && 
-				jsonstring.charAt(pos + 4) == 'e')
-		{
-			pos += 5;
-			if (*parent == NULL)
-				*parent = abstract_b(getSys(),false);
-			else 
-				(*parent)->setVariableByMultiname(key,abstract_b((*parent)->getSystemState(),false),ASObject::CONST_NOT_ALLOWED);
-		}
-		else
+		const char* frac = ++p;
+		while (p < cur && *p >= '0' && *p <= '9')
+			p++;
+		if (p == frac)
 			throwError<SyntaxError>(kJSONInvalidParseInput);
 	}
-	else
-		throwError<SyntaxError>(kJSONInvalidParseInput);
-	return pos;
-}
-int JSON::parseNull(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key)
-{
-	int len = jsonstring.numChars();
-	if (len >= pos+4)
+	if (p < cur && (*p == 'e' || *p == 'E'))
 	{
-		if (jsonstring.charAt(pos) == 'n' && 
-				jsonstring.charAt(pos + 1) == 'u' &&
-				jsonstring.charAt(pos + 2) == 'l' && 
-				jsonstring.charAt(pos + 3) == 'l')
-		{
-			pos += 4;
-			if (*parent == NULL)
-				*parent = getSys()->getNullRef();
-			else 
-				(*parent)->setVariableByMultiname(key,getSys()->getNullRef(),ASObject::CONST_NOT_ALLOWED);
-		}
-		else
+		p++;
+		if (p < cur && (*p == '+' || *p == '-'))
+			p++;
+		const char* exp = p;
+		while (p < cur && *p >= '0' && *p <= '9')
+			p++;
+		if (p == exp)
 			throwError<SyntaxError>(kJSONInvalidParseInput);
 	}
-	else
+	if (p != cur)
 		throwError<SyntaxError>(kJSONInvalidParseInput);
-	return pos;
+	//Plain integers are exact in a double up to 15 digits, -0 is not
+	//an integer
+	if (intEnd == cur && cur - digits <= 15 && !(*digits == '0' && digits != start))
+	{
+		int64_t v = 0;
+		for (p = digits; p < cur; p++)
+			v = v * 10 + (*p - '0');
+		return abstract_d(sys, (digits != start) ? -v : v);
+	}
+	//Same conversion as String to Number
+	scratch.assign(start, cur - start);
+	errno = 0;
+	number_t num = g_ascii_strtod(scratch.c_str(), NULL);
+	if (errno == ERANGE)
+	{
+		if (num == HUGE_VAL)
+			num = numeric_limits<double>::infinity();
+		else if (num == -HUGE_VAL)
+			num = -numeric_limits<double>::infinity();
+	}
+	return abstract_d(sys, num);
 }
-int JSON::parseString(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key, tiny_string* result)
-{
-	pos++; // ignore starting quotes
-	int len = jsonstring.numChars();
-	if (pos >= len)
-		throwError<SyntaxError>(kJSONInvalidParseInput);
 
-	tiny_string sub = jsonstring.substr(pos,len-pos);
-	
-	tiny_string res;
-	bool done = false;
-	for (CharIterator it=sub.begin(); it!=sub.end(); it++)
+ASObject* JSONParser::parseObject()
+{
+	cur++; // ignore '{'
+	_R<ASObject> res = _MR(Class<ASObject>::getInstanceS(sys));
+	skipWhitespace();
+	if (cur < end && *cur == '}')
 	{
-		pos++;
-		if (*it == '\"')
-		{
-			done = true;
-			break;
-		}
-		else if(*it == '\\')
+		cur++;
+		res->incRef();
+		return res.getPtr();
+	}
+	while (true)
+	{
+		if (cur == end || *cur != '"')
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		uint32_t key = parseKey();
+		skipWhitespace();
+		if (cur == end || *cur != ':')
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		cur++;
+		skipWhitespace();
+		ASObject* value = parseValue();
+		keyName.name_s_id = key;
+		res->setVariableByMultiname(keyName,value,ASObject::CONST_NOT_ALLOWED);
+		if (reviver)
 		{
-			it++;
-			pos++;
-			if(it == sub.end())
-				break;
-			if(*it == '\"')
-				res += '\"';
-			else if(*it == '\\')
-				res += '\\';
-			else if(*it == '/')
-				res += '/';
-			else if(*it == 'b')
-				res += '\b';
-			else if(*it == 'f')
-				res += '\f';
-			else if(*it == 'n')
-				res += '\n';
-			else if(*it == 'r')
-				res += '\r';
-			else if(*it == 't')
-				res += '\t';
-			else if(*it == 'u')
-			{
-				tiny_string strhex;
-				for (int i = 0; i < 4; i++)
-				{
-					it++; pos++; 
-					if (it==sub.end()) 
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-					switch(*it)
-					{
-						case '0':
-						case '1':
-						case '2':
-						case '3':
-						case '4':
-						case '5':
-						case '6':
-						case '7':
-						case '8':
-						case '9':
-						case 'a':
-						case 'b':
-						case 'c':
-						case 'd':
-						case 'e':
-						case 'f':
-						case 'A':
-						case 'B':
-						case 'C':
-						case 'D':
-						case 'E':
-						case 'F':
-							strhex += *it;
-							break;
-						default:
-							throwError<SyntaxError>(kJSONInvalidParseInput);
-					}
-					if (it==sub.end()) 
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-				}
-				int64_t hexnum;
-				if (Integer::fromStringFlashCompatible(strhex.raw_buf(),hexnum,16))
-				{
-					if (hexnum < 0x20 && hexnum != 0xf)
-						throwError<SyntaxError>(kJSONInvalidParseInput);
-					res += tiny_string::fromChar(hexnum);
-				}
-				else
-					break;
-			}
-			else
-				throwError<SyntaxError>(kJSONInvalidParseInput);
+			keyName.name_s_id = key;
+			revive(res.getPtr(),keyName,value);
 		}
-		else if (*it < 0x20)
-		{
+		skipWhitespace();
+		if (cur == end)
 			throwError<SyntaxError>(kJSONInvalidParseInput);
-		}
-		else
+		if (*cur == '}')
 		{
-			res += *it;
+			cur++;
+			break;
 		}
+		if (*cur != ',')
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		cur++;
+		skipWhitespace();
 	}
-	if (!done)
-		throwError<SyntaxError>(kJSONInvalidParseInput);
-	
-	if (parent != NULL)
-	{
-		if (*parent == NULL)
-			*parent = abstract_s(getSys(),res);
-		else 
-			(*parent)->setVariableByMultiname(key,abstract_s(getSys(),res),ASObject::CONST_NOT_ALLOWED);
-	}
-	if (result)
-		*result =res;
-	return pos;
+	res->incRef();
+	return res.getPtr();
 }
-int JSON::parseNumber(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key)
+
+ASObject* JSONParser::parseArray()
 {
-	int len = jsonstring.numChars();
-	tiny_string res;
-	bool done = false;
-	while (!done && pos < len)
+	cur++; // ignore '['
+	_R<Array> res = _MR(Class<Array>::getInstanceSNoArgs(sys));
+	skipWhitespace();
+	if (cur < end && *cur == ']')
 	{
-		char c = jsonstring.charAt(pos);
-		switch(c)
+		cur++;
+		res->incRef();
+		return res.getPtr();
+	}
+	uint32_t index = 0;
+	while (true)
+	{
+		ASObject* value = parseValue();
+		if (reviver)
+			value->incRef();
+		res->push(_MR(value));
+		if (reviver)
 		{
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-			case '-':
-			case '+':
-			case '.':
-			case 'E':
-			case 'e':
-				res += c;
-				pos++;
-				break;
-			default:
-				done = true;
-				break;
+			indexName.name_ui = index;
+			revive(res.getPtr(),indexName,value);
+			value->decRef();
+		}
+		index++;
+		skipWhitespace();
+		if (cur == end)
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		if (*cur == ']')
+		{
+			cur++;
+			break;
 		}
+		if (*cur != ',')
+			throwError<SyntaxError>(kJSONInvalidParseInput);
+		cur++;
+		skipWhitespace();
 	}
-	ASString* numstr = abstract_s(getSys(),res);
-	number_t num = numstr->toNumber();
+	res->incRef();
+	return res.getPtr();
+}
 
-	if (std::isnan(num))
-		throwError<SyntaxError>(kJSONInvalidParseInput);
+ASObject *JSON::doParse(const tiny_string &jsonstring, IFunction *reviver)
+{
+	JSONParser parser(getSys(),jsonstring,reviver);
+	return parser.parseAll();
+}
 
-	if (*parent == NULL)
-		*parent = abstract_d(getSys(),num);
-	else 
+ASFUNCTIONBODY(JSON,_parse)
+{
+	tiny_string text;
+	IFunction* reviver = NULL;
+
+	if (argslen > 0 && (args[0]->is<Null>() ||args[0]->is<Undefined>()))
+		throwError<SyntaxError>(kJSONInvalidParseInput);
+	ARG_UNPACK_MORE_ALLOWED(text);
+	if (argslen > 1)
 	{
-		(*parent)->setVariableByMultiname(key,abstract_d(getSys(),num),ASObject::CONST_NOT_ALLOWED);
+		if (!args[1]->is<IFunction>())
+			throwError<TypeError>(kCheckTypeFailedError);
+		reviver = args[1]->as<IFunction>();
 	}
-	return pos;
+	return doParse(text,reviver);
 }
-int JSON::parseObject(const tiny_string &jsonstring, int pos,ASObject** parent,const multiname& key, IFunction *reviver)
+
+ASFUNCTIONBODY(JSON,_stringify)
 {
-	int len = jsonstring.numChars();
-	pos++; // ignore '{' or ','
-	ASObject* subobj = Class<ASObject>::getInstanceS(getSys());
-	if (*parent == NULL)
-		*parent = subobj;
-	else 
-		(*parent)->setVariableByMultiname(key,subobj,ASObject::CONST_NOT_ALLOWED);
-	multiname name(NULL);
-	name.name_type=multiname::NAME_STRING;
-	name.ns.push_back(nsNameAndKind(getSys(),"",NAMESPACE));
-	name.isAttribute = false;
-	bool done = false;
-	bool bfirst = true;
-	bool needkey = true;
-	bool needvalue = false;
-
-	while (!done && pos < len)
+	_NR<ASObject> value;
+	ARG_UNPACK_MORE_ALLOWED(value);
+	std::vector<ASObject *> path;
+	tiny_string filter;
+	IFunction* replacer = NULL;
+	if (argslen > 1 && !args[1]->is<Null>() && !args[1]->is<Undefined>())
 	{
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
-		char c = jsonstring.charAt(pos);
-		switch(c)
+		if (args[1]->is<IFunction>())
 		{
-			case '}':
-				if (!bfirst && (needkey || needvalue))
-					throwError<SyntaxError>(kJSONInvalidParseInput);
-				done = true;
-				pos++;
-				break;
-			case '\"':
-				{
-					tiny_string keyname;
-					pos = parseString(jsonstring,pos,NULL,name,&keyname);
-					name.name_s_id=getSys()->getUniqueStringId(keyname);
-					needkey = false;
-					needvalue = true;
-				}
-				break;
-			case ',':
-				if (needkey || needvalue)
-					throwError<SyntaxError>(kJSONInvalidParseInput);
-				pos++;
-				name.name_s_id=0;
-				needkey = true;
-				break;
-			case ':':
-				pos++;
-				pos = parse(jsonstring,pos,&subobj,name,reviver);
-				needvalue = false;
-				break;
-			default:
-				throwError<SyntaxError>(kJSONInvalidParseInput);
+			replacer = args[1]->as<IFunction>();
 		}
-		bfirst=false;
+		else if (args[1]->is<Array>())
+		{
+			filter = " ";
+			Array* ar = args[1]->as<Array>();
+			for (uint64_t i = 0; i < ar->size(); i++)
+			{
+				filter += ar->at(i)->toString();
+				filter += " ";
+			}
+		}
+		else
+			throwError<TypeError>(kJSONInvalidReplacer);
 	}
-	if (!done)
-		throwError<SyntaxError>(kJSONInvalidParseInput);
 
-	return pos;
-}
-
-int JSON::parseArray(const tiny_string &jsonstring, int pos, ASObject** parent, const multiname& key, IFunction *reviver)
-{
-	int len = jsonstring.numChars();
-	pos++; // ignore '['
-	ASObject* subobj = Class<Array>::getInstanceSNoArgs(getSys());
-	if (*parent == NULL)
-		*parent = subobj;
-	else 
-		(*parent)->setVariableByMultiname(key,subobj,ASObject::CONST_NOT_ALLOWED);
-	multiname name(NULL);
-	name.name_type=multiname::NAME_UINT;
-	name.name_ui = 0;
-	name.ns.push_back(nsNameAndKind(getSys(),"",NAMESPACE));
-	name.isAttribute = false;
-	bool done = false;
-	bool needdata = false;
-	while (!done && pos < len)
+	tiny_string spaces = "";
+	if (argslen > 2)
 	{
-		while (jsonstring.charAt(pos) == ' ' ||
-			   jsonstring.charAt(pos) == '\t' ||
-			   jsonstring.charAt(pos) == '\n' ||
-			   jsonstring.charAt(pos) == '\r'
-			   )
-			pos++;
-		char c = jsonstring.charAt(pos);
-		switch(c)
+		ASObject* space = args[2];
+		spaces = "          ";
+		if (space->is<Number>() || space->is<Integer>() || space->is<UInteger>())
 		{
-			case ']':
-				done = true;
-				pos++;
-				break;
-			case ',':
-				name.name_ui++;
-				needdata = true;
-				pos++;
-				break;
-			default:
-				pos = parse(jsonstring,pos,&subobj,name, reviver);
-				needdata = false;
-				break;
+			int32_t v = space->toInt();
+			if (v < 0) v = 0;
+			if (v > 10) v = 10;
+			spaces = spaces.substr_bytes(0,v);
+		}
+		else if (space->is<Boolean>() || space->is<Null>())
+		{
+			spaces = "";
+		}
+		else
+		{
+			if(space->has_toString())
+			{
+				_R<ASObject> ret = space->call_toString();
+				spaces = ret->toString();
+			}
+			else
+				spaces = space->toString();
+			if (spaces.numBytes() > 10)
+				spaces = spaces.substr_bytes(0,10);
 		}
 	}
-	if (!done || needdata)
-		throwError<SyntaxError>(kJSONInvalidParseInput);
+	tiny_string res = value->toJSON(path,replacer,spaces,filter);
 
-	return pos;
+	return abstract_s(obj->getSystemState(),res);
 }
-
-
-
-
 /***** 
 
 static QString sanitizeString(QString str)
@@ -19,10 +19,165 @@
 
 #include "scripting/argconv.h"
 #include "scripting/toplevel/RegExp.h"
+#include <list>
+#include <map>
+#include <cstring>
 
 using namespace std;
 using namespace lightspark;
 
+/* Maximum number of distinct source+options pairs kept compiled */
+#define REGEXP_CACHE_SIZE 128
+
+typedef pair<string,int> regexpCacheKey;
+typedef list<pair<regexpCacheKey,CompiledRegExp*>> regexpCacheList;
+static Mutex regexpCacheMutex;
+//Most recently used patterns are at the front
+static regexpCacheList regexpCacheLRU;
+static map<regexpCacheKey,regexpCacheList::iterator> regexpCacheIndex;
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+/* The default JIT stack lives on the machine stack and is only 32K big,
+ * each thread gets its own one that can grow up to REGEXP_JIT_STACK_MAX */
+#define REGEXP_JIT_STACK_MIN (32*1024)
+#define REGEXP_JIT_STACK_MAX (1024*1024)
+/* Bound of the backtracking of the JIT code, which has no recursion limit */
+#define REGEXP_JIT_MATCH_LIMIT 1000000
+
+static void freeJitStack(gpointer stack)
+{
+	pcre_jit_stack_free((pcre_jit_stack*)stack);
+}
+DEFINE_AND_INITIALIZE_TLS_WITH_NOTIFY(regexpJitStack, freeJitStack);
+
+static pcre_jit_stack* getJitStack(void*)
+{
+	pcre_jit_stack* stack=(pcre_jit_stack*)tls_get(&regexpJitStack);
+	if(stack==NULL)
+	{
+		stack=pcre_jit_stack_alloc(REGEXP_JIT_STACK_MIN, REGEXP_JIT_STACK_MAX);
+		tls_set(&regexpJitStack, stack);
+	}
+	//When NULL is returned PCRE falls back to the machine stack
+	return stack;
+}
+#endif
+
+CompiledRegExp::CompiledRegExp(pcre* _re):re(_re),studyData(NULL),jitCompiled(false),capturingGroups(0),namedGroups(0),namedSize(0),nameTable(NULL)
+{
+	int studyOptions=0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+	studyOptions|=PCRE_STUDY_JIT_COMPILE;
+#endif
+	const char* error;
+	studyData=pcre_study(re, studyOptions, &error);
+	if(studyData)
+		extra=*studyData;
+	else
+		memset(&extra, 0, sizeof(extra));
+	limitedExtra=extra;
+	limitedExtra.match_limit_recursion=200;
+	limitedExtra.flags|=PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	jitLimitedExtra=extra;
+#ifdef PCRE_STUDY_JIT_COMPILE
+	int jit=0;
+	if(studyData && pcre_fullinfo(re, studyData, PCRE_INFO_JIT, &jit)==0 && jit)
+	{
+		jitCompiled=true;
+		//The callback is stored in the JIT data, so it is shared by all the copies of the extra
+		pcre_assign_jit_stack(studyData, getJitStack, NULL);
+		jitLimitedExtra.match_limit=REGEXP_JIT_MATCH_LIMIT;
+		jitLimitedExtra.flags|=PCRE_EXTRA_MATCH_LIMIT;
+	}
+#endif
+}
+
+int CompiledRegExp::exec(const tiny_string& str, int offset, bool limitRecursion, int* ovector, int ovectorSize) const
+{
+	if(!jitCompiled)
+		return pcre_exec(re, limitRecursion ? &limitedExtra : &extra, str.raw_buf(), str.numBytes(), offset, 0, ovector, ovectorSize);
+	int rc=pcre_exec(re, limitRecursion ? &jitLimitedExtra : &extra, str.raw_buf(), str.numBytes(), offset, 0, ovector, ovectorSize);
+#if defined(PCRE_ERROR_JIT_STACKLIMIT) && defined(PCRE_NO_JIT)
+	//The pattern needs more stack than the JIT can have, the interpreter has no such limit
+	if(rc==PCRE_ERROR_JIT_STACKLIMIT)
+		rc=pcre_exec(re, limitRecursion ? &limitedExtra : &extra, str.raw_buf(), str.numBytes(), offset, PCRE_NO_JIT, ovector, ovectorSize);
+#endif
+	return rc;
+}
+
+CompiledRegExp::~CompiledRegExp()
+{
+	if(studyData)
+	{
+#ifdef PCRE_STUDY_JIT_COMPILE
+		pcre_free_study(studyData);
+#else
+		pcre_free(studyData);
+#endif
+	}
+	pcre_free(re);
+}
+
+_NR<CompiledRegExp> CompiledRegExp::get(const tiny_string& source, int options)
+{
+	regexpCacheKey key(source.raw_buf(), options);
+	{
+		Locker l(regexpCacheMutex);
+		auto it=regexpCacheIndex.find(key);
+		if(it!=regexpCacheIndex.end())
+		{
+			regexpCacheLRU.splice(regexpCacheLRU.begin(), regexpCacheLRU, it->second);
+			CompiledRegExp* ret=it->second->second;
+			ret->incRef();
+			return _MNR(ret);
+		}
+	}
+
+	//Compile outside of the lock, it may take a while
+	const char * error;
+	int errorOffset;
+	int errorcode;
+	pcre* pcreRE=pcre_compile2(source.raw_buf(), options, &errorcode, &error, &errorOffset, NULL);
+	if(error)
+	{
+		if (errorcode == 64 && (options&PCRE_JAVASCRIPT_COMPAT)) // invalid pattern in javascript compatibility mode (we try again in normal mode to match flash behaviour)
+			pcreRE=pcre_compile2(source.raw_buf(), options&~PCRE_JAVASCRIPT_COMPAT, &errorcode, &error, &errorOffset, NULL);
+		if (error)
+			return NullRef;
+	}
+	CompiledRegExp* ret=new CompiledRegExp(pcreRE);
+	if(pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &ret->capturingGroups)!=0 ||
+		pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMECOUNT, &ret->namedGroups)!=0 ||
+		pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMEENTRYSIZE, &ret->namedSize)!=0 ||
+		pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMETABLE, &ret->nameTable)!=0)
+	{
+		ret->decRef();
+		return NullRef;
+	}
+
+	Locker l(regexpCacheMutex);
+	auto it=regexpCacheIndex.find(key);
+	if(it!=regexpCacheIndex.end())
+	{
+		//Another thread compiled the same pattern in the meantime
+		ret->decRef();
+		ret=it->second->second;
+	}
+	else
+	{
+		regexpCacheLRU.push_front(make_pair(key,ret));
+		regexpCacheIndex[key]=regexpCacheLRU.begin();
+		if(regexpCacheLRU.size()>REGEXP_CACHE_SIZE)
+		{
+			regexpCacheIndex.erase(regexpCacheLRU.back().first);
+			regexpCacheLRU.back().second->decRef();
+			regexpCacheLRU.pop_back();
+		}
+	}
+	ret->incRef();
+	return _MNR(ret);
+}
+
 RegExp::RegExp(Class_base* c):ASObject(c,T_OBJECT,SUBTYPE_REGEXP),dotall(false),global(false),ignoreCase(false),
 	extended(false),multiline(false),lastIndex(0)
 {
@@ -33,6 +188,12 @@ RegExp::RegExp(Class_base* c, const tiny_string& _re):ASObject(c,T_OBJECT,SUBTYP
 {
 }
 
+void RegExp::finalize()
+{
+	ASObject::finalize();
+	compiled.reset();
+}
+
 void RegExp::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_DYNAMIC_NOT_FINAL);
@@ -62,6 +223,7 @@ void RegExp::buildTraits(ASObject* o)
 ASFUNCTIONBODY(RegExp,_constructor)
 {
 	RegExp* th=static_cast<RegExp*>(obj);
+	th->compiled.reset();
 	if(argslen > 0 && args[0]->is<RegExp>())
 	{
 		if(argslen > 1 && !args[1]->is<Undefined>())
@@ -147,55 +309,22 @@ ASFUNCTIONBODY(RegExp,exec)
 
 ASObject *RegExp::match(const tiny_string& str)
 {
-	pcre* pcreRE = compile();
-	if (!pcreRE)
-		return getSystemState()->getNullRef();
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
+	_NR<CompiledRegExp> pcreRE = compile();
+	if (pcreRE.isNull())
 		return getSystemState()->getNullRef();
-	}
-	//Get information about named capturing groups
-	int namedGroups;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMECOUNT, &namedGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
-	//Get information about the size of named entries
-	int namedSize;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMEENTRYSIZE, &namedSize);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return getSystemState()->getNullRef();
-	}
+	int capturingGroups=pcreRE->capturingGroups;
 	struct nameEntry
 	{
 		uint16_t number;
 		char name[0];
 	};
-	char* entries;
-	infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_NAMETABLE, &entries);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		lastIndex=0;
-		return getSystemState()->getNullRef();
-	}
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+	char* entries=pcreRE->nameTable;
 	int ovector[(capturingGroups+1)*3];
 	int offset=global?lastIndex:0;
-	int rc=pcre_exec(pcreRE,capturingGroups > 200 ? &extra : NULL, str.raw_buf(), str.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc=pcreRE->exec(str, offset, capturingGroups > 200, ovector, (capturingGroups+1)*3);
 	if(rc<0)
 	{
 		//No matches or error
-		pcre_free(pcreRE);
 		return getSystemState()->getNullRef();
 	}
 	Array* a=Class<Array>::getInstanceSNoArgs(getSystemState());
@@ -214,17 +343,16 @@ ASObject *RegExp::match(const tiny_string& str)
 	int index = tmp.numChars();
 
 	a->setVariableByQName("index","",abstract_i(getSystemState(),index),DYNAMIC_TRAIT);
-	for(int i=0;i<namedGroups;i++)
+	for(int i=0;i<pcreRE->namedGroups;i++)
 	{
 		nameEntry* entry=reinterpret_cast<nameEntry*>(entries);
 		uint16_t num=GINT16_FROM_BE(entry->number);
 		ASObject* captured=a->at(num).getPtr();
 		captured->incRef();
 		a->setVariableByQName(tiny_string(entry->name, true),"",captured,DYNAMIC_TRAIT);
-		entries+=namedSize;
+		entries+=pcreRE->namedSize;
 	}
 	lastIndex=ovector[1];
-	pcre_free(pcreRE);
 	return a;
 }
 
@@ -235,26 +363,16 @@ ASFUNCTIONBODY(RegExp,test)
 	RegExp* th=static_cast<RegExp*>(obj);
 
 	const tiny_string& arg0 = args[0]->toString();
-	pcre* pcreRE = th->compile();
-	if (!pcreRE)
+	_NR<CompiledRegExp> pcreRE = th->compile();
+	if (pcreRE.isNull())
 		return obj->getSystemState()->getNullRef();
 
-	int capturingGroups;
-	int infoOk=pcre_fullinfo(pcreRE, NULL, PCRE_INFO_CAPTURECOUNT, &capturingGroups);
-	if(infoOk!=0)
-	{
-		pcre_free(pcreRE);
-		return obj->getSystemState()->getNullRef();
-	}
+	int capturingGroups=pcreRE->capturingGroups;
 	int ovector[(capturingGroups+1)*3];
 	
 	int offset=(th->global)?th->lastIndex:0;
-	pcre_extra extra;
-	extra.match_limit_recursion=200;
-	extra.flags = PCRE_EXTRA_MATCH_LIMIT_RECURSION;
-	int rc = pcre_exec(pcreRE, &extra, arg0.raw_buf(), arg0.numBytes(), offset, 0, ovector, (capturingGroups+1)*3);
+	int rc = pcreRE->exec(arg0, offset, true, ovector, (capturingGroups+1)*3);
 	bool ret = (rc >= 0);
-	pcre_free(pcreRE);
 
 	return abstract_b(obj->getSystemState(),ret);
 }
@@ -282,8 +400,12 @@ ASFUNCTIONBODY(RegExp,_toString)
 	return abstract_s(obj->getSystemState(),ret);
 }
 
-pcre* RegExp::compile()
+_NR<CompiledRegExp> RegExp::compile()
 {
+	//source and flags only change in the constructor, which drops the compiled pattern
+	if(!compiled.isNull())
+		return compiled;
+
 	int options = PCRE_UTF8|PCRE_NEWLINE_ANY|PCRE_JAVASCRIPT_COMPAT;
 	if(ignoreCase)
 		options |= PCRE_CASELESS;
@@ -294,19 +416,6 @@ pcre* RegExp::compile()
 	if(dotall)
 		options|=PCRE_DOTALL;
 
-	const char * error;
-	int errorOffset;
-	int errorcode;
-	pcre* pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
-	if(error)
-	{
-		if (errorcode == 64) // invalid pattern in javascript compatibility mode (we try again in normal mode to match flash behaviour)
-		{
-			options &= ~PCRE_JAVASCRIPT_COMPAT;
-			pcreRE=pcre_compile2(source.raw_buf(), options,&errorcode,  &error, &errorOffset,NULL);
-		}
-		if (error)
-			return NULL;
-	}
-	return pcreRE;
+	compiled=CompiledRegExp::get(source, options);
+	return compiled;
 }
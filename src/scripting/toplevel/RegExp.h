@@ -26,12 +26,41 @@
 namespace lightspark
 {
 
+/* A compiled and studied pattern. Instances are shared between all the
+ * RegExp objects with the same source and options, through a bounded
+ * LRU cache. pcre_exec is reentrant, so they can be used from any thread */
+class CompiledRegExp: public RefCountable
+{
+private:
+	pcre* re;
+	pcre_extra* studyData;
+	CompiledRegExp(pcre* _re);
+public:
+	~CompiledRegExp();
+	/* The study data, with and without the recursion limit used by test/split/replace/search.
+	 * The JIT ignores the recursion limit, jitLimitedExtra limits the matches instead */
+	pcre_extra extra;
+	pcre_extra limitedExtra;
+	pcre_extra jitLimitedExtra;
+	bool jitCompiled;
+	int capturingGroups;
+	int namedGroups;
+	int namedSize;
+	char* nameTable;
+	int exec(const tiny_string& str, int offset, bool limitRecursion, int* ovector, int ovectorSize) const;
+	/* Returns NULL if the pattern is not valid */
+	static _NR<CompiledRegExp> get(const tiny_string& source, int options);
+};
+
 class RegExp: public ASObject
 {
+private:
+	_NR<CompiledRegExp> compiled;
 public:
 	RegExp(Class_base* c);
 	RegExp(Class_base* c, const tiny_string& _re);
-	pcre* compile();
+	void finalize();
+	_NR<CompiledRegExp> compile();
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
 	ASObject *match(const tiny_string& str);
@@ -22,6 +22,8 @@
 #include "scripting/class.h"
 #include "parsing/amf3_generator.h"
 #include "scripting/argconv.h"
+#include <algorithm>
+#include <functional>
 
 using namespace std;
 using namespace lightspark;
@@ -97,7 +99,9 @@ void Vector::sinit(Class_base* c)
 	c->prototype->setVariableByQName("unshift",AS3,Class<IFunction>::getFunction(c->getSystemState(),unshift),DYNAMIC_TRAIT);
 }
 
-Vector::Vector(Class_base* c, const Type *vtype):ASObject(c,T_OBJECT,SUBTYPE_VECTOR),vec_type(vtype),fixed(false),vec(reporter_allocator<ASObject*>(c->memoryAccount))
+Vector::Vector(Class_base* c, const Type *vtype):ASObject(c,T_OBJECT,SUBTYPE_VECTOR),vec_type(vtype),fixed(false),storage(STORE_OBJECT),
+	vec(reporter_allocator<ASObject*>(c->memoryAccount)),vec_i(reporter_allocator<int32_t>(c->memoryAccount)),
+	vec_ui(reporter_allocator<uint32_t>(c->memoryAccount)),vec_d(reporter_allocator<number_t>(c->memoryAccount))
 {
 }
 
@@ -110,6 +114,13 @@ void Vector::setTypes(const std::vector<const Type *> &types)
 	assert(vec_type == NULL);
 	if(types.size() == 1)
 		vec_type = types[0];
+	//int, uint and Number are final, so the type is enough to unbox the elements
+	if(vec_type == Class<Integer>::getClass(getSystemState()))
+		storage = STORE_INT;
+	else if(vec_type == Class<UInteger>::getClass(getSystemState()))
+		storage = STORE_UINT;
+	else if(vec_type == Class<Number>::getClass(getSystemState()))
+		storage = STORE_NUMBER;
 }
 bool Vector::sameType(const Class_base *cls) const
 {
@@ -117,14 +128,211 @@ bool Vector::sameType(const Class_base *cls) const
 	return (clsname.startsWith(cls->class_name.getQualifiedName(getSystemState()).raw_buf()));
 }
 
+ASObject* Vector::getElement(uint32_t index) const
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			return abstract_i(getSystemState(),vec_i[index]);
+		case STORE_UINT:
+			return abstract_ui(getSystemState(),vec_ui[index]);
+		case STORE_NUMBER:
+			return abstract_d(getSystemState(),vec_d[index]);
+		default:
+			if(vec[index])
+			{
+				vec[index]->incRef();
+				return vec[index];
+			}
+			return vec_type->coerce(getSystemState()->getNullRef());
+	}
+}
+
+void Vector::setElement(uint32_t index, ASObject* o)
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			vec_i[index]=o->toInt();
+			break;
+		case STORE_UINT:
+			vec_ui[index]=o->toUInt();
+			break;
+		case STORE_NUMBER:
+			vec_d[index]=o->toNumber();
+			break;
+		default:
+		{
+			ASObject* coerced=vec_type->coerce(o);
+			if(vec[index])
+				vec[index]->decRef();
+			vec[index]=coerced;
+			return;
+		}
+	}
+	o->decRef();
+}
+
+void Vector::pushElement(ASObject* o)
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			vec_i.push_back(o->toInt());
+			break;
+		case STORE_UINT:
+			vec_ui.push_back(o->toUInt());
+			break;
+		case STORE_NUMBER:
+			vec_d.push_back(o->toNumber());
+			break;
+		default:
+			vec.push_back(vec_type->coerce(o));
+			return;
+	}
+	o->decRef();
+}
+
+void Vector::insertElement(uint32_t index, ASObject* o)
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			vec_i.insert(vec_i.begin()+index,o->toInt());
+			break;
+		case STORE_UINT:
+			vec_ui.insert(vec_ui.begin()+index,o->toUInt());
+			break;
+		case STORE_NUMBER:
+			vec_d.insert(vec_d.begin()+index,o->toNumber());
+			break;
+		default:
+			vec.insert(vec.begin()+index,vec_type->coerce(o));
+			return;
+	}
+	o->decRef();
+}
+
+void Vector::appendElements(Vector* src, uint32_t index, uint32_t count)
+{
+	if(storage!=src->storage || (storage==STORE_OBJECT && vec_type!=src->vec_type))
+	{
+		for(uint32_t i=0;i<count;i++)
+			pushElement(src->getElement(index+i));
+		return;
+	}
+	switch(storage)
+	{
+		case STORE_INT:
+			vec_i.insert(vec_i.end(),src->vec_i.begin()+index,src->vec_i.begin()+index+count);
+			break;
+		case STORE_UINT:
+			vec_ui.insert(vec_ui.end(),src->vec_ui.begin()+index,src->vec_ui.begin()+index+count);
+			break;
+		case STORE_NUMBER:
+			vec_d.insert(vec_d.end(),src->vec_d.begin()+index,src->vec_d.begin()+index+count);
+			break;
+		default:
+			for(uint32_t i=0;i<count;i++)
+			{
+				ASObject* o=src->vec[index+i];
+				if(o)
+					o->incRef();
+				vec.push_back(o);
+			}
+			break;
+	}
+}
+
+void Vector::eraseElements(uint32_t index, uint32_t count)
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			vec_i.erase(vec_i.begin()+index,vec_i.begin()+index+count);
+			break;
+		case STORE_UINT:
+			vec_ui.erase(vec_ui.begin()+index,vec_ui.begin()+index+count);
+			break;
+		case STORE_NUMBER:
+			vec_d.erase(vec_d.begin()+index,vec_d.begin()+index+count);
+			break;
+		default:
+			for(uint32_t i=index;i<index+count;i++)
+			{
+				if(vec[i])
+					vec[i]->decRef();
+			}
+			vec.erase(vec.begin()+index,vec.begin()+index+count);
+			break;
+	}
+}
+
+void Vector::resizeElements(uint32_t len)
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			vec_i.resize(len, 0);
+			break;
+		case STORE_UINT:
+			vec_ui.resize(len, 0);
+			break;
+		case STORE_NUMBER:
+			vec_d.resize(len, 0);
+			break;
+		default:
+			for(size_t i=len; i<vec.size(); ++i)
+			{
+				if(vec[i])
+					vec[i]->decRef();
+			}
+			vec.resize(len, NULL);
+			break;
+	}
+}
+
+void Vector::clearElements()
+{
+	resizeElements(0);
+}
+
+tiny_string Vector::elementToString(uint32_t index) const
+{
+	switch(storage)
+	{
+		case STORE_INT:
+			return Integer::toString(vec_i[index]);
+		case STORE_UINT:
+			return UInteger::toString(vec_ui[index]);
+		case STORE_NUMBER:
+			return Number::toString(vec_d[index]);
+		default:
+			return _MR(getElement(index))->toString();
+	}
+}
+
+bool Vector::isElementEqualStrict(uint32_t index, ASObject* o)
+{
+	if(storage==STORE_OBJECT)
+		return vec[index] && vec[index]->isEqualStrict(o);
+	switch(o->getObjectType())
+	{
+		case T_INTEGER:
+		case T_UINTEGER:
+		case T_NUMBER:
+			return numberAt(index)==o->toNumber();
+		default:
+			return false;
+	}
+}
+
 ASObject* Vector::generator(TemplatedClass<Vector>* o_class, ASObject* const* args, const unsigned int argslen)
 {
 	assert_and_throw(argslen == 1);
 	assert_and_throw(args[0]->getClass());
 	assert_and_throw(o_class->getTypes().size() == 1);
 
-	const Type* type = o_class->getTypes()[0];
-
 	if(args[0]->getClass() == Class<Array>::getClass(args[0]->getSystemState()))
 	{
 		//create object without calling _constructor
@@ -136,7 +344,7 @@ ASObject* Vector::generator(TemplatedClass<Vector>* o_class, ASObject* const* ar
 			_R<ASObject> obj = a->at(i);
 			obj->incRef();
 			//Convert the elements of the array to the type of this vector
-			ret->vec.push_back( type->coerce(obj.getPtr()) );
+			ret->pushElement(obj.getPtr());
 		}
 		return ret;
 	}
@@ -146,11 +354,8 @@ ASObject* Vector::generator(TemplatedClass<Vector>* o_class, ASObject* const* ar
 
 		//create object without calling _constructor
 		Vector* ret = o_class->getInstance(false,NULL,0);
-		for(auto i = arg->vec.begin(); i != arg->vec.end(); ++i)
-		{
-			(*i)->incRef();
-			ret->vec.push_back( type->coerce(*i) );
-		}
+		for(uint32_t i=0;i<arg->size();i++)
+			ret->pushElement(arg->getElement(i));
 		return ret;
 	}
 	else
@@ -172,7 +377,7 @@ ASFUNCTIONBODY(Vector,_constructor)
 	Vector* th=static_cast< Vector *>(obj);
 	assert(th->vec_type);
 	th->fixed = fixed;
-	th->vec.resize(len, NULL);
+	th->resizeElements(len);
 
 	return NULL;
 }
@@ -182,45 +387,36 @@ ASFUNCTIONBODY(Vector,_concat)
 	Vector* th=static_cast<Vector*>(obj);
 	Vector* ret= (Vector*)obj->getClass()->getInstance(true,NULL,0);
 	// copy values into new Vector
-	ret->vec.resize(th->size(), NULL);
-	auto it=th->vec.begin();
-	uint32_t index = 0;
-	for(;it != th->vec.end();++it)
-	{
-		if (*it)
-		{
-			ret->vec[index]=*it;
-			ret->vec[index]->incRef();
-		}
-		index++;
-	}
+	ret->appendElements(th,0,th->size());
 	//Insert the arguments in the vector
 	for(unsigned int i=0;i<argslen;i++)
 	{
 		if (args[i]->is<Vector>())
 		{
 			Vector* arg=static_cast<Vector*>(args[i]);
-			ret->vec.resize(index+arg->size(), NULL);
-			auto it=arg->vec.begin();
-			for(;it != arg->vec.end();++it)
+			if (arg->vec_type == th->vec_type)
+			{
+				ret->appendElements(arg,0,arg->size());
+				continue;
+			}
+			for(uint32_t j=0;j<arg->size();j++)
 			{
-				if (*it)
+				if (arg->isUnset(j))
 				{
-					// force Class_base to ensure that a TypeError is thrown 
-					// if the object type does not match the base vector type
-					ret->vec[index]=((Class_base*)th->vec_type)->Class_base::coerce(*it);
-					ret->vec[index]->incRef();
+					ret->pushElement(obj->getSystemState()->getNullRef());
+					continue;
 				}
-				index++;
+				// force Class_base to ensure that a TypeError is thrown
+				// if the object type does not match the base vector type
+				ret->pushElement(((Class_base*)th->vec_type)->Class_base::coerce(arg->getElement(j)));
 			}
 		}
 		else
 		{
-			ret->vec[index] = th->vec_type->coerce(args[i]);
-			ret->vec[index]->incRef();
-			index++;
+			args[i]->incRef();
+			ret->pushElement(args[i]);
 		}
-	}	
+	}
 	return ret;
 }
 
@@ -231,7 +427,7 @@ ASFUNCTIONBODY(Vector,filter)
 	if (!args[0]->is<IFunction>())
 		throwError<TypeError>(kCheckTypeFailedError, args[0]->getClassName(), "Function");
 	Vector* th=static_cast<Vector*>(obj);
-	  
+
 	IFunction* f = static_cast<IFunction*>(args[0]);
 	ASObject* params[3];
 	Vector* ret= (Vector*)obj->getClass()->getInstance(true,NULL,0);
@@ -239,10 +435,9 @@ ASFUNCTIONBODY(Vector,filter)
 
 	for(unsigned int i=0;i<th->size();i++)
 	{
-		if (!th->vec[i])
+		if (th->isUnset(i))
 			continue;
-		params[0] = th->vec[i];
-		th->vec[i]->incRef();
+		params[0] = th->getElement(i);
 		params[1] = abstract_i(obj->getSystemState(),i);
 		params[2] = th;
 		th->incRef();
@@ -259,10 +454,7 @@ ASFUNCTIONBODY(Vector,filter)
 		if(funcRet)
 		{
 			if(Boolean_concrete(funcRet))
-			{
-				th->vec[i]->incRef();
-				ret->vec.push_back(th->vec[i]);
-			}
+				ret->appendElements(th,i,1);
 			funcRet->decRef();
 		}
 	}
@@ -282,10 +474,9 @@ ASFUNCTIONBODY(Vector, some)
 
 	for(unsigned int i=0; i < th->size(); i++)
 	{
-		if (!th->vec[i])
+		if (th->isUnset(i))
 			continue;
-		params[0] = th->vec[i];
-		th->vec[i]->incRef();
+		params[0] = th->getElement(i);
 		params[1] = abstract_i(obj->getSystemState(),i);
 		params[2] = th;
 		th->incRef();
@@ -324,13 +515,10 @@ ASFUNCTIONBODY(Vector, every)
 
 	for(unsigned int i=0; i < th->size(); i++)
 	{
-		if (th->vec[i])
-		{
-			params[0] = th->vec[i];
-			th->vec[i]->incRef();
-		}
-		else
+		if (th->isUnset(i))
 			params[0] = obj->getSystemState()->getNullRef();
+		else
+			params[0] = th->getElement(i);
 		params[1] = abstract_i(obj->getSystemState(),i);
 		params[2] = th;
 		th->incRef();
@@ -366,7 +554,7 @@ void Vector::append(ASObject *o)
 		throwError<RangeError>(kVectorFixedError);
 	}
 
-	vec.push_back(vec_type->coerce(o));
+	pushElement(o);
 }
 
 ASFUNCTIONBODY(Vector,push)
@@ -379,9 +567,9 @@ ASFUNCTIONBODY(Vector,push)
 		args[i]->incRef();
 		//The proprietary player violates the specification and allows elements of any type to be pushed;
 		//they are converted to the vec_type
-		th->vec.push_back( th->vec_type->coerce(args[i]) );
+		th->pushElement(args[i]);
 	}
-	return abstract_ui(obj->getSystemState(),th->vec.size());
+	return abstract_ui(obj->getSystemState(),th->size());
 }
 
 ASFUNCTIONBODY(Vector,_pop)
@@ -392,16 +580,14 @@ ASFUNCTIONBODY(Vector,_pop)
 	uint32_t size =th->size();
 	if (size == 0)
         return th->vec_type->coerce(obj->getSystemState()->getNullRef());
-	ASObject* ret = th->vec[size-1];
-	if (!ret)
-		ret = th->vec_type->coerce(obj->getSystemState()->getNullRef());
-	th->vec.pop_back();
+	ASObject* ret = th->getElement(size-1);
+	th->eraseElements(size-1,1);
 	return ret;
 }
 
 ASFUNCTIONBODY(Vector,getLength)
 {
-	return abstract_ui(obj->getSystemState(),obj->as<Vector>()->vec.size());
+	return abstract_ui(obj->getSystemState(),obj->as<Vector>()->size());
 }
 
 ASFUNCTIONBODY(Vector,setLength)
@@ -411,13 +597,7 @@ ASFUNCTIONBODY(Vector,setLength)
 		throwError<RangeError>(kVectorFixedError);
 	uint32_t len;
 	ARG_UNPACK (len);
-	if(len <= th->vec.size())
-	{
-		for(size_t i=len; i< th->vec.size(); ++i)
-			if(th->vec[i])
-				th->vec[i]->decRef();
-	}
-	th->vec.resize(len, NULL);
+	th->resizeElements(len);
 	return NULL;
 }
 
@@ -447,10 +627,9 @@ ASFUNCTIONBODY(Vector,forEach)
 
 	for(unsigned int i=0; i < th->size(); i++)
 	{
-		if (!th->vec[i])
+		if (th->isUnset(i))
 			continue;
-		params[0] = th->vec[i];
-		th->vec[i]->incRef();
+		params[0] = th->getElement(i);
 		params[1] = abstract_i(obj->getSystemState(),i);
 		params[2] = th;
 		th->incRef();
@@ -476,16 +655,20 @@ ASFUNCTIONBODY(Vector, _reverse)
 {
 	Vector* th = static_cast<Vector*>(obj);
 
-	std::vector<ASObject*> tmp = std::vector<ASObject*>(th->vec.begin(),th->vec.end());
-	uint32_t size = th->size();
-	th->vec.clear();
-	th->vec.resize(size, NULL);
-	std::vector<ASObject*>::iterator it=tmp.begin();
-	uint32_t index = size-1;
-	for(;it != tmp.end();++it)
- 	{
-		th->vec[index]=*it;
-		index--;
+	switch(th->storage)
+	{
+		case STORE_INT:
+			std::reverse(th->vec_i.begin(),th->vec_i.end());
+			break;
+		case STORE_UINT:
+			std::reverse(th->vec_ui.begin(),th->vec_ui.end());
+			break;
+		case STORE_NUMBER:
+			std::reverse(th->vec_d.begin(),th->vec_d.end());
+			break;
+		default:
+			std::reverse(th->vec.begin(),th->vec.end());
+			break;
 	}
 	th->incRef();
 	return th;
@@ -498,7 +681,7 @@ ASFUNCTIONBODY(Vector,lastIndexOf)
 	int ret=-1;
 	ASObject* arg0=args[0];
 
-	if(th->vec.size() == 0)
+	if(th->size() == 0)
 		return abstract_di(obj->getSystemState(),-1);
 
 	size_t i = th->size()-1;
@@ -526,9 +709,7 @@ ASFUNCTIONBODY(Vector,lastIndexOf)
 	}
 	do
 	{
-		if (!th->vec[i])
-		    continue;
-		if (th->vec[i]->isEqualStrict(arg0))
+		if (th->isElementEqualStrict(i,arg0))
 		{
 			ret=i;
 			break;
@@ -546,23 +727,8 @@ ASFUNCTIONBODY(Vector,shift)
 		throwError<RangeError>(kVectorFixedError);
 	if(!th->size())
 		return th->vec_type->coerce(obj->getSystemState()->getNullRef());
-	ASObject* ret;
-	if(th->vec[0])
-		ret=th->vec[0];
-	else
-		ret=th->vec_type->coerce(obj->getSystemState()->getNullRef());
-	for(uint32_t i= 1;i< th->size();i++)
-	{
-		if (th->vec[i])
-		{
-			th->vec[i-1]=th->vec[i];
-		}
-		else if (th->vec[i-1])
-		{
-			th->vec[i-1] = NULL;
-		}
-	}
-	th->vec.resize(th->size()-1, NULL);
+	ASObject* ret=th->getElement(0);
+	th->eraseElements(0,1);
 	return ret;
 }
 
@@ -599,17 +765,8 @@ ASFUNCTIONBODY(Vector,slice)
 	startIndex=th->capIndex(startIndex);
 	endIndex=th->capIndex(endIndex);
 	Vector* ret= (Vector*)obj->getClass()->getInstance(true,NULL,0);
-	ret->vec.resize(endIndex-startIndex, NULL);
-	int j = 0;
-	for(int i=startIndex; i<endIndex; i++) 
-	{
-		if (th->vec[i])
-		{
-			th->vec[i]->incRef();
-			ret->vec[j] =th->vec_type->coerce(th->vec[i]);
-		}
-		j++;
-	}
+	if(endIndex>startIndex)
+		ret->appendElements(th,startIndex,endIndex-startIndex);
 	return ret;
 }
 
@@ -632,50 +789,17 @@ ASFUNCTIONBODY(Vector,splice)
 	if((startIndex+deleteCount)>totalSize)
 		deleteCount=totalSize-startIndex;
 
-	ret->vec.resize(deleteCount, NULL);
-	if(deleteCount)
-	{
-		// write deleted items to return array
-		for(int i=0;i<deleteCount;i++)
-		{
-			if (th->vec[startIndex+i])
-				ret->vec[i] = th->vec[startIndex+i];
-		}
-		// delete items from current array
-		for (int i = 0; i < deleteCount; i++)
-		{
-			if(th->vec[startIndex+i])
-			{
-				th->vec[startIndex+i] = NULL;
-			}
-		}
-	}
-	// remember items in current array that have to be moved to new position
-	vector<ASObject*> tmp = vector<ASObject*>(totalSize- (startIndex+deleteCount));
-	tmp.resize(totalSize- (startIndex+deleteCount), NULL);
-	for (int i = startIndex+deleteCount; i < totalSize ; i++)
+	if(deleteCount>0)
 	{
-		if (th->vec[i])
-		{
-			tmp[i-(startIndex+deleteCount)] = th->vec[i];
-			th->vec[i] = NULL;
-		}
+		// move deleted items to the returned vector
+		ret->appendElements(th,startIndex,deleteCount);
+		th->eraseElements(startIndex,deleteCount);
 	}
-	th->vec.resize(startIndex, NULL);
-
-	
 	//Insert requested values starting at startIndex
 	for(unsigned int i=2;i<argslen;i++)
 	{
 		args[i]->incRef();
-		th->vec.push_back(args[i]);
-	}
-	// move remembered items to new position
-	th->vec.resize((totalSize-deleteCount)+(argslen > 2 ? argslen-2 : 0), NULL);
-	for(int i=0;i<totalSize- (startIndex+deleteCount);i++)
-	{
-		if (tmp[i])
-			th->vec[startIndex+i+(argslen > 2 ? argslen-2 : 0)] = tmp[i];
+		th->insertElement(startIndex+i-2,args[i]);
 	}
 	return ret;
 }
@@ -683,15 +807,15 @@ ASFUNCTIONBODY(Vector,splice)
 ASFUNCTIONBODY(Vector,join)
 {
 	Vector* th=static_cast<Vector*>(obj);
-	
+
 	tiny_string del = ",";
 	if (argslen == 1)
 	      del=args[0]->toString();
 	string ret;
 	for(uint32_t i=0;i<th->size();i++)
 	{
-		if (th->vec[i])
-			ret+=th->vec[i]->toString().raw_buf();
+		if (!th->isUnset(i))
+			ret+=th->elementToString(i).raw_buf();
 		if(i!=th->size()-1)
 			ret+=del.raw_buf();
 	}
@@ -713,9 +837,7 @@ ASFUNCTIONBODY(Vector,indexOf)
 
 	for(;i<th->size();i++)
 	{
-		if (!th->vec[i])
-			continue;
-		if(th->vec[i]->isEqualStrict(arg0))
+		if(th->isElementEqualStrict(i,arg0))
 		{
 			ret=i;
 			break;
@@ -786,12 +908,21 @@ bool Vector::sortComparatorWrapper::operator()(ASObject* d1, ASObject* d2)
 	return (ret->toNumber()<0); //Less
 }
 
+template<class T>
+static void sortUnboxed(T& values, bool isDescending)
+{
+	if(isDescending)
+		sort(values.begin(),values.end(),greater<typename T::value_type>());
+	else
+		sort(values.begin(),values.end());
+}
+
 ASFUNCTIONBODY(Vector,_sort)
 {
 	if (argslen != 1)
 		throwError<ArgumentError>(kWrongArgumentCountError, "Vector.sort", "1", Integer::toString(argslen));
 	Vector* th=static_cast<Vector*>(obj);
-	
+
 	IFunction* comp=NULL;
 	bool isNumeric=false;
 	bool isCaseInsensitive=false;
@@ -813,22 +944,47 @@ ASFUNCTIONBODY(Vector,_sort)
 		if(options&(~(Array::NUMERIC|Array::CASEINSENSITIVE|Array::DESCENDING)))
 			throw UnsupportedException("Vector::sort not completely implemented");
 	}
-	std::vector<ASObject*> tmp = vector<ASObject*>(th->vec.size());
-	int i = 0;
-	for(auto it=th->vec.begin();it != th->vec.end();++it)
+
+	//Numeric sorts of unboxed values do not need any conversion
+	if(comp==NULL && isNumeric && th->storage!=STORE_OBJECT)
 	{
-		tmp[i++]= *it;
+		switch(th->storage)
+		{
+			case STORE_INT:
+				sortUnboxed(th->vec_i,isDescending);
+				break;
+			case STORE_UINT:
+				sortUnboxed(th->vec_ui,isDescending);
+				break;
+			default:
+				for(auto it=th->vec_d.begin();it != th->vec_d.end();++it)
+				{
+					if(std::isnan(*it))
+						throw RunTimeException("Cannot sort non number with Array.NUMERIC option");
+				}
+				sortUnboxed(th->vec_d,isDescending);
+				break;
+		}
+		obj->incRef();
+		return obj;
 	}
-	
+
+	std::vector<ASObject*> tmp = vector<ASObject*>(th->size());
+	for(uint32_t i=0;i<tmp.size();i++)
+		tmp[i]= th->storage==STORE_OBJECT ? th->vec[i] : th->getElement(i);
+
 	if(comp)
 		sort(tmp.begin(),tmp.end(),sortComparatorWrapper(comp,th->vec_type));
 	else
 		sort(tmp.begin(),tmp.end(),sortComparatorDefault(isNumeric,isCaseInsensitive,isDescending));
 
-	th->vec.clear();
-	for(auto ittmp=tmp.begin();ittmp != tmp.end();++ittmp)
+	if(th->storage==STORE_OBJECT)
+		th->vec.assign(tmp.begin(),tmp.end());
+	else
 	{
-		th->vec.push_back(*ittmp);
+		th->clearElements();
+		for(auto ittmp=tmp.begin();ittmp != tmp.end();++ittmp)
+			th->pushElement(*ittmp);
 	}
 	obj->incRef();
 	return obj;
@@ -839,24 +995,10 @@ ASFUNCTIONBODY(Vector,unshift)
 	Vector* th=static_cast<Vector*>(obj);
 	if (th->fixed)
 		throwError<RangeError>(kVectorFixedError);
-	if (argslen > 0)
+	for(uint32_t i=0;i<argslen;i++)
 	{
-		th->vec.resize(th->size()+argslen, NULL);
-		for(uint32_t i=th->size();i> 0;i--)
-		{
-			if (th->vec[i-1])
-			{
-				th->vec[(i-1)+argslen]=th->vec[i-1];
-				th->vec[i-1] = NULL;
-			}
-			
-		}
-		
-		for(uint32_t i=0;i<argslen;i++)
-		{
-			args[i]->incRef();
-			th->vec[i] = th->vec_type->coerce(args[i]);
-		}
+		args[i]->incRef();
+		th->insertElement(i,args[i]);
 	}
 	return abstract_i(obj->getSystemState(),th->size());
 }
@@ -866,30 +1008,22 @@ ASFUNCTIONBODY(Vector,_map)
 	Vector* th=static_cast<Vector*>(obj);
 	_NR<IFunction> func;
 	_NR<ASObject> thisObject;
-	
+
 	if (argslen >= 1 && !args[0]->is<IFunction>())
 		throwError<TypeError>(kCheckTypeFailedError, args[0]->getClassName(), "Function");
 
 	ARG_UNPACK(func)(thisObject,NullRef);
-	
+
 	Vector* ret= (Vector*)obj->getClass()->getInstance(true,NULL,0);
 
 	ASObject* thisObj;
 	for(uint32_t i=0;i<th->size();i++)
 	{
 		ASObject* funcArgs[3];
-		if (!th->vec[i])
+		if (th->isUnset(i))
 			funcArgs[0]=obj->getSystemState()->getNullRef();
 		else
-		{
-			if(th->vec[i])
-			{
-				funcArgs[0]=th->vec[i];
-				funcArgs[0]->incRef();
-			}
-			else
-				funcArgs[0]=obj->getSystemState()->getUndefinedRef();
-		}
+			funcArgs[0]=th->getElement(i);
 		funcArgs[1]=abstract_i(obj->getSystemState(),i);
 		funcArgs[2]=th;
 		funcArgs[2]->incRef();
@@ -902,7 +1036,7 @@ ASFUNCTIONBODY(Vector,_map)
 		}
 		ASObject* funcRet=func->call(thisObj, funcArgs, 3);
 		assert_and_throw(funcRet);
-		ret->vec.push_back(funcRet);
+		ret->pushElement(funcRet);
 	}
 
 	return ret;
@@ -912,15 +1046,12 @@ ASFUNCTIONBODY(Vector,_toString)
 {
 	tiny_string ret;
 	Vector* th = obj->as<Vector>();
-	for(size_t i=0; i < th->vec.size(); ++i)
+	for(size_t i=0; i < th->size(); ++i)
 	{
-		if (th->vec[i])
-			ret += th->vec[i]->toString();
-		else
-			// use the type's default value
-			ret += th->vec_type->coerce( obj->getSystemState()->getNullRef() )->toString();
+		// unset elements use the type's default value
+		ret += th->elementToString(i);
 
-		if(i!=th->vec.size()-1)
+		if(i!=th->size()-1)
 			ret += ',';
 	}
 	return abstract_s(obj->getSystemState(),ret);
@@ -935,21 +1066,16 @@ ASFUNCTIONBODY(Vector,insertAt)
 	_NR<ASObject> o;
 	ARG_UNPACK(index)(o);
 
-	if (index < 0 && th->vec.size() >= (uint32_t)(-index))
-		index = th->vec.size()+(index);
+	if (index < 0 && th->size() >= (uint32_t)(-index))
+		index = th->size()+(index);
 	if (index < 0)
 		index = 0;
-	LOG(LOG_ERROR,"insertat:"<<index<<" "<<th->vec.size()<<" "<<th->toString());
-	if ((uint32_t)index >= th->vec.size())
-	{
-		o->incRef();
-		th->vec.push_back(o.getPtr());
-	}
+	LOG(LOG_ERROR,"insertat:"<<index<<" "<<th->size()<<" "<<th->toString());
+	o->incRef();
+	if ((uint32_t)index >= th->size())
+		th->pushElement(o.getPtr());
 	else
-	{
-		o->incRef();
-		th->vec.insert(th->vec.begin()+index,o.getPtr());
-	}
+		th->insertElement(index,o.getPtr());
 	return NULL;
 }
 
@@ -961,18 +1087,18 @@ ASFUNCTIONBODY(Vector,removeAt)
 	int32_t index;
 	ARG_UNPACK(index);
 	if (index < 0)
-		index = th->vec.size()+index;
+		index = th->size()+index;
 	if (index < 0)
 		index = 0;
 	ASObject* o = NULL;
-	if (index < th->vec.size())
+	if ((uint32_t)index < th->size())
 	{
-		o = th->vec[index];
-		th->vec.erase(th->vec.begin()+index);
+		o = th->getElement(index);
+		th->eraseElements(index,1);
 	}
 	else
 		throwError<RangeError>(kOutOfRangeError);
-		
+
 	return o;
 }
 
@@ -988,7 +1114,7 @@ bool Vector::hasPropertyByMultiname(const multiname& name, bool considerDynamic,
 	if(!Vector::isValidMultiname(getSystemState(),name,index))
 		return ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype);
 
-	if(index < vec.size())
+	if(index < size())
 		return true;
 	else
 		return false;
@@ -1009,28 +1135,20 @@ _NR<ASObject> Vector::getVariableByMultiname(const multiname& name, GET_VARIABLE
 	{
 		if (name.name_type == multiname::NAME_INT || name.name_type == multiname::NAME_UINT ||
 				(name.name_type == multiname::NAME_NUMBER && Number::isInteger(name.name_d)))
-			throwError<RangeError>(kOutOfRangeError,Integer::toString(name.name_i),Integer::toString(vec.size()));
+			throwError<RangeError>(kOutOfRangeError,Integer::toString(name.name_i),Integer::toString(size()));
 
 		_NR<ASObject> ret = ASObject::getVariableByMultiname(name,opt);
-		if (ret.isNull()) 
+		if (ret.isNull())
 			throwError<ReferenceError>(kReadSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 		return ret;
 	}
-	if(index < vec.size())
-	{
-		if (vec[index])
-		{
-			vec[index]->incRef();
-			return _MNR(vec[index]);
-		}
-		else
-			return _MNR(vec_type->coerce( getSystemState()->getNullRef() ));
-	}
+	if(index < size())
+		return _MNR(getElement(index));
 	else
 	{
 		throwError<RangeError>(kOutOfRangeError,
 				       Integer::toString(index),
-				       Integer::toString(vec.size()));
+				       Integer::toString(size()));
 	}
 
 	return NullRef;
@@ -1047,31 +1165,77 @@ void Vector::setVariableByMultiname(const multiname& name, ASObject* o, CONST_AL
 	{
 		if (name.name_type == multiname::NAME_INT || name.name_type == multiname::NAME_UINT ||
 				(name.name_type == multiname::NAME_NUMBER && Number::isInteger(name.name_d)))
-			throwError<RangeError>(kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(vec.size()));
-		
+			throwError<RangeError>(kOutOfRangeError,name.normalizedName(getSystemState()),Integer::toString(size()));
+
 		if (!ASObject::hasPropertyByMultiname(name,false,true))
 			throwError<ReferenceError>(kWriteSealedError, name.normalizedName(getSystemState()), this->getClass()->getQualifiedClassName());
 		return ASObject::setVariableByMultiname(name, o, allowConst);
 	}
-	ASObject* o2 = this->vec_type->coerce(o);
-	  
-	if(index < vec.size())
-	{
-		if (vec[index])
-			vec[index]->decRef();
-		vec[index] = o2;
-	}
-	else if(!fixed && index == vec.size())
-	{
-		vec.push_back( o2 );
-	}
-	else
+	if(!setIndexed(index, o))
 	{
 		/* Spec says: one may not set a value with an index more than
 		 * one beyond the current final index. */
+		o->decRef();
 		throwError<RangeError>(kOutOfRangeError,
 				       Integer::toString(index),
-				       Integer::toString(vec.size()));
+				       Integer::toString(size()));
+	}
+}
+
+bool Vector::getIndexed(uint32_t index, ASObject*& ret)
+{
+	if(!implEnable || index >= size())
+		return false;
+	ret=getElement(index);
+	return true;
+}
+
+bool Vector::getIndexedInt(uint32_t index, int32_t& ret)
+{
+	if(storage != STORE_INT || !implEnable || index >= vec_i.size())
+		return false;
+	ret=vec_i[index];
+	return true;
+}
+
+bool Vector::setIndexed(uint32_t index, ASObject* o)
+{
+	if(index < size())
+		setElement(index, o);
+	else if(!fixed && index == size())
+		pushElement(o);
+	else
+		return false;
+	return true;
+}
+
+bool Vector::setIndexedInt(uint32_t index, int32_t v)
+{
+	uint32_t len=size();
+	if(index > len || (index == len && fixed))
+		return false;
+	switch(storage)
+	{
+		case STORE_INT:
+			if(index == len)
+				vec_i.push_back(v);
+			else
+				vec_i[index]=v;
+			return true;
+		case STORE_UINT:
+			if(index == len)
+				vec_ui.push_back(v);
+			else
+				vec_ui[index]=v;
+			return true;
+		case STORE_NUMBER:
+			if(index == len)
+				vec_d.push_back(v);
+			else
+				vec_d[index]=v;
+			return true;
+		default:
+			return false;
 	}
 }
 
@@ -1079,21 +1243,18 @@ tiny_string Vector::toString()
 {
 	//TODO: test
 	tiny_string t;
-	for(size_t i = 0; i < vec.size(); ++i)
+	for(size_t i = 0; i < size(); ++i)
 	{
 		if( i )
 			t += ",";
-		if (vec[i]) 
-			t += vec[i]->toString();
-		else
-			t += vec_type->coerce( getSystemState()->getNullRef() )->toString();
+		t += elementToString(i);
 	}
 	return t;
 }
 
 uint32_t Vector::nextNameIndex(uint32_t cur_index)
 {
-	if(cur_index < vec.size())
+	if(cur_index < size())
 		return cur_index+1;
 	else
 		return 0;
@@ -1101,7 +1262,7 @@ uint32_t Vector::nextNameIndex(uint32_t cur_index)
 
 _R<ASObject> Vector::nextName(uint32_t index)
 {
-	if(index<=vec.size())
+	if(index<=size())
 		return _MR(abstract_i(getSystemState(),index-1));
 	else
 		throw RunTimeException("Vector::nextName out of bounds");
@@ -1109,15 +1270,8 @@ _R<ASObject> Vector::nextName(uint32_t index)
 
 _R<ASObject> Vector::nextValue(uint32_t index)
 {
-	if(index<=vec.size())
-	{
-		if (vec[index-1])
-		{
-			vec[index-1]->incRef();
-			return _MR(vec[index-1]);
-		}
-		return _MR(vec_type->coerce( getSystemState()->getNullRef() ));
-	}
+	if(index<=size())
+		return _MR(getElement(index-1));
 	else
 		throw RunTimeException("Vector::nextValue out of bounds");
 }
@@ -1149,19 +1303,17 @@ tiny_string Vector::toJSON(std::vector<ASObject *> &path, IFunction *replacer, c
 	res += "[";
 	bool bfirst = true;
 	tiny_string newline = (spaces.empty() ? "" : "\n");
-	for (unsigned int i =0;  i < vec.size(); i++)
+	for (unsigned int i =0;  i < size(); i++)
 	{
 		tiny_string subres;
-		ASObject* o = vec[i];
-		if (!o)
-			o = getSystemState()->getNullRef();
+		_R<ASObject> o = _MR(isUnset(i) ? getSystemState()->getNullRef() : getElement(i));
 		if (replacer != NULL)
 		{
 			ASObject* params[2];
-			
+
 			params[0] = abstract_di(getSystemState(),i);
 			params[0]->incRef();
-			params[1] = o;
+			params[1] = o.getPtr();
 			params[1]->incRef();
 			ASObject *funcret=replacer->call(getSystemState()->getNullRef(), params, 2);
 			if (funcret)
@@ -1176,7 +1328,7 @@ tiny_string Vector::toJSON(std::vector<ASObject *> &path, IFunction *replacer, c
 			if (!bfirst)
 				res += ",";
 			res += newline+spaces;
-			
+
 			bfirst = false;
 			res += subres;
 		}
@@ -1188,17 +1340,63 @@ tiny_string Vector::toJSON(std::vector<ASObject *> &path, IFunction *replacer, c
 	return res;
 }
 
-ASObject* Vector::at(unsigned int index, ASObject *defaultValue) const
+_R<ASObject> Vector::at(unsigned int index) const
 {
-	if (index < vec.size())
-		return vec.at(index);
-	else
+	if (index >= size())
+		throw RunTimeException("Vector::at out of bounds");
+	return _MR(getElement(index));
+}
+
+number_t Vector::numberAt(unsigned int index, number_t defaultValue) const
+{
+	if (index >= size())
+		return defaultValue;
+	switch(storage)
+	{
+		case STORE_INT:
+			return vec_i[index];
+		case STORE_UINT:
+			return vec_ui[index];
+		case STORE_NUMBER:
+			return vec_d[index];
+		default:
+			return _MR(getElement(index))->toNumber();
+	}
+}
+
+int32_t Vector::intAt(unsigned int index, int32_t defaultValue) const
+{
+	if (index >= size())
+		return defaultValue;
+	switch(storage)
+	{
+		case STORE_INT:
+			return vec_i[index];
+		case STORE_UINT:
+			return vec_ui[index];
+		default:
+			return _MR(getElement(index))->toInt();
+	}
+}
+
+uint32_t Vector::uintAt(unsigned int index, uint32_t defaultValue) const
+{
+	if (index >= size())
 		return defaultValue;
+	switch(storage)
+	{
+		case STORE_INT:
+			return vec_i[index];
+		case STORE_UINT:
+			return vec_ui[index];
+		default:
+			return _MR(getElement(index))->toUInt();
+	}
 }
 
-void Vector::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Vector::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -1236,29 +1434,99 @@ void Vector::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMa
 		{
 			out->writeStringVR(stringMap,vec_type->getName());
 		}
-		for(uint32_t i=0;i<count;i++)
+		//Unboxed elements are written in a single block
+		switch (storage)
 		{
-			if (!vec[i])
+			case STORE_INT:
+			case STORE_UINT:
 			{
-				//TODO should we write a null_marker here?
-				LOG(LOG_NOT_IMPLEMENTED,"serialize unset vector objects");
-				continue;
+				uint8_t* buf = out->reserveBytes(count*4);
+				for(uint32_t i=0;i<count;i++)
+				{
+					uint32_t v = out->endianIn(storage==STORE_INT ? (uint32_t)vec_i[i] : vec_ui[i]);
+					memcpy(buf+i*4,&v,4);
+				}
+				break;
 			}
-			switch (marker)
+			case STORE_NUMBER:
 			{
-				case vector_int_marker:
-					out->writeUnsignedInt(out->endianIn((uint32_t)vec[i]->toInt()));
-					break;
-				case vector_uint_marker:
-					out->writeUnsignedInt(out->endianIn(vec[i]->toUInt()));
-					break;
-				case vector_double_marker:
-					out->serializeDouble(vec[i]->toNumber());
-					break;
-				case vector_object_marker:
+				//Doubles are always in network byte order
+				uint8_t* buf = out->reserveBytes(count*8);
+				for(uint32_t i=0;i<count;i++)
+				{
+					uint64_t v;
+					memcpy(&v,&vec_d[i],8);
+					v = GUINT64_TO_BE(v);
+					memcpy(buf+i*8,&v,8);
+				}
+				break;
+			}
+			default:
+				for(uint32_t i=0;i<count;i++)
+				{
+					if (isUnset(i))
+					{
+						//TODO should we write a null_marker here?
+						LOG(LOG_NOT_IMPLEMENTED,"serialize unset vector objects");
+						continue;
+					}
 					vec[i]->serialize(out, stringMap, objMap, traitsMap);
-					break;
+				}
+				break;
+		}
+	}
+}
+
+bool Vector::appendSerialized(ByteArray* in, uint32_t count)
+{
+	if (fixed)
+		throwError<RangeError>(kVectorFixedError);
+	const uint32_t elemSize = (storage==STORE_NUMBER) ? 8 : 4;
+	if (count > UINT32_MAX/elemSize)
+		return false;
+	const uint8_t* buf = in->consumeBytes(count*elemSize);
+	if (buf == NULL)
+		return false;
+	switch (storage)
+	{
+		case STORE_INT:
+		{
+			vec_i.reserve(vec_i.size()+count);
+			for(uint32_t i=0;i<count;i++)
+			{
+				uint32_t v;
+				memcpy(&v,buf+i*4,4);
+				vec_i.push_back((int32_t)in->endianOut(v));
+			}
+			break;
+		}
+		case STORE_UINT:
+		{
+			vec_ui.reserve(vec_ui.size()+count);
+			for(uint32_t i=0;i<count;i++)
+			{
+				uint32_t v;
+				memcpy(&v,buf+i*4,4);
+				vec_ui.push_back(in->endianOut(v));
+			}
+			break;
+		}
+		case STORE_NUMBER:
+		{
+			vec_d.reserve(vec_d.size()+count);
+			for(uint32_t i=0;i<count;i++)
+			{
+				uint64_t v;
+				memcpy(&v,buf+i*8,8);
+				v = GUINT64_FROM_BE(v);
+				number_t d;
+				memcpy(&d,&v,8);
+				vec_d.push_back(d);
 			}
+			break;
 		}
+		default:
+			assert_and_throw(false);
 	}
+	return true;
 }
@@ -28,10 +28,39 @@ namespace lightspark
 template<class T> class TemplatedClass;
 class Vector: public ASObject
 {
+public:
+	/* Vectors of int, uint and Number keep the unboxed values instead of
+	 * ASObjects, the storage is selected from the element type */
+	enum STORAGE_KIND { STORE_OBJECT=0, STORE_INT, STORE_UINT, STORE_NUMBER };
+private:
 	const Type* vec_type;
 	bool fixed;
+	STORAGE_KIND storage;
+	//Unset elements are NULL, they are read as the default value of vec_type
 	std::vector<ASObject*, reporter_allocator<ASObject*>> vec;
+	std::vector<int32_t, reporter_allocator<int32_t>> vec_i;
+	std::vector<uint32_t, reporter_allocator<uint32_t>> vec_ui;
+	std::vector<number_t, reporter_allocator<number_t>> vec_d;
 	int capIndex(int i) const;
+	//Returns a new reference to the element at index, which must be valid
+	ASObject* getElement(uint32_t index) const;
+	//Only elements of STORE_OBJECT vectors can be unset
+	bool isUnset(uint32_t index) const
+	{
+		return storage==STORE_OBJECT && vec[index]==NULL;
+	}
+	//These coerce o to vec_type and take ownership of it
+	void setElement(uint32_t index, ASObject* o);
+	void pushElement(ASObject* o);
+	void insertElement(uint32_t index, ASObject* o);
+	//Moves count elements starting at index of src to the end of this vector
+	void appendElements(Vector* src, uint32_t index, uint32_t count);
+	void eraseElements(uint32_t index, uint32_t count);
+	void resizeElements(uint32_t len);
+	void clearElements();
+	//Converts the element at index without boxing it when possible
+	tiny_string elementToString(uint32_t index) const;
+	bool isElementEqualStrict(uint32_t index, ASObject* o);
 	class sortComparatorDefault
 	{
 	private:
@@ -56,12 +85,7 @@ public:
 	~Vector();
 	bool destruct()
 	{
-		for(unsigned int i=0;i<size();i++)
-		{
-			if(vec[i])
-				vec[i]->decRef();
-		}
-		vec.clear();
+		clearElements();
 		return ASObject::destruct();
 	}
 	
@@ -88,19 +112,40 @@ public:
 
 	uint32_t size() const
 	{
-		return vec.size();
+		switch(storage)
+		{
+			case STORE_INT:
+				return vec_i.size();
+			case STORE_UINT:
+				return vec_ui.size();
+			case STORE_NUMBER:
+				return vec_d.size();
+			default:
+				return vec.size();
+		}
 	}
-        ASObject* at(unsigned int index) const
-        {
-                return vec.at(index);
-        }
-	//Get value at index, or return defaultValue (a borrowed
-	//reference) if index is out-of-range
-	ASObject* at(unsigned int index, ASObject *defaultValue) const;
+	STORAGE_KIND getStorageKind() const { return storage; }
+	//Returns a new reference to the element at index
+	_R<ASObject> at(unsigned int index) const;
+	//Get the element at index converted to a primitive without boxing
+	//it, or return defaultValue if index is out-of-range
+	number_t numberAt(unsigned int index, number_t defaultValue=0) const;
+	int32_t intAt(unsigned int index, int32_t defaultValue=0) const;
+	uint32_t uintAt(unsigned int index, uint32_t defaultValue=0) const;
 
 	//Appends an object to the Vector. o is coerced to vec_type.
 	//Takes ownership of o.
 	void append(ASObject *o);
+	//Appends count int, uint or Number elements read from AMF3 data in a
+	//single block. Returns false if not enough data is available
+	bool appendSerialized(ByteArray* in, uint32_t count);
+	//Fast paths for indexed accesses from the interpreter. They return
+	//false when the generic property lookup must be used instead, in that
+	//case o is not consumed
+	bool getIndexed(uint32_t index, ASObject*& ret);
+	bool getIndexedInt(uint32_t index, int32_t& ret);
+	bool setIndexed(uint32_t index, ASObject* o);
+	bool setIndexedInt(uint32_t index, int32_t v);
 	void setFixed(bool v) { fixed = v; }
 
 	//TODO: do we need to implement generator?
@@ -134,9 +179,9 @@ public:
 	ASFUNCTION(removeAt);
 
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 }
@@ -51,7 +51,7 @@ XML::XML(Class_base* c):ASObject(c,T_OBJECT,SUBTYPE_XML),parentNode(0),nodetype(
 
 XML::XML(Class_base* c, const std::string &str):ASObject(c,T_OBJECT,SUBTYPE_XML),parentNode(0),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
 {
-	createTree(buildFromString(str, getParseMode()),false);
+	createTreeFromString(str);
 }
 
 XML::XML(Class_base* c, const pugi::xml_node& _n, XML* parent, bool fromXMLList):ASObject(c,T_OBJECT,SUBTYPE_XML),parentNode(0),nodetype((pugi::xml_node_type)0),isAttribute(false),nodenamespace_uri(BUILTIN_STRINGS::EMPTY),nodenamespace_prefix(BUILTIN_STRINGS::EMPTY),constructed(false)
@@ -61,7 +61,7 @@ XML::XML(Class_base* c, const pugi::xml_node& _n, XML* parent, bool fromXMLList)
 		parent->incRef();
 		parentNode = _NR<XML>(parent);
 	}
-	createTree(_n,fromXMLList);
+	createTree(_n,fromXMLList,NullRef);
 }
 
 bool XML::destruct()
@@ -72,6 +72,8 @@ bool XML::destruct()
 	isAttribute = false;
 	constructed = false;
 	childrenlist.reset();
+	childrensource=pugi::xml_node();
+	sourcedoc.reset();
 	nodename.clear();
 	nodevalue.clear();
 	nodenamespace_uri=BUILTIN_STRINGS::EMPTY;
@@ -204,7 +206,7 @@ ASFUNCTIONBODY(XML,_constructor)
 	   args[0]->is<Null>() || 
 	   args[0]->is<Undefined>())
 	{
-		th->createTree(th->buildFromString("", getParseMode()),false);
+		th->createTreeFromString("");
 	}
 	else if(args[0]->getClass()->isSubClass(Class<ByteArray>::getClass(obj->getSystemState())))
 	{
@@ -213,8 +215,8 @@ ASFUNCTIONBODY(XML,_constructor)
 		ByteArray* ba=Class<ByteArray>::cast(args[0]);
 		uint32_t len=ba->getLength();
 		const uint8_t* str=ba->getBuffer(len, false);
-		th->createTree(th->buildFromString(std::string((const char*)str,len), getParseMode(),
-					     getVm(obj->getSystemState())->getDefaultXMLNamespace()),false);
+		th->createTreeFromString(std::string((const char*)str,len),
+					     getVm(obj->getSystemState())->getDefaultXMLNamespace());
 	}
 	else if(args[0]->is<ASString>() ||
 		args[0]->is<Number>() ||
@@ -224,24 +226,24 @@ ASFUNCTIONBODY(XML,_constructor)
 	{
 		//By specs, XML constructor will only convert to string Numbers or Booleans
 		//ints are not explicitly mentioned, but they seem to work
-		th->createTree(th->buildFromString(args[0]->toString(), getParseMode(),
-					     getVm(obj->getSystemState())->getDefaultXMLNamespace()),false);
+		th->createTreeFromString(args[0]->toString(),
+					     getVm(obj->getSystemState())->getDefaultXMLNamespace());
 	}
 	else if(args[0]->is<XML>())
 	{
-		th->createTree(th->buildFromString(args[0]->as<XML>()->toXMLString_internal(), getParseMode(),
-					     getVm(obj->getSystemState())->getDefaultXMLNamespace()),false);
+		th->createTreeFromString(args[0]->as<XML>()->toXMLString_internal(),
+					     getVm(obj->getSystemState())->getDefaultXMLNamespace());
 	}
 	else if(args[0]->is<XMLList>())
 	{
 		XMLList *list=args[0]->as<XMLList>();
 		_R<XML> reduced=list->reduceToXML();
-		th->createTree(th->buildFromString(reduced->toXMLString_internal(), getParseMode()),false);
+		th->createTreeFromString(reduced->toXMLString_internal());
 	}
 	else
 	{
-		th->createTree(th->buildFromString(args[0]->toString(), getParseMode(),
-					     getVm(obj->getSystemState())->getDefaultXMLNamespace()),false);
+		th->createTreeFromString(args[0]->toString(),
+					     getVm(obj->getSystemState())->getDefaultXMLNamespace());
 	}
 
 	return NULL;
@@ -364,6 +366,8 @@ void XML::appendChild(_R<XML> newChild)
 				throwError<TypeError>(kXMLIllegalCyclicalLoop);
 			node = node->parentNode;
 		}
+		materializeChildren();
+		newChild->materializeSubtree();
 		this->incRef();
 		newChild->parentNode = _NR<XML>(this);
 		childrenlist->append(newChild);
@@ -615,6 +619,7 @@ const tiny_string XML::toXMLString_internal(bool pretty, uint32_t defaultnsprefi
 						res += "\"";
 					}
 				}
+				materializeChildren();
 				if (childrenlist.isNull() || childrenlist->nodes.size() == 0)
 				{
 					res += "/>";
@@ -693,6 +698,7 @@ ASFUNCTIONBODY(XML,toXMLString)
 
 void XML::childrenImpl(XMLVector& ret, const tiny_string& name)
 {
+	materializeChildren();
 	if (!childrenlist.isNull())
 	{
 		for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -708,6 +714,7 @@ void XML::childrenImpl(XMLVector& ret, const tiny_string& name)
 
 void XML::childrenImpl(XMLVector& ret, uint32_t index)
 {
+	materializeChildren();
 	if (constructed && !childrenlist.isNull() && index < childrenlist->nodes.size())
 	{
 		_R<XML> child= childrenlist->nodes[index];
@@ -786,6 +793,7 @@ ASFUNCTIONBODY(XML,valueOf)
 
 void XML::getText(XMLVector& ret)
 {
+	materializeChildren();
 	if (childrenlist.isNull())
 		return;
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -824,6 +832,7 @@ ASFUNCTIONBODY(XML,elements)
 
 void XML::getElementNodes(const tiny_string& name, XMLVector& foundElements)
 {
+	materializeChildren();
 	if (childrenlist.isNull())
 		return;
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -887,6 +896,7 @@ ASFUNCTIONBODY(XML,addNamespace)
 	}
 	else
 		ns_uri = th->getSystemState()->getUniqueStringId(newNamespace->toString());
+	th->materializeSubtree();
 	if (th->nodenamespace_prefix == ns_prefix)
 		th->nodenamespace_prefix=BUILTIN_STRINGS::EMPTY;
 	for (uint32_t i = 0; i < th->namespacedefs.size(); i++)
@@ -1074,6 +1084,7 @@ ASFUNCTIONBODY(XML,_setNamespace)
 	if (th->isAttribute && th->parentNode)
 	{
 		XML* tmp = th->parentNode.getPtr();
+		tmp->materializeSubtree();
 		for (uint32_t i = 0; i < tmp->namespacedefs.size(); i++)
 		{
 			bool b;
@@ -1092,6 +1103,7 @@ ASFUNCTIONBODY(XML,_setNamespace)
 
 void XML::setNamespace(uint32_t ns_uri, uint32_t ns_prefix)
 {
+	materializeSubtree();
 	this->nodenamespace_prefix = ns_prefix;
 	this->nodenamespace_uri = ns_uri;
 }
@@ -1113,6 +1125,7 @@ ASFUNCTIONBODY(XML,_setChildren)
 	_NR<ASObject> newChildren;
 	ARG_UNPACK(newChildren);
 
+	th->materializeChildren();
 	th->childrenlist->clear();
 
 	if (newChildren->is<XML>())
@@ -1147,6 +1160,7 @@ ASFUNCTIONBODY(XML,_normalize)
 
 void XML::normalize()
 {
+	materializeChildren();
 	childrenlist->normalize();
 }
 
@@ -1175,6 +1189,7 @@ bool XML::hasSimpleContent() const
 	if (getNodeKind() == pugi::node_comment ||
 		getNodeKind() == pugi::node_pi)
 		return false;
+	materializeChildren();
 	if (childrenlist.isNull())
 		return true;
 	for(size_t i=0; i<childrenlist->nodes.size(); i++)
@@ -1212,6 +1227,7 @@ void XML::getDescendantsByQName(const tiny_string& name, uint32_t ns, bool bIsAt
 			}
 		}
 	}
+	materializeChildren();
 	if (childrenlist.isNull())
 		return;
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
@@ -1474,6 +1490,7 @@ _NR<ASObject> XML::getVariableByMultiname(const multiname& name, GET_VARIABLE_OP
 	}
 	else
 	{
+		materializeChildren();
 		if (normalizedName == "*")
 		{
 			XMLVector ret;
@@ -1528,6 +1545,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 		isAttr=true;
 		buf+=1;
 	}
+	materializeChildren();
 	if (childrenlist.isNull())
 		childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 	
@@ -1591,6 +1609,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 			_R<XML> tmpnode = childrenlist->nodes.back();
 			if (tmpnode->nodenamespace_uri == ns_uri && tmpnode->nodename == normalizedName)
 			{
+				tmpnode->materializeChildren();
 				if(o->is<XMLList>())
 				{
 					if (!found)
@@ -1620,6 +1639,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 					else
 					{
 						_NR<XML> tmp = _MR<XML>(o->as<XML>());
+						tmp->materializeSubtree();
 						tmp->parentNode = _MR<XML>(this);
 						tmp->incRef();
 						if (!found)
@@ -1660,6 +1680,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 			if(o->is<XML>())
 			{
 				_R<XML> tmp = _MR<XML>(o->as<XML>());
+				tmp->materializeSubtree();
 				tmp->parentNode = _MR<XML>(this);
 				tmp->incRef();
 				tmpnodes.insert(tmpnodes.begin(),tmp);
@@ -1755,6 +1776,7 @@ bool XML::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bo
 	else
 	{
 		//Lookup children
+		materializeChildren();
 		for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
 		{
 			_R<XML> child= childrenlist->nodes[i];
@@ -1806,6 +1828,7 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 	}
 	else if(XML::isValidMultiname(getSystemState(),name,index))
 	{
+		materializeChildren();
 		if (!childrenlist.isNull())
 			childrenlist->nodes.erase(childrenlist->nodes.begin() + index);
 	}
@@ -1818,6 +1841,7 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 			assert_and_throw(name.ns[0].kind==NAMESPACE);
 			ns_uri=name.ns[0].nsNameId;
 		}
+		materializeChildren();
 		if (!childrenlist.isNull() && childrenlist->nodes.size() > 0)
 		{
 			XMLList::XMLListVector::iterator it = childrenlist->nodes.end();
@@ -1877,6 +1901,7 @@ uint32_t XML::getNamespacePrefixByURI(uint32_t uri, bool create)
 
 	if(!found && create)
 	{
+		materializeSubtree();
 		nodenamespace_uri = uri;
 	}
 
@@ -2062,11 +2087,11 @@ void XML::CheckCyclicReference(XML* node)
 XML *XML::createFromString(SystemState* sys, const tiny_string &s)
 {
 	XML* res = Class<XML>::getInstanceSNoArgs(sys);
-	res->createTree(res->buildFromString(s, getParseMode()),false);
+	res->createTreeFromString(s);
 	return res;
 }
 
-XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList)
+XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList, const _NR<XMLSharedDocument>& doc)
 {
 	XML* res = Class<XML>::getInstanceSNoArgs(parent ? parent->getSystemState() : getSys());
 	if (parent)
@@ -2074,7 +2099,7 @@ XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList
 		parent->incRef();
 		res->parentNode = _NR<XML>(parent);
 	}
-	res->createTree(_n,fromXMLList);
+	res->createTree(_n,fromXMLList,doc);
 	return res;
 }
 
@@ -2098,6 +2123,14 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 	}
 	else
 		child2 = _NR<XML>(createFromString(obj->getSystemState(),child2->toString()));
+	th->materializeChildren();
+	if (child2->is<XML>())
+		child2->as<XML>()->materializeSubtree();
+	else
+	{
+		for (auto it = child2->as<XMLList>()->nodes.begin(); it < child2->as<XMLList>()->nodes.end(); it++)
+			(*it)->materializeSubtree();
+	}
 	if (th->childrenlist.isNull())
 		th->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(obj->getSystemState()));
 	if (child1->is<Null>())
@@ -2177,6 +2210,14 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 	else
 		child2 = _NR<XML>(createFromString(obj->getSystemState(),child2->toString()));
 
+	th->materializeChildren();
+	if (child2->is<XML>())
+		child2->as<XML>()->materializeSubtree();
+	else
+	{
+		for (auto it = child2->as<XMLList>()->nodes.begin(); it < child2->as<XMLList>()->nodes.end(); it++)
+			(*it)->materializeSubtree();
+	}
 	if (th->childrenlist.isNull())
 		th->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(obj->getSystemState()));
 	if (child1->is<Null>())
@@ -2266,6 +2307,7 @@ ASFUNCTIONBODY(XML,removeNamespace)
 }
 void XML::RemoveNamespace(Namespace *ns)
 {
+	materializeChildren();
 	if (this->nodenamespace_uri == ns->getURI())
 	{
 		this->nodenamespace_uri = BUILTIN_STRINGS::EMPTY;
@@ -2300,6 +2342,7 @@ ASFUNCTIONBODY(XML,comments)
 }
 void XML::getComments(XMLVector& ret)
 {
+	materializeChildren();
 	if (childrenlist)
 	{
 		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
@@ -2324,6 +2367,7 @@ ASFUNCTIONBODY(XML,processingInstructions)
 }
 void XML::getprocessingInstructions(XMLVector& ret, tiny_string name)
 {
+	materializeChildren();
 	if (childrenlist)
 	{
 		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
@@ -2401,6 +2445,11 @@ bool XML::getPrettyPrinting()
 	return prettyPrinting;
 }
 
+bool XML::getIgnoreWhitespace()
+{
+	return ignoreWhitespace;
+}
+
 unsigned int XML::getParseMode()
 {
 	unsigned int parsemode = pugi::parse_cdata | pugi::parse_escapes|pugi::parse_fragment | pugi::parse_doctype |pugi::parse_pi|pugi::parse_declaration;
@@ -2508,6 +2557,8 @@ bool XML::nodesEqual(XML *a, XML *b) const
 	}
 	
 	// children
+	a->materializeChildren();
+	b->materializeChildren();
 	if (a->childrenlist.isNull())
 		return b->childrenlist.isNull() || b->childrenlist->nodes.size() == 0;
 	if (b->childrenlist.isNull())
@@ -2559,9 +2610,9 @@ bool XML::isEqual(ASObject* r)
 	return false;
 }
 
-void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-		    std::map<const ASObject*, uint32_t>& objMap,
-		    std::map<const Class_base*, uint32_t>& traitsMap)
+void XML::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+		    std::unordered_map<const ASObject*, uint32_t>& objMap,
+		    std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -2573,10 +2624,20 @@ void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
 	out->writeXMLString(objMap, this, toString());
 }
 
-void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
+void XML::createTreeFromString(const tiny_string& str, const tiny_string& default_ns)
+{
+	const pugi::xml_node root=buildFromString(str, getParseMode(), default_ns);
+	xmldoc->defaultns = getVm(getSystemState())->getDefaultXMLNamespaceID();
+	xmldoc->ignorewhitespace = ignoreWhitespace;
+	createTree(root,false,xmldoc);
+}
+
+void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList,const _NR<XMLSharedDocument>& doc)
 {
 	pugi::xml_node node = rootnode;
 	bool done = false;
+	childrensource = pugi::xml_node();
+	sourcedoc.reset();
 	this->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 	this->childrenlist->incRef();
 	if (parentNode.isNull() && !fromXMLList)
@@ -2587,17 +2648,17 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			switch (node.type())
 			{
 				case pugi::node_null: // Empty (null) node handle
-					fillNode(this,node);
+					fillNode(this,node,doc);
 					done = true;
 					break;
 				case pugi::node_document:// A document tree's absolute root
-					createTree(node.first_child(),fromXMLList);
+					createTree(node.first_child(),fromXMLList,doc);
 					return;
 				case pugi::node_pi:	// Processing instruction, i.e. '<?name?>'
 				case pugi::node_declaration: // Document declaration, i.e. '<?xml version="1.0"?>'
 				{
 					_NR<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
-					fillNode(tmp.getPtr(),node);
+					fillNode(tmp.getPtr(),node,doc);
 					if(this->procinstlist.isNull())
 						this->procinstlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 					this->procinstlist->incRef();
@@ -2605,27 +2666,20 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 					break;
 				}
 				case pugi::node_doctype:// Document type declaration, i.e. '<!DOCTYPE doc>'
-					fillNode(this,node);
+					fillNode(this,node,doc);
 					break;
 				case pugi::node_pcdata: // Plain character data, i.e. 'text'
 				case pugi::node_cdata: // Character data, i.e. '<![CDATA[text]]>'
-					fillNode(this,node);
+					fillNode(this,node,doc);
 					done = true;
 					break;
 				case pugi::node_comment: // Comment tag, i.e. '<!-- text -->'
-					fillNode(this,node);
+					fillNode(this,node,doc);
 					break;
 				case pugi::node_element: // Element tag, i.e. '<node/>'
 				{
-					fillNode(this,node);
-					pugi::xml_node_iterator it=node.begin();
-					while(it!=node.end())
-					{
-						//LOG(LOG_INFO,"rootchildnode1:"<<it->name()<<" "<<it->value()<<" "<<it->type()<<" "<<parentNode.isNull());
-						_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,this));
-						this->childrenlist->append(_R<XML>(tmp));
-						it++;
-					}
+					fillNode(this,node,doc);
+					createChildren(node,doc);
 					done = true;
 					break;
 				}
@@ -2650,20 +2704,12 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			case pugi::node_pcdata: // Plain character data, i.e. 'text'
 			case pugi::node_cdata: // Character data, i.e. '<![CDATA[text]]>'
 			case pugi::node_comment: // Comment tag, i.e. '<!-- text -->'
-				fillNode(this,node);
+				fillNode(this,node,doc);
 				break;
 			case pugi::node_element: // Element tag, i.e. '<node/>'
 			{
-				fillNode(this,node);
-				pugi::xml_node_iterator it=node.begin();
-				{
-					while(it!=node.end())
-					{
-						_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,this));
-						this->childrenlist->append(_R<XML>(tmp));
-						it++;
-					}
-				}
+				fillNode(this,node,doc);
+				createChildren(node,doc);
 				break;
 			}
 			default:
@@ -2673,21 +2719,68 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 	}
 }
 
-void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
+void XML::createChildren(const pugi::xml_node& srcnode, const _NR<XMLSharedDocument>& doc)
+{
+	if (!srcnode.first_child())
+		return;
+	if (!doc.isNull())
+	{
+		childrensource = srcnode;
+		sourcedoc = doc;
+		return;
+	}
+	//The document is owned by the caller, copy the whole subtree now
+	pugi::xml_node_iterator it=srcnode.begin();
+	while(it!=srcnode.end())
+	{
+		_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,this));
+		this->childrenlist->append(_R<XML>(tmp));
+		it++;
+	}
+}
+
+void XML::buildPendingChildren() const
+{
+	XML* th = const_cast<XML*>(this);
+	pugi::xml_node srcnode = childrensource;
+	_NR<XMLSharedDocument> doc = sourcedoc;
+	childrensource = pugi::xml_node();
+	sourcedoc.reset();
+	pugi::xml_node_iterator it=srcnode.begin();
+	while(it!=srcnode.end())
+	{
+		_NR<XML> tmp = _MR<XML>(XML::createFromNode(*it,th,false,doc));
+		th->childrenlist->append(_R<XML>(tmp));
+		it++;
+	}
+}
+
+void XML::materializeSubtree()
+{
+	materializeChildren();
+	if (childrenlist.isNull())
+		return;
+	for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
+		(*it)->materializeSubtree();
+}
+
+void XML::fillNode(XML* node, const pugi::xml_node &srcnode, const _NR<XMLSharedDocument>& doc)
 {
 	if (node->childrenlist.isNull())
 	{
 		node->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(node->getSystemState()));
 		node->childrenlist->incRef();
 	}
+	uint32_t defaultns = doc.isNull() ? getVm(node->getSystemState())->getDefaultXMLNamespaceID() : doc->defaultns;
+	bool ignorews = doc.isNull() ? ignoreWhitespace : doc->ignorewhitespace;
 	node->nodetype = srcnode.type();
 	node->nodename = srcnode.name();
 	node->nodevalue = srcnode.value();
 	if (!node->parentNode.isNull() && node->parentNode->nodenamespace_prefix == BUILTIN_STRINGS::EMPTY)
 		node->nodenamespace_uri = node->parentNode->nodenamespace_uri;
 	else
-		node->nodenamespace_uri = getVm(node->getSystemState())->getDefaultXMLNamespaceID();
-	if (ignoreWhitespace && node->nodetype == pugi::node_pcdata)
+		node->nodenamespace_uri = defaultns;
+	if (ignorews && node->nodetype == pugi::node_pcdata)
 		node->nodevalue = node->removeWhitespace(node->nodevalue);
 	node->attributelist = _MR(Class<XMLList>::getInstanceSNoArgs(node->getSystemState()));
 	pugi::xml_attribute_iterator itattr;
@@ -2752,7 +2845,7 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 		tmp->nodetype = pugi::node_null;
 		tmp->isAttribute = true;
 		tmp->nodename = aname;
-		tmp->nodenamespace_uri = getVm(node->getSystemState())->getDefaultXMLNamespaceID();
+		tmp->nodenamespace_uri = defaultns;
 		pos = tmp->nodename.find(":");
 		if (pos != tiny_string::npos)
 		{
@@ -2835,6 +2928,8 @@ void XML::prependChild(_R<XML> newChild)
 				throwError<TypeError>(kXMLIllegalCyclicalLoop);
 			node = node->parentNode;
 		}
+		materializeChildren();
+		newChild->materializeSubtree();
 		this->incRef();
 		newChild->parentNode = _NR<XML>(this);
 		childrenlist->prepend(newChild);
@@ -2850,6 +2945,7 @@ ASFUNCTIONBODY(XML,_replace)
 	_NR<ASObject> value;
 	ARG_UNPACK(propertyName) (value);
 
+	th->materializeChildren();
 	multiname name(NULL);
 	name.name_type=multiname::NAME_STRING;
 	if (propertyName->is<ASQName>())
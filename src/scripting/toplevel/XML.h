@@ -44,9 +44,29 @@ private:
 	_NR<XMLList> attributelist;
 	_NR<XMLList> procinstlist;
 	NSVector namespacedefs;
+	/*
+	 * Children parsed from a shared document are built on first access.
+	 * childrensource is the element they come from, sourcedoc keeps it alive
+	 */
+	mutable pugi::xml_node childrensource;
+	mutable _NR<XMLSharedDocument> sourcedoc;
 
-	void createTree(const pugi::xml_node &rootnode, bool fromXMLList);
-	static void fillNode(XML* node, const pugi::xml_node &srcnode);
+	void createTree(const pugi::xml_node &rootnode, bool fromXMLList, const _NR<XMLSharedDocument>& doc);
+	void createTreeFromString(const tiny_string& str, const tiny_string& default_ns=tiny_string());
+	void createChildren(const pugi::xml_node &srcnode, const _NR<XMLSharedDocument>& doc);
+	static void fillNode(XML* node, const pugi::xml_node &srcnode, const _NR<XMLSharedDocument>& doc);
+	void buildPendingChildren() const;
+	inline void materializeChildren() const
+	{
+		if (!childrensource.empty())
+			buildPendingChildren();
+	}
+	/*
+	 * Build every pending node below this one. Needed before changing
+	 * the namespaces or the parent of a node, as descendants resolve
+	 * their namespaces through the parent chain when they are built
+	 */
+	void materializeSubtree();
 	tiny_string toString_priv();
 	const char* nodekindString();
 	
@@ -143,13 +163,18 @@ public:
 	static void sinit(Class_base* c);
 	
 	static bool getPrettyPrinting();
+	static bool getIgnoreWhitespace();
 	static unsigned int getParseMode();
 	static XML* createFromString(SystemState *sys, const tiny_string& s);
-	static XML* createFromNode(const pugi::xml_node& _n, XML* parent=NULL, bool fromXMLList=false);
+	/*
+	 * If doc is set the node must belong to it and its children are built lazily,
+	 * otherwise the whole subtree is copied immediately
+	 */
+	static XML* createFromNode(const pugi::xml_node& _n, XML* parent=NULL, bool fromXMLList=false, const _NR<XMLSharedDocument>& doc=NullRef);
 
 	const tiny_string getName() const { return nodename;}
 	uint32_t getNamespaceURI() const { return nodenamespace_uri;}
-	XMLList* getChildrenlist() { return childrenlist ? childrenlist.getPtr() : NULL; }
+	XMLList* getChildrenlist() { materializeChildren(); return childrenlist ? childrenlist.getPtr() : NULL; }
 	
 	
 	void getDescendantsByQName(const tiny_string& name, uint32_t ns, bool bIsAttribute, XMLVector& ret) const;
@@ -177,9 +202,9 @@ public:
 	_R<ASObject> nextName(uint32_t index);
 	_R<ASObject> nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 }
 #endif /* SCRIPTING_TOPLEVEL_XML_H */
@@ -216,9 +216,12 @@ ASFUNCTIONBODY(XMLList,_constructor)
 
 void XMLList::buildFromString(const tiny_string &str)
 {
-	pugi::xml_document xmldoc;
+	//Shared with the nodes, they build their children from it on first access
+	_R<XMLSharedDocument> xmldoc = _MR(new XMLSharedDocument());
+	xmldoc->defaultns = getVm(getSystemState())->getDefaultXMLNamespaceID();
+	xmldoc->ignorewhitespace = XML::getIgnoreWhitespace();
 
-	pugi::xml_parse_result res = xmldoc.load_buffer((void*)str.raw_buf(),str.numBytes(),XML::getParseMode());
+	pugi::xml_parse_result res = xmldoc->doc.load_buffer((void*)str.raw_buf(),str.numBytes(),XML::getParseMode());
 	switch (res.status)
 	{
 		case pugi::status_ok:
@@ -249,10 +252,10 @@ void XMLList::buildFromString(const tiny_string &str)
 			break;
 	}
 	
-	pugi::xml_node_iterator it=xmldoc.begin();
-	for(;it!=xmldoc.end();++it)
+	pugi::xml_node_iterator it=xmldoc->doc.begin();
+	for(;it!=xmldoc->doc.end();++it)
 	{
-		_R<XML> tmp = _MR(XML::createFromNode(*it,(XML*)NULL,true));
+		_R<XML> tmp = _MR(XML::createFromNode(*it,(XML*)NULL,true,xmldoc));
 		if (tmp->constructed)
 			nodes.push_back(tmp);
 	}
@@ -636,6 +639,7 @@ void XMLList::removeNode(XML *node)
 		_R<XML> n = *it;
 		if (n.getPtr() == node)
 		{
+			node->materializeSubtree();
 			node->parentNode = NullRef;
 			nodes.erase(it);
 			break;
@@ -676,6 +680,7 @@ void XMLList::getTargetVariables(const multiname& name,XML::XMLVector& retnodes)
 			{
 				retnodes.push_back(child);
 			}
+			child->materializeChildren();
 			if (child->childrenlist)
 				child->childrenlist->getTargetVariables(name,retnodes);
 		}
@@ -1039,6 +1044,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 		}
 		if (o->as<XML>()->getNodeKind() == pugi::node_pcdata)
 		{
+			nodes[idx]->materializeChildren();
 			nodes[idx]->childrenlist->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
 			nodes[idx]->incRef();
@@ -1063,6 +1069,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 			nodes[idx]->nodevalue = o->toString();
 		else 
 		{
+			nodes[idx]->materializeChildren();
 			nodes[idx]->childrenlist->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
 			nodes[idx]->incRef();
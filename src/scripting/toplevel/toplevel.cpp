@@ -115,9 +115,9 @@ ASObject *Undefined::describeType() const
 	return ASObject::describeType();
 }
 
-void Undefined::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Undefined::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 		out->writeByte(amf0_undefined_marker);
@@ -292,12 +292,14 @@ SyntheticFunction::SyntheticFunction(Class_base* c,method_info* m):IFunction(c,S
  */
 ASObject* SyntheticFunction::call(ASObject* obj, ASObject* const* args, uint32_t numArgs)
 {
-	const uint32_t opt_hit_threshold=1;
-	const uint32_t jit_hit_threshold=20;
+	const uint32_t opt_hit_threshold=getSystemState()->optimizationThreshold;
+	const uint32_t jit_hit_threshold=getSystemState()->jitThreshold;
 	if (!mi->body)
 		return getSystemState()->getUndefinedRef();
 
-	const uint16_t hit_count = mi->body->hit_count;
+	//Both calls and loop iterations make a method hot
+	const uint32_t hit_count = (mi->body->backedge_count > UINT32_MAX - mi->body->hit_count) ?
+		UINT32_MAX : mi->body->hit_count + mi->body->backedge_count;
 	const method_body_info::CODE_STATUS& codeStatus = mi->body->codeStatus;
 
 	uint32_t& cur_recursion = getVm(getSystemState())->cur_recursion;
@@ -350,13 +352,27 @@ ASObject* SyntheticFunction::call(ASObject* obj, ASObject* const* args, uint32_t
 	}
 
 	//Temporarily disable JITting
-	if(mi->body->exceptions.size()==0 && getSystemState()->useJit && ((hit_count>=jit_hit_threshold && codeStatus==method_body_info::OPTIMIZED) || getSystemState()->useInterpreter==false))
+	if(mi->body->exceptions.size()==0 && getSystemState()->useJit && val==NULL)
 	{
-		//We passed the hot function threshold, synt the function
-		val=mi->synt_method(getSystemState());
-		assert(val);
+		if(codeStatus==method_body_info::JITTED || getSystemState()->useInterpreter==false)
+		{
+			//Without the interpreter the code must be ready now
+			val=mi->synt_method(getSystemState());
+			assert(val);
+		}
+		else if(hit_count>=jit_hit_threshold && codeStatus==method_body_info::OPTIMIZED)
+		{
+			//We passed the hot function threshold, synt the function in background
+			//and keep interpreting it until the native code is ready
+			ABCVm* vm=getVm(getSystemState());
+			if(!mi->body->jitQueued)
+				vm->compileInBackground(mi);
+			else if(vm->backgroundCompilationDone(mi))
+				val=mi->synt_method(getSystemState());
+		}
 	}
-	++mi->body->hit_count;
+	if(mi->body->hit_count!=UINT32_MAX)
+		++mi->body->hit_count;
 
 	//Prepare arguments
 	uint32_t args_len=mi->numArgs();
@@ -706,9 +722,9 @@ int64_t Null::toInt64()
 	return 0;
 }
 
-void Null::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Null::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 		out->writeByte(amf0_null_marker);
@@ -835,20 +851,10 @@ Class_base::Class_base(const Class_object*):ASObject((MemoryAccount*)NULL),prote
  */
 void Class_base::copyBorrowedTraitsFromSuper()
 {
-	//assert(borrowedVariables.Variables.empty());
-	variables_map::var_iterator i = super->borrowedVariables.Variables.begin();
-	for(;i != super->borrowedVariables.Variables.end(); ++i)
-	{
-		variable& v = i->second;
-		if(v.var)
-			v.var->incRef();
-		if(v.getter)
-			v.getter->incRef();
-		if(v.setter)
-			v.setter->incRef();
-		v.issealed = super->isSealed;
-		borrowedVariables.Variables.insert(make_pair(i->first,v));
-	}
+	//The variables are copied with the shape, that is shared between the classes
+	borrowedVariables.copyFrom(super->borrowedVariables);
+	for(uint32_t i=0;i<borrowedVariables.size();i++)
+		borrowedVariables.getValueAt(i)->issealed = super->isSealed;
 }
 
 void Class_base::initStandardProps()
@@ -1254,35 +1260,35 @@ void Class_base::describeInstance(pugi::xml_node& root) const
 
 void Class_base::describeVariables(pugi::xml_node& root,const Class_base* c, std::map<tiny_string, pugi::xml_node*>& instanceNodes, const variables_map& map) const
 {
-	variables_map::const_var_iterator it=map.Variables.cbegin();
-	for(;it!=map.Variables.cend();++it)
+	for(uint32_t i=0;i<map.size();i++)
 	{
+		const variable& v=*map.getValueAt(i);
 		const char* nodename;
 		const char* access = NULL;
-		switch (it->second.kind)
+		switch (v.kind)
 		{
 			case CONSTANT_TRAIT:
 				nodename = "constant";
 				break;
 			case DECLARED_TRAIT:
 			case INSTANCE_TRAIT:
-				if (it->second.var)
+				if (v.var)
 					nodename="method";
 				else
 				{
 					nodename="accessor";
-					if (it->second.getter && it->second.setter)
+					if (v.getter && v.setter)
 						access = "readwrite";
-					else if (it->second.getter)
+					else if (v.getter)
 						access = "readonly";
-					else if (it->second.setter)
+					else if (v.setter)
 						access = "writeonly";
 				}
 				break;
 			default:
 				continue;
 		}
-		tiny_string name = getSystemState()->getStringFromUniqueId(it->first);
+		tiny_string name = getSystemState()->getStringFromUniqueId(map.getNameIdAt(i));
 		auto existing=instanceNodes.find(name);
 		if(existing != instanceNodes.cend())
 			continue;
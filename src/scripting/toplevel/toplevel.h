@@ -458,6 +458,7 @@ class FunctionPrototype;
 class Function : public IFunction
 {
 friend class Class<IFunction>;
+friend class Dictionary;
 public:
 	typedef ASObject* (*as_function)(ASObject*, ASObject* const *, const unsigned int);
 protected:
@@ -507,6 +508,7 @@ class SyntheticFunction : public IFunction
 {
 friend class ABCVm;
 friend class Class<IFunction>;
+friend class Dictionary;
 public:
 	typedef ASObject* (*synt_function)(call_context* cc);
 private:
@@ -654,9 +656,9 @@ public:
 	TRISTATE isLess(ASObject* r);
 	ASObject *describeType() const;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
 };
 
@@ -673,9 +675,9 @@ public:
 	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
 
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 class ASQName: public ASObject
@@ -19,7 +19,9 @@
 
 #include <string>
 #include <algorithm>
+#include <thread>
 #include "backends/security.h"
+#include "backends/sharedobjectstore.h"
 #include "scripting/abc.h"
 #include "scripting/flash/events/flashevents.h"
 #include "scripting/flash/utils/flashutils.h"
@@ -186,7 +188,8 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	parameters(NullRef),
 	invalidateQueueHead(NullRef),invalidateQueueTail(NullRef),lastUsedStringId(0),lastUsedNamespaceId(0x7fffffff),
 	showProfilingData(false),flashMode(mode),
-	currentVm(NULL),builtinClasses(NULL),useInterpreter(true),useFastInterpreter(false),useJit(false),exitOnError(ERROR_NONE),
+	currentVm(NULL),builtinClasses(NULL),useInterpreter(true),useFastInterpreter(false),useJit(false),
+	optimizationThreshold(1),jitThreshold(20),exitOnError(ERROR_NONE),
 	downloadManager(NULL),extScriptObject(NULL),scaleMode(SHOW_ALL),unaccountedMemory(NULL),tagsMemory(NULL),stringMemory(NULL)
 {
 	//Forge the builtin strings
@@ -208,6 +211,10 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	assert(nsId==1 && baseId==1);
 
 	cookiesFileName = NULL;
+#ifdef PROFILING_SUPPORT
+	decompressedBytes = 0;
+	decompressionTime = 0;
+#endif
 
 	setTLSSys(this);
 	// it seems Adobe ignores any locale date settings
@@ -254,6 +261,7 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	audioManager=NULL;
 	intervalManager=new IntervalManager();
 	securityManager=new SecurityManager();
+	sharedObjectStore=new SharedObjectStore();
 
 	_NR<LoaderInfo> loaderInfo=_MR(Class<LoaderInfo>::getInstanceS(this));
 	loaderInfo->applicationDomain = applicationDomain;
@@ -466,7 +474,17 @@ void SystemState::saveProfilingInformation()
 	if(profOut.numBytes())
 	{
 		ofstream f(profOut.raw_buf());
-		f << "events: Time" << endl;
+		if(decompressionTime)
+			f << "# decompression: " << decompressedBytes << " bytes in " << decompressionTime/1000 << " ms ("
+			  << decompressedBytes/decompressionTime << " MB/s)" << endl;
+		if(renderThread)
+		{
+			TextureStatistics stats;
+			renderThread->getTextureStatistics(stats);
+			f << "# textures: peak " << stats.peakTextures << ", released " << stats.releasedTextures
+			  << ", evicted " << stats.evictedChunks << " chunks, moved " << stats.movedChunks << " chunks" << endl;
+		}
+		f << "events: Time Boxes" << endl;
 		for(uint32_t i=0;i<contextes.size();i++)
 			contextes[i]->dumpProfilingData(f);
 		f.close();
@@ -586,6 +604,9 @@ void SystemState::destroy()
 
 	delete extScriptObject;
 	delete intervalManager;
+	//Waits for the pending shared object writes
+	delete sharedObjectStore;
+	sharedObjectStore=NULL;
 	//Finalize ourselves
 	systemFinalize();
 
@@ -1198,7 +1219,7 @@ void ThreadProfile::plot(uint32_t maxTime, cairo_t *cr)
 
 ParseThread::ParseThread(istream& in, _R<ApplicationDomain> appDomain, _R<SecurityDomain> secDomain, Loader *_loader, tiny_string srcurl)
   : version(0),applicationDomain(appDomain),securityDomain(secDomain),
-    f(in),uncompressingFilter(NULL),backend(NULL),loader(_loader),
+    f(in),uncompressingFilter(NULL),pipelinedFilter(NULL),backend(NULL),loader(_loader),
     parsedObject(NullRef),url(srcurl),fileType(FT_UNKNOWN)
 {
 	f.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
@@ -1206,7 +1227,7 @@ ParseThread::ParseThread(istream& in, _R<ApplicationDomain> appDomain, _R<Securi
 
 ParseThread::ParseThread(std::istream& in, RootMovieClip *root)
   : version(0),applicationDomain(NullRef),securityDomain(NullRef), //The domains are not needed since the system state create them itself
-    f(in),uncompressingFilter(NULL),backend(NULL),loader(NULL),
+    f(in),uncompressingFilter(NULL),pipelinedFilter(NULL),backend(NULL),loader(NULL),
     parsedObject(NullRef),url(),fileType(FT_UNKNOWN)
 {
 	f.exceptions ( istream::eofbit | istream::failbit | istream::badbit );
@@ -1219,6 +1240,8 @@ ParseThread::~ParseThread()
 	{
 		//Restore the istream
 		f.rdbuf(backend);
+		//The decompression thread reads from uncompressingFilter
+		delete pipelinedFilter;
 		delete uncompressingFilter;
 	}
 	parsedObject.reset();
@@ -1277,7 +1300,14 @@ void ParseThread::parseSWFHeader(RootMovieClip *root, UI8 ver)
 			// not reached
 			assert(false);
 		}
-		f.rdbuf(uncompressingFilter);
+		//Inflate on another thread while the tags are parsed
+		if(std::thread::hardware_concurrency()>1)
+		{
+			pipelinedFilter = new pipelined_filter(uncompressingFilter);
+			f.rdbuf(pipelinedFilter);
+		}
+		else
+			f.rdbuf(uncompressingFilter);
 		// the first 8 bytes from the header are always uncompressed (magic bytes + FileLength)
 		root->loaderInfo->setBytesTotal(FileLength-8);
 	}
@@ -1344,6 +1374,22 @@ void ParseThread::execute()
 	{
 		LOG(LOG_ERROR,_("Stream exception in ParseThread ") << e.what());
 	}
+	if(pipelinedFilter)
+		reportDecompression();
+}
+
+void ParseThread::reportDecompression()
+{
+	//Wait for the decompression thread, so that its statistics are complete
+	pipelinedFilter->stop();
+	uint64_t bytes=pipelinedFilter->getDecompressedBytes();
+	uint64_t time=pipelinedFilter->getDecompressionTime();
+	if(time)
+		LOG(LOG_INFO,_("Decompressed ") << bytes << _(" bytes in ") << time/1000 << _(" ms (") << bytes/time << _(" MB/s)"));
+#ifdef PROFILING_SUPPORT
+	getSys()->decompressedBytes+=bytes;
+	getSys()->decompressionTime+=time;
+#endif
 }
 
 void ParseThread::parseSWF(UI8 ver)
@@ -36,6 +36,7 @@
 #include "platforms/engineutils.h"
 
 class uncompressing_filter;
+class pipelined_filter;
 
 namespace lightspark
 {
@@ -53,6 +54,7 @@ class ParseThread;
 class PluginManager;
 class RenderThread;
 class SecurityManager;
+class SharedObjectStore;
 class Tag;
 class ApplicationDomain;
 class SecurityDomain;
@@ -362,6 +364,10 @@ public:
 	bool useInterpreter;
 	bool useFastInterpreter;
 	bool useJit;
+	//Number of calls and loop iterations after which a method is optimized for the fast interpreter
+	uint32_t optimizationThreshold;
+	//Number of calls and loop iterations after which an optimized method is compiled by the JIT
+	uint32_t jitThreshold;
 	ERROR_TYPE exitOnError;
 
 	//Parameters/FlashVars
@@ -397,6 +403,7 @@ public:
 	DownloadManager* downloadManager;
 	IntervalManager* intervalManager;
 	SecurityManager* securityManager;
+	SharedObjectStore* sharedObjectStore;
 	ExtScriptObject* extScriptObject;
 
 	enum SCALE_MODE { EXACT_FIT=0, NO_BORDER=1, NO_SCALE=2, SHOW_ALL=3 };
@@ -434,6 +441,9 @@ public:
 	const tiny_string& getProfilingOutput() const;
 	std::vector<ABCContext*> contextes;
 	void saveProfilingInformation();
+	//Bytes inflated by the pipelined decompression and its CPU time in microseconds
+	std::atomic<uint64_t> decompressedBytes;
+	std::atomic<uint64_t> decompressionTime;
 #endif
 	MemoryAccount* allocateMemoryAccount(const tiny_string& name) DLL_PUBLIC;
 	MemoryAccount* unaccountedMemory;
@@ -498,6 +508,8 @@ public:
 private:
 	std::istream& f;
 	uncompressing_filter* uncompressingFilter;
+	//Runs uncompressingFilter on its own thread on multi-core hosts
+	pipelined_filter* pipelinedFilter;
 	std::streambuf* backend;
 	Loader *loader;
 	_NR<DisplayObject> parsedObject;
@@ -510,6 +522,7 @@ private:
 	void parseSWF(UI8 ver);
 	void parseBitmap();
 	void setRootMovie(RootMovieClip *root);
+	void reportDecompression();
 };
 
 /* Returns the thread-specific SystemState */
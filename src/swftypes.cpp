@@ -855,18 +855,22 @@ std::istream& lightspark::operator>>(std::istream& s, FILLSTYLE& v)
 					LOG(LOG_ERROR,"Invalid bitmap ID " << bitmapId);
 					throw ParseException("Invalid ID for bitmap");
 				}
-				v.bitmap = b->getBitmap();
+				//Don't wait for the decoding here, the bitmap is resolved when rendering
+				v.bitmapTag = b;
+				v.bitmap.reset();
 			}
 			catch(RunTimeException& e)
 			{
 				//Thrown if the bitmapId does not exists in dictionary
 				LOG(LOG_ERROR,"Exception in FillStyle parsing: " << e.what());
+				v.bitmapTag = NULL;
 				v.bitmap.reset();
 			}
 		}
 		else
 		{
 			//The bitmap might be invalid, the style should not be used
+			v.bitmapTag = NULL;
 			v.bitmap.reset();
 		}
 	}
@@ -1423,8 +1427,13 @@ ASString* lightspark::abstract_s(SystemState *sys, uint32_t stringId)
 	return ret;
 }
 
+#ifdef PROFILING_SUPPORT
+std::atomic<uint64_t> lightspark::numericBoxCount(0);
+#endif
+
 ASObject* lightspark::abstract_d(SystemState* sys,number_t i)
 {
+	PROF_COUNT_BOX();
 	Number* ret=Class<Number>::getInstanceSNoArgs(sys);
 	ret->dval = i;
 	ret->isfloat = true;
@@ -1432,6 +1441,7 @@ ASObject* lightspark::abstract_d(SystemState* sys,number_t i)
 }
 ASObject* lightspark::abstract_di(SystemState* sys,int64_t i)
 {
+	PROF_COUNT_BOX();
 	Number* ret=Class<Number>::getInstanceSNoArgs(sys);
 	ret->ival = i;
 	ret->isfloat = false;
@@ -1439,6 +1449,7 @@ ASObject* lightspark::abstract_di(SystemState* sys,int64_t i)
 }
 ASObject* lightspark::abstract_i(SystemState *sys, int32_t i)
 {
+	PROF_COUNT_BOX();
 	Integer* ret=Class<Integer>::getInstanceSNoArgs(sys);
 	ret->val = i;
 	return ret;
@@ -1446,6 +1457,7 @@ ASObject* lightspark::abstract_i(SystemState *sys, int32_t i)
 
 ASObject* lightspark::abstract_ui(SystemState *sys, uint32_t i)
 {
+	PROF_COUNT_BOX();
 	UInteger* ret=Class<UInteger>::getInstanceSNoArgs(sys);
 	ret->val = i;
 	return ret;
@@ -1510,12 +1522,12 @@ QName::operator multiname() const
 	return ret;
 }
 
-FILLSTYLE::FILLSTYLE(uint8_t v):Gradient(v),version(v)
+FILLSTYLE::FILLSTYLE(uint8_t v):Gradient(v),bitmapTag(NULL),version(v)
 {
 }
 
 FILLSTYLE::FILLSTYLE(const FILLSTYLE& r):Matrix(r.Matrix),Gradient(r.Gradient),FocalGradient(r.FocalGradient),
-	bitmap(r.bitmap),Color(r.Color),FillStyleType(r.FillStyleType),version(r.version)
+	bitmap(r.bitmap),bitmapTag(r.bitmapTag),Color(r.Color),FillStyleType(r.FillStyleType),version(r.version)
 {
 }
 
@@ -1523,12 +1535,20 @@ FILLSTYLE::~FILLSTYLE()
 {
 }
 
+_NR<BitmapContainer> FILLSTYLE::getBitmap() const
+{
+	if(bitmapTag)
+		return bitmapTag->getBitmap();
+	return bitmap;
+}
+
 FILLSTYLE& FILLSTYLE::operator=(FILLSTYLE r)
 {
 	std::swap(Matrix, r.Matrix);
 	std::swap(Gradient, r.Gradient);
 	std::swap(FocalGradient, r.FocalGradient);
 	std::swap(bitmap, r.bitmap);
+	std::swap(bitmapTag, r.bitmapTag);
 	std::swap(Color, r.Color);
 	std::swap(FillStyleType, r.FillStyleType);
 	std::swap(version, r.version);
@@ -33,6 +33,7 @@
 #include "smartrefs.h"
 #include "tiny_string.h"
 #include "memory_support.h"
+#include <atomic>
 
 #ifdef BIG_ENDIAN
 #include <algorithm>
@@ -912,6 +913,7 @@ enum FILL_STYLE_TYPE { SOLID_FILL=0x00, LINEAR_GRADIENT=0x10, RADIAL_GRADIENT=0x
 			CLIPPED_BITMAP=0x41, NON_SMOOTHED_REPEATING_BITMAP=0x42, NON_SMOOTHED_CLIPPED_BITMAP=0x43};
 
 class BitmapContainer;
+class BitmapTag;
 
 class FILLSTYLE
 {
@@ -924,6 +926,11 @@ public:
 	GRADIENT Gradient;
 	FOCALGRADIENT FocalGradient;
 	_NR<BitmapContainer> bitmap;
+	//Bitmap of a style read from the SWF, it is decoded in background and
+	//resolved on first use. The tag is owned by the dictionary of its root
+	const BitmapTag* bitmapTag;
+	//Returns the bitmap of the style, waiting for it to be decoded if needed
+	_NR<BitmapContainer> getBitmap() const;
 	RGBA Color;
 	FILL_STYLE_TYPE FillStyleType;
 	uint8_t version;
@@ -1368,6 +1375,14 @@ ASObject* abstract_i(SystemState *sys, int32_t i);
 ASObject* abstract_ui(SystemState *sys, uint32_t i);
 ASObject* abstract_d(SystemState *sys, number_t i);
 ASObject* abstract_di(SystemState *sys, int64_t i);
+#ifdef PROFILING_SUPPORT
+/* Count of Integer/UInteger/Number objects created by the abstract_* helpers,
+ * used to attribute boxing cost to single ABC instructions */
+extern std::atomic<uint64_t> numericBoxCount;
+#define PROF_COUNT_BOX() numericBoxCount.fetch_add(1,std::memory_order_relaxed)
+#else
+#define PROF_COUNT_BOX()
+#endif
 ASString* abstract_s(SystemState *sys);
 ASString* abstract_s(SystemState *sys, const char* s, uint32_t len);
 ASString* abstract_s(SystemState *sys, const char* s);
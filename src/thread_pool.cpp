@@ -17,62 +17,164 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
 #include <cassert>
+#include <thread>
 
 #include "thread_pool.h"
 #include "exceptions.h"
 #include "compat.h"
 #include "logger.h"
 #include "swf.h"
+#include "backends/config.h"
 
 using namespace lightspark;
 
-ThreadPool::ThreadPool(SystemState* s):num_jobs(0),stopFlag(false)
+/* Workers above the configured size exit when they are idle for this
+ * many milliseconds */
+#define IDLE_THREAD_TIMEOUT 10000
+/* One job every PRIORITY_AGING is taken from the lowest priority queue
+ * which is not empty */
+#define PRIORITY_AGING 4
+
+DEFINE_AND_INITIALIZE_TLS(tls_worker);
+
+bool WorkStealingDeque::push(IThreadJob* j)
+{
+	int64_t b=bottom.load(std::memory_order_relaxed);
+	int64_t t=top.load(std::memory_order_acquire);
+	if(b-t>=WORKER_DEQUE_SIZE)
+		return false;
+	buffer[b%WORKER_DEQUE_SIZE].store(j,std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b+1,std::memory_order_relaxed);
+	return true;
+}
+
+IThreadJob* WorkStealingDeque::pop()
 {
-	m_sys=s;
-	for(uint32_t i=0;i<NUM_THREADS;i++)
+	int64_t b=bottom.load(std::memory_order_relaxed)-1;
+	bottom.store(b,std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t=top.load(std::memory_order_relaxed);
+	if(t>b)
 	{
-		curJobs[i]=NULL;
+		//The deque is empty
+		bottom.store(b+1,std::memory_order_relaxed);
+		return NULL;
+	}
+	IThreadJob* ret=buffer[b%WORKER_DEQUE_SIZE].load(std::memory_order_relaxed);
+	if(t==b)
+	{
+		//This is the last job, the thieves may be taking it too
+		if(!top.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,std::memory_order_relaxed))
+			ret=NULL;
+		bottom.store(b+1,std::memory_order_relaxed);
+	}
+	return ret;
+}
+
+IThreadJob* WorkStealingDeque::steal()
+{
+	int64_t t=top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b=bottom.load(std::memory_order_acquire);
+	if(t>=b)
+		return NULL;
+	IThreadJob* ret=buffer[t%WORKER_DEQUE_SIZE].load(std::memory_order_relaxed);
+	if(!top.compare_exchange_strong(t,t+1,std::memory_order_seq_cst,std::memory_order_relaxed))
+		return NULL;
+	return ret;
+}
+
+bool WorkStealingDeque::empty() const
+{
+	return top.load(std::memory_order_acquire)>=bottom.load(std::memory_order_acquire);
+}
+
+ThreadPool::ThreadPool(SystemState* s, uint32_t numThreads):queuedJobs(0),dequeJobs(0),runningThreads(0),idleThreads(0),picks(0),
+	m_sys(s),stopFlag(false)
+{
+	if(numThreads==0)
+		numThreads=Config::getConfig()->getThreadPoolSize();
+	if(numThreads==0)
+		numThreads=std::thread::hardware_concurrency();
+	//hardware_concurrency may not be able to tell
+	if(numThreads==0)
+		numThreads=4;
+	baseThreads=std::min(numThreads,(uint32_t)MAX_THREADS);
+	for(uint32_t i=0;i<MAX_THREADS;i++)
+		workers[i].pool=this;
+	//Workers are started by addJob when they are needed
+}
+
+void ThreadPool::spawnWorker()
+{
+	for(uint32_t i=0;i<MAX_THREADS;i++)
+	{
+		Worker& w=workers[i];
+		if(w.running)
+			continue;
+		//The previous worker of this slot has exited after being idle
+		if(w.thread)
+			w.thread->join();
+		w.running=true;
+		runningThreads++;
 #ifdef HAVE_NEW_GLIBMM_THREAD_API
-		threads[i] = Thread::create(sigc::bind(&job_worker,this,i));
+		w.thread = Thread::create(sigc::bind(&job_worker,&w,i));
 #else
-		threads[i] = Thread::create(sigc::bind(&job_worker,this,i),true);
+		w.thread = Thread::create(sigc::bind(&job_worker,&w,i),true);
 #endif
-		
+		return;
 	}
 }
 
 void ThreadPool::forceStop()
 {
-	if(!stopFlag)
+	if(stopFlag.exchange(true))
+		return;
+
 	{
-		stopFlag=true;
+		Locker l(mutex);
 		//Signal an event for all the threads
-		for(int i=0;i<NUM_THREADS;i++)
-			num_jobs.signal();
-
+		jobAvailable.broadcast();
+		//Fence all the non executed jobs
+		for(int i=0;i<JOB_PRIORITY_COUNT;i++)
 		{
-			Locker l(mutex);
-			//Now abort any job that is still executing
-			for(int i=0;i<NUM_THREADS;i++)
-			{
-				if(curJobs[i])
-				{
-					curJobs[i]->threadAborting = true;
-					curJobs[i]->threadAbort();
-				}
-			}
-			//Fence all the non executed jobs
-			std::deque<IThreadJob*>::iterator it=jobs.begin();
-			for(;it!=jobs.end();++it)
+			std::deque<IThreadJob*>::iterator it=jobs[i].begin();
+			for(;it!=jobs[i].end();++it)
 				(*it)->jobFence();
-			jobs.clear();
+			jobs[i].clear();
 		}
+		queuedJobs=0;
+	}
 
-		for(int i=0;i<NUM_THREADS;i++)
+	//Now abort any job that is still executing
+	for(int i=0;i<MAX_THREADS;i++)
+	{
+		Locker l(workers[i].jobMutex);
+		if(workers[i].curJob)
 		{
-			threads[i]->join();
+			workers[i].curJob->threadAborting = true;
+			workers[i].curJob->threadAbort();
 		}
 	}
+
+	for(int i=0;i<MAX_THREADS;i++)
+	{
+		if(workers[i].thread)
+		{
+			workers[i].thread->join();
+			workers[i].thread=NULL;
+		}
+	}
+
+	//No worker is left, fence the jobs they had queued for themselves
+	for(int i=0;i<MAX_THREADS;i++)
+	{
+		IThreadJob* j;
+		while((j=workers[i].deque.steal())!=NULL)
+			j->jobFence();
+	}
+	dequeJobs=0;
 }
 
 ThreadPool::~ThreadPool()
@@ -80,33 +182,122 @@ ThreadPool::~ThreadPool()
 	forceStop();
 }
 
-void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
+IThreadJob* ThreadPool::popQueuedJob()
 {
+	if(queuedJobs==0)
+		return NULL;
+	//Higher priority jobs are taken first, but from time to time the
+	//lowest priority waiting job goes first so that it is not starved
+	bool aging=(++picks%PRIORITY_AGING)==0;
+	for(int i=0;i<JOB_PRIORITY_COUNT;i++)
+	{
+		std::deque<IThreadJob*>& queue=jobs[aging ? JOB_PRIORITY_COUNT-1-i : i];
+		if(queue.empty())
+			continue;
+		IThreadJob* ret=queue.front();
+		queue.pop_front();
+		queuedJobs--;
+		return ret;
+	}
+	return NULL;
+}
+
+IThreadJob* ThreadPool::stealJob(uint32_t index)
+{
+	for(uint32_t i=1;i<=MAX_THREADS;i++)
+	{
+		Worker& victim=workers[(index+i)%MAX_THREADS];
+		IThreadJob* ret=victim.deque.steal();
+		if(ret)
+		{
+			dequeJobs--;
+			return ret;
+		}
+	}
+	return NULL;
+}
+
+IThreadJob* ThreadPool::takeJob(uint32_t index)
+{
+	Worker& w=workers[index];
+	//The most recent job added by this worker is the most likely to be cache hot
+	IThreadJob* ret=w.deque.pop();
+	if(ret)
+	{
+		dequeJobs--;
+		return ret;
+	}
+
+	Locker l(mutex);
+	while(!stopFlag)
+	{
+		ret=popQueuedJob();
+		if(ret)
+			return ret;
+		if(dequeJobs>0)
+		{
+			//Stealing does not need the lock
+			l.release();
+			ret=stealJob(index);
+			l.acquire();
+			if(ret)
+				return ret;
+			continue;
+		}
+
+		idleThreads++;
+		CondTime timeout(IDLE_THREAD_TIMEOUT);
+		bool signaled=timeout.wait(mutex,jobAvailable);
+		idleThreads--;
+		if(!signaled && queuedJobs==0 && dequeJobs==0 && runningThreads>baseThreads)
+		{
+			//This worker is not needed anymore, addJob will join it
+			w.running=false;
+			runningThreads--;
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+void ThreadPool::job_worker(Worker* w, uint32_t index)
+{
+	ThreadPool* th=w->pool;
 	setTLSSys(th->m_sys);
+	tls_set(&tls_worker,w);
 
-	ThreadProfile* profile=th->m_sys->allocateProfiler(RGB(200,200,0));
-	char buf[16];
-	snprintf(buf,16,"Thread %u",index);
-	profile->setTag(buf);
+	//Workers started again in the same slot reuse the profiler
+	if(w->profile==NULL)
+	{
+		w->profile=th->m_sys->allocateProfiler(RGB(200,200,0));
+		char buf[16];
+		snprintf(buf,16,"Thread %u",index);
+		w->profile->setTag(buf);
+	}
 
 	Chronometer chronometer;
 	while(1)
 	{
-		th->num_jobs.wait();
-		if(th->stopFlag)
+		IThreadJob* myJob=th->takeJob(index);
+		if(myJob==NULL)
 			return;
-		Locker l(th->mutex);
-		IThreadJob* myJob=th->jobs.front();
-		th->jobs.pop_front();
-		th->curJobs[index]=myJob;
+		Locker l(w->jobMutex);
+		w->curJob=myJob;
 		l.release();
 
+		// it's possible that a job was taken while forcestop() has been called
+		if(th->stopFlag)
+		{
+			l.acquire();
+			w->curJob=NULL;
+			l.release();
+			myJob->jobFence();
+			return;
+		}
+
 		chronometer.checkpoint();
 		try
 		{
-			// it's possible that a job was added and will be executed while forcestop() has been called
-			if(th->stopFlag)
-				return;
 			myJob->execute();
 		}
 	        catch(JobTerminationException& ex)
@@ -118,10 +309,10 @@ void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
 			LOG(LOG_ERROR,_("Exception in ThreadPool ") << e.what());
 			th->m_sys->setError(e.cause);
 		}
-		profile->accountTime(chronometer.checkpoint());
+		w->profile->accountTime(chronometer.checkpoint());
 
 		l.acquire();
-		th->curJobs[index]=NULL;
+		w->curJob=NULL;
 		l.release();
 
 		//jobFencing is allowed to happen outside the mutex
@@ -131,14 +322,38 @@ void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
 
 void ThreadPool::addJob(IThreadJob* j)
 {
+	assert(j);
+	assert(j->getPriority()<JOB_PRIORITY_COUNT);
+	//Jobs added by a worker go to its own deque, idle workers steal them
+	//from there. High priority jobs must not wait behind them
+	Worker* w=(Worker*)tls_get(&tls_worker);
+	bool inDeque=false;
+	if(w && w->pool==this && !stopFlag && j->getPriority()!=JOB_PRIORITY_HIGH)
+	{
+		//Count the job before publishing it, a thief may take and
+		//uncount it before push returns
+		dequeJobs++;
+		inDeque=w->deque.push(j);
+		if(!inDeque)
+			dequeJobs--;
+	}
+
 	Locker l(mutex);
 	if(stopFlag)
 	{
-		j->jobFence();
+		//Jobs in the deques are fenced by forceStop
+		if(!inDeque)
+			j->jobFence();
 		return;
 	}
-	assert(j);
-	jobs.push_back(j);
-	num_jobs.signal();
+	if(!inDeque)
+	{
+		jobs[j->getPriority()].push_back(j);
+		queuedJobs++;
+	}
+	//Jobs may block for a long time, so start a new worker when the idle
+	//ones are not enough
+	if(queuedJobs+dequeJobs>idleThreads && runningThreads<MAX_THREADS)
+		spawnWorker();
+	jobAvailable.signal();
 }
-
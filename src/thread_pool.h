@@ -23,28 +23,85 @@
 #include "compat.h"
 #include <deque>
 #include <cstdlib>
+#include <atomic>
 #include "threading.h"
 
 namespace lightspark
 {
 
-#define NUM_THREADS 20
+/* Upper bound of the worker threads. Jobs may block for a long time
+ * (downloads, sockets, streams), so more workers than the configured
+ * size are started when all of them are busy */
+#define MAX_THREADS 64
+/* Capacity of the deque of each worker, jobs which do not fit are queued
+ * in the shared queues */
+#define WORKER_DEQUE_SIZE 256
 
 class SystemState;
+class ThreadProfile;
+
+/*
+ * Chase-Lev work stealing deque of fixed size. Only the owner pushes and
+ * pops at the bottom, any thread can steal the oldest job from the top.
+ */
+class WorkStealingDeque
+{
+private:
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	std::atomic<IThreadJob*> buffer[WORKER_DEQUE_SIZE];
+public:
+	WorkStealingDeque():top(0),bottom(0){}
+	//Returns false if the deque is full
+	bool push(IThreadJob* j);
+	IThreadJob* pop();
+	//May fail when racing with other thieves or with the owner
+	IThreadJob* steal();
+	bool empty() const;
+};
 
 class ThreadPool
 {
 private:
+	struct Worker
+	{
+		ThreadPool* pool;
+		Thread* thread;
+		ThreadProfile* profile;
+		//Protects curJob, so that jobs are not aborted after being fenced
+		Mutex jobMutex;
+		IThreadJob* curJob;
+		//Jobs added by the worker itself
+		WorkStealingDeque deque;
+		//False when the thread has exited and can be joined
+		bool running;
+		Worker():pool(NULL),thread(NULL),profile(NULL),curJob(NULL),running(false){}
+	};
 	Mutex mutex;
-	Thread* threads[NUM_THREADS];
-	IThreadJob* volatile curJobs[NUM_THREADS];
-	std::deque<IThreadJob*> jobs;
-	Semaphore num_jobs;
-	static void job_worker(ThreadPool* th, uint32_t threadIndex);
+	Cond jobAvailable;
+	Worker workers[MAX_THREADS];
+	//Jobs added from outside the workers, one queue for each priority
+	std::deque<IThreadJob*> jobs[JOB_PRIORITY_COUNT];
+	uint32_t queuedJobs;
+	//Number of jobs waiting in the deques of the workers
+	std::atomic<uint32_t> dequeJobs;
+	//Workers that are kept alive when there is nothing to do
+	uint32_t baseThreads;
+	uint32_t runningThreads;
+	uint32_t idleThreads;
+	//Used to give a share of the threads to lower priority jobs
+	uint32_t picks;
+	static void job_worker(Worker* w, uint32_t threadIndex);
+	void spawnWorker();
+	IThreadJob* popQueuedJob();
+	IThreadJob* stealJob(uint32_t threadIndex);
+	IThreadJob* takeJob(uint32_t threadIndex);
 	SystemState* m_sys;
-	volatile bool stopFlag;
+	std::atomic<bool> stopFlag;
 public:
-	ThreadPool(SystemState* s);
+	/* The pool keeps up to numThreads idle workers alive, 0 means the
+	 * number of hardware threads or the configured size */
+	ThreadPool(SystemState* s, uint32_t numThreads=0);
 	~ThreadPool();
 	void addJob(IThreadJob* j);
 	void forceStop();
@@ -57,10 +57,14 @@ typedef Mutex::Lock SpinlockLocker;
 
 #if GLIB_CHECK_VERSION(2, 31, 0)
 #define DEFINE_AND_INITIALIZE_TLS(name) static GPrivate (name)
+//notify is called on the value when the thread exits
+#define DEFINE_AND_INITIALIZE_TLS_WITH_NOTIFY(name, notify) static GPrivate (name) = G_PRIVATE_INIT(notify)
 void tls_set(GPrivate *key, gpointer value);
 gpointer tls_get(GPrivate *key);
 #else
 #define DEFINE_AND_INITIALIZE_TLS(name) static GStaticPrivate (name) = G_STATIC_PRIVATE_INIT
+//The old API does not support notify functions, the value is leaked
+#define DEFINE_AND_INITIALIZE_TLS_WITH_NOTIFY(name, notify) DEFINE_AND_INITIALIZE_TLS(name)
 void tls_set(GStaticPrivate *key, gpointer value);
 gpointer tls_get(GStaticPrivate *key);
 #endif
@@ -100,6 +104,12 @@ public:
 	}
 };
 
+/*
+ * Jobs with an higher priority are started first by the ThreadPool, lower
+ * priority jobs still get a share of the threads so they are not starved
+ */
+enum JOB_PRIORITY { JOB_PRIORITY_HIGH=0, JOB_PRIORITY_NORMAL, JOB_PRIORITY_LOW, JOB_PRIORITY_COUNT };
+
 class IThreadJob
 {
 friend class ThreadPool;
@@ -133,6 +143,11 @@ public:
 	 * 'delete this'.
 	 */
 	virtual void jobFence()=0;
+	/*
+	 * Used by the ThreadPool to order the jobs which are waiting
+	 * for a free thread.
+	 */
+	virtual JOB_PRIORITY getPriority() const { return JOB_PRIORITY_NORMAL; }
 	IThreadJob() : threadAborting(false) {}
 	virtual ~IThreadJob() {}
 };
@@ -209,6 +224,86 @@ public:
 
 };
 
+class MPSCNode
+{
+public:
+	std::atomic<MPSCNode*> next;
+	MPSCNode():next(NULL){}
+};
+
+/*
+ * Unbounded lock-free queue with many producers and a single consumer, using
+ * Vyukov's algorithm. Elements must derive from MPSCNode and are not copied.
+ * push is wait-free and can be called from any thread, pop and isEmpty only
+ * from the consumer thread
+ */
+template<class T>
+class MPSCQueue
+{
+private:
+	//The last pushed node, shared by the producers
+	std::atomic<MPSCNode*> head;
+	//The next node to pop, owned by the consumer
+	MPSCNode* tail;
+	MPSCNode stub;
+	void pushNode(MPSCNode* n)
+	{
+		n->next.store(NULL, std::memory_order_relaxed);
+		MPSCNode* prev=head.exchange(n);
+		//Between the exchange and this store the node is not reachable from tail yet
+		prev->next.store(n, std::memory_order_release);
+	}
+public:
+	MPSCQueue():head(&stub),tail(&stub)
+	{
+	}
+	void push(T* n)
+	{
+		pushNode(n);
+	}
+	/*
+	 * Returns NULL if the queue is empty or if the only pushed
+	 * element is not completely linked yet
+	 */
+	T* pop()
+	{
+		MPSCNode* t=tail;
+		MPSCNode* next=t->next.load(std::memory_order_acquire);
+		if(t==&stub)
+		{
+			if(next==NULL)
+				return NULL;
+			tail=next;
+			t=next;
+			next=next->next.load(std::memory_order_acquire);
+		}
+		if(next)
+		{
+			tail=next;
+			return static_cast<T*>(t);
+		}
+		if(t!=head.load())
+			return NULL;
+		//t is the last node, push the stub behind it to be able to unlink it
+		pushNode(&stub);
+		next=t->next.load(std::memory_order_acquire);
+		if(next)
+		{
+			tail=next;
+			return static_cast<T*>(t);
+		}
+		return NULL;
+	}
+	/*
+	 * False as soon as a producer has started pushing, even if pop
+	 * can not return the element yet
+	 */
+	bool isEmpty() const
+	{
+		return tail==&stub && head.load()==&stub;
+	}
+};
+
 // This class represents the end time when waiting on a conditional
 // variable. It encapsulates the differences between new and old
 // glibmm API.
@@ -18,6 +18,8 @@
 **************************************************************************/
 
 #include "scripting/abc.h"
+#include "backends/streamcache.h"
+#include "backends/headless.h"
 
 #include <fstream>
 #ifndef _WIN32
@@ -36,9 +38,20 @@ int main(int argc, char* argv[])
 {
 	std::vector<char*> fileNames;
 	bool useInterpreter=true;
+	bool useFastInterpreter=false;
 	bool useJit=false;
+	int optimizationThreshold=-1;
+	int jitThreshold=-1;
 	LOG_LEVEL log_level=LOG_INFO;
 	bool error=false;
+	//Headless rendering is enabled when a frame count is given
+	uint32_t renderFrames=0;
+	uint32_t renderWidth=550;
+	uint32_t renderHeight=400;
+	float renderFrameRate=0;
+	HeadlessRenderer::DUMP_FORMAT dumpFormat=HeadlessRenderer::DUMP_PNG;
+	char* dumpDir=NULL;
+	char* frameTimesFile=NULL;
 
 	for(int i=1;i<argc;i++)
 	{
@@ -47,11 +60,38 @@ int main(int argc, char* argv[])
 		{
 			useInterpreter=false;
 		}
+		else if(strcmp(argv[i],"-fi")==0 || 
+			strcmp(argv[i],"--enable-fast-interpreter")==0)
+		{
+			useFastInterpreter=true;
+		}
 		else if(strcmp(argv[i],"-j")==0 || 
 			strcmp(argv[i],"--enable-jit")==0)
 		{
 			useJit=true;
 		}
+		else if(strcmp(argv[i],"-t")==0 || 
+			strcmp(argv[i],"--tiered")==0)
+		{
+			useInterpreter=true;
+			useFastInterpreter=true;
+			useJit=true;
+		}
+		else if(strcmp(argv[i],"--optimization-threshold")==0 ||
+			strcmp(argv[i],"--jit-threshold")==0)
+		{
+			bool jit=strcmp(argv[i],"--jit-threshold")==0;
+			i++;
+			if(i==argc)
+			{
+				error=true;
+				break;
+			}
+			if(jit)
+				jitThreshold=atoi(argv[i]);
+			else
+				optimizationThreshold=atoi(argv[i]);
+		}
 		else if(strcmp(argv[i],"-l")==0 || 
 			strcmp(argv[i],"--log-level")==0)
 		{
@@ -64,6 +104,50 @@ int main(int argc, char* argv[])
 
 			log_level=(LOG_LEVEL)atoi(argv[i]);
 		}
+		else if(strcmp(argv[i],"--render-frames")==0 ||
+			strcmp(argv[i],"--render-size")==0 ||
+			strcmp(argv[i],"--frame-rate")==0 ||
+			strcmp(argv[i],"--dump-frames")==0 ||
+			strcmp(argv[i],"--dump-format")==0 ||
+			strcmp(argv[i],"--frame-times")==0)
+		{
+			const char* option=argv[i];
+			i++;
+			if(i==argc)
+			{
+				error=true;
+				break;
+			}
+
+			if(strcmp(option,"--render-frames")==0)
+				renderFrames=atoi(argv[i]);
+			else if(strcmp(option,"--render-size")==0)
+			{
+				if(sscanf(argv[i],"%ux%u",&renderWidth,&renderHeight)!=2 || renderWidth==0 || renderHeight==0)
+				{
+					error=true;
+					break;
+				}
+			}
+			else if(strcmp(option,"--frame-rate")==0)
+				renderFrameRate=atof(argv[i]);
+			else if(strcmp(option,"--dump-frames")==0)
+				dumpDir=argv[i];
+			else if(strcmp(option,"--dump-format")==0)
+			{
+				if(strcmp(argv[i],"png")==0)
+					dumpFormat=HeadlessRenderer::DUMP_PNG;
+				else if(strcmp(argv[i],"raw")==0)
+					dumpFormat=HeadlessRenderer::DUMP_RAW;
+				else
+				{
+					error=true;
+					break;
+				}
+			}
+			else
+				frameTimesFile=argv[i];
+		}
 		else
 		{
 			//More than a file is allowed in tightspark
@@ -73,7 +157,10 @@ int main(int argc, char* argv[])
 
 	if(fileNames.empty() || error)
 	{
-		LOG(LOG_ERROR, "Usage: " << argv[0] << " [--disable-interpreter|-ni] [--enable-jit|-j] [--log-level|-l 0-4] <file.abc> [<file2.abc>]");
+		LOG(LOG_ERROR, "Usage: " << argv[0] << " [--disable-interpreter|-ni] [--enable-fast-interpreter|-fi] [--enable-jit|-j]" <<
+			" [--tiered|-t] [--optimization-threshold count] [--jit-threshold count]" <<
+			" [--log-level|-l 0-4] [--render-frames count] [--render-size WxH] [--frame-rate fps]" <<
+			" [--dump-frames dir] [--dump-format png|raw] [--frame-times file] <file.abc> [<file2.abc>]");
 		exit(-1);
 	}
 #ifdef HAVE_G_THREAD_INIT
@@ -93,9 +180,16 @@ int main(int argc, char* argv[])
 		exit(-1);
 	}
 	sys->useInterpreter=useInterpreter;
+	sys->useFastInterpreter=useFastInterpreter;
 	sys->useJit=useJit;
+	if(optimizationThreshold>=0)
+		sys->optimizationThreshold=optimizationThreshold;
+	if(jitThreshold>=0)
+		sys->jitThreshold=jitThreshold;
 
 	sys->mainClip->setOrigin(string("file://") + fileNames[0]);
+	if(renderFrames)
+		sys->mainClip->setFrameSize(RECT(0,renderWidth*20,0,renderHeight*20));
 
 #ifndef _WIN32
 	struct rlimit rl;
@@ -111,21 +205,44 @@ int main(int argc, char* argv[])
 	vector<ABCContext*> contexts;
 	for(unsigned int i=0;i<fileNames.size();i++)
 	{
-		ifstream f(fileNames[i]);
-		if(f.is_open())
+		//Read the ABC from the pages of the file when it can be mapped
+		_R<MemoryStreamCache> mappedFile(_MR(new MemoryStreamCache(sys)));
+		streambuf* mappedBuf=NULL;
+		ifstream file;
+		if(mappedFile->mapFile(fileNames[i]))
+			mappedBuf=mappedFile->createReader();
+		else
+			file.open(fileNames[i]);
+		istream f(mappedBuf ? mappedBuf : file.rdbuf());
+		if(mappedBuf || file.is_open())
 		{
 			sys->mainClip->incRef();
 			ABCContext* context=new ABCContext(_MR(sys->mainClip), f, vm);
 			contexts.push_back(context);
-			f.close();
 			vm->addEvent(NullRef,_MR(new (sys->unaccountedMemory) ABCContextInitEvent(context,false)));
 		}
 		else
 		{
 			LOG(LOG_ERROR, fileNames[i] << _(" could not be opened for execution"));
 		}
+		delete mappedBuf;
 	}
 	vm->start();
+	if(renderFrames)
+	{
+		//Render the display list without a window, for regression tests and benchmarks
+		HeadlessRenderer renderer(sys, renderWidth, renderHeight);
+		renderer.setFrameRate(renderFrameRate);
+		if(dumpDir)
+			renderer.setDumpFrames(dumpFormat, dumpDir);
+		renderer.run(renderFrames);
+		renderer.logStatistics();
+		if(frameTimesFile)
+		{
+			ofstream out(frameTimesFile);
+			renderer.writeFrameTimes(out);
+		}
+	}
 	sys->setShutdownFlag();
 	sys->destroy();
 	delete sys;
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <ostream>
 #include <list>
+#include <functional>
 /* for utf8 handling */
 #include <glib.h>
 #include <glibmm/ustring.h>
@@ -217,7 +218,23 @@ public:
 	CharIterator end();
 	CharIterator end() const;
 	int compare(const tiny_string& r) const;
+	/* FNV-1a hash of the bytes, to key hash tables */
+	size_t hash() const
+	{
+		size_t h = 2166136261u;
+		for (uint32_t i = 0; i < stringSize-1; i++)
+			h = (h ^ (uint8_t)buf[i]) * 16777619u;
+		return h;
+	}
+};
+
 };
 
+namespace std
+{
+template<> struct hash<lightspark::tiny_string>
+{
+	size_t operator()(const lightspark::tiny_string& s) const { return s.hash(); }
 };
+}
 #endif /* TINY_STRING_H */